@@ -0,0 +1,205 @@
+;------------------------------------------------------------------------------
+;
+; SHA-256 block function using the ARMv8 cryptography extensions. The
+; caller checks ID_AA64ISAR0_EL1 before selecting it.
+;
+; State is kept as ABCD in v0 and EFGH in v1, the round constants in
+; v16-v31 and the message schedule in v4-v7.
+;
+;------------------------------------------------------------------------------
+
+  EXPORT AcpiSha256ReadIsar0
+  EXPORT AcpiSha256BlocksAccel
+  AREA |.text|, CODE, READONLY, ALIGN=4
+
+;------------------------------------------------------------------------------
+; UINT64
+; EFIAPI
+; AcpiSha256ReadIsar0 (
+;   VOID
+;   );
+;------------------------------------------------------------------------------
+AcpiSha256ReadIsar0
+  mrs       x0, ID_AA64ISAR0_EL1
+  ret
+
+;------------------------------------------------------------------------------
+; VOID
+; EFIAPI
+; AcpiSha256BlocksAccel (
+;   IN OUT UINT32       *State,     ; x0
+;   IN     CONST UINT8  *Data,      ; x1
+;   IN     UINTN        Blocks      ; x2
+;   );
+;------------------------------------------------------------------------------
+AcpiSha256BlocksAccel
+  cbz       x2, Sha256Done
+  adr       x8, mSha256K
+  ld1       {v16.4s-v19.4s}, [x8], #64
+  ld1       {v20.4s-v23.4s}, [x8], #64
+  ld1       {v24.4s-v27.4s}, [x8], #64
+  ld1       {v28.4s-v31.4s}, [x8]
+
+  ; d8 and d9 are callee-saved
+  stp       d8, d9, [sp, #-16]!
+  ld1       {v0.4s, v1.4s}, [x0]
+
+Sha256Block
+  ld1       {v4.16b-v7.16b}, [x1], #64
+  rev32     v4.16b, v4.16b
+  rev32     v5.16b, v5.16b
+  rev32     v6.16b, v6.16b
+  rev32     v7.16b, v7.16b
+  mov       v8.16b, v0.16b
+  mov       v9.16b, v1.16b
+
+  ; Rounds 0-3
+  add       v3.4s, v4.4s, v16.4s
+  sha256su0 v4.4s, v5.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v4.4s, v6.4s, v7.4s
+
+  ; Rounds 4-7
+  add       v3.4s, v5.4s, v17.4s
+  sha256su0 v5.4s, v6.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v5.4s, v7.4s, v4.4s
+
+  ; Rounds 8-11
+  add       v3.4s, v6.4s, v18.4s
+  sha256su0 v6.4s, v7.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v6.4s, v4.4s, v5.4s
+
+  ; Rounds 12-15
+  add       v3.4s, v7.4s, v19.4s
+  sha256su0 v7.4s, v4.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v7.4s, v5.4s, v6.4s
+
+  ; Rounds 16-19
+  add       v3.4s, v4.4s, v20.4s
+  sha256su0 v4.4s, v5.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v4.4s, v6.4s, v7.4s
+
+  ; Rounds 20-23
+  add       v3.4s, v5.4s, v21.4s
+  sha256su0 v5.4s, v6.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v5.4s, v7.4s, v4.4s
+
+  ; Rounds 24-27
+  add       v3.4s, v6.4s, v22.4s
+  sha256su0 v6.4s, v7.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v6.4s, v4.4s, v5.4s
+
+  ; Rounds 28-31
+  add       v3.4s, v7.4s, v23.4s
+  sha256su0 v7.4s, v4.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v7.4s, v5.4s, v6.4s
+
+  ; Rounds 32-35
+  add       v3.4s, v4.4s, v24.4s
+  sha256su0 v4.4s, v5.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v4.4s, v6.4s, v7.4s
+
+  ; Rounds 36-39
+  add       v3.4s, v5.4s, v25.4s
+  sha256su0 v5.4s, v6.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v5.4s, v7.4s, v4.4s
+
+  ; Rounds 40-43
+  add       v3.4s, v6.4s, v26.4s
+  sha256su0 v6.4s, v7.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v6.4s, v4.4s, v5.4s
+
+  ; Rounds 44-47
+  add       v3.4s, v7.4s, v27.4s
+  sha256su0 v7.4s, v4.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+  sha256su1 v7.4s, v5.4s, v6.4s
+
+  ; Rounds 48-51
+  add       v3.4s, v4.4s, v28.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+
+  ; Rounds 52-55
+  add       v3.4s, v5.4s, v29.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+
+  ; Rounds 56-59
+  add       v3.4s, v6.4s, v30.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+
+  ; Rounds 60-63
+  add       v3.4s, v7.4s, v31.4s
+  mov       v2.16b, v0.16b
+  sha256h   q0, q1, v3.4s
+  sha256h2  q1, q2, v3.4s
+
+  add       v0.4s, v0.4s, v8.4s
+  add       v1.4s, v1.4s, v9.4s
+  subs      x2, x2, #1
+  b.ne      Sha256Block
+
+  st1       {v0.4s, v1.4s}, [x0]
+  ldp       d8, d9, [sp], #16
+Sha256Done
+  ret
+
+  ALIGN 16
+mSha256K
+  DCD       0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5
+  DCD       0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5
+  DCD       0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3
+  DCD       0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174
+  DCD       0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc
+  DCD       0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da
+  DCD       0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7
+  DCD       0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967
+  DCD       0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13
+  DCD       0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85
+  DCD       0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3
+  DCD       0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070
+  DCD       0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5
+  DCD       0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3
+  DCD       0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208
+  DCD       0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+
+  END
@@ -7,43 +7,26 @@
 #include <Guid/Acpi.h>
 #include <Guid/FileInfo.h>
 
+#include "ACPIPatcher.h"
+#include "AcpiInstall.h"
+#include "AcpiConsolidate.h"
+#include "AcpiSource.h"
+#include "AcpiDeadline.h"
+#include "AcpiState.h"
+#include "AcpiManifest.h"
+#include "AcpiHistory.h"
+#include "AcpiFpdt.h"
+#include "AcpiAml.h"
+#include "AcpiDelta.h"
+#include "AcpiNvStore.h"
+#include "AcpiReadTune.h"
 #include "FsHelpers.h"
-
-//
-// Constants
-//
-#define ACPI_PATCHER_VERSION_MAJOR    1
-#define ACPI_PATCHER_VERSION_MINOR    1
-#define MAX_ADDITIONAL_TABLES         16
-#define FILE_NAME_BUFFER_SIZE         512
-#define DSDT_FILE_NAME                L"DSDT.aml"
-
-//
-// Debug levels
-//
-#define DEBUG_ERROR   1
-#define DEBUG_WARN    2
-#define DEBUG_INFO    3
-#define DEBUG_VERBOSE 4
-
-#ifndef DEBUG_LEVEL
-#define DEBUG_LEVEL DEBUG_INFO  // Default debug level
-#endif
-
-//
-// Helper macros
-//
-#ifndef MIN
-#define MIN(a, b) (((a) < (b)) ? (a) : (b))
-#endif
-
-// Safe pointer to integer conversion for debug output
-#ifdef MDE_CPU_IA32
-#define PTR_TO_INT(ptr) ((UINT32)(UINTN)(ptr))
-#define PTR_FMT L"0x%x"
-#else
-#define PTR_TO_INT(ptr) ((UINT64)(UINTN)(ptr))
-#define PTR_FMT L"0x%llx"
+#include "FatReader.h"
+#include "AcpiLog.h"
+#include "AcpiPerf.h"
+#include "AcpiMemory.h"
+#ifdef DXE
+#include "AcpiHook.h"
 #endif
 
 //
@@ -54,40 +37,14 @@ EFI_ACPI_SDT_HEADER                                 *gXsdt      = NULL;
 EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE           *gFacp      = NULL;
 UINT64                                              gXsdtEnd    = 0;
 BOOLEAN                                             gIsEfi1x    = FALSE;
+ACPI_PATCHER_OPTIONS                                gOptions    = { FALSE, 0, DEBUG_LEVEL, { 0 }, FALSE, ACPI_PATCHER_CONSOLIDATE, ACPI_PATCHER_DIRECT_FAT, ACPI_PATCHER_READ_STRATEGY, FALSE, FALSE, ACPI_PATCHER_VERIFY, ACPI_PATCHER_DEADLINE_MS, 0, { 0 } };
 
 #ifndef DXE
 #include <Library/PrintLib.h>
+#include "AcpiIoSim.h"
 #define MAX_PRINT_BUFFER (80 * 4)
 #endif
 
-//
-// Function Declarations
-//
-VOID
-AcpiDebugPrint (
-  IN UINTN         Level,
-  IN CONST CHAR16  *Format,
-  ...
-  );
-
-VOID
-HexDump (
-  IN VOID    *Data,
-  IN UINTN   Size,
-  IN UINTN   Address
-  );
-
-EFI_STATUS
-ValidateAcpiTable (
-  IN VOID    *TableBuffer,
-  IN UINTN   BufferSize
-  );
-
-BOOLEAN
-DetectEfiFirmwareVersion (
-  IN EFI_SYSTEM_TABLE *SystemTable
-  );
-
 /**
   Conditionally prints formatted output to console.
   Only prints in non-DXE builds to avoid conflicts.
@@ -112,7 +69,7 @@ SelectivePrint (
     return;
   }
 
-  Status = gBS->AllocatePool(EfiBootServicesData, BufferSize, (VOID**)&Buffer);
+  Status = AcpiAllocatePool(EfiBootServicesData, BufferSize, (VOID**)&Buffer);
   if (EFI_ERROR(Status) || Buffer == NULL) {
     return;
   }
@@ -126,30 +83,88 @@ SelectivePrint (
     gST->ConOut->OutputString(gST->ConOut, Buffer);
   }
   
-  gBS->FreePool(Buffer);
+  AcpiFreePool(Buffer);
 #endif
 }
 
+/**
+  Patches ACPI tables by reading .aml files from the specified directory.
+  
+  This function reads all .aml files from the given directory and either:
+  - Replaces the DSDT if the file is named "DSDT.aml"
+  - Replaces the DSDT with one rebuilt from the firmware's if the file is a
+    delta such as "DSDT.aml.delta" (see AcpiDelta.h)
+  - Adds an SSDT compiled from a device property config such as
+    "SSDT-PROPS.aml.cfg" (see AcpiAml.h)
+  - Adds additional tables to the XSDT for other .aml files
+
+  The run is split into timed phases: the directory is enumerated first,
+  then every file is read and validated, and finally the collected plan is
+  installed with a single XSDT rebuild, or applied to scratch copies of the
+  root tables when gOptions.DryRun is set. With gOptions.Consolidate, small
+  compatible SSDTs are merged before installation. Timings land in gAcpiPerf.
+
+  Besides the .aml files in Directory, the tables of the platform profile
+  matching this machine are loaded from Directory\P-XXXXXXXX and from the
+  TABLES.BND bundle, if present (see AcpiSource.h). Tables in the NVRAM
+  store are loaded too; without Directory they are the only source.
+
+  When an earlier run in this boot installed tables, files unchanged since
+  then are not read again; the tables of changed and deleted files are
+  replaced in place or removed (see AcpiState.h).
+
+  With gOptions.Verify, each table read is checked against the SHA-256 in
+  Manifest.sha256 (see AcpiManifest.h). The open policy only reports
+  mismatched and unlisted tables; the closed policy skips them and fails
+  the run with EFI_SECURITY_VIOLATION when there is no manifest.
+
+  With gOptions.DeadlineMs, required tables are read first. Once reading
+  the next optional table (from Directory\Optional) is predicted to end
+  past the deadline, it and every later optional table are deferred; the
+  tables read so far are still committed with one XSDT rebuild.
+
+  @param[in] Directory    Directory containing .aml files to process, or NULL
+
+  @retval EFI_SUCCESS             ACPI patching completed successfully
+  @retval EFI_INVALID_PARAMETER   Invalid input parameters
+  @retval EFI_SECURITY_VIOLATION  Closed digest policy and no usable manifest
+  @retval Other                   Error occurred during file operations
+**/
 EFI_STATUS
 PatchAcpi (
-  IN EFI_FILE_PROTOCOL* Directory
+  IN EFI_FILE_PROTOCOL* Directory OPTIONAL
   )
 {
-  UINTN                BufferSize     = 0;
-  UINTN                ReadSize       = 0;
   EFI_STATUS           Status         = EFI_SUCCESS;
-  EFI_FILE_INFO        *FileInfo      = NULL;
-  EFI_FILE_PROTOCOL    *FileProtocol  = NULL;
+  ACPI_FILE_LIST       Files;
+  ACPI_FILE_ENTRY      *File;
+  ACPI_PROFILE_IDENTITY Identity;
   VOID                 *FileBuffer    = NULL;
-  UINT32               MaxEntries;
+  ACPI_TABLE_PLAN      Plan;
+  ACPI_CONSOLIDATE_STATS Consolidation;
+  ACPI_STATE_SUMMARY   Reuse;
+  ACPI_MANIFEST        Manifest;
+  BOOLEAN              CheckDigests   = FALSE;
+  UINT32               DigestFailures = 0;
   UINT32               CurrentEntries;
+  UINT32               QueuedTables   = 0;
   UINT32               ProcessedFiles = 0;
-  UINT32               SkippedFiles   = 0;
   UINT32               AddedTables    = 0;
+  UINT32               DeltaTables    = 0;
+  UINT64               DeltaBytes     = 0;
+  UINT64               DeltaTableBytes = 0;
+  UINT32               ConfigTables   = 0;
+  ACPI_DEADLINE_WALK   Walk;
+  UINTN                TableSize;
+  BOOLEAN              IsDsdt;
+  UINT64               PhaseStart;
+  UINT64               ReadNs;
+  VOID                 *Source;
   
   AcpiDebugPrint(DEBUG_INFO, L"Starting ACPI patching process...\n");
+  AcpiPerfReset();
   
-  if (Directory == NULL || gXsdt == NULL || gFacp == NULL) {
+  if (gXsdt == NULL || gFacp == NULL) {
     AcpiDebugPrint(DEBUG_ERROR, L"Invalid parameters for ACPI patching\n");
     AcpiDebugPrint(DEBUG_VERBOSE, L"  Directory: " PTR_FMT L"\n", PTR_TO_INT(Directory));
     AcpiDebugPrint(DEBUG_VERBOSE, L"  gXsdt: " PTR_FMT L"\n", PTR_TO_INT(gXsdt));
@@ -157,201 +172,299 @@ PatchAcpi (
     return EFI_INVALID_PARAMETER;
   }
 
-  // Calculate current and maximum entries in XSDT
-  CurrentEntries = (gXsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
+  // Calculate current entries in XSDT and the additional table limit
+  CurrentEntries = AcpiXsdtEntryCount();
+  AcpiPlanInit(&Plan);
+  ZeroMem(&Consolidation, sizeof(Consolidation));
+  ZeroMem(&Files, sizeof(Files));
+  ZeroMem(&Manifest, sizeof(Manifest));
   
-  // Apply EFI 1.x specific limitations if detected
   if (gIsEfi1x) {
-    MaxEntries = CurrentEntries + MIN(MAX_ADDITIONAL_TABLES, 8);  // Limit to 8 additional tables for EFI 1.x
     AcpiDebugPrint(DEBUG_INFO, L"EFI 1.x detected: Limiting additional tables to %u\n", 
-                   MIN(MAX_ADDITIONAL_TABLES, 8));
-  } else {
-    MaxEntries = CurrentEntries + MAX_ADDITIONAL_TABLES;
+                   Plan.MaxTables);
   }
   
   AcpiDebugPrint(DEBUG_INFO, L"XSDT analysis:\n");
   AcpiDebugPrint(DEBUG_INFO, L"  Current entries: %u\n", CurrentEntries);
-  AcpiDebugPrint(DEBUG_INFO, L"  Maximum entries allowed: %u\n", MaxEntries);
-  AcpiDebugPrint(DEBUG_INFO, L"  Available slots: %u\n", MaxEntries - CurrentEntries);
+  AcpiDebugPrint(DEBUG_INFO, L"  Maximum entries allowed: %u\n", CurrentEntries + Plan.MaxTables);
+  AcpiDebugPrint(DEBUG_INFO, L"  Available slots: %u\n", Plan.MaxTables);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  XSDT address: " PTR_FMT L"\n", PTR_TO_INT(gXsdt));
   AcpiDebugPrint(DEBUG_VERBOSE, L"  XSDT end: 0x%llx\n", gXsdtEnd);
-  
-  BufferSize = sizeof(EFI_FILE_INFO) + sizeof(CHAR16) * FILE_NAME_BUFFER_SIZE;
-  Status = gBS->AllocatePool(EfiBootServicesData, BufferSize, (VOID**)&FileInfo);
-  if (EFI_ERROR(Status)) {
-    AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate memory for FileInfo: %r\n", Status);
-    return Status;
-  }
-  
-  AcpiDebugPrint(DEBUG_VERBOSE, L"Allocated FileInfo buffer: " PTR_FMT L" (%u bytes)\n", 
-             PTR_TO_INT(FileInfo), BufferSize);
 
+  // Phase 1: enumerate the common tables and this platform's profile
   AcpiDebugPrint(DEBUG_INFO, L"Scanning ACPI directory for .aml files...\n");
+  PhaseStart = AcpiPerfNow();
+  AcpiProfileIdentify(&Identity);
+  Status = AcpiSourceCollect(Directory, &Identity, &Files);
+  AcpiPerfAddPhase(AcpiPhaseEnumerate, PhaseStart);
+  if (EFI_ERROR(Status)) {
+    goto Cleanup;
+  }
 
-  while (TRUE) {
-    ReadSize = BufferSize;
-    Status = Directory->Read(Directory, &ReadSize, FileInfo);
+  // Under the closed policy a missing or unreadable manifest installs nothing
+  if (gOptions.Verify != ACPI_VERIFY_OFF) {
+    Status = AcpiManifestLoad(Directory, &Manifest);
+    CheckDigests = (BOOLEAN)!EFI_ERROR(Status);
     if (EFI_ERROR(Status)) {
-      AcpiDebugPrint(DEBUG_ERROR, L"Directory read error: %r\n", Status);
-      goto Cleanup;
-    }
-    
-    if (ReadSize == 0) {
-      AcpiDebugPrint(DEBUG_VERBOSE, L"End of directory reached\n");
-      break; // End of directory
+      ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_MANIFEST_MISSING, Status, gOptions.Verify);
+      if (gOptions.Verify == ACPI_VERIFY_CLOSED) {
+        AcpiDebugPrint(DEBUG_ERROR, L"No usable %s, installing nothing: %r\n", ACPI_MANIFEST_FILE_NAME, Status);
+        Status = EFI_SECURITY_VIOLATION;
+        goto Cleanup;
+      }
+      AcpiDebugPrint(DEBUG_WARN, L"No usable %s, tables are not checked: %r\n", ACPI_MANIFEST_FILE_NAME, Status);
+    } else {
+      AcpiDebugPrint(DEBUG_VERBOSE, L"Checking table digests with the %s SHA-256\n",
+                     AcpiSha256ImplName(AcpiSha256Current()));
     }
+  }
 
-    AcpiDebugPrint(DEBUG_VERBOSE, L"Found directory entry: %s\n", FileInfo->FileName);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  File size: %llu bytes\n", FileInfo->FileSize);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  Attributes: 0x%llx\n", FileInfo->Attribute);
+  if (!EFI_ERROR(AcpiStatePrepare(&Files, &Plan, &Reuse))) {
+    AcpiDebugPrint(DEBUG_INFO, L"Last run: %u files unchanged in %u tables, %u tables to replace or remove\n",
+                   Reuse.Kept, Reuse.KeptTables, Reuse.StaleTables);
+  }
 
-    // Skip hidden files, current/parent directories, and non-AML files
-    if (StrnCmp(&FileInfo->FileName[0], L".", 1) == 0 ||
-        StrnCmp(&FileInfo->FileName[0], L"_", 1) == 0 ||
-        StrStr(FileInfo->FileName, L".aml") == NULL) {
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Skipping file: %s\n", FileInfo->FileName);
-      SkippedFiles++;
-      continue;
-    }
-      
+  // Phases 2 and 3: read and validate each file, one tier after the other
+  // so that only optional tables are left when the deadline draws near
+  AcpiDeadlineWalkInit(&Walk, gOptions.DeadlineMs);
+  while ((File = AcpiDeadlineNext(&Walk, &Files)) != NULL) {
     AcpiDebugPrint(DEBUG_INFO, L"Processing file: %s (%llu bytes)\n", 
-               FileInfo->FileName, FileInfo->FileSize);
+               File->Name, File->Size);
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_FILE_PROCESS, AcpiLogPackName(File->Name), File->Size);
     ProcessedFiles++;
-    
-    Status = FsOpenFile(Directory, FileInfo->FileName, &FileProtocol);
-    if (EFI_ERROR(Status)) {
-      AcpiDebugPrint(DEBUG_ERROR, L"Failed to open file %s: %r\n", FileInfo->FileName, Status);
-      continue; // Skip this file and continue with others
+
+    if (File->Installed != 0) {
+      AcpiDebugPrint(DEBUG_INFO, L"  Unchanged since the last run, keeping table at 0x%llx\n", File->Installed);
+      continue;
+    }
+
+    if (AcpiDeadlineDefers(&Walk, File)) {
+      continue;
+    }
+
+    // Check capacity before paying for the read; merging may free slots. Deltas only rebuild the DSDT
+    IsDsdt = (BOOLEAN)((StrnCmp(File->Name, DSDT_FILE_NAME, 8) == 0 && !AcpiAmlIsConfig(File->Name)) ||
+                       AcpiDeltaIsDelta(File->Name));
+    if (!IsDsdt && Plan.TableCount >= Plan.MaxTables && gOptions.Consolidate) {
+      PhaseStart = AcpiPerfNow();
+      AcpiPlanConsolidate(&Plan, &Consolidation);
+      AcpiPerfAddPhase(AcpiPhaseMerge, PhaseStart);
+    }
+    if (!IsDsdt && Plan.TableCount >= Plan.MaxTables) {
+      AcpiDebugPrint(DEBUG_WARN, L"Maximum XSDT entries reached (%u), skipping %s\n", 
+                 CurrentEntries + Plan.MaxTables, File->Name);
+      ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_XSDT_FULL, CurrentEntries + Plan.MaxTables,
+                AcpiLogPackName(File->Name));
+      continue;
     }
-    
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  File opened successfully\n");
 
     // Check if file size fits in UINTN (important for IA32 builds)
-    if (FileInfo->FileSize > ~(UINTN)0) {
+    if (File->Size > ~(UINTN)0) {
       AcpiDebugPrint(DEBUG_ERROR, L"File %s is too large (%llu bytes) for this architecture\n", 
-                     FileInfo->FileName, FileInfo->FileSize);
-      FileProtocol->Close(FileProtocol);
-      FileProtocol = NULL;
+                     File->Name, File->Size);
       continue; // Skip this file and continue with others
     }
 
-    Status = FsReadFileToBuffer(FileProtocol, (UINTN)FileInfo->FileSize, &FileBuffer);
-    FileProtocol->Close(FileProtocol);
-    FileProtocol = NULL;
-    
+    PhaseStart = AcpiPerfNow();
+    Status = AcpiSourceRead(File, &FileBuffer);
+    ReadNs = AcpiPerfAddPhase(AcpiPhaseRead, PhaseStart);
     if (EFI_ERROR(Status)) {
-      AcpiDebugPrint(DEBUG_ERROR, L"Failed to read file %s: %r\n", FileInfo->FileName, Status);
       continue; // Skip this file and continue with others
     }
 
+    AcpiPerfRecordRead(File->Size, ReadNs);
     AcpiDebugPrint(DEBUG_VERBOSE, L"  File read to buffer at " PTR_FMT L"\n", PTR_TO_INT(FileBuffer));
 
+    // The digest covers the file as read, so a delta or config is checked before it is used
+    if (CheckDigests) {
+      PhaseStart = AcpiPerfNow();
+      Status = AcpiManifestVerify(&Manifest, File, FileBuffer);
+      AcpiPerfAddPhase(AcpiPhaseValidate, PhaseStart);
+      File->Verified = (BOOLEAN)!EFI_ERROR(Status);
+      if (EFI_ERROR(Status)) {
+        DigestFailures++;
+        ACPI_LOG3(DEBUG_WARN, ACPI_LOG_MSG_DIGEST_FAILED, AcpiLogPackName(File->Name), Status, gOptions.Verify);
+        AcpiDebugPrint((gOptions.Verify == ACPI_VERIFY_CLOSED) ? DEBUG_ERROR : DEBUG_WARN,
+                       L"%s %s %s%s\n", File->Name,
+                       (Status == EFI_NOT_FOUND) ? L"is not listed in" : L"does not match its digest in",
+                       ACPI_MANIFEST_FILE_NAME,
+                       (gOptions.Verify == ACPI_VERIFY_CLOSED) ? L", skipping" : L"");
+        if (gOptions.Verify == ACPI_VERIFY_CLOSED) {
+          AcpiFreePool(FileBuffer);
+          continue;
+        }
+      }
+    }
+    
+    // Rebuild the table from a delta against the firmware's, looking through a DSDT installed by an earlier run
+    TableSize = (UINTN)File->Size;
+    if (AcpiDeltaIsDelta(File->Name)) {
+      PhaseStart = AcpiPerfNow();
+      Source     = FileBuffer;
+      Status     = AcpiDeltaApply((EFI_ACPI_SDT_HEADER *)(UINTN)AcpiStateFirmwareDsdt(), Source, TableSize,
+                                  &FileBuffer, &TableSize);
+      ReadNs     = AcpiPerfAddPhase(AcpiPhaseRead, PhaseStart);
+      AcpiFreePool(Source);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_ERROR, L"Delta %s not applied: %r\n", File->Name, Status);
+        ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_DELTA_REFUSED, AcpiLogPackName(File->Name), Status);
+        continue;
+      }
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Rebuilt %u byte table from the %llu byte delta in %llu us\n",
+                     (UINT32)TableSize, File->Size, DivU64x32(ReadNs, 1000));
+      DeltaTables++;
+      DeltaBytes      += File->Size;
+      DeltaTableBytes += TableSize;
+    }
+
+    // Or compile it from a device property config
+    if (AcpiAmlIsConfig(File->Name)) {
+      PhaseStart = AcpiPerfNow();
+      Source     = FileBuffer;
+      Status     = AcpiAmlBuildSsdt(Source, TableSize, &FileBuffer, &TableSize);
+      ReadNs     = AcpiPerfAddPhase(AcpiPhaseRead, PhaseStart);
+      AcpiFreePool(Source);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_ERROR, L"Config %s not compiled: %r\n", File->Name, Status);
+        ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_CONFIG_REFUSED, AcpiLogPackName(File->Name), Status);
+        continue;
+      }
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Compiled %u byte SSDT from the %llu byte config in %llu us\n",
+                     (UINT32)TableSize, File->Size, DivU64x32(ReadNs, 1000));
+      ConfigTables++;
+    }
+
     // Apply EFI 1.x file size limitations
-    if (gIsEfi1x && FileInfo->FileSize > (64 * 1024)) {
+    if (gIsEfi1x && TableSize > ACPI_EFI1X_MAX_TABLE_SIZE) {
       AcpiDebugPrint(DEBUG_WARN, L"File %s is %u bytes (>64KB) - may have issues on EFI 1.x firmware\n", 
-                     FileInfo->FileName, (UINT32)FileInfo->FileSize);
+                     File->Name, (UINT32)TableSize);
       AcpiDebugPrint(DEBUG_WARN, L"Consider reducing ACPI table size for better EFI 1.x compatibility\n");
     }
 
     // Validate the ACPI table
     AcpiDebugPrint(DEBUG_VERBOSE, L"  Validating ACPI table...\n");
-    Status = ValidateAcpiTable(FileBuffer, (UINTN)FileInfo->FileSize);
+    PhaseStart = AcpiPerfNow();
+    Status = ValidateAcpiTable(FileBuffer, TableSize);
+    AcpiPerfAddPhase(AcpiPhaseValidate, PhaseStart);
     if (EFI_ERROR(Status)) {
-      AcpiDebugPrint(DEBUG_ERROR, L"Invalid ACPI table in file %s: %r\n", FileInfo->FileName, Status);
-      gBS->FreePool(FileBuffer);
+      AcpiDebugPrint(DEBUG_ERROR, L"Invalid ACPI table in file %s: %r\n", File->Name, Status);
+      ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_TABLE_INVALID, AcpiLogPackName(File->Name), Status);
+      AcpiFreePool(FileBuffer);
       continue; // Skip this file and continue with others
     }
     
-    // Handle DSDT specially
-    if (StrnCmp(FileInfo->FileName, DSDT_FILE_NAME, 8) == 0) {
-      AcpiDebugPrint(DEBUG_INFO, L"  Processing as DSDT replacement\n");
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Old DSDT address (32-bit): 0x%x\n", gFacp->Dsdt);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Old DSDT address (64-bit): 0x%llx\n", gFacp->XDsdt);
-      
-      gFacp->Dsdt = (UINT32)PTR_TO_INT(FileBuffer);
-      gFacp->XDsdt = (UINT64)PTR_TO_INT(FileBuffer);
-      
-      AcpiDebugPrint(DEBUG_INFO, L"  Updated DSDT address: 0x%llx\n", gFacp->XDsdt);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  DSDT replacement completed\n");
-      AddedTables++;
+    // Queue the table; DSDT is handled specially at commit time
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Queuing table %s for installation\n", File->Name);
+    Status = AcpiPlanAddTable(&Plan, (EFI_ACPI_SDT_HEADER *)FileBuffer, IsDsdt);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(FileBuffer);
       continue;
     }
-    
-    // Check if we have room for more entries
-    if (CurrentEntries >= MaxEntries) {
-      AcpiDebugPrint(DEBUG_WARN, L"Maximum XSDT entries reached (%u), skipping %s\n", 
-                 MaxEntries, FileInfo->FileName);
-      gBS->FreePool(FileBuffer);
-      continue;
+    if (!IsDsdt) {
+      File->QueueIndex = QueuedTables++;
     }
-    
-    // Add to XSDT
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  Adding table to XSDT entry %u\n", CurrentEntries);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  XSDT entry address: 0x%llx\n", gXsdtEnd);
-    
-    ((UINT64 *)(UINTN)gXsdtEnd)[0] = (UINT64)PTR_TO_INT(FileBuffer);
-    gXsdt->Length += sizeof(UINT64);
-    gXsdtEnd = gRsdp->XsdtAddress + gXsdt->Length;
-    CurrentEntries++;
     AddedTables++;
-    
-    AcpiDebugPrint(DEBUG_INFO, L"  Added table at address: " PTR_FMT L"\n", PTR_TO_INT(FileBuffer));
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  New XSDT length: %u bytes\n", gXsdt->Length);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"  New XSDT end: 0x%llx\n", gXsdtEnd);
+  }
+
+  // Phase 4: optionally merge small SSDTs
+  if (gOptions.Consolidate) {
+    PhaseStart = AcpiPerfNow();
+    AcpiPlanConsolidate(&Plan, &Consolidation);
+    AcpiPerfAddPhase(AcpiPhaseMerge, PhaseStart);
+  }
+
+  // Phase 5: install everything with one XSDT rebuild
+  if (!gOptions.DryRun) {
+    AcpiFpdtPrepare(&Plan);
+  }
+  AcpiStateAssign(&Files, &Plan);
+  CurrentEntries = CurrentEntries + Plan.TableCount - Reuse.StaleTables;
+  PhaseStart = AcpiPerfNow();
+  if (gOptions.DryRun) {
+    Status = AcpiPlanDryRun(&Plan);
+  } else {
+    Status = AcpiPlanCommit(&Plan);
+  }
+  AcpiPerfAddPhase(AcpiPhasePlan, PhaseStart);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to install planned tables: %r\n", Status);
+    AcpiFpdtRelease();
+    goto Cleanup;
+  }
+  gAcpiPerf.TablesInstalled = AddedTables;
+
+  if (!gOptions.DryRun) {
+    Status = AcpiStateSave(&Files);
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_WARN, L"Could not record installed tables, the next run reloads all: %r\n", Status);
+    }
   }
   
-  AcpiDebugPrint(DEBUG_INFO, L"ACPI patching summary:\n");
+  AcpiDebugPrint(DEBUG_INFO, L"ACPI patching summary%s:\n", gOptions.DryRun ? L" (dry run)" : L"");
   AcpiDebugPrint(DEBUG_INFO, L"  Files processed: %u\n", ProcessedFiles);
-  AcpiDebugPrint(DEBUG_INFO, L"  Files skipped: %u\n", SkippedFiles);
+  AcpiDebugPrint(DEBUG_INFO, L"  Files skipped: %u\n", Files.Skipped);
   AcpiDebugPrint(DEBUG_INFO, L"  Tables added/replaced: %u\n", AddedTables);
+  AcpiDebugPrint(DEBUG_INFO, L"  Tables kept from last run: %u\n", Reuse.Kept);
+  if (gOptions.DeadlineMs != 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"  Optional tables deferred by the %u ms deadline: %u\n",
+                   gOptions.DeadlineMs, Walk.Deferred);
+  }
+  if (DeltaTables > 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"  Tables rebuilt from deltas: %u (%llu bytes read for %llu table bytes)\n",
+                   DeltaTables, DeltaBytes, DeltaTableBytes);
+  }
+  if (ConfigTables > 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"  SSDTs compiled from configs: %u\n", ConfigTables);
+  }
+  if (CheckDigests) {
+    AcpiDebugPrint(DEBUG_INFO, L"  Digest check failures: %u (%s)\n", DigestFailures,
+                   (gOptions.Verify == ACPI_VERIFY_CLOSED) ? L"skipped" : L"installed");
+  }
+  AcpiReadTuneReport();
   AcpiDebugPrint(DEBUG_INFO, L"  Final XSDT entries: %u\n", CurrentEntries);
+  if (gOptions.Consolidate) {
+    AcpiDebugPrint(DEBUG_INFO, L"  SSDTs consolidated: %u into %u (%u XSDT entries, %u bytes saved)\n",
+                   Consolidation.TablesMerged, Consolidation.Consolidated,
+                   Consolidation.TablesMerged - Consolidation.Consolidated, Consolidation.BytesSaved);
+  }
+  AcpiDebugPrint(DEBUG_VERBOSE, L"  Time: %llu us (%llu bytes read)\n",
+                 DivU64x32(gAcpiPerf.TotalNs, 1000), gAcpiPerf.BytesRead);
+  ACPI_LOG4(DEBUG_INFO, ACPI_LOG_MSG_SUMMARY, ProcessedFiles, Files.Skipped, AddedTables, CurrentEntries);
   
   Status = EFI_SUCCESS;
 
 Cleanup:
-  if (FileInfo != NULL) {
-    AcpiDebugPrint(DEBUG_VERBOSE, L"Cleaning up FileInfo buffer\n");
-    gBS->FreePool(FileInfo);
-  }
-  if (FileProtocol != NULL) {
-    AcpiDebugPrint(DEBUG_VERBOSE, L"Closing file protocol\n");
-    FileProtocol->Close(FileProtocol);
-  }
+  AcpiPlanRelease(&Plan);
+  AcpiSourceRelease(&Files);
+  AcpiManifestRelease(&Manifest);
   
   AcpiDebugPrint(DEBUG_VERBOSE, L"ACPI patching cleanup completed\n");
   return Status;
 }
 
 /**
-  Patches ACPI tables by reading .aml files from the specified directory.
-  
-  This function reads all .aml files from the given directory and either:
-  - Replaces the DSDT if the file is named "DSDT.aml"
-  - Adds additional tables to the XSDT for other .aml files
+  Calls Visitor for every non-null XSDT entry, in XSDT order.
 
-  @param[in] Directory    Directory containing .aml files to process
+  @param[in] Visitor    Callback; returns TRUE to stop the walk
+  @param[in] Context    Passed through to Visitor
 
-  @retval EFI_SUCCESS             ACPI patching completed successfully
-  @retval EFI_INVALID_PARAMETER   Invalid input parameters
-  @retval Other                   Error occurred during file operations
+  @return Number of XSDT entries
 **/
-
-EFI_STATUS
-FindFacp (
-  VOID
+UINTN
+AcpiWalkXsdt (
+  IN ACPI_XSDT_VISITOR  Visitor,
+  IN VOID               *Context
   )
 {
   EFI_ACPI_SDT_HEADER *Entry;
   UINT32              EntryCount;
   UINT64              *EntryPtr;
+  UINT64              Address;
   UINTN               Index;
   CHAR8               SigStr[5];
 
-  AcpiDebugPrint(DEBUG_INFO, L"Searching for FADT in XSDT...\n");
-
   if (gXsdt == NULL) {
-    AcpiDebugPrint(DEBUG_ERROR, L"XSDT pointer is null\n");
-    return EFI_INVALID_PARAMETER;
+    return 0;
   }
 
   EntryCount = (gXsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
@@ -361,16 +474,18 @@ FindFacp (
   AcpiDebugPrint(DEBUG_VERBOSE, L"Scanning entries starting at " PTR_FMT L"\n", PTR_TO_INT(EntryPtr));
 
   for (Index = 0; Index < EntryCount; Index++, EntryPtr++) {
-    if (*EntryPtr == 0) {
+    // Entries start at offset 36 and are not naturally aligned
+    Address = ReadUnaligned64(EntryPtr);
+    if (Address == 0) {
       AcpiDebugPrint(DEBUG_VERBOSE, L"  Entry %u: NULL pointer, skipping\n", Index);
       continue; // Skip null entries
     }
 
-    Entry = (EFI_ACPI_SDT_HEADER *)((UINTN)(*EntryPtr));
+    Entry = (EFI_ACPI_SDT_HEADER *)((UINTN)Address);
     
     // Validate entry pointer
     if (Entry == NULL) {
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Entry %u: Invalid pointer (0x%llx), skipping\n", Index, *EntryPtr);
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Entry %u: Invalid pointer (0x%llx), skipping\n", Index, Address);
       continue;
     }
 
@@ -382,22 +497,66 @@ FindFacp (
     SigStr[4] = '\0';
     
     AcpiDebugPrint(DEBUG_VERBOSE, L"  Entry %u: 0x%llx -> Signature: %a, Length: %u\n", 
-               Index, *EntryPtr, SigStr, Entry->Length);
-
-    if (Entry->Signature == EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE_SIGNATURE) {
-      gFacp = (EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE *)Entry;
-      AcpiDebugPrint(DEBUG_INFO, L"Found FADT at address: " PTR_FMT L"\n", PTR_TO_INT(gFacp));
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  FADT length: %u bytes\n", gFacp->Header.Length);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  FADT revision: %u\n", gFacp->Header.Revision);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Current DSDT (32-bit): 0x%x\n", gFacp->Dsdt);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Current DSDT (64-bit): 0x%llx\n", gFacp->XDsdt);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  Firmware Control: 0x%x\n", gFacp->FirmwareCtrl);
-      AcpiDebugPrint(DEBUG_VERBOSE, L"  X_Firmware Control: 0x%llx\n", gFacp->XFirmwareCtrl);
-      return EFI_SUCCESS;
+               Index, Address, SigStr, Entry->Length);
+
+    if (Visitor(Entry, Index, Context)) {
+      break;
     }
   }
+
+  return EntryCount;
+}
+
+/**
+  XSDT visitor that stops at the FADT and caches it in gFacp.
+**/
+STATIC
+BOOLEAN
+AcpiMatchFacp (
+  IN EFI_ACPI_SDT_HEADER  *Table,
+  IN UINTN                Index,
+  IN VOID                 *Context
+  )
+{
+  if (Table->Signature != EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE_SIGNATURE) {
+    return FALSE;
+  }
+
+  gFacp = (EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE *)Table;
+  return TRUE;
+}
+
+EFI_STATUS
+FindFacp (
+  VOID
+  )
+{
+  UINTN               EntryCount;
+
+  AcpiDebugPrint(DEBUG_INFO, L"Searching for FADT in XSDT...\n");
+
+  if (gXsdt == NULL) {
+    AcpiDebugPrint(DEBUG_ERROR, L"XSDT pointer is null\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  gFacp = NULL;
+  EntryCount = AcpiWalkXsdt(AcpiMatchFacp, NULL);
+
+  if (gFacp != NULL) {
+    AcpiDebugPrint(DEBUG_INFO, L"Found FADT at address: " PTR_FMT L"\n", PTR_TO_INT(gFacp));
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_FADT_FOUND, PTR_TO_INT(gFacp), gFacp->XDsdt);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  FADT length: %u bytes\n", gFacp->Header.Length);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  FADT revision: %u\n", gFacp->Header.Revision);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Current DSDT (32-bit): 0x%x\n", gFacp->Dsdt);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Current DSDT (64-bit): 0x%llx\n", gFacp->XDsdt);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Firmware Control: 0x%x\n", gFacp->FirmwareCtrl);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  X_Firmware Control: 0x%llx\n", gFacp->XFirmwareCtrl);
+    return EFI_SUCCESS;
+  }
   
-  AcpiDebugPrint(DEBUG_WARN, L"FADT not found in XSDT (scanned %u entries)\n", EntryCount);
+  AcpiDebugPrint(DEBUG_WARN, L"FADT not found in XSDT (scanned %u entries)\n", (UINT32)EntryCount);
+  ACPI_LOG1(DEBUG_WARN, ACPI_LOG_MSG_FADT_NOT_FOUND, EntryCount);
   return EFI_NOT_FOUND;
 }
 
@@ -410,11 +569,14 @@ ValidateAcpiTable (
   EFI_ACPI_SDT_HEADER *Header;
   UINT8               Checksum;
   CHAR8               SigStr[5];
+  ACPI_TABLE_DEFECT   Defect;
 
   AcpiDebugPrint(DEBUG_VERBOSE, L"Validating ACPI table at " PTR_FMT L", size %u bytes\n", 
              PTR_TO_INT(TableBuffer), BufferSize);
 
-  if (TableBuffer == NULL || BufferSize < sizeof(EFI_ACPI_SDT_HEADER)) {
+  // The checks themselves live in AcpiRules.c, shared with Tools/FleetValidator
+  Defect = AcpiRulesCheckTable(TableBuffer, BufferSize, &Checksum);
+  if (Defect == AcpiTableTruncated) {
     AcpiDebugPrint(DEBUG_ERROR, L"Invalid parameters for table validation\n");
     return EFI_INVALID_PARAMETER;
   }
@@ -435,38 +597,35 @@ ValidateAcpiTable (
   AcpiDebugPrint(DEBUG_VERBOSE, L"  OEM Table ID: %.8a\n", Header->OemTableId);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  OEM Revision: 0x%x\n", Header->OemRevision);
   
-  // Validate signature (should be printable ASCII)
-  if (Header->Signature == 0) {
+  if (Defect == AcpiTableNoSignature) {
     AcpiDebugPrint(DEBUG_ERROR, L"Invalid table signature (zero)\n");
     return EFI_INVALID_PARAMETER;
   }
 
-  // Validate length
-  if (Header->Length < sizeof(EFI_ACPI_SDT_HEADER)) {
+  if (Defect == AcpiTableShortLength) {
     AcpiDebugPrint(DEBUG_ERROR, L"Table length too small: %u < %u\n", 
                Header->Length, sizeof(EFI_ACPI_SDT_HEADER));
     return EFI_INVALID_PARAMETER;
   }
   
-  if (Header->Length > BufferSize) {
+  if (Defect == AcpiTableOverrun) {
     AcpiDebugPrint(DEBUG_ERROR, L"Table length exceeds buffer: %u > %u\n", 
                Header->Length, BufferSize);
     return EFI_INVALID_PARAMETER;
   }
 
-  // Validate checksum
-  Checksum = CalculateCheckSum8((UINT8*)TableBuffer, Header->Length);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  Calculated checksum: 0x%02x\n", Checksum);
   
   if (Checksum != 0) {
     AcpiDebugPrint(DEBUG_WARN, L"ACPI table checksum validation failed (0x%02x)\n", Checksum);
+    ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_TABLE_CHECKSUM, Header->Signature, Checksum);
     // Don't return error as we'll recalculate checksum anyway
   } else {
     AcpiDebugPrint(DEBUG_VERBOSE, L"  Checksum validation passed\n");
   }
 
   // Show first few bytes of table data for debugging
-  if (DEBUG_LEVEL >= DEBUG_VERBOSE) {
+  if (gOptions.DebugLevel >= DEBUG_VERBOSE) {
     HexDump(TableBuffer, MIN(Header->Length, 64), (UINTN)TableBuffer);
   }
 
@@ -475,60 +634,31 @@ ValidateAcpiTable (
 }
 
 /**
-  Main entry point for the ACPI Patcher application.
-  
-  This function orchestrates the entire ACPI patching process:
-  1. Locates and validates the ACPI root tables (RSDP, XSDT, FADT)
-  2. Opens the ACPI directory containing .aml files
-  3. Patches ACPI tables with new content
-  4. Updates checksums for modified tables
-
-  @param[in] ImageHandle    Handle for this UEFI application
-  @param[in] SystemTable    Pointer to the UEFI System Table
+  Locates and validates the ACPI root tables (RSDP, XSDT, FADT) and caches
+  them in gRsdp, gXsdt and gFacp.
 
-  @retval EFI_SUCCESS             ACPI patching completed successfully
-  @retval EFI_INVALID_PARAMETER   Invalid input parameters
-  @retval EFI_NOT_FOUND          Required ACPI structures not found
-  @retval Other                   Error occurred during patching process
+  @retval EFI_SUCCESS             Root tables located
+  @retval EFI_NOT_FOUND           RSDP or FADT not found
+  @retval EFI_INVALID_PARAMETER   RSDP or XSDT is malformed
 **/
 EFI_STATUS
-EFIAPI
-AcpiPatcherEntryPoint (
-  IN EFI_HANDLE        ImageHandle,
-  IN EFI_SYSTEM_TABLE  *SystemTable
+AcpiLocateRootTables (
+  VOID
   )
 {
-  EFI_STATUS           Status         = EFI_SUCCESS;
-  EFI_FILE_PROTOCOL    *AcpiFolder    = NULL;
-  EFI_FILE_PROTOCOL    *SelfDir       = NULL;
-  UINT32               EntryCount;
-  
-  // Validate input parameters
-  if (ImageHandle == NULL || SystemTable == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  AcpiDebugPrint(DEBUG_INFO, L"=== ACPIPatcher v%u.%u Starting ===\n", 
-             ACPI_PATCHER_VERSION_MAJOR, ACPI_PATCHER_VERSION_MINOR);
-  AcpiDebugPrint(DEBUG_INFO, L"ImageHandle: " PTR_FMT L"\n", PTR_TO_INT(ImageHandle));
-  AcpiDebugPrint(DEBUG_INFO, L"SystemTable: " PTR_FMT L"\n", PTR_TO_INT(SystemTable));
-  AcpiDebugPrint(DEBUG_VERBOSE, L"Debug level: %u\n", DEBUG_LEVEL);
-
-  // Detect EFI firmware version for compatibility optimizations
-  gIsEfi1x = DetectEfiFirmwareVersion(SystemTable);
-
-  // Detect EFI firmware version
-  gIsEfi1x = DetectEfiFirmwareVersion(SystemTable);
+  EFI_STATUS           Status;
 
   // Get RSDP from system configuration table
   AcpiDebugPrint(DEBUG_INFO, L"Locating RSDP...\n");
   Status = EfiGetSystemConfigurationTable(&gEfiAcpi20TableGuid, (VOID **)&gRsdp);
   if (EFI_ERROR(Status) || gRsdp == NULL) {
     AcpiDebugPrint(DEBUG_ERROR, L"Could not find RSDP: %r\n", Status);
+    ACPI_LOG1(DEBUG_ERROR, ACPI_LOG_MSG_RSDP_NOT_FOUND, Status);
     return EFI_NOT_FOUND;
   }
 
   AcpiDebugPrint(DEBUG_INFO, L"Found RSDP at address: " PTR_FMT L"\n", PTR_TO_INT(gRsdp));
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_RSDP_FOUND, PTR_TO_INT(gRsdp), gRsdp->Revision);
   AcpiDebugPrint(DEBUG_VERBOSE, L"RSDP details:\n");
   AcpiDebugPrint(DEBUG_VERBOSE, L"  Signature: 0x%llx\n", gRsdp->Signature);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  Checksum: 0x%02x\n", gRsdp->Checksum);
@@ -556,10 +686,12 @@ AcpiPatcherEntryPoint (
   // Validate XSDT
   if (gXsdt->Signature != EFI_ACPI_6_4_EXTENDED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
     AcpiDebugPrint(DEBUG_ERROR, L"Invalid XSDT signature: 0x%x\n", gXsdt->Signature);
+    ACPI_LOG1(DEBUG_ERROR, ACPI_LOG_MSG_XSDT_INVALID, gXsdt->Signature);
     return EFI_INVALID_PARAMETER;
   }
 
   AcpiDebugPrint(DEBUG_INFO, L"XSDT validation passed\n");
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_XSDT_FOUND, PTR_TO_INT(gXsdt), gXsdt->Length);
   AcpiDebugPrint(DEBUG_INFO, L"  Size: 0x%x (%u bytes)\n", gXsdt->Length, gXsdt->Length);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  Revision: %u\n", gXsdt->Revision);
   AcpiDebugPrint(DEBUG_VERBOSE, L"  Checksum: 0x%02x\n", gXsdt->Checksum);
@@ -576,18 +708,191 @@ AcpiPatcherEntryPoint (
     return Status;
   }
 
-  EntryCount = (gXsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
-  AcpiDebugPrint(DEBUG_INFO, L"XSDT contains %u table entries\n", EntryCount);
+  return EFI_SUCCESS;
+}
+
+/**
+  Main entry point for the ACPI Patcher application.
+  
+  This function orchestrates the entire ACPI patching process:
+  1. Locates and validates the ACPI root tables (RSDP, XSDT, FADT)
+  2. Opens the ACPI directory containing .aml files
+  3. Patches ACPI tables with new content
+  4. Updates checksums for modified tables
+
+  The application accepts options (see AcpiParseOptions) for a dry run
+  against scratch copies of the root tables, for a repeated benchmark and
+  for exporting the live tables instead of patching them.
+
+  The timings of each committing run are added to a history kept in a UEFI
+  variable, and runs that regress against it are flagged (see
+  AcpiHistory.h). They are also reported as FPDT boot performance records
+  (see AcpiFpdt.h).
+
+  Pool allocations are accounted per call site and reported at the end of
+  the run together with the memory map growth (see AcpiMemory.h).
+
+  Small tables kept in the NVRAM store are read with GetVariable; when the
+  store does not ask for the ACPI folder, no file system is touched at all
+  (see AcpiNvStore.h). Neither is it in builds that embed their tables
+  with Tools/AcpiBundle.py embed --only.
+
+  The DXE build additionally installs ACPI_PATCHER_PROTOCOL and stays
+  resident so other drivers can submit tables from memory. Built with
+  ACPI_PATCHER_HOOK_INSTALL it replaces tables as the firmware installs
+  them instead of patching the published ones (see AcpiHook.h).
+
+  @param[in] ImageHandle    Handle for this UEFI application
+  @param[in] SystemTable    Pointer to the UEFI System Table
+
+  @retval EFI_SUCCESS             ACPI patching completed successfully
+  @retval EFI_INVALID_PARAMETER   Invalid input parameters
+  @retval EFI_NOT_FOUND          Required ACPI structures not found
+  @retval Other                   Error occurred during patching process
+**/
+EFI_STATUS
+EFIAPI
+AcpiPatcherEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS           Status         = EFI_SUCCESS;
+  EFI_FILE_PROTOCOL    *AcpiFolder    = NULL;
+  EFI_FILE_PROTOCOL    *SelfDir       = NULL;
+  EFI_FILE_PROTOCOL    *FatRoot;
+  UINT32               EntryCount;
+  ACPI_MEM_SNAPSHOT    MemBefore;
+  ACPI_MEM_SNAPSHOT    MemAfter;
+  BOOLEAN              HaveMemBefore;
+  BOOLEAN              SkipFolder;
+  BOOLEAN              DirectFat      = FALSE;
+  BOOLEAN              RecordHistory;
+  EFI_HANDLE           Device;
+#ifdef DXE
+  EFI_STATUS           ProtocolStatus;
+#else
+  EFI_FILE_PROTOCOL    *Wrapped;
+  ACPI_IO_PROFILE      Profile;
+#endif
+  
+  // Validate input parameters
+  if (ImageHandle == NULL || SystemTable == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+#ifndef DXE
+  // Options change the console verbosity, so parse them before printing
+  Status = AcpiParseOptions(ImageHandle);
+  if (Status == EFI_ABORTED) {
+    return EFI_SUCCESS; // Usage was requested
+  }
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+#endif
+
+  AcpiPerfStartClock();
+
+  // Baseline for the memory report; everything below is accounted to this run
+  HaveMemBefore = (BOOLEAN)!EFI_ERROR(AcpiMemSnapshot(&MemBefore));
+
+  // Attach the binary log ring first so every later step can record into it
+  AcpiLogInit();
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_START, ACPI_PATCHER_VERSION_MAJOR, ACPI_PATCHER_VERSION_MINOR);
+
+  AcpiDebugPrint(DEBUG_INFO, L"=== ACPIPatcher v%u.%u Starting ===\n", 
+             ACPI_PATCHER_VERSION_MAJOR, ACPI_PATCHER_VERSION_MINOR);
+  AcpiDebugPrint(DEBUG_INFO, L"ImageHandle: " PTR_FMT L"\n", PTR_TO_INT(ImageHandle));
+  AcpiDebugPrint(DEBUG_INFO, L"SystemTable: " PTR_FMT L"\n", PTR_TO_INT(SystemTable));
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Debug level: %u\n", gOptions.DebugLevel);
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Log ring: " PTR_FMT L"\n", PTR_TO_INT(AcpiLogGetRing()));
+
+  // Detect EFI firmware version for compatibility optimizations
+  gIsEfi1x = DetectEfiFirmwareVersion(SystemTable);
+
+  // Detect EFI firmware version
+  gIsEfi1x = DetectEfiFirmwareVersion(SystemTable);
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_FIRMWARE, SystemTable->FirmwareRevision, gIsEfi1x);
+
+#ifdef DXE
+  // Publish the protocol first so drivers can submit in-memory tables even
+  // when no ACPI folder is available to this driver
+  ProtocolStatus = AcpiPatcherInstallProtocol(ImageHandle);
+#else
+  // Store maintenance needs no tables and, except to add one, no file system
+  if (gOptions.NvCommand != AcpiNvCommandNone && gOptions.NvCommand != AcpiNvCommandAdd) {
+    Status = AcpiNvRunCommand(NULL);
+    goto Cleanup;
+  }
+#endif
+
+  Status = AcpiLocateRootTables();
+#ifdef DXE
+  // The install hook is armed before the firmware publishes its tables
+  if (EFI_ERROR(Status) && ACPI_PATCHER_HOOK_INSTALL) {
+    gRsdp  = NULL;
+    gXsdt  = NULL;
+    gFacp  = NULL;
+    Status = EFI_SUCCESS;
+  }
+#endif
+  if (EFI_ERROR(Status)) {
+    goto Cleanup;
+  }
+
+  if (gXsdt != NULL) {
+    EntryCount = (gXsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
+    AcpiDebugPrint(DEBUG_INFO, L"XSDT contains %u table entries\n", EntryCount);
+  }
+
+  // Tables linked into the image or kept in NVRAM need no file system,
+  // unless the NVRAM store asks for the ACPI folder too; the benchmark,
+  // export, latency and digest tools all work on the folder
+  SkipFolder = (BOOLEAN)(gOptions.NvCommand == AcpiNvCommandNone && gOptions.Repeat == 0 && !gOptions.RecordIo &&
+                         gOptions.ExportDir[0] == L'\0' && gOptions.Verify == ACPI_VERIFY_OFF);
+#ifndef DXE
+  SkipFolder = (BOOLEAN)(SkipFolder && !gAcpiIoProfile.Enabled);
+#endif
+  if (SkipFolder && (gAcpiEmbeddedOnly || AcpiNvSkipsFolder())) {
+    AcpiDebugPrint(DEBUG_INFO, L"Loading embedded and NVRAM tables, not touching the file system\n");
+    goto Patch;
+  }
 
   // Get current directory
   AcpiDebugPrint(DEBUG_INFO, L"Locating current directory...\n");
-  SelfDir = FsGetSelfDir();
+  // Export writes files, which only the firmware file system driver can do
+  if (gOptions.DirectFat && gOptions.ExportDir[0] == L'\0') {
+    Status = FatOpenVolume(FsGetSelfDevice(), &FatRoot);
+    if (!EFI_ERROR(Status)) {
+      SelfDir = FsGetSelfDirFrom(FatRoot);
+      Status  = (SelfDir == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+    }
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_WARN, L"Direct FAT access unavailable (%r), using the file system driver\n", Status);
+    } else {
+      AcpiDebugPrint(DEBUG_INFO, L"Reading tables through the direct FAT reader\n");
+      DirectFat = TRUE;
+    }
+  }
+  if (SelfDir == NULL) {
+    SelfDir = FsGetSelfDir();
+  }
   if (SelfDir == NULL) {
     AcpiDebugPrint(DEBUG_ERROR, L"Could not find current working directory\n");
-    return EFI_NOT_FOUND;
+    Status = EFI_NOT_FOUND;
+    goto Cleanup;
   }
   
   AcpiDebugPrint(DEBUG_VERBOSE, L"Current directory located at: " PTR_FMT L"\n", PTR_TO_INT(SelfDir));
+
+#ifndef DXE
+  if (gOptions.ExportDir[0] != L'\0') {
+    AcpiDebugPrint(DEBUG_INFO, L"=== Exporting firmware ACPI tables ===\n");
+    Status = AcpiExportTables(SelfDir);
+    goto Cleanup;
+  }
+#endif
   
   // Open ACPI folder
   AcpiDebugPrint(DEBUG_INFO, L"Opening ACPI folder...\n");
@@ -599,15 +904,76 @@ AcpiPatcherEntryPoint (
                     EFI_FILE_READ_ONLY | EFI_FILE_HIDDEN | EFI_FILE_SYSTEM
                     );
   
+  if (EFI_ERROR(Status) && SkipFolder && gAcpiEmbeddedTablesSize > 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"No ACPI folder (%r), loading embedded tables\n", Status);
+    AcpiFolder = NULL;
+    goto Patch;
+  }
   if (EFI_ERROR(Status)) {
     AcpiDebugPrint(DEBUG_ERROR, L"Could not open ACPI folder: %r\n", Status);
+    ACPI_LOG1(DEBUG_ERROR, ACPI_LOG_MSG_ACPI_DIR_FAILED, Status);
     AcpiDebugPrint(DEBUG_INFO, L"Please ensure 'ACPI' directory exists with .aml files\n");
     goto Cleanup;
   }
   
   AcpiDebugPrint(DEBUG_VERBOSE, L"ACPI folder opened successfully at: " PTR_FMT L"\n", PTR_TO_INT(AcpiFolder));
-  
-  AcpiDebugPrint(DEBUG_INFO, L"=== Starting ACPI table patching ===\n");
+
+#ifndef DXE
+  if (gOptions.NvCommand == AcpiNvCommandAdd) {
+    Status = AcpiNvRunCommand(AcpiFolder);
+    goto Cleanup;
+  }
+#endif
+
+Patch:
+#ifdef DXE
+  if (ACPI_PATCHER_HOOK_INSTALL) {
+    AcpiDebugPrint(DEBUG_INFO, L"=== Arming the ACPI table install hook ===\n");
+    Status = AcpiHookStart(AcpiFolder);
+    goto Cleanup;
+  }
+#endif
+
+  if (AcpiFolder != NULL &&
+      (gOptions.ReadStrategy == AcpiReadAdaptive || gOptions.ReadStrategy == AcpiReadStrategyMax)) {
+    // Timings under latency replay are not the volume's own, and repeated
+    // runs read from warm caches, so neither is remembered; a dry run writes
+    // nothing at all
+    Device = FsGetSelfDevice();
+    if (gOptions.Repeat > 0 || gOptions.DryRun) {
+      Device = NULL;
+    }
+#ifndef DXE
+    if (gAcpiIoProfile.Enabled) {
+      Device = NULL;
+    }
+#endif
+    AcpiReadTuneStart(Device, DirectFat ? ACPI_PATCHER_READ_TUNING_FAT : ACPI_PATCHER_READ_TUNING_DRIVER);
+  }
+
+#ifndef DXE
+  if (gOptions.RecordIo) {
+    AcpiDebugPrint(DEBUG_INFO, L"=== Recording file system latency ===\n");
+    Status = AcpiIoSimRecord(AcpiFolder, &Profile);
+    goto Cleanup;
+  }
+
+  if (gAcpiIoProfile.Enabled) {
+    Status = AcpiIoSimWrap(AcpiFolder, &Wrapped);
+    if (EFI_ERROR(Status)) {
+      goto Cleanup;
+    }
+    AcpiFolder = Wrapped;
+  }
+
+  if (gOptions.Repeat > 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"=== Benchmarking %u dry runs ===\n", gOptions.Repeat);
+    Status = AcpiRunBenchmark(AcpiFolder);
+    goto Cleanup;
+  }
+#endif
+
+  AcpiDebugPrint(DEBUG_INFO, L"=== Starting ACPI table patching%s ===\n", gOptions.DryRun ? L" (dry run)" : L"");
   Status = PatchAcpi(AcpiFolder);
   if (EFI_ERROR(Status)) {
     AcpiDebugPrint(DEBUG_ERROR, L"ACPI patching failed: %r\n", Status);
@@ -615,25 +981,16 @@ AcpiPatcherEntryPoint (
   }
 
   AcpiDebugPrint(DEBUG_INFO, L"=== ACPI patching completed successfully ===\n");
-
-  // Update checksums
-  AcpiDebugPrint(DEBUG_INFO, L"Updating table checksums...\n");
-  if (gFacp != NULL) {
-    UINT8 OldChecksum = gFacp->Header.Checksum;
-    gFacp->Header.Checksum = 0;
-    gFacp->Header.Checksum = CalculateCheckSum8((UINT8*)gFacp, gFacp->Header.Length);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"FADT checksum: 0x%02x -> 0x%02x\n", 
-               OldChecksum, gFacp->Header.Checksum);
-    AcpiDebugPrint(DEBUG_INFO, L"Updated FADT checksum\n");
+  // Timings under latency replay are simulated, so they stay out of the
+  // cross-boot baseline just as the read tuning does
+  RecordHistory = (BOOLEAN)!gOptions.DryRun;
+#ifndef DXE
+  if (gAcpiIoProfile.Enabled) {
+    RecordHistory = FALSE;
   }
-
-  if (gXsdt != NULL) {
-    UINT8 OldChecksum = gXsdt->Checksum;
-    gXsdt->Checksum = 0;
-    gXsdt->Checksum = CalculateCheckSum8((UINT8*)gXsdt, gXsdt->Length);
-    AcpiDebugPrint(DEBUG_VERBOSE, L"XSDT checksum: 0x%02x -> 0x%02x\n", 
-               OldChecksum, gXsdt->Checksum);
-    AcpiDebugPrint(DEBUG_INFO, L"Updated XSDT checksum\n");
+#endif
+  if (RecordHistory) {
+    AcpiHistoryRecord(SystemTable->FirmwareRevision);
   }
 
 Cleanup:
@@ -646,12 +1003,36 @@ Cleanup:
     AcpiDebugPrint(DEBUG_VERBOSE, L"Closing self directory\n");
     SelfDir->Close(SelfDir);
   }
+  AcpiReadTuneSave();
+
+#ifndef DXE
+  if (gAcpiIoProfile.Enabled) {
+    AcpiIoSimReport();
+  }
+#endif
+
+  if (HaveMemBefore && !EFI_ERROR(AcpiMemSnapshot(&MemAfter))) {
+    AcpiMemReport(&MemBefore, &MemAfter);
+  } else {
+    AcpiMemReport(NULL, NULL);
+  }
+
+  // Last, so the end record covers the whole run
+  AcpiFpdtPublish();
 
   if (EFI_ERROR(Status)) {
     AcpiDebugPrint(DEBUG_ERROR, L"ACPIPatcher finished with ERROR: %r\n", Status);
   } else {
     AcpiDebugPrint(DEBUG_INFO, L"=== ACPIPatcher finished successfully ===\n");
   }
+  ACPI_LOG1(EFI_ERROR(Status) ? DEBUG_ERROR : DEBUG_INFO, ACPI_LOG_MSG_FINISHED, Status);
+
+#ifdef DXE
+  // Stay resident while the protocol is published
+  if (!EFI_ERROR(ProtocolStatus)) {
+    return EFI_SUCCESS;
+  }
+#endif
   
   return Status;
 }
@@ -676,7 +1057,7 @@ AcpiDebugPrint (
   CHAR16    *Prefix     = L"";
   EFI_STATUS Status;
 
-  if (Format == NULL || Level > DEBUG_LEVEL) {
+  if (Format == NULL || Level > gOptions.DebugLevel) {
     return;
   }
 
@@ -696,7 +1077,7 @@ AcpiDebugPrint (
       break;
   }
 
-  Status = gBS->AllocatePool(EfiBootServicesData, BufferSize, (VOID**)&Buffer);
+  Status = AcpiAllocatePool(EfiBootServicesData, BufferSize, (VOID**)&Buffer);
   if (EFI_ERROR(Status) || Buffer == NULL) {
     return;
   }
@@ -715,7 +1096,7 @@ AcpiDebugPrint (
     gST->ConOut->OutputString(gST->ConOut, Buffer);
   }
   
-  gBS->FreePool(Buffer);
+  AcpiFreePool(Buffer);
 #endif
 }
 
@@ -737,7 +1118,7 @@ HexDump (
   UINT8  *Bytes = (UINT8 *)Data;
   UINTN  i, j;
   
-  if (Data == NULL || Size == 0 || DEBUG_LEVEL < DEBUG_VERBOSE) {
+  if (Data == NULL || Size == 0 || gOptions.DebugLevel < DEBUG_VERBOSE) {
     return;
   }
 
@@ -0,0 +1,206 @@
+/** @file
+
+  Shared definitions for the ACPI Patcher modules.
+
+**/
+
+#ifndef __ACPI_PATCHER_H__
+#define __ACPI_PATCHER_H__
+
+#include <Protocol/AcpiSystemDescriptionTable.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#include "AcpiRules.h"
+
+//
+// Constants
+//
+#define ACPI_PATCHER_VERSION_MAJOR    1
+#define ACPI_PATCHER_VERSION_MINOR    1
+#define FILE_NAME_BUFFER_SIZE         512
+#define DSDT_FILE_NAME                L"DSDT.aml"
+#define ACPI_FILE_NAME_LENGTH         128
+#define MAX_REPEAT_COUNT              1000
+#define MAX_DEADLINE_MS               600000
+
+//
+// Debug levels
+//
+#define DEBUG_ERROR   1
+#define DEBUG_WARN    2
+#define DEBUG_INFO    3
+#define DEBUG_VERBOSE 4
+
+#ifndef ACPI_PATCHER_CONSOLIDATE
+#define ACPI_PATCHER_CONSOLIDATE FALSE  // Default for --consolidate; DXE builds may set it with -D
+#endif
+
+#ifndef ACPI_PATCHER_DIRECT_FAT
+#define ACPI_PATCHER_DIRECT_FAT FALSE   // Default for --fat; DXE builds may set it with -D
+#endif
+
+//
+// Table digest policies for --verify, against Manifest.sha256 in the ACPI folder
+//
+#define ACPI_VERIFY_OFF     0   ///< Digests are not checked
+#define ACPI_VERIFY_OPEN    1   ///< Mismatched or unlisted tables are reported but installed
+#define ACPI_VERIFY_CLOSED  2   ///< Mismatched or unlisted tables are skipped; no manifest fails the run
+
+#ifndef ACPI_PATCHER_VERIFY
+#define ACPI_PATCHER_VERIFY ACPI_VERIFY_OFF  // Default for --verify; DXE builds may set it with -D
+#endif
+
+#ifndef ACPI_PATCHER_HOOK_INSTALL
+#define ACPI_PATCHER_HOOK_INSTALL FALSE // DXE only: replace tables as the firmware installs them (see AcpiHook.h)
+#endif
+
+#ifndef ACPI_PATCHER_DEADLINE_MS
+#define ACPI_PATCHER_DEADLINE_MS 0      // Default for --deadline, 0 for none; DXE builds may set it with -D
+#endif
+
+#ifndef ACPI_PATCHER_REGRESSION_PERCENT
+#define ACPI_PATCHER_REGRESSION_PERCENT 25  // Slowdown over the history baseline reported as a regression
+#endif
+
+//
+// Share of the deadline kept for validation and the commit once tables are read
+//
+#define ACPI_DEADLINE_RESERVE_DIVISOR 8
+
+#ifndef DEBUG_LEVEL
+#define DEBUG_LEVEL DEBUG_INFO  // Default debug level
+#endif
+
+//
+// Helper macros
+//
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+// Safe pointer to integer conversion for debug output
+#ifdef MDE_CPU_IA32
+#define PTR_TO_INT(ptr) ((UINT32)(UINTN)(ptr))
+#define PTR_FMT L"0x%x"
+#else
+#define PTR_TO_INT(ptr) ((UINT64)(UINTN)(ptr))
+#define PTR_FMT L"0x%llx"
+#endif
+
+//
+// Run options; parsed from the command line by the application, defaults in DXE
+//
+typedef struct {
+  BOOLEAN  DryRun;          ///< Plan against scratch root tables, never commit
+  UINT32   Repeat;          ///< Benchmark iterations, 0 for a normal run
+  UINTN    DebugLevel;      ///< Console verbosity, DEBUG_ERROR .. DEBUG_VERBOSE
+  CHAR16   ExportDir[ACPI_FILE_NAME_LENGTH];  ///< Export live tables here instead of patching
+  BOOLEAN  ExportBundle;    ///< Export into one bundle file instead of one file per table
+  BOOLEAN  Consolidate;     ///< Merge small compatible SSDTs before installing
+  BOOLEAN  DirectFat;       ///< Read tables through FatReader instead of the firmware file system
+  UINT32   ReadStrategy;    ///< ACPI_READ_STRATEGY for table files; AcpiReadStrategyMax benchmarks each
+  BOOLEAN  RecordIo;        ///< Record the file system latency profile instead of patching
+  BOOLEAN  ReloadAll;       ///< Reread every file instead of keeping tables unchanged since the last run
+  UINT32   Verify;          ///< ACPI_VERIFY_* digest policy
+  UINT32   DeadlineMs;      ///< Defer optional tables that would finish past this many ms, 0 for none
+  UINT32   NvCommand;       ///< ACPI_NV_COMMAND to run on the NVRAM table store instead of patching
+  CHAR16   NvName[ACPI_FILE_NAME_LENGTH];  ///< Table file for the NVRAM store command
+} ACPI_PATCHER_OPTIONS;
+
+//
+// XSDT walk callback; return TRUE to stop the walk
+//
+typedef
+BOOLEAN
+(*ACPI_XSDT_VISITOR) (
+  IN EFI_ACPI_SDT_HEADER  *Table,
+  IN UINTN                Index,
+  IN VOID                 *Context
+  );
+
+//
+// Global Variables
+//
+extern EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  *gRsdp;
+extern EFI_ACPI_SDT_HEADER                           *gXsdt;
+extern EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE     *gFacp;
+extern UINT64                                        gXsdtEnd;
+extern BOOLEAN                                       gIsEfi1x;
+extern ACPI_PATCHER_OPTIONS                          gOptions;
+
+//
+// Function Declarations
+//
+VOID
+AcpiDebugPrint (
+  IN UINTN         Level,
+  IN CONST CHAR16  *Format,
+  ...
+  );
+
+VOID
+SelectivePrint (
+  IN CONST CHAR16  *Format,
+  ...
+  );
+
+VOID
+HexDump (
+  IN VOID    *Data,
+  IN UINTN   Size,
+  IN UINTN   Address
+  );
+
+EFI_STATUS
+ValidateAcpiTable (
+  IN VOID    *TableBuffer,
+  IN UINTN   BufferSize
+  );
+
+BOOLEAN
+DetectEfiFirmwareVersion (
+  IN EFI_SYSTEM_TABLE *SystemTable
+  );
+
+UINTN
+AcpiWalkXsdt (
+  IN ACPI_XSDT_VISITOR  Visitor,
+  IN VOID               *Context
+  );
+
+EFI_STATUS
+FindFacp (
+  VOID
+  );
+
+EFI_STATUS
+AcpiLocateRootTables (
+  VOID
+  );
+
+EFI_STATUS
+PatchAcpi (
+  IN EFI_FILE_PROTOCOL* Directory OPTIONAL
+  );
+
+EFI_STATUS
+AcpiParseOptions (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+EFI_STATUS
+AcpiRunBenchmark (
+  IN EFI_FILE_PROTOCOL  *Directory
+  );
+
+EFI_STATUS
+AcpiExportTables (
+  IN EFI_FILE_PROTOCOL  *BaseDir
+  );
+
+EFI_STATUS
+AcpiPatcherInstallProtocol (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+#endif // __ACPI_PATCHER_H__
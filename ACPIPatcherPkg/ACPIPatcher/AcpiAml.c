@@ -0,0 +1,804 @@
+/** @file
+
+  SSDTs compiled at boot from a device property config.
+
+  The config is parsed once into a property list. The list is then emitted
+  twice by the same code: first with no output buffer to measure the table,
+  then into a scratch buffer. A PkgLength is written as four reserved bytes
+  and shrunk to its shortest encoding when its package is closed, so both
+  passes agree on every length, but while packages are open the encoding
+  runs ahead of the final size by up to three bytes for each of them. The
+  measure pass records that high-water mark to size the scratch buffer,
+  and the finished table is copied out to a pool buffer of its exact size.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "AcpiAml.h"
+#include "AcpiMemory.h"
+
+//
+// AML encodings used by the generated table (ACPI 6.4, section 20)
+//
+#define AML_ZERO_OP             0x00
+#define AML_ONE_OP              0x01
+#define AML_NAME_OP             0x08
+#define AML_BYTE_PREFIX         0x0A
+#define AML_WORD_PREFIX         0x0B
+#define AML_DWORD_PREFIX        0x0C
+#define AML_STRING_PREFIX       0x0D
+#define AML_QWORD_PREFIX        0x0E
+#define AML_SCOPE_OP            0x10
+#define AML_BUFFER_OP           0x11
+#define AML_PACKAGE_OP          0x12
+#define AML_METHOD_OP           0x14
+#define AML_EXTERNAL_OP         0x15
+#define AML_DUAL_NAME_PREFIX    0x2E
+#define AML_MULTI_NAME_PREFIX   0x2F
+#define AML_ROOT_CHAR           0x5C
+#define AML_ARG2                0x6A
+#define AML_LEQUAL_OP           0x93
+#define AML_IF_OP               0xA0
+#define AML_RETURN_OP           0xA4
+#define AML_ONES_OP             0xFF
+
+#define AML_OBJECT_TYPE_DEVICE  0x06
+#define AML_NAME_SEG_SIZE       4
+#define AML_PKG_LENGTH_MAX      4
+
+//
+// Root prefix, multi-name prefix and count, then the segments
+//
+#define ACPI_AML_PATH_SIZE      (3 + ACPI_AML_MAX_SEGMENTS * AML_NAME_SEG_SIZE)
+
+typedef enum {
+  AcpiAmlValueString,
+  AcpiAmlValueInteger,
+  AcpiAmlValueData,
+  AcpiAmlValueStatus        ///< _STA, emitted as a named integer instead of a _DSM property
+} ACPI_AML_VALUE_TYPE;
+
+typedef struct {
+  UINT8                Path[ACPI_AML_PATH_SIZE];   ///< Device NameString
+  UINT32               PathSize;
+  ACPI_AML_VALUE_TYPE  Type;
+  CONST CHAR8          *Property;
+  UINT32               PropertyLength;
+  CONST CHAR8          *Value;                     ///< String text or hex digits
+  UINT32               ValueLength;
+  UINT64               Integer;                    ///< Integer value, or data byte count
+} ACPI_AML_PROPERTY;
+
+typedef struct {
+  UINT8   *Buffer;      ///< Output, or NULL to measure
+  UINT32  Used;
+  UINT32  Peak;         ///< Largest Used so far, with open PkgLengths at full size
+} ACPI_AML_WRITER;
+
+BOOLEAN
+AcpiAmlIsConfig (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINTN  Length;
+  UINTN  SuffixLength;
+
+  Length       = StrLen(Name);
+  SuffixLength = StrLen(ACPI_AML_CONFIG_SUFFIX);
+  return (BOOLEAN)(Length > SuffixLength && StrCmp(Name + Length - SuffixLength, ACPI_AML_CONFIG_SUFFIX) == 0);
+}
+
+STATIC
+BOOLEAN
+AcpiAmlIsBlank (
+  IN CHAR8  Char
+  )
+{
+  return (BOOLEAN)(Char == ' ' || Char == '\t' || Char == '\r');
+}
+
+STATIC
+INTN
+AcpiAmlHexDigit (
+  IN CHAR8  Char
+  )
+{
+  if (Char >= '0' && Char <= '9') {
+    return Char - '0';
+  }
+  if (Char >= 'a' && Char <= 'f') {
+    return Char - 'a' + 10;
+  }
+  if (Char >= 'A' && Char <= 'F') {
+    return Char - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+  Returns the next blank-separated token of a line.
+
+  @param[in,out] Cursor   Position in the line; advanced past the token
+  @param[in]     End      End of the line
+  @param[out]    Length   Token length, 0 at the end of the line
+**/
+STATIC
+CONST CHAR8 *
+AcpiAmlToken (
+  IN OUT CONST CHAR8  **Cursor,
+  IN     CONST CHAR8  *End,
+  OUT    UINT32       *Length
+  )
+{
+  CONST CHAR8  *Token;
+
+  while (*Cursor < End && AcpiAmlIsBlank(**Cursor)) {
+    (*Cursor)++;
+  }
+  Token = *Cursor;
+  while (*Cursor < End && !AcpiAmlIsBlank(**Cursor)) {
+    (*Cursor)++;
+  }
+  *Length = (UINT32)(*Cursor - Token);
+  return Token;
+}
+
+/**
+  Returns TRUE if Length characters of Text equal the NUL-terminated Word.
+**/
+STATIC
+BOOLEAN
+AcpiAmlTokenIs (
+  IN CONST CHAR8  *Text,
+  IN UINT32       Length,
+  IN CONST CHAR8  *Word
+  )
+{
+  return (BOOLEAN)(Length == AsciiStrLen(Word) && CompareMem(Text, Word, Length) == 0);
+}
+
+/**
+  Encodes an absolute device path such as \_SB.PCI0.GFX0 as a NameString.
+  Segments shorter than four characters are padded with underscores.
+
+  @param[in]  Text       Path text
+  @param[in]  Length     Path length
+  @param[out] Property   Receives Path and PathSize
+
+  @return FALSE if the path is not absolute or a segment is not a valid name
+**/
+STATIC
+BOOLEAN
+AcpiAmlEncodePath (
+  IN  CONST CHAR8        *Text,
+  IN  UINT32             Length,
+  OUT ACPI_AML_PROPERTY  *Property
+  )
+{
+  UINT32  Segments;
+  UINT32  Index;
+  UINT32  SegmentLength;
+  UINT8   *Out;
+  CHAR8   Char;
+
+  if (Length < 2 || Text[0] != '\\') {
+    return FALSE;
+  }
+
+  Segments = 1;
+  for (Index = 1; Index < Length; Index++) {
+    Segments += (Text[Index] == '.') ? 1 : 0;
+  }
+  if (Segments > ACPI_AML_MAX_SEGMENTS) {
+    return FALSE;
+  }
+
+  Out    = Property->Path;
+  *Out++ = AML_ROOT_CHAR;
+  if (Segments == 2) {
+    *Out++ = AML_DUAL_NAME_PREFIX;
+  } else if (Segments > 2) {
+    *Out++ = AML_MULTI_NAME_PREFIX;
+    *Out++ = (UINT8)Segments;
+  }
+
+  SegmentLength = 0;
+  for (Index = 1; Index <= Length; Index++) {
+    if (Index == Length || Text[Index] == '.') {
+      if (SegmentLength == 0) {
+        return FALSE;
+      }
+      for (; SegmentLength < AML_NAME_SEG_SIZE; SegmentLength++) {
+        *Out++ = '_';
+      }
+      SegmentLength = 0;
+      continue;
+    }
+
+    Char = Text[Index];
+    if (SegmentLength == AML_NAME_SEG_SIZE ||
+        !((Char >= 'A' && Char <= 'Z') || Char == '_' || (SegmentLength > 0 && Char >= '0' && Char <= '9'))) {
+      return FALSE;
+    }
+    *Out++ = (UINT8)Char;
+    SegmentLength++;
+  }
+
+  Property->PathSize = (UINT32)(Out - Property->Path);
+  return TRUE;
+}
+
+/**
+  Parses a decimal or 0x-prefixed hex integer.
+
+  @return FALSE if the text is not a number or does not fit 64 bits
+**/
+STATIC
+BOOLEAN
+AcpiAmlParseInteger (
+  IN  CONST CHAR8  *Text,
+  IN  UINT32       Length,
+  OUT UINT64       *Value
+  )
+{
+  UINT32  Index;
+  UINT32  Base;
+  INTN    Digit;
+
+  Base  = 10;
+  Index = 0;
+  if (Length > 2 && Text[0] == '0' && (Text[1] == 'x' || Text[1] == 'X')) {
+    Base  = 16;
+    Index = 2;
+  }
+  if (Index == Length) {
+    return FALSE;
+  }
+
+  *Value = 0;
+  for (; Index < Length; Index++) {
+    Digit = AcpiAmlHexDigit(Text[Index]);
+    if (Digit < 0 || (UINT32)Digit >= Base ||
+        *Value > DivU64x32(MAX_UINT64 - (UINT64)Digit, Base)) {
+      return FALSE;
+    }
+    *Value = MultU64x32(*Value, Base) + (UINT64)Digit;
+  }
+  return TRUE;
+}
+
+/**
+  Counts the bytes of a hex data value; blanks may separate bytes.
+
+  @return FALSE if the value holds anything but whole hex bytes, or none
+**/
+STATIC
+BOOLEAN
+AcpiAmlParseData (
+  IN  CONST CHAR8  *Text,
+  IN  UINT32       Length,
+  OUT UINT64       *Count
+  )
+{
+  UINT32  Index;
+
+  *Count = 0;
+  Index  = 0;
+  while (Index < Length) {
+    if (AcpiAmlIsBlank(Text[Index])) {
+      Index++;
+      continue;
+    }
+    if (Index + 1 >= Length || AcpiAmlHexDigit(Text[Index]) < 0 || AcpiAmlHexDigit(Text[Index + 1]) < 0) {
+      return FALSE;
+    }
+    Index += 2;
+    (*Count)++;
+  }
+  return (BOOLEAN)(*Count > 0);
+}
+
+/**
+  Parses one non-blank, non-comment config line.
+
+  @param[in]  Line       First character of the line
+  @param[in]  End        End of the line, blanks trimmed
+  @param[out] Property   Parsed property
+
+  @return NULL on success, otherwise what is wrong with the line
+**/
+STATIC
+CONST CHAR16 *
+AcpiAmlParseLine (
+  IN  CONST CHAR8        *Line,
+  IN  CONST CHAR8        *End,
+  OUT ACPI_AML_PROPERTY  *Property
+  )
+{
+  CONST CHAR8  *Cursor;
+  CONST CHAR8  *Path;
+  CONST CHAR8  *Type;
+  UINT32       PathLength;
+  UINT32       TypeLength;
+  UINT32       Index;
+
+  ZeroMem(Property, sizeof(*Property));
+  Cursor = Line;
+  Path   = AcpiAmlToken(&Cursor, End, &PathLength);
+  Property->Property = AcpiAmlToken(&Cursor, End, &Property->PropertyLength);
+  Type   = AcpiAmlToken(&Cursor, End, &TypeLength);
+  while (Cursor < End && AcpiAmlIsBlank(*Cursor)) {
+    Cursor++;
+  }
+  Property->Value       = Cursor;
+  Property->ValueLength = (UINT32)(End - Cursor);
+
+  if (Property->ValueLength == 0 && !AcpiAmlTokenIs(Type, TypeLength, "string")) {
+    return L"expected <path> <property> <string|int|data> <value>";
+  }
+  if (!AcpiAmlEncodePath(Path, PathLength, Property)) {
+    return L"device path must be absolute, with segments of up to four A-Z, 0-9 or _";
+  }
+  for (Index = 0; Index < Property->PropertyLength; Index++) {
+    if (Property->Property[Index] < 0x21 || Property->Property[Index] > 0x7E) {
+      return L"property names are limited to printable ASCII";
+    }
+  }
+
+  if (AcpiAmlTokenIs(Type, TypeLength, "string")) {
+    Property->Type = AcpiAmlValueString;
+    if (Property->ValueLength >= 2 && Property->Value[0] == '"' &&
+        Property->Value[Property->ValueLength - 1] == '"') {
+      Property->Value++;
+      Property->ValueLength -= 2;
+    }
+    for (Index = 0; Index < Property->ValueLength; Index++) {
+      if (Property->Value[Index] < 0x20 || Property->Value[Index] > 0x7E) {
+        return L"strings are limited to printable ASCII";
+      }
+    }
+  } else if (AcpiAmlTokenIs(Type, TypeLength, "int")) {
+    Property->Type = AcpiAmlValueInteger;
+    if (!AcpiAmlParseInteger(Property->Value, Property->ValueLength, &Property->Integer)) {
+      return L"int values are decimal or 0x hex and fit 64 bits";
+    }
+  } else if (AcpiAmlTokenIs(Type, TypeLength, "data")) {
+    Property->Type = AcpiAmlValueData;
+    if (!AcpiAmlParseData(Property->Value, Property->ValueLength, &Property->Integer)) {
+      return L"data values are one or more hex bytes";
+    }
+  } else {
+    return L"type must be string, int or data";
+  }
+
+  if (AcpiAmlTokenIs(Property->Property, Property->PropertyLength, "_STA")) {
+    if (Property->Type != AcpiAmlValueInteger) {
+      return L"_STA takes an int value";
+    }
+    Property->Type = AcpiAmlValueStatus;
+  }
+  return NULL;
+}
+
+/**
+  Returns TRUE if two properties belong to the same device.
+**/
+STATIC
+BOOLEAN
+AcpiAmlSameDevice (
+  IN CONST ACPI_AML_PROPERTY  *Left,
+  IN CONST ACPI_AML_PROPERTY  *Right
+  )
+{
+  return (BOOLEAN)(Left->PathSize == Right->PathSize && CompareMem(Left->Path, Right->Path, Left->PathSize) == 0);
+}
+
+/**
+  Returns TRUE if two properties of the same device share a name.
+**/
+STATIC
+BOOLEAN
+AcpiAmlSameProperty (
+  IN CONST ACPI_AML_PROPERTY  *Left,
+  IN CONST ACPI_AML_PROPERTY  *Right
+  )
+{
+  return (BOOLEAN)(AcpiAmlSameDevice(Left, Right) &&
+                   Left->PropertyLength == Right->PropertyLength &&
+                   CompareMem(Left->Property, Right->Property, Left->PropertyLength) == 0);
+}
+
+STATIC
+VOID
+AcpiAmlBytes (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     CONST VOID       *Data,
+  IN     UINT32           Length
+  )
+{
+  if (Writer->Buffer != NULL) {
+    CopyMem(Writer->Buffer + Writer->Used, Data, Length);
+  }
+  Writer->Used += Length;
+  Writer->Peak  = MAX(Writer->Peak, Writer->Used);
+}
+
+STATIC
+VOID
+AcpiAmlByte (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     UINT8            Byte
+  )
+{
+  AcpiAmlBytes(Writer, &Byte, 1);
+}
+
+/**
+  Writes Op and reserves the largest PkgLength after it.
+
+  @return Offset of the PkgLength, for AcpiAmlClose
+**/
+STATIC
+UINT32
+AcpiAmlOpen (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     UINT8            Op
+  )
+{
+  UINT32  Mark;
+
+  AcpiAmlByte(Writer, Op);
+  Mark = Writer->Used;
+  Writer->Used += AML_PKG_LENGTH_MAX;
+  Writer->Peak  = MAX(Writer->Peak, Writer->Used);
+  return Mark;
+}
+
+/**
+  Encodes the PkgLength of the package opened at Mark in as few bytes as
+  it needs, counting its own, and moves the package body up behind it.
+**/
+STATIC
+VOID
+AcpiAmlClose (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     UINT32           Mark
+  )
+{
+  UINT32  Body;
+  UINT32  Size;
+  UINT32  Length;
+  UINT32  Index;
+  UINT8   *Out;
+
+  Body = Writer->Used - Mark - AML_PKG_LENGTH_MAX;
+  if (Body + 1 <= 0x3F) {
+    Size = 1;
+  } else if (Body + 2 <= 0xFFF) {
+    Size = 2;
+  } else if (Body + 3 <= 0xFFFFF) {
+    Size = 3;
+  } else {
+    Size = 4;
+  }
+
+  if (Writer->Buffer != NULL) {
+    Out    = Writer->Buffer + Mark;
+    Length = Body + Size;
+    CopyMem(Out + Size, Out + AML_PKG_LENGTH_MAX, Body);
+    if (Size == 1) {
+      Out[0] = (UINT8)Length;
+    } else {
+      // Low nibble in the lead byte with the count of bytes that follow, then whole bytes
+      Out[0] = (UINT8)(((Size - 1) << 6) | (Length & 0x0F));
+      for (Index = 1; Index < Size; Index++) {
+        Out[Index] = (UINT8)(Length >> (4 + 8 * (Index - 1)));
+      }
+    }
+  }
+  Writer->Used -= AML_PKG_LENGTH_MAX - Size;
+}
+
+STATIC
+VOID
+AcpiAmlInteger (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     UINT64           Value
+  )
+{
+  if (Value == 0) {
+    AcpiAmlByte(Writer, AML_ZERO_OP);
+  } else if (Value == 1) {
+    AcpiAmlByte(Writer, AML_ONE_OP);
+  } else if (Value == MAX_UINT64) {
+    AcpiAmlByte(Writer, AML_ONES_OP);
+  } else if (Value <= MAX_UINT8) {
+    AcpiAmlByte(Writer, AML_BYTE_PREFIX);
+    AcpiAmlBytes(Writer, &Value, 1);
+  } else if (Value <= MAX_UINT16) {
+    AcpiAmlByte(Writer, AML_WORD_PREFIX);
+    AcpiAmlBytes(Writer, &Value, 2);
+  } else if (Value <= MAX_UINT32) {
+    AcpiAmlByte(Writer, AML_DWORD_PREFIX);
+    AcpiAmlBytes(Writer, &Value, 4);
+  } else {
+    AcpiAmlByte(Writer, AML_QWORD_PREFIX);
+    AcpiAmlBytes(Writer, &Value, 8);
+  }
+}
+
+STATIC
+VOID
+AcpiAmlString (
+  IN OUT ACPI_AML_WRITER  *Writer,
+  IN     CONST CHAR8      *Text,
+  IN     UINT32           Length
+  )
+{
+  AcpiAmlByte(Writer, AML_STRING_PREFIX);
+  AcpiAmlBytes(Writer, Text, Length);
+  AcpiAmlByte(Writer, 0);
+}
+
+/**
+  Writes a property value as a _DSM package element.
+**/
+STATIC
+VOID
+AcpiAmlValue (
+  IN OUT ACPI_AML_WRITER          *Writer,
+  IN     CONST ACPI_AML_PROPERTY  *Property
+  )
+{
+  UINT32  Mark;
+  UINT32  Index;
+
+  if (Property->Type == AcpiAmlValueString) {
+    AcpiAmlString(Writer, Property->Value, Property->ValueLength);
+  } else if (Property->Type == AcpiAmlValueInteger) {
+    AcpiAmlInteger(Writer, Property->Integer);
+  } else {
+    Mark = AcpiAmlOpen(Writer, AML_BUFFER_OP);
+    AcpiAmlInteger(Writer, Property->Integer);
+    for (Index = 0; Index < Property->ValueLength; Index++) {
+      if (!AcpiAmlIsBlank(Property->Value[Index])) {
+        AcpiAmlByte(Writer, (UINT8)((AcpiAmlHexDigit(Property->Value[Index]) << 4) |
+                                    AcpiAmlHexDigit(Property->Value[Index + 1])));
+        Index++;
+      }
+    }
+    AcpiAmlClose(Writer, Mark);
+  }
+}
+
+/**
+  Writes the definition block body: for each device in order of first
+  appearance, External (Path, DeviceObj) and a Scope holding its _STA and
+  a _DSM returning its properties.
+
+    Method (_DSM, 4, NotSerialized)
+    {
+      If (LEqual (Arg2, Zero)) { Return (Buffer (One) { 0x03 }) }
+      Return (Package () { "name", value, ... })
+    }
+**/
+STATIC
+VOID
+AcpiAmlEmit (
+  IN OUT ACPI_AML_WRITER          *Writer,
+  IN     CONST ACPI_AML_PROPERTY  *Properties,
+  IN     UINT32                   Count
+  )
+{
+  CONST ACPI_AML_PROPERTY  *Device;
+  UINT32                   Index;
+  UINT32                   Other;
+  UINT32                   Listed;
+  UINT32                   Scope;
+  UINT32                   Method;
+  UINT32                   Mark;
+
+  for (Index = 0; Index < Count; Index++) {
+    Device = &Properties[Index];
+    for (Other = 0; Other < Index && !AcpiAmlSameDevice(&Properties[Other], Device); Other++) {
+    }
+    if (Other < Index) {
+      continue;
+    }
+
+    AcpiAmlByte(Writer, AML_EXTERNAL_OP);
+    AcpiAmlBytes(Writer, Device->Path, Device->PathSize);
+    AcpiAmlByte(Writer, AML_OBJECT_TYPE_DEVICE);
+    AcpiAmlByte(Writer, 0);
+
+    Scope  = AcpiAmlOpen(Writer, AML_SCOPE_OP);
+    AcpiAmlBytes(Writer, Device->Path, Device->PathSize);
+    Listed = 0;
+    for (Other = Index; Other < Count; Other++) {
+      if (!AcpiAmlSameDevice(&Properties[Other], Device)) {
+        continue;
+      }
+      if (Properties[Other].Type == AcpiAmlValueStatus) {
+        AcpiAmlByte(Writer, AML_NAME_OP);
+        AcpiAmlBytes(Writer, "_STA", AML_NAME_SEG_SIZE);
+        AcpiAmlInteger(Writer, Properties[Other].Integer);
+      } else {
+        Listed++;
+      }
+    }
+
+    if (Listed > 0) {
+      Method = AcpiAmlOpen(Writer, AML_METHOD_OP);
+      AcpiAmlBytes(Writer, "_DSM", AML_NAME_SEG_SIZE);
+      AcpiAmlByte(Writer, 4);
+
+      Mark = AcpiAmlOpen(Writer, AML_IF_OP);
+      AcpiAmlByte(Writer, AML_LEQUAL_OP);
+      AcpiAmlByte(Writer, AML_ARG2);
+      AcpiAmlByte(Writer, AML_ZERO_OP);
+      AcpiAmlByte(Writer, AML_RETURN_OP);
+      Other = AcpiAmlOpen(Writer, AML_BUFFER_OP);
+      AcpiAmlByte(Writer, AML_ONE_OP);
+      AcpiAmlByte(Writer, 0x03);
+      AcpiAmlClose(Writer, Other);
+      AcpiAmlClose(Writer, Mark);
+
+      AcpiAmlByte(Writer, AML_RETURN_OP);
+      Mark = AcpiAmlOpen(Writer, AML_PACKAGE_OP);
+      AcpiAmlByte(Writer, (UINT8)(Listed * 2));
+      for (Other = Index; Other < Count; Other++) {
+        if (AcpiAmlSameDevice(&Properties[Other], Device) && Properties[Other].Type != AcpiAmlValueStatus) {
+          AcpiAmlString(Writer, Properties[Other].Property, Properties[Other].PropertyLength);
+          AcpiAmlValue(Writer, &Properties[Other]);
+        }
+      }
+      AcpiAmlClose(Writer, Mark);
+      AcpiAmlClose(Writer, Method);
+    }
+    AcpiAmlClose(Writer, Scope);
+  }
+}
+
+/**
+  Parses a config into Properties, reporting each line in error.
+
+  @return Number of properties, or MAX_UINT32 if a line is in error
+**/
+STATIC
+UINT32
+AcpiAmlParse (
+  IN  CONST CHAR8        *Config,
+  IN  UINTN              ConfigSize,
+  OUT ACPI_AML_PROPERTY  *Properties
+  )
+{
+  CONST CHAR8   *Line;
+  CONST CHAR8   *End;
+  CONST CHAR8   *ConfigEnd;
+  CONST CHAR16  *Error;
+  UINT32        LineNumber;
+  UINT32        Count;
+  UINT32        Other;
+  UINT32        Listed;
+  BOOLEAN       Failed;
+
+  Count      = 0;
+  Failed     = FALSE;
+  LineNumber = 0;
+  ConfigEnd  = Config + ConfigSize;
+  for (Line = Config; Line < ConfigEnd; Line = End + 1) {
+    LineNumber++;
+    for (End = Line; End < ConfigEnd && *End != '\n'; End++) {
+    }
+    while (Line < End && AcpiAmlIsBlank(*Line)) {
+      Line++;
+    }
+    if (Line == End || *Line == '#') {
+      continue;
+    }
+    if (Count == ACPI_AML_MAX_PROPERTIES) {
+      AcpiDebugPrint(DEBUG_ERROR, L"  Line %u: more than %u properties\n", LineNumber, ACPI_AML_MAX_PROPERTIES);
+      return MAX_UINT32;
+    }
+
+    while (AcpiAmlIsBlank(End[-1])) {
+      End--;
+    }
+    Error = AcpiAmlParseLine(Line, End, &Properties[Count]);
+    while (End < ConfigEnd && *End != '\n') {
+      End++;
+    }
+    if (Error == NULL) {
+      Listed = 0;
+      for (Other = 0; Other < Count; Other++) {
+        if (AcpiAmlSameProperty(&Properties[Other], &Properties[Count])) {
+          Error = L"property already set for this device";
+          break;
+        }
+        if (AcpiAmlSameDevice(&Properties[Other], &Properties[Count]) && Properties[Other].Type != AcpiAmlValueStatus) {
+          Listed++;
+        }
+      }
+      if (Error == NULL && Listed == ACPI_AML_MAX_DSM_PROPERTIES && Properties[Count].Type != AcpiAmlValueStatus) {
+        Error = L"too many properties for this device";
+      }
+    }
+    if (Error != NULL) {
+      AcpiDebugPrint(DEBUG_ERROR, L"  Line %u: %s\n", LineNumber, Error);
+      Failed = TRUE;
+      continue;
+    }
+    Count++;
+  }
+
+  return Failed ? MAX_UINT32 : Count;
+}
+
+EFI_STATUS
+AcpiAmlBuildSsdt (
+  IN  CONST VOID  *Config,
+  IN  UINTN       ConfigSize,
+  OUT VOID        **Table,
+  OUT UINTN       *TableSize
+  )
+{
+  EFI_STATUS           Status;
+  ACPI_AML_PROPERTY    *Properties;
+  ACPI_AML_WRITER      Writer;
+  EFI_ACPI_SDT_HEADER  *Ssdt;
+  UINT8                *Scratch;
+  UINT32               Count;
+
+  Status = AcpiAllocatePool(EfiBootServicesData, ACPI_AML_MAX_PROPERTIES * sizeof(ACPI_AML_PROPERTY),
+                            (VOID **)&Properties);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Count = AcpiAmlParse((CONST CHAR8 *)Config, ConfigSize, Properties);
+  if (Count == MAX_UINT32 || Count == 0) {
+    AcpiFreePool(Properties);
+    return (Count == 0) ? EFI_NOT_FOUND : EFI_INVALID_PARAMETER;
+  }
+
+  // Measure, encode into a scratch buffer of the peak size, then copy out the exact size
+  Writer.Buffer = NULL;
+  Writer.Used   = sizeof(EFI_ACPI_SDT_HEADER);
+  Writer.Peak   = Writer.Used;
+  AcpiAmlEmit(&Writer, Properties, Count);
+  Status = AcpiAllocatePool(EfiBootServicesData, Writer.Peak, (VOID **)&Scratch);
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(Properties);
+    return Status;
+  }
+  Status = AcpiAllocatePool(EfiRuntimeServicesData, Writer.Used, (VOID **)&Ssdt);
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(Scratch);
+    AcpiFreePool(Properties);
+    return Status;
+  }
+  Writer.Buffer = Scratch;
+  Writer.Used   = sizeof(EFI_ACPI_SDT_HEADER);
+  AcpiAmlEmit(&Writer, Properties, Count);
+  AcpiFreePool(Properties);
+  CopyMem(Ssdt, Scratch, Writer.Used);
+  AcpiFreePool(Scratch);
+
+  Ssdt->Signature       = EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE;
+  Ssdt->Length          = Writer.Used;
+  Ssdt->Revision        = EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_REVISION;
+  Ssdt->Checksum        = 0;
+  CopyMem(Ssdt->OemId, gXsdt->OemId, sizeof(Ssdt->OemId));
+  CopyMem(Ssdt->OemTableId, ACPI_AML_OEM_TABLE_ID, sizeof(Ssdt->OemTableId));
+  Ssdt->OemRevision     = Count;
+  Ssdt->CreatorId       = SIGNATURE_32('A', 'P', 'C', 'H');
+  Ssdt->CreatorRevision = (ACPI_PATCHER_VERSION_MAJOR << 16) | ACPI_PATCHER_VERSION_MINOR;
+  Ssdt->Checksum        = CalculateCheckSum8((UINT8 *)Ssdt, Ssdt->Length);
+
+  *Table     = Ssdt;
+  *TableSize = Ssdt->Length;
+  return EFI_SUCCESS;
+}
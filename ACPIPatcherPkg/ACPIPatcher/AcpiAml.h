@@ -0,0 +1,73 @@
+/** @file
+
+  SSDTs compiled at boot from a device property config.
+
+  A table file whose name ends in ACPI_AML_CONFIG_SUFFIX, such as
+  SSDT-PROPS.aml.cfg, is read as a config and compiled to one SSDT; like
+  any table file its name must contain .aml. The manifest digest of a
+  config covers the config file. Each line declares one property:
+
+    # Path            Property               Type    Value
+    \_SB.PCI0.GFX0    AAPL,ig-platform-id    data    0300923E
+    \_SB.PCI0.GFX0    model                  string  "Intel UHD Graphics 630"
+    \_SB.PCI0.GFX0    hda-gfx                string  onboard-1
+    \_SB.PCI0.RP05    _STA                   int     0
+
+  Types are string (optionally quoted, up to the end of the line), int
+  (decimal or 0x hex) and data (hex bytes, blanks allowed between bytes).
+  Blank lines and lines starting with # are ignored.
+
+  The properties of a device are returned from a generated
+  Method (_DSM, 4) in the Apple device property layout. The property _STA
+  with an int value is emitted as Name (_STA, Value) instead, to enable or
+  disable the device. Both are added to the device with Scope, so a device
+  that already has its own _DSM or _STA cannot be changed this way.
+
+**/
+
+#ifndef __ACPI_AML_H__
+#define __ACPI_AML_H__
+
+#include "ACPIPatcher.h"
+
+#define ACPI_AML_CONFIG_SUFFIX      L".cfg"
+#define ACPI_AML_OEM_TABLE_ID       "APCONFIG"
+
+#define ACPI_AML_MAX_PROPERTIES     256   ///< Lines per config
+#define ACPI_AML_MAX_DSM_PROPERTIES 127   ///< Properties per device, two package elements each
+#define ACPI_AML_MAX_SEGMENTS       16    ///< Name segments per device path
+
+/**
+  Returns TRUE if a table file holds a device property config.
+
+  @param[in] Name   Table file name
+**/
+BOOLEAN
+AcpiAmlIsConfig (
+  IN CONST CHAR16  *Name
+  );
+
+/**
+  Compiles a device property config to an SSDT. The table is measured
+  first, then encoded and returned in a pool buffer of its exact size.
+  Lines in error are reported with their line numbers.
+
+  @param[in]  Config       Config file contents
+  @param[in]  ConfigSize   Size of the config file
+  @param[out] Table        Compiled SSDT; freed by the caller
+  @param[out] TableSize    Length of the compiled SSDT
+
+  @retval EFI_SUCCESS               Table compiled
+  @retval EFI_INVALID_PARAMETER     Malformed line, or a limit above exceeded
+  @retval EFI_NOT_FOUND             The config declares no properties
+  @retval EFI_OUT_OF_RESOURCES      Memory allocation failed
+**/
+EFI_STATUS
+AcpiAmlBuildSsdt (
+  IN  CONST VOID  *Config,
+  IN  UINTN       ConfigSize,
+  OUT VOID        **Table,
+  OUT UINTN       *TableSize
+  );
+
+#endif // __ACPI_AML_H__
@@ -0,0 +1,313 @@
+/** @file
+
+  Repeated dry-run benchmark for the ACPIPatcher application.
+
+  Runs the full enumerate/read/validate/plan pipeline against the real
+  firmware filesystem driver several times and reports min/median/max per
+  phase plus read throughput by file size class, so storage types and
+  firmware generations can be compared on the actual hardware. With
+  --strategy all each table read strategy is measured in turn and their
+  median totals are compared. The cost per MB of each SHA-256
+  implementation the CPU supports follows, for choosing --verify.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiPerf.h"
+#include "AcpiMemory.h"
+#include "AcpiSource.h"
+#include "AcpiSha256.h"
+
+//
+// One sample row per phase plus the run total
+//
+#define BENCH_ROWS  (AcpiPhaseMax + 1)
+
+#define BENCH_SHA256_SIZE   SIZE_1MB
+
+/**
+  Sorts samples in ascending order. Counts are small, insertion sort is enough.
+
+  @param[in,out] Samples  Samples to sort
+  @param[in]     Count    Number of samples
+**/
+STATIC
+VOID
+AcpiSortSamples (
+  IN OUT UINT64  *Samples,
+  IN     UINTN   Count
+  )
+{
+  UINTN   Index;
+  UINTN   Slot;
+  UINT64  Value;
+
+  for (Index = 1; Index < Count; Index++) {
+    Value = Samples[Index];
+    for (Slot = Index; Slot > 0 && Samples[Slot - 1] > Value; Slot--) {
+      Samples[Slot] = Samples[Slot - 1];
+    }
+    Samples[Slot] = Value;
+  }
+}
+
+/**
+  Prints min/median/max of one row of samples in microseconds.
+
+  @param[in]     Name     Row label
+  @param[in,out] Samples  Samples in nanoseconds, sorted in place
+  @param[in]     Count    Number of samples
+
+  @return Median in nanoseconds
+**/
+STATIC
+UINT64
+AcpiPrintSampleRow (
+  IN     CONST CHAR16  *Name,
+  IN OUT UINT64        *Samples,
+  IN     UINTN         Count
+  )
+{
+  UINT64  Median;
+
+  AcpiSortSamples(Samples, Count);
+
+  if ((Count % 2) == 0) {
+    Median = (Samples[Count / 2 - 1] + Samples[Count / 2]) / 2;
+  } else {
+    Median = Samples[Count / 2];
+  }
+
+  SelectivePrint(L"  %-10s %10llu %10llu %10llu\n", Name,
+                 DivU64x32(Samples[0], 1000),
+                 DivU64x32(Median, 1000),
+                 DivU64x32(Samples[Count - 1], 1000));
+
+  return Median;
+}
+
+/**
+  Runs gOptions.Repeat dry runs with the current read strategy and prints
+  their report.
+
+  @param[in]  Directory     ACPI directory to load from
+  @param[in]  Samples       Storage for BENCH_ROWS * gOptions.Repeat samples
+  @param[out] TotalMedian   Median run total in nanoseconds, 0 if no run completed
+
+  @retval EFI_SUCCESS   All iterations completed
+  @retval Other         An iteration failed; partial results are printed
+**/
+STATIC
+EFI_STATUS
+AcpiBenchmarkPass (
+  IN  EFI_FILE_PROTOCOL  *Directory,
+  IN  UINT64             *Samples,
+  OUT UINT64             *TotalMedian
+  )
+{
+  EFI_STATUS         Status;
+  ACPI_PATCHER_PERF  Sum;
+  UINT64             ColdNs;
+  UINT64             Median;
+  UINTN              SavedLevel;
+  UINTN              Repeat;
+  UINTN              Completed;
+  UINTN              Row;
+  UINTN              Class;
+
+  Repeat       = gOptions.Repeat;
+  *TotalMedian = 0;
+  Status       = EFI_SUCCESS;
+
+  ZeroMem(&Sum, sizeof(Sum));
+  ColdNs     = 0;
+  Median     = 0;
+  SavedLevel = gOptions.DebugLevel;
+  gOptions.DebugLevel = MIN(SavedLevel, DEBUG_WARN);
+
+  for (Completed = 0; Completed < Repeat; Completed++) {
+    Status = Directory->SetPosition(Directory, 0);
+    if (!EFI_ERROR(Status)) {
+      // Each pass gets the whole --deadline
+      AcpiPerfStartClock();
+      Status = PatchAcpi(Directory);
+    }
+    if (EFI_ERROR(Status)) {
+      break;
+    }
+
+    for (Row = 0; Row < AcpiPhaseMax; Row++) {
+      Samples[Row * Repeat + Completed] = gAcpiPerf.PhaseNs[Row];
+    }
+    Samples[AcpiPhaseMax * Repeat + Completed] = gAcpiPerf.TotalNs;
+
+    if (Completed == 0) {
+      ColdNs = gAcpiPerf.TotalNs;
+    }
+
+    for (Class = 0; Class < ACPI_SIZE_CLASS_COUNT; Class++) {
+      Sum.ClassBytes[Class] += gAcpiPerf.ClassBytes[Class];
+      Sum.ClassNs[Class]    += gAcpiPerf.ClassNs[Class];
+      Sum.ClassFiles[Class] += gAcpiPerf.ClassFiles[Class];
+    }
+    Sum.BytesRead       = gAcpiPerf.BytesRead;
+    Sum.FilesRead       = gAcpiPerf.FilesRead;
+    Sum.TablesInstalled = gAcpiPerf.TablesInstalled;
+  }
+
+  gOptions.DebugLevel = SavedLevel;
+
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Benchmark iteration %u failed: %r\n", (UINT32)(Completed + 1), Status);
+  }
+
+  if (Completed > 0) {
+    SelectivePrint(L"\nBenchmark: %u of %u dry runs, %u files, %llu bytes, %u tables per run, %s reads\n",
+                   (UINT32)Completed, (UINT32)Repeat, Sum.FilesRead, Sum.BytesRead, Sum.TablesInstalled,
+                   gAcpiReadStrategyNames[gOptions.ReadStrategy]);
+    SelectivePrint(L"  First run (cold): %llu us\n", DivU64x32(ColdNs, 1000));
+    SelectivePrint(L"  %-10s %10s %10s %10s\n", L"Phase", L"min us", L"median us", L"max us");
+    for (Row = 0; Row < BENCH_ROWS; Row++) {
+      Median = AcpiPrintSampleRow(Row < AcpiPhaseMax ? gAcpiPhaseNames[Row] : L"Total",
+                                  &Samples[Row * Repeat], Completed);
+    }
+    *TotalMedian = Median;
+
+    SelectivePrint(L"  Read throughput by file size:\n");
+    for (Class = 0; Class < ACPI_SIZE_CLASS_COUNT; Class++) {
+      if (Sum.ClassFiles[Class] == 0) {
+        continue;
+      }
+      SelectivePrint(L"  %-10s %6u reads %10llu bytes %8llu KB/s\n",
+                     gAcpiSizeClassNames[Class], Sum.ClassFiles[Class], Sum.ClassBytes[Class],
+                     AcpiPerfKbPerSecond(Sum.ClassBytes[Class], Sum.ClassNs[Class]));
+    }
+  }
+
+  return Status;
+}
+
+/**
+  Hashes 1 MB gOptions.Repeat times with each available SHA-256
+  implementation and prints the time per MB.
+
+  @param[in] Samples    Storage for gOptions.Repeat samples
+
+  @retval EFI_SUCCESS             Report printed
+  @retval EFI_OUT_OF_RESOURCES    Data buffer could not be allocated
+**/
+STATIC
+EFI_STATUS
+AcpiBenchmarkSha256 (
+  IN UINT64  *Samples
+  )
+{
+  EFI_STATUS        Status;
+  UINT8             *Data;
+  UINT8             Digest[ACPI_SHA256_DIGEST_SIZE];
+  ACPI_SHA256_IMPL  Active;
+  ACPI_SHA256_IMPL  Impl;
+  UINTN             Index;
+  UINT64            Start;
+
+  Status = AcpiAllocatePool(EfiBootServicesData, BENCH_SHA256_SIZE, (VOID**)&Data);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  for (Index = 0; Index < BENCH_SHA256_SIZE; Index++) {
+    Data[Index] = (UINT8)(Index * 31 + (Index >> 8));
+  }
+
+  Active = AcpiSha256Current();
+  SelectivePrint(L"\nSHA-256, per MB:\n");
+  SelectivePrint(L"  %-10s %10s %10s %10s\n", L"Impl", L"min us", L"median us", L"max us");
+  for (Impl = 0; Impl < AcpiSha256ImplMax; Impl++) {
+    if (EFI_ERROR(AcpiSha256Select(Impl))) {
+      SelectivePrint(L"  %-10s not supported by this CPU\n", AcpiSha256ImplName(Impl));
+      continue;
+    }
+    for (Index = 0; Index < gOptions.Repeat; Index++) {
+      Start = AcpiPerfNow();
+      AcpiSha256(Data, BENCH_SHA256_SIZE, Digest);
+      Samples[Index] = AcpiPerfElapsedNs(Start);
+    }
+    AcpiPrintSampleRow(AcpiSha256ImplName(Impl), Samples, gOptions.Repeat);
+  }
+  AcpiSha256Select(Active);
+
+  AcpiFreePool(Data);
+  return EFI_SUCCESS;
+}
+
+/**
+  Runs gOptions.Repeat dry runs over the directory and prints the report,
+  once per read strategy when gOptions.ReadStrategy is AcpiReadStrategyMax.
+  Console output below warnings is suppressed while iterations run so that
+  printing does not distort the timings.
+
+  @param[in] Directory    ACPI directory to load from
+
+  @retval EFI_SUCCESS             All iterations completed
+  @retval EFI_OUT_OF_RESOURCES    Sample storage could not be allocated
+  @retval Other                   An iteration failed; partial results are printed
+**/
+EFI_STATUS
+AcpiRunBenchmark (
+  IN EFI_FILE_PROTOCOL  *Directory
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      *Samples;
+  UINT64      Totals[AcpiReadStrategyMax];
+  UINT32      Requested;
+  UINT32      Strategy;
+
+  if (Directory == NULL || gOptions.Repeat == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = AcpiAllocatePool(EfiBootServicesData, BENCH_ROWS * gOptions.Repeat * sizeof(UINT64), (VOID**)&Samples);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  gOptions.DryRun = TRUE;
+  Requested       = gOptions.ReadStrategy;
+
+  if (Requested != AcpiReadStrategyMax) {
+    Status = AcpiBenchmarkPass(Directory, Samples, &Totals[0]);
+    if (!EFI_ERROR(Status)) {
+      Status = AcpiBenchmarkSha256(Samples);
+    }
+    AcpiFreePool(Samples);
+    return Status;
+  }
+
+  for (Strategy = 0; Strategy < AcpiReadStrategyMax && !EFI_ERROR(Status); Strategy++) {
+    gOptions.ReadStrategy = Strategy;
+    Status = AcpiBenchmarkPass(Directory, Samples, &Totals[Strategy]);
+  }
+  gOptions.ReadStrategy = Requested;
+
+  if (!EFI_ERROR(Status) && Totals[AcpiReadWhole] > 0) {
+    SelectivePrint(L"\nRead strategies, median total:\n");
+    for (Strategy = 0; Strategy < AcpiReadStrategyMax; Strategy++) {
+      SelectivePrint(L"  %-10s %10llu us %6llu%% of whole\n",
+                     gAcpiReadStrategyNames[Strategy],
+                     DivU64x32(Totals[Strategy], 1000),
+                     DivU64x64Remainder(MultU64x32(Totals[Strategy], 100), Totals[AcpiReadWhole], NULL));
+    }
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Status = AcpiBenchmarkSha256(Samples);
+  }
+
+  AcpiFreePool(Samples);
+  return Status;
+}
@@ -0,0 +1,240 @@
+/** @file
+
+  Optional SSDT consolidation stage.
+
+  Every installed SSDT costs an XSDT slot, an allocation, and a separate
+  table load and namespace pass in the OS. A definition block body is a
+  plain TermList, so the bodies of several SSDTs can be concatenated under
+  one header and loaded as a single table.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "AcpiConsolidate.h"
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+
+//
+// AML StringPrefix, used to spot LoadTable ("SSDT", "OEMID", "TABLEID") arguments
+//
+#define AML_STRING_PREFIX       0x0D
+
+#define ACPI_OEM_TABLE_ID_SIZE  8
+
+/**
+  Returns TRUE if Haystack contains OemTableId as a NUL-terminated AML string.
+
+  @param[in] Haystack     Table to search
+  @param[in] OemTableId   Table ID to look for
+**/
+STATIC
+BOOLEAN
+AcpiTableNamesId (
+  IN EFI_ACPI_SDT_HEADER  *Haystack,
+  IN CONST CHAR8          *OemTableId
+  )
+{
+  CHAR8   Pattern[ACPI_OEM_TABLE_ID_SIZE + 2];
+  UINTN   Length;
+  UINT8   *Bytes;
+  UINTN   Index;
+
+  Pattern[0] = AML_STRING_PREFIX;
+  CopyMem(&Pattern[1], OemTableId, ACPI_OEM_TABLE_ID_SIZE);
+  for (Length = ACPI_OEM_TABLE_ID_SIZE; Length > 0; Length--) {
+    if (Pattern[Length] != ' ' && Pattern[Length] != '\0') {
+      break;
+    }
+  }
+  if (Length == 0) {
+    return FALSE;
+  }
+  Pattern[Length + 1] = '\0';
+  Length += 2;
+
+  Bytes = (UINT8 *)Haystack;
+  for (Index = sizeof(EFI_ACPI_SDT_HEADER); Index + Length <= Haystack->Length; Index++) {
+    if (Bytes[Index] == AML_STRING_PREFIX && CompareMem(&Bytes[Index], Pattern, Length) == 0) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Returns TRUE if the planned table at Index may be merged with others.
+
+  @param[in] Plan     Plan holding the table
+  @param[in] Index    Index into Plan->Tables
+**/
+STATIC
+BOOLEAN
+AcpiIsMergeable (
+  IN ACPI_TABLE_PLAN  *Plan,
+  IN UINT32           Index
+  )
+{
+  EFI_ACPI_SDT_HEADER  *Table;
+  UINT32               Other;
+
+  Table = Plan->Tables[Index];
+  if (Table->Signature != EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE ||
+      Table->Length <= sizeof(EFI_ACPI_SDT_HEADER) ||
+      Table->Length > ACPI_CONSOLIDATE_MAX_TABLE_SIZE) {
+    return FALSE;
+  }
+
+  // A table loaded dynamically by ID must keep its own header
+  if (Plan->Dsdt != NULL && AcpiTableNamesId(Plan->Dsdt, Table->OemTableId)) {
+    return FALSE;
+  }
+  for (Other = 0; Other < Plan->TableCount; Other++) {
+    if (Other != Index && AcpiTableNamesId(Plan->Tables[Other], Table->OemTableId)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Builds one SSDT from the definition blocks of Count tables.
+
+  @param[in] Tables     Tables to merge, in load order
+  @param[in] Count      Number of tables
+  @param[in] Length     Total length of the merged table
+
+  @return Merged table, or NULL if it could not be allocated
+**/
+STATIC
+EFI_ACPI_SDT_HEADER *
+AcpiMergeTables (
+  IN EFI_ACPI_SDT_HEADER  **Tables,
+  IN UINT32               Count,
+  IN UINT32               Length
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Merged;
+  UINT8                *Cursor;
+  UINT32               Body;
+  UINT32               Index;
+
+  Status = AcpiAllocatePool(EfiACPIReclaimMemory, Length, (VOID **)&Merged);
+  if (EFI_ERROR(Status)) {
+    return NULL;
+  }
+
+  CopyMem(Merged, Tables[0], sizeof(EFI_ACPI_SDT_HEADER));
+  Merged->Length          = Length;
+  CopyMem(Merged->OemTableId, ACPI_CONSOLIDATE_OEM_TABLE_ID, ACPI_OEM_TABLE_ID_SIZE);
+  Merged->OemRevision     = Count;
+  Merged->CreatorId       = SIGNATURE_32('A', 'P', 'C', 'H');
+  Merged->CreatorRevision = (ACPI_PATCHER_VERSION_MAJOR << 16) | ACPI_PATCHER_VERSION_MINOR;
+
+  Cursor = (UINT8 *)(Merged + 1);
+  for (Index = 0; Index < Count; Index++) {
+    Body = Tables[Index]->Length - sizeof(EFI_ACPI_SDT_HEADER);
+    CopyMem(Cursor, Tables[Index] + 1, Body);
+    Cursor += Body;
+    if (Tables[Index]->Revision > Merged->Revision) {
+      Merged->Revision = Tables[Index]->Revision;
+    }
+  }
+
+  Merged->Checksum = 0;
+  Merged->Checksum = CalculateCheckSum8((UINT8 *)Merged, Length);
+
+  return Merged;
+}
+
+EFI_STATUS
+AcpiPlanConsolidate (
+  IN OUT ACPI_TABLE_PLAN         *Plan,
+  IN OUT ACPI_CONSOLIDATE_STATS  *Stats
+  )
+{
+  BOOLEAN              Mergeable[MAX_ADDITIONAL_TABLES];
+  EFI_ACPI_SDT_HEADER  *Merged;
+  UINT32               Index;
+  UINT32               End;
+  UINT32               Out;
+  UINT32               Length;
+  UINT32               Member;
+  UINT32               Before;
+  UINT32               Spans;
+
+  if (Plan == NULL || Stats == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Before = Plan->TableCount;
+
+  // Decide up front; merging rewrites the table list
+  for (Index = 0; Index < Plan->TableCount; Index++) {
+    Mergeable[Index] = AcpiIsMergeable(Plan, Index);
+  }
+
+  Out   = 0;
+  Index = 0;
+  while (Index < Plan->TableCount) {
+    // Grow a run of adjacent mergeable tables with the same integer width
+    Length = Plan->Tables[Index]->Length;
+    End    = Index + 1;
+    if (Mergeable[Index]) {
+      while (End < Plan->TableCount && Mergeable[End] &&
+             (Plan->Tables[End]->Revision >= 2) == (Plan->Tables[Index]->Revision >= 2) &&
+             Length + Plan->Tables[End]->Length - sizeof(EFI_ACPI_SDT_HEADER) <= ACPI_CONSOLIDATE_MAX_MERGED_SIZE) {
+        Length += Plan->Tables[End]->Length - sizeof(EFI_ACPI_SDT_HEADER);
+        End++;
+      }
+    }
+
+    Merged = NULL;
+    if (End - Index >= 2) {
+      Merged = AcpiMergeTables(&Plan->Tables[Index], End - Index, Length);
+    }
+
+    if (Merged == NULL) {
+      // Nothing to merge, or out of memory: keep the tables as they are
+      for (; Index < End; Index++) {
+        Plan->Spans[Out]    = Plan->Spans[Index];
+        Plan->Tables[Out++] = Plan->Tables[Index];
+      }
+      continue;
+    }
+
+    AcpiDebugPrint(DEBUG_INFO, L"Consolidated %u SSDTs into one table (%u bytes)\n", End - Index, Length);
+    Spans = 0;
+    for (Member = Index; Member < End; Member++) {
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Merged %.8a (%u bytes)\n",
+                     Plan->Tables[Member]->OemTableId, Plan->Tables[Member]->Length);
+      AcpiFreePool(Plan->Tables[Member]);
+      Spans += Plan->Spans[Member];
+    }
+
+    Stats->TablesMerged += End - Index;
+    Stats->Consolidated++;
+    Stats->BytesSaved += (End - Index - 1) * sizeof(EFI_ACPI_SDT_HEADER);
+    Plan->Spans[Out]    = Spans;
+    Plan->Tables[Out++] = Merged;
+    Index = End;
+  }
+
+  for (Index = Out; Index < Plan->TableCount; Index++) {
+    Plan->Tables[Index] = NULL;
+    Plan->Spans[Index]  = 0;
+  }
+  Plan->TableCount = Out;
+
+  if (Out < Before) {
+    ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_CONSOLIDATED, Before, Out, Stats->BytesSaved);
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,57 @@
+/** @file
+
+  Optional SSDT consolidation stage.
+
+**/
+
+#ifndef __ACPI_CONSOLIDATE_H__
+#define __ACPI_CONSOLIDATE_H__
+
+#include "AcpiInstall.h"
+
+//
+// SSDTs larger than this are always installed on their own
+//
+#define ACPI_CONSOLIDATE_MAX_TABLE_SIZE    SIZE_8KB
+
+//
+// Consolidated tables are kept below the size EFI 1.x firmware handles well
+//
+#define ACPI_CONSOLIDATE_MAX_MERGED_SIZE   SIZE_64KB
+
+#define ACPI_CONSOLIDATE_OEM_TABLE_ID      "APMERGED"
+
+//
+// Accumulated over every run of the stage; the caller zeroes it once
+//
+typedef struct {
+  UINT32  TablesMerged;     ///< Source tables folded into consolidated SSDTs
+  UINT32  Consolidated;     ///< Consolidated SSDTs created
+  UINT32  BytesSaved;       ///< Table headers no longer installed
+} ACPI_CONSOLIDATE_STATS;
+
+/**
+  Merges runs of adjacent, compatible small SSDTs in the plan into single
+  SSDTs whose body is the concatenation of the original definition blocks.
+
+  Tables stay separate when they are not SSDTs, are larger than
+  ACPI_CONSOLIDATE_MAX_TABLE_SIZE, are named by a LoadTable () string in
+  another planned table, or use a different integer width (revision 1
+  versus 2+) than their neighbours. Only adjacent tables are merged, so the
+  namespace load order seen by the OS is unchanged.
+
+  The stage may run again on a plan that already holds consolidated tables,
+  for example to free slots once the plan is full.
+
+  @param[in,out] Plan     Plan to consolidate; merged originals are freed
+  @param[in,out] Stats    Tables and bytes saved, accumulated
+
+  @retval EFI_SUCCESS     Stage completed, possibly without merging anything
+**/
+EFI_STATUS
+AcpiPlanConsolidate (
+  IN OUT ACPI_TABLE_PLAN         *Plan,
+  IN OUT ACPI_CONSOLIDATE_STATS  *Stats
+  );
+
+#endif // __ACPI_CONSOLIDATE_H__
@@ -0,0 +1,81 @@
+/** @file
+
+  Load order and --deadline deferral for the table reads of a patch run.
+
+**/
+
+#include <Library/BaseLib.h>
+
+#include "AcpiDeadline.h"
+#include "AcpiPerf.h"
+#include "AcpiLog.h"
+
+/**
+  Returns TRUE if a table of Size bytes is predicted to be read before the
+  deadline, leaving 1/ACPI_DEADLINE_RESERVE_DIVISOR of it for validation and
+  the commit.
+
+  @param[in] DeadlineMs   Deadline in ms
+  @param[in] Size         Table file size
+**/
+STATIC
+BOOLEAN
+AcpiDeadlineAllows (
+  IN UINT32  DeadlineMs,
+  IN UINT64  Size
+  )
+{
+  UINT64  BudgetNs;
+
+  BudgetNs  = MultU64x32(DeadlineMs, 1000000);
+  BudgetNs -= DivU64x32(BudgetNs, ACPI_DEADLINE_RESERVE_DIVISOR);
+  return (BOOLEAN)(AcpiPerfClockNs() + AcpiPerfPredictReadNs(Size) <= BudgetNs);
+}
+
+VOID
+AcpiDeadlineWalkInit (
+  OUT ACPI_DEADLINE_WALK  *Walk,
+  IN  UINT32              DeadlineMs
+  )
+{
+  Walk->DeadlineMs = DeadlineMs;
+  Walk->Step       = 0;
+  Walk->Deferred   = 0;
+}
+
+ACPI_FILE_ENTRY *
+AcpiDeadlineNext (
+  IN OUT ACPI_DEADLINE_WALK  *Walk,
+  IN     ACPI_FILE_LIST      *Files
+  )
+{
+  ACPI_FILE_ENTRY  *File;
+
+  while (Walk->Step < AcpiTierMax * Files->Count) {
+    File = &Files->Entries[Walk->Step % Files->Count];
+    if (File->Tier == Walk->Step++ / Files->Count) {
+      return File;
+    }
+  }
+  return NULL;
+}
+
+BOOLEAN
+AcpiDeadlineDefers (
+  IN OUT ACPI_DEADLINE_WALK     *Walk,
+  IN     CONST ACPI_FILE_ENTRY  *File
+  )
+{
+  if (File->Tier != AcpiTierOptional || Walk->DeadlineMs == 0) {
+    return FALSE;
+  }
+  if (Walk->Deferred == 0 && AcpiDeadlineAllows(Walk->DeadlineMs, File->Size)) {
+    return FALSE;
+  }
+
+  AcpiDebugPrint(DEBUG_WARN, L"  Deferred: reading it would overrun the %u ms deadline\n", Walk->DeadlineMs);
+  ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_TABLE_DEFERRED, AcpiLogPackName(File->Name),
+            DivU64x32(AcpiPerfClockNs(), 1000000));
+  Walk->Deferred++;
+  return TRUE;
+}
@@ -0,0 +1,68 @@
+/** @file
+
+  Load order and --deadline deferral for the table reads of a patch run.
+
+  Collected tables are visited one tier after the other, required tables
+  first, so only optional tables are left when the deadline draws near.
+  An optional table is deferred when reading it is predicted to finish past
+  the deadline (see AcpiPerfPredictReadNs()); every optional table after
+  the first deferred one is deferred too, so a run never loads a later
+  table and skips an earlier one.
+
+**/
+
+#ifndef __ACPI_DEADLINE_H__
+#define __ACPI_DEADLINE_H__
+
+#include "AcpiSource.h"
+
+typedef struct {
+  UINT32  DeadlineMs;       ///< Deadline in ms since AcpiPerfStartClock(), 0 for none
+  UINTN   Step;             ///< Position in the tier by tier walk
+  UINT32  Deferred;         ///< Optional tables deferred so far
+} ACPI_DEADLINE_WALK;
+
+/**
+  Starts a walk over the collected tables.
+
+  @param[out] Walk          Walk state
+  @param[in]  DeadlineMs    gOptions.DeadlineMs
+**/
+VOID
+AcpiDeadlineWalkInit (
+  OUT ACPI_DEADLINE_WALK  *Walk,
+  IN  UINT32              DeadlineMs
+  );
+
+/**
+  Returns the next table to process, in tier order and in collection order
+  within a tier.
+
+  @param[in,out] Walk     Walk state
+  @param[in]     Files    Collected tables
+
+  @return Next table, or NULL when every table was returned
+**/
+ACPI_FILE_ENTRY *
+AcpiDeadlineNext (
+  IN OUT ACPI_DEADLINE_WALK  *Walk,
+  IN     ACPI_FILE_LIST      *Files
+  );
+
+/**
+  Decides whether a table is deferred instead of read, and logs and counts
+  it if so. Required tables are never deferred.
+
+  @param[in,out] Walk     Walk state
+  @param[in]     File     Table about to be read
+
+  @retval TRUE    Table is deferred; Walk->Deferred was incremented
+  @retval FALSE   Table is read
+**/
+BOOLEAN
+AcpiDeadlineDefers (
+  IN OUT ACPI_DEADLINE_WALK     *Walk,
+  IN     CONST ACPI_FILE_ENTRY  *File
+  );
+
+#endif // __ACPI_DEADLINE_H__
@@ -0,0 +1,183 @@
+/** @file
+
+  Tables rebuilt from a delta against the firmware's copy.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "AcpiDelta.h"
+#include "AcpiMemory.h"
+#include "AcpiSha256.h"
+
+BOOLEAN
+AcpiDeltaIsDelta (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINTN  Length;
+  UINTN  SuffixLength;
+
+  Length       = StrLen(Name);
+  SuffixLength = StrLen(ACPI_DELTA_SUFFIX);
+  return (BOOLEAN)(Length > SuffixLength && StrCmp(Name + Length - SuffixLength, ACPI_DELTA_SUFFIX) == 0);
+}
+
+/**
+  Reads one LEB128 operand.
+
+  @param[in,out] Cursor   Next delta byte; advanced past the operand
+  @param[in]     End      End of the delta
+  @param[out]    Value    Operand
+
+  @return FALSE if the operand is truncated or does not fit 32 bits
+**/
+STATIC
+BOOLEAN
+AcpiDeltaReadNumber (
+  IN OUT CONST UINT8  **Cursor,
+  IN     CONST UINT8  *End,
+  OUT    UINT32       *Value
+  )
+{
+  UINT64  Result;
+  UINTN   Shift;
+
+  Result = 0;
+  for (Shift = 0; Shift < 35; Shift += 7) {
+    if (*Cursor >= End) {
+      return FALSE;
+    }
+    Result |= LShiftU64(**Cursor & 0x7F, Shift);
+    if ((*(*Cursor)++ & 0x80) == 0) {
+      *Value = (UINT32)Result;
+      return (BOOLEAN)(Result <= MAX_UINT32);
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Runs the operations of a delta.
+
+  @param[in]  Ops       First operation
+  @param[in]  End       End of the delta
+  @param[in]  Base      Base table
+  @param[in]  BaseSize  Length of the base table
+  @param[out] Table     Table to write
+  @param[in]  Size      Length of the table
+
+  @return FALSE if an operation reaches outside either table or the
+          operations do not fill the table exactly
+**/
+STATIC
+BOOLEAN
+AcpiDeltaRun (
+  IN  CONST UINT8  *Ops,
+  IN  CONST UINT8  *End,
+  IN  CONST UINT8  *Base,
+  IN  UINT32       BaseSize,
+  OUT UINT8        *Table,
+  IN  UINT32       Size
+  )
+{
+  UINT32  Written;
+  UINT32  Offset;
+  UINT32  Length;
+  UINT8   Op;
+
+  Written = 0;
+  while (Ops < End) {
+    Op = *Ops++;
+    if (Op == ACPI_PATCHER_DELTA_OP_END) {
+      return (BOOLEAN)(Written == Size);
+    }
+
+    if (Op == ACPI_PATCHER_DELTA_OP_COPY) {
+      if (!AcpiDeltaReadNumber(&Ops, End, &Offset) || !AcpiDeltaReadNumber(&Ops, End, &Length) ||
+          Offset > BaseSize || Length > BaseSize - Offset || Length > Size - Written) {
+        return FALSE;
+      }
+      CopyMem(Table + Written, Base + Offset, Length);
+    } else if (Op == ACPI_PATCHER_DELTA_OP_INSERT) {
+      if (!AcpiDeltaReadNumber(&Ops, End, &Length) ||
+          Length > (UINTN)(End - Ops) || Length > Size - Written) {
+        return FALSE;
+      }
+      CopyMem(Table + Written, Ops, Length);
+      Ops += Length;
+    } else {
+      return FALSE;
+    }
+    Written += Length;
+  }
+  return FALSE;
+}
+
+EFI_STATUS
+AcpiDeltaApply (
+  IN  CONST EFI_ACPI_SDT_HEADER  *Base  OPTIONAL,
+  IN  CONST VOID                 *Delta,
+  IN  UINTN                      DeltaSize,
+  OUT VOID                       **Table,
+  OUT UINTN                      *TableSize
+  )
+{
+  EFI_STATUS                       Status;
+  CONST ACPI_PATCHER_DELTA_HEADER  *Header;
+  UINT8                            Digest[ACPI_SHA256_DIGEST_SIZE];
+  UINT8                            *Rebuilt;
+
+  Header = (CONST ACPI_PATCHER_DELTA_HEADER *)Delta;
+  if (DeltaSize < sizeof(*Header) ||
+      Header->Signature != ACPI_PATCHER_DELTA_SIGNATURE ||
+      Header->Version != ACPI_PATCHER_DELTA_VERSION ||
+      Header->HeaderSize < sizeof(*Header) || Header->HeaderSize > DeltaSize ||
+      Header->TableLength < sizeof(EFI_ACPI_SDT_HEADER)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  if (Header->BaseSignature != EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  // Identify the base before paying for the hash
+  if (Base == NULL ||
+      Base->Signature != Header->BaseSignature ||
+      Base->Length != Header->BaseLength ||
+      CompareMem(Base->OemTableId, Header->BaseOemTableId, sizeof(Header->BaseOemTableId)) != 0) {
+    return EFI_INCOMPATIBLE_VERSION;
+  }
+  AcpiSha256(Base, Base->Length, Digest);
+  if (CompareMem(Digest, Header->BaseSha256, sizeof(Digest)) != 0) {
+    return EFI_INCOMPATIBLE_VERSION;
+  }
+
+  Status = AcpiAllocatePool(EfiRuntimeServicesData, Header->TableLength, (VOID **)&Rebuilt);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = EFI_SUCCESS;
+  if (!AcpiDeltaRun((CONST UINT8 *)Delta + Header->HeaderSize, (CONST UINT8 *)Delta + DeltaSize,
+                    (CONST UINT8 *)Base, Base->Length, Rebuilt, Header->TableLength)) {
+    Status = EFI_VOLUME_CORRUPTED;
+  } else {
+    AcpiSha256(Rebuilt, Header->TableLength, Digest);
+    if (CompareMem(Digest, Header->TableSha256, sizeof(Digest)) != 0) {
+      Status = EFI_CRC_ERROR;
+    } else if (((EFI_ACPI_SDT_HEADER *)Rebuilt)->Signature != Header->BaseSignature) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(Rebuilt);
+    return Status;
+  }
+
+  *Table     = Rebuilt;
+  *TableSize = Header->TableLength;
+  return EFI_SUCCESS;
+}
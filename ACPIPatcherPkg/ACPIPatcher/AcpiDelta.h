@@ -0,0 +1,59 @@
+/** @file
+
+  Tables rebuilt from a delta against the firmware's copy (see
+  Include/AcpiPatcherDelta.h and Tools/AcpiDelta.py).
+
+  A table file whose name ends in ACPI_DELTA_SUFFIX, such as DSDT.aml.delta,
+  is read as a delta; like any table file its name must contain .aml. The
+  manifest digest of a delta covers the delta file. Only DSDT deltas are supported: the DSDT is replaced
+  through the FADT, while the firmware's other tables cannot be taken out of
+  the XSDT without freeing memory the patcher does not own.
+
+**/
+
+#ifndef __ACPI_DELTA_H__
+#define __ACPI_DELTA_H__
+
+#include <AcpiPatcherDelta.h>
+
+#include "ACPIPatcher.h"
+
+#define ACPI_DELTA_SUFFIX   L".delta"
+
+/**
+  Returns TRUE if a table file holds a delta.
+
+  @param[in] Name   Table file name
+**/
+BOOLEAN
+AcpiDeltaIsDelta (
+  IN CONST CHAR16  *Name
+  );
+
+/**
+  Rebuilds a table from a delta and the firmware DSDT, decoding straight
+  into the pool buffer of the new table.
+
+  @param[in]  Base        Firmware DSDT the delta was made against, or NULL if unknown
+  @param[in]  Delta       Delta file contents
+  @param[in]  DeltaSize   Size of the delta file
+  @param[out] Table       Rebuilt table; freed by the caller
+  @param[out] TableSize   Length of the rebuilt table
+
+  @retval EFI_SUCCESS               Table rebuilt
+  @retval EFI_UNSUPPORTED           The base table is not the DSDT
+  @retval EFI_INCOMPATIBLE_VERSION  Base is NULL or not the table the delta was made against
+  @retval EFI_VOLUME_CORRUPTED      Malformed delta
+  @retval EFI_CRC_ERROR             The rebuilt table does not match its digest
+  @retval EFI_OUT_OF_RESOURCES      Memory allocation failed
+**/
+EFI_STATUS
+AcpiDeltaApply (
+  IN  CONST EFI_ACPI_SDT_HEADER  *Base  OPTIONAL,
+  IN  CONST VOID                 *Delta,
+  IN  UINTN                      DeltaSize,
+  OUT VOID                       **Table,
+  OUT UINTN                      *TableSize
+  );
+
+#endif // __ACPI_DELTA_H__
@@ -0,0 +1,574 @@
+/** @file
+
+  Export of the live firmware ACPI tables.
+
+  Walks RSDP -> XSDT -> FADT -> DSDT/FACS and writes every table either to
+  its own SIG-OEMTABLEID-N.aml file or into a single bundle file (see
+  AcpiPatcherBundle.h). The output directory is opened once and all data
+  goes through a large write buffer, so slow firmware FAT drivers see a few
+  big writes instead of many small ones. A Manifest.sha256 with the digest
+  of every table allows diffing two dumps on the host, and lets --verify
+  check the tables when the dump is used as an ACPI folder.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <AcpiPatcherBundle.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiLog.h"
+#include "AcpiManifest.h"
+#include "AcpiMemory.h"
+
+#define EXPORT_MAX_TABLES       128
+#define EXPORT_MAX_TABLE_SIZE   SIZE_16MB
+#define EXPORT_WRITE_BUFFER     SIZE_512KB
+#define EXPORT_BUNDLE_NAME      L"TABLES.BND"
+
+typedef struct {
+  EFI_ACPI_SDT_HEADER  *Table;
+  UINT32               Length;
+  UINT32               Crc32;
+  CHAR8                Name[ACPI_PATCHER_BUNDLE_NAME_SIZE];
+} EXPORT_ENTRY;
+
+typedef struct {
+  EXPORT_ENTRY  Entries[EXPORT_MAX_TABLES];
+  UINTN         Count;
+} EXPORT_LIST;
+
+//
+// Accumulates small writes and passes large ones straight through
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              *Buffer;
+  UINTN              Used;
+  UINT64             Written;
+  EFI_STATUS         Status;
+} EXPORT_WRITER;
+
+/**
+  Writes the buffered data to the file.
+
+  @param[in,out] Writer   Writer to flush
+**/
+STATIC
+VOID
+AcpiWriterFlush (
+  IN OUT EXPORT_WRITER  *Writer
+  )
+{
+  UINTN  Size;
+
+  if (EFI_ERROR(Writer->Status) || Writer->Used == 0) {
+    return;
+  }
+
+  Size = Writer->Used;
+  Writer->Status = Writer->File->Write(Writer->File, &Size, Writer->Buffer);
+  if (!EFI_ERROR(Writer->Status) && Size != Writer->Used) {
+    Writer->Status = EFI_VOLUME_FULL;
+  }
+  Writer->Written += Size;
+  Writer->Used     = 0;
+}
+
+/**
+  Appends data to the file through the write buffer. The first error is
+  latched in Writer->Status and later appends are ignored.
+
+  @param[in,out] Writer   Writer to append to
+  @param[in]     Data     Data to write
+  @param[in]     Size     Number of bytes
+**/
+STATIC
+VOID
+AcpiWriterAppend (
+  IN OUT EXPORT_WRITER  *Writer,
+  IN     CONST VOID     *Data,
+  IN     UINTN          Size
+  )
+{
+  CONST UINT8  *Bytes;
+  UINTN        Chunk;
+  UINTN        Direct;
+
+  Bytes = (CONST UINT8 *)Data;
+
+  while (Size > 0 && !EFI_ERROR(Writer->Status)) {
+    // Skip the copy for anything that would fill the buffer on its own
+    if (Writer->Used == 0 && Size >= EXPORT_WRITE_BUFFER) {
+      Direct = Size;
+      Writer->Status = Writer->File->Write(Writer->File, &Direct, (VOID *)Bytes);
+      if (!EFI_ERROR(Writer->Status) && Direct != Size) {
+        Writer->Status = EFI_VOLUME_FULL;
+      }
+      Writer->Written += Direct;
+      return;
+    }
+
+    Chunk = MIN(Size, EXPORT_WRITE_BUFFER - Writer->Used);
+    CopyMem(Writer->Buffer + Writer->Used, Bytes, Chunk);
+    Writer->Used += Chunk;
+    Bytes        += Chunk;
+    Size         -= Chunk;
+
+    if (Writer->Used == EXPORT_WRITE_BUFFER) {
+      AcpiWriterFlush(Writer);
+    }
+  }
+}
+
+/**
+  Creates or truncates a file in the output directory.
+
+  @param[in]  Directory   Output directory
+  @param[in]  Name        File name
+  @param[out] File        Opened file
+
+  @retval EFI_SUCCESS     File is open and empty
+  @retval Other           File could not be created
+**/
+STATIC
+EFI_STATUS
+AcpiExportCreateFile (
+  IN  EFI_FILE_PROTOCOL  *Directory,
+  IN  CHAR16             *Name,
+  OUT EFI_FILE_PROTOCOL  **File
+  )
+{
+  EFI_STATUS  Status;
+
+  // EFI_FILE_MODE_CREATE does not truncate, so drop a previous dump first
+  Status = Directory->Open(Directory, File, Name, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR(Status)) {
+    (*File)->Delete(*File);
+  }
+
+  return Directory->Open(Directory, File, Name,
+                         EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+}
+
+/**
+  Copies an ACPI identifier into a file name, replacing characters that are
+  not safe on FAT and dropping trailing padding.
+
+  @param[out] Dest      Destination
+  @param[in]  Source    Identifier bytes
+  @param[in]  Length    Identifier length
+
+  @return Number of characters written
+**/
+STATIC
+UINTN
+AcpiExportCopyId (
+  OUT CHAR8        *Dest,
+  IN  CONST CHAR8  *Source,
+  IN  UINTN        Length
+  )
+{
+  UINTN  Index;
+  CHAR8  Char;
+
+  while (Length > 0 && (Source[Length - 1] == ' ' || Source[Length - 1] == '\0')) {
+    Length--;
+  }
+
+  for (Index = 0; Index < Length; Index++) {
+    Char = Source[Index];
+    if (!((Char >= 'A' && Char <= 'Z') || (Char >= 'a' && Char <= 'z') ||
+          (Char >= '0' && Char <= '9') || Char == '_')) {
+      Char = '_';
+    }
+    Dest[Index] = Char;
+  }
+
+  return Length;
+}
+
+/**
+  Adds a table to the export list, skipping duplicates and implausible
+  lengths, and names it SIG-OEMTABLEID-N.aml where N counts earlier tables
+  with the same signature and OEM table ID. The FACS has no OEM fields and
+  is named FACS-N.aml.
+
+  @param[in,out] List     Export list
+  @param[in]     Table    Table to add
+**/
+STATIC
+VOID
+AcpiExportAdd (
+  IN OUT EXPORT_LIST          *List,
+  IN     EFI_ACPI_SDT_HEADER  *Table
+  )
+{
+  EXPORT_ENTRY  *Entry;
+  UINTN         Index;
+  UINTN         Length;
+  UINT32        Duplicates;
+  BOOLEAN       HasOemFields;
+
+  if (Table == NULL || List->Count >= EXPORT_MAX_TABLES) {
+    return;
+  }
+
+  if (Table->Length < 2 * sizeof(UINT32) || Table->Length > EXPORT_MAX_TABLE_SIZE) {
+    AcpiDebugPrint(DEBUG_WARN, L"Skipping table at " PTR_FMT L" with length %u\n",
+                   PTR_TO_INT(Table), Table->Length);
+    return;
+  }
+
+  HasOemFields = (BOOLEAN)(Table->Signature != EFI_ACPI_6_4_FIRMWARE_ACPI_CONTROL_STRUCTURE_SIGNATURE);
+  if (HasOemFields && Table->Length < sizeof(EFI_ACPI_SDT_HEADER)) {
+    return;
+  }
+
+  Duplicates = 0;
+  for (Index = 0; Index < List->Count; Index++) {
+    if (List->Entries[Index].Table == Table) {
+      return; // Firmware listed the same table twice
+    }
+    if (List->Entries[Index].Table->Signature == Table->Signature &&
+        (!HasOemFields || CompareMem(&List->Entries[Index].Table->OemTableId, &Table->OemTableId,
+                                     sizeof(Table->OemTableId)) == 0)) {
+      Duplicates++;
+    }
+  }
+
+  Entry  = &List->Entries[List->Count++];
+  Entry->Table  = Table;
+  Entry->Length = Table->Length;
+  gBS->CalculateCrc32(Table, Table->Length, &Entry->Crc32);
+
+  Length = AcpiExportCopyId(Entry->Name, (CONST CHAR8 *)&Table->Signature, sizeof(Table->Signature));
+  Entry->Name[Length++] = '-';
+  if (HasOemFields) {
+    Length += AcpiExportCopyId(&Entry->Name[Length], (CONST CHAR8 *)&Table->OemTableId, sizeof(Table->OemTableId));
+    Entry->Name[Length++] = '-';
+  }
+  AsciiSPrint(&Entry->Name[Length], sizeof(Entry->Name) - Length, "%u.aml", Duplicates);
+}
+
+/**
+  XSDT visitor collecting every table for export.
+**/
+STATIC
+BOOLEAN
+AcpiExportVisit (
+  IN EFI_ACPI_SDT_HEADER  *Table,
+  IN UINTN                Index,
+  IN VOID                 *Context
+  )
+{
+  AcpiExportAdd((EXPORT_LIST *)Context, Table);
+  return FALSE;
+}
+
+/**
+  Collects the XSDT, every table it lists, and the DSDT and FACS referenced
+  by the FADT.
+
+  @param[out] List    Export list
+**/
+STATIC
+VOID
+AcpiExportCollect (
+  OUT EXPORT_LIST  *List
+  )
+{
+  UINT64  Address;
+  UINT32  Length;
+
+  List->Count = 0;
+
+  AcpiExportAdd(List, gXsdt);
+  AcpiWalkXsdt(AcpiExportVisit, List);
+
+  if (gFacp == NULL) {
+    return;
+  }
+
+  Length = gFacp->Header.Length;
+
+  // Prefer the 64-bit fields when the FADT is long enough to have them
+  Address = gFacp->Dsdt;
+  if (Length >= OFFSET_OF(EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE, XDsdt) + sizeof(UINT64) &&
+      gFacp->XDsdt != 0) {
+    Address = gFacp->XDsdt;
+  }
+  AcpiExportAdd(List, (EFI_ACPI_SDT_HEADER *)(UINTN)Address);
+
+  Address = gFacp->FirmwareCtrl;
+  if (Length >= OFFSET_OF(EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE, XFirmwareCtrl) + sizeof(UINT64) &&
+      gFacp->XFirmwareCtrl != 0) {
+    Address = gFacp->XFirmwareCtrl;
+  }
+  AcpiExportAdd(List, (EFI_ACPI_SDT_HEADER *)(UINTN)Address);
+}
+
+/**
+  Writes each table to its own file.
+
+  @param[in]     Directory    Output directory
+  @param[in]     List         Tables to write
+  @param[in,out] Writer       Writer whose buffer is reused for every file
+**/
+STATIC
+EFI_STATUS
+AcpiExportFiles (
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN     EXPORT_LIST        *List,
+  IN OUT EXPORT_WRITER      *Writer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  CHAR16      Name[ACPI_PATCHER_BUNDLE_NAME_SIZE];
+
+  for (Index = 0; Index < List->Count; Index++) {
+    UnicodeSPrint(Name, sizeof(Name), L"%a", List->Entries[Index].Name);
+
+    Status = AcpiExportCreateFile(Directory, Name, &Writer->File);
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Failed to create %s: %r\n", Name, Status);
+      return Status;
+    }
+
+    AcpiWriterAppend(Writer, List->Entries[Index].Table, List->Entries[Index].Length);
+    AcpiWriterFlush(Writer);
+    Writer->File->Close(Writer->File);
+    Writer->File = NULL;
+
+    if (EFI_ERROR(Writer->Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Failed to write %s: %r\n", Name, Writer->Status);
+      return Writer->Status;
+    }
+
+    AcpiDebugPrint(DEBUG_INFO, L"  %s (%u bytes)\n", Name, List->Entries[Index].Length);
+    ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_EXPORT_TABLE, List->Entries[Index].Table->Signature,
+              List->Entries[Index].Length, List->Entries[Index].Crc32);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes all tables into a single bundle file.
+
+  @param[in]     Directory    Output directory
+  @param[in]     List         Tables to write
+  @param[in,out] Writer       Writer to use
+**/
+STATIC
+EFI_STATUS
+AcpiExportBundle (
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN     EXPORT_LIST        *List,
+  IN OUT EXPORT_WRITER      *Writer
+  )
+{
+  EFI_STATUS                  Status;
+  ACPI_PATCHER_BUNDLE_HEADER  Header;
+  ACPI_PATCHER_BUNDLE_ENTRY   Entry;
+  STATIC CONST UINT8          Padding[ACPI_PATCHER_BUNDLE_ALIGN] = { 0 };
+  UINT64                      Offset;
+  UINTN                       Index;
+
+  Offset = sizeof(Header) + List->Count * sizeof(Entry);
+  Offset = ALIGN_VALUE(Offset, ACPI_PATCHER_BUNDLE_ALIGN);
+
+  ZeroMem(&Header, sizeof(Header));
+  Header.Signature  = ACPI_PATCHER_BUNDLE_SIGNATURE;
+  Header.Version    = ACPI_PATCHER_BUNDLE_VERSION;
+  Header.EntrySize  = sizeof(Entry);
+  Header.TableCount = (UINT32)List->Count;
+  Header.TotalSize  = Offset;
+  for (Index = 0; Index < List->Count; Index++) {
+    Header.TotalSize += ALIGN_VALUE(List->Entries[Index].Length, ACPI_PATCHER_BUNDLE_ALIGN);
+  }
+
+  Status = AcpiExportCreateFile(Directory, EXPORT_BUNDLE_NAME, &Writer->File);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to create %s: %r\n", EXPORT_BUNDLE_NAME, Status);
+    return Status;
+  }
+
+  AcpiWriterAppend(Writer, &Header, sizeof(Header));
+
+  for (Index = 0; Index < List->Count; Index++) {
+    ZeroMem(&Entry, sizeof(Entry));
+    Entry.Signature = List->Entries[Index].Table->Signature;
+    Entry.Offset    = (UINT32)Offset;
+    Entry.Length    = List->Entries[Index].Length;
+    Entry.Crc32     = List->Entries[Index].Crc32;
+    CopyMem(Entry.Name, List->Entries[Index].Name, sizeof(Entry.Name));
+    AcpiWriterAppend(Writer, &Entry, sizeof(Entry));
+    Offset += ALIGN_VALUE(Entry.Length, ACPI_PATCHER_BUNDLE_ALIGN);
+  }
+
+  Offset = sizeof(Header) + List->Count * sizeof(Entry);
+  AcpiWriterAppend(Writer, Padding, (UINTN)(ALIGN_VALUE(Offset, ACPI_PATCHER_BUNDLE_ALIGN) - Offset));
+
+  for (Index = 0; Index < List->Count; Index++) {
+    AcpiWriterAppend(Writer, List->Entries[Index].Table, List->Entries[Index].Length);
+    AcpiWriterAppend(Writer, Padding,
+                     ALIGN_VALUE(List->Entries[Index].Length, ACPI_PATCHER_BUNDLE_ALIGN) - List->Entries[Index].Length);
+    ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_EXPORT_TABLE, List->Entries[Index].Table->Signature,
+              List->Entries[Index].Length, List->Entries[Index].Crc32);
+  }
+
+  AcpiWriterFlush(Writer);
+  Writer->File->Close(Writer->File);
+  Writer->File = NULL;
+
+  if (EFI_ERROR(Writer->Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to write %s: %r\n", EXPORT_BUNDLE_NAME, Writer->Status);
+    return Writer->Status;
+  }
+
+  AcpiDebugPrint(DEBUG_INFO, L"  %s (%u tables, %llu bytes)\n", EXPORT_BUNDLE_NAME,
+                 (UINT32)List->Count, Header.TotalSize);
+  return EFI_SUCCESS;
+}
+
+/**
+  Writes Manifest.sha256 in the format AcpiManifestLoad() reads: one
+  "<sha256>  name" line per table, in export order.
+
+  @param[in]     Directory    Output directory
+  @param[in]     List         Exported tables
+  @param[in,out] Writer       Writer to use
+**/
+STATIC
+EFI_STATUS
+AcpiExportManifest (
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN     EXPORT_LIST        *List,
+  IN OUT EXPORT_WRITER      *Writer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+  UINTN       Byte;
+  UINTN       Length;
+  UINT8       Digest[ACPI_SHA256_DIGEST_SIZE];
+  CHAR8       Line[ACPI_SHA256_DIGEST_SIZE * 2 + ACPI_PATCHER_BUNDLE_NAME_SIZE + 4];
+
+  Status = AcpiExportCreateFile(Directory, ACPI_MANIFEST_FILE_NAME, &Writer->File);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to create %s: %r\n", ACPI_MANIFEST_FILE_NAME, Status);
+    return Status;
+  }
+
+  Length = AsciiSPrint(Line, sizeof(Line), "# ACPIPatcher table digests (%u tables)\n", (UINT32)List->Count);
+  AcpiWriterAppend(Writer, Line, Length);
+
+  for (Index = 0; Index < List->Count; Index++) {
+    AcpiSha256(List->Entries[Index].Table, List->Entries[Index].Length, Digest);
+    Length = 0;
+    for (Byte = 0; Byte < ACPI_SHA256_DIGEST_SIZE; Byte++) {
+      Length += AsciiSPrint(&Line[Length], sizeof(Line) - Length, "%02x", Digest[Byte]);
+    }
+    Length += AsciiSPrint(&Line[Length], sizeof(Line) - Length, "  %a\n", List->Entries[Index].Name);
+    AcpiWriterAppend(Writer, Line, Length);
+  }
+
+  AcpiWriterFlush(Writer);
+  Writer->File->Close(Writer->File);
+  Writer->File = NULL;
+
+  return Writer->Status;
+}
+
+/**
+  Exports the live ACPI tables into gOptions.ExportDir below BaseDir.
+
+  @param[in] BaseDir    Directory the export directory is created in
+
+  @retval EFI_SUCCESS             All tables and the manifest written
+  @retval EFI_NOT_READY           Root tables have not been located
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed
+  @retval Other                   File system error
+**/
+EFI_STATUS
+AcpiExportTables (
+  IN EFI_FILE_PROTOCOL  *BaseDir
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Directory;
+  EXPORT_LIST        *List;
+  EXPORT_WRITER      Writer;
+
+  if (BaseDir == NULL || gXsdt == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  Directory = NULL;
+  List      = NULL;
+  ZeroMem(&Writer, sizeof(Writer));
+
+  Status = AcpiAllocatePool(EfiBootServicesData, sizeof(*List), (VOID**)&List);
+  if (!EFI_ERROR(Status)) {
+    Status = AcpiAllocatePool(EfiBootServicesData, EXPORT_WRITE_BUFFER, (VOID**)&Writer.Buffer);
+  }
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate export buffers: %r\n", Status);
+    goto Cleanup;
+  }
+
+  AcpiExportCollect(List);
+  AcpiDebugPrint(DEBUG_INFO, L"Exporting %u tables to %s%s\n", (UINT32)List->Count,
+                 gOptions.ExportDir, gOptions.ExportBundle ? L" as a bundle" : L"");
+
+  // Resolve the output directory once; every file is created relative to it
+  Status = BaseDir->Open(BaseDir, &Directory, gOptions.ExportDir,
+                         EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                         EFI_FILE_DIRECTORY);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Could not create export directory %s: %r\n", gOptions.ExportDir, Status);
+    goto Cleanup;
+  }
+
+  if (gOptions.ExportBundle) {
+    Status = AcpiExportBundle(Directory, List, &Writer);
+  } else {
+    Status = AcpiExportFiles(Directory, List, &Writer);
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Status = AcpiExportManifest(Directory, List, &Writer);
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Status = Directory->Flush(Directory);
+  }
+
+Cleanup:
+  ACPI_LOG3(EFI_ERROR(Status) ? DEBUG_ERROR : DEBUG_INFO, ACPI_LOG_MSG_EXPORT_DONE,
+            List != NULL ? List->Count : 0, Writer.Written, Status);
+  if (!EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_INFO, L"Export complete: %llu bytes written\n", Writer.Written);
+  }
+
+  if (Writer.File != NULL) {
+    Writer.File->Close(Writer.File);
+  }
+  if (Directory != NULL) {
+    Directory->Close(Directory);
+  }
+  if (Writer.Buffer != NULL) {
+    AcpiFreePool(Writer.Buffer);
+  }
+  if (List != NULL) {
+    AcpiFreePool(List);
+  }
+
+  return Status;
+}
@@ -0,0 +1,250 @@
+/** @file
+
+  FPDT boot performance records for the patch run.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/PerformanceLib.h>
+#include <IndustryStandard/Acpi.h>
+#include <Guid/ExtendedFirmwarePerformance.h>
+#include <Protocol/PerformanceMeasurement.h>
+
+#include "AcpiFpdt.h"
+#include "AcpiMemory.h"
+#include "AcpiPerf.h"
+
+typedef enum {
+  AcpiFpdtNone,
+  AcpiFpdtProtocol,       ///< Through EDKII_PERFORMANCE_MEASUREMENT_PROTOCOL
+  AcpiFpdtOwnTable        ///< Into the FBPT of a patcher-owned FPDT
+} ACPI_FPDT_MODE;
+
+#pragma pack(1)
+typedef struct {
+  EFI_ACPI_DESCRIPTION_HEADER                  Header;
+  EFI_ACPI_5_0_FPDT_BOOT_TABLE_POINTER_RECORD  BootPointer;
+} ACPI_FPDT_TABLE;
+
+typedef struct {
+  FPDT_DYNAMIC_STRING_EVENT_RECORD  Event;
+  CHAR8                             Name[ACPI_FPDT_NAME_SIZE];
+} ACPI_FPDT_NAMED_RECORD;
+#pragma pack()
+
+//
+// The run and each phase, in gAcpiPerf.PhaseNs order
+//
+#define ACPI_FPDT_SPANS     (1 + AcpiPhaseMax)
+
+STATIC CONST CHAR8  *mFpdtNames[ACPI_FPDT_SPANS] = {
+  "ACPIPatcher",
+  "ACPIPatcher:Enumerate",
+  "ACPIPatcher:Read",
+  "ACPIPatcher:Validate",
+  "ACPIPatcher:Merge",
+  "ACPIPatcher:Plan"
+};
+
+STATIC ACPI_FPDT_MODE                              mFpdtMode    = AcpiFpdtNone;
+STATIC EDKII_PERFORMANCE_MEASUREMENT_PROTOCOL      *mPerformance = NULL;
+STATIC EFI_ACPI_5_0_FPDT_PERFORMANCE_TABLE_HEADER  *mFbpt        = NULL;
+
+#ifndef DXE
+/**
+  XSDT visitor that stops at an installed FPDT.
+**/
+STATIC
+BOOLEAN
+AcpiFpdtMatch (
+  IN EFI_ACPI_SDT_HEADER  *Table,
+  IN UINTN                Index,
+  IN VOID                 *Context
+  )
+{
+  if (Table->Signature != EFI_ACPI_5_0_FIRMWARE_PERFORMANCE_DATA_TABLE_SIGNATURE) {
+    return FALSE;
+  }
+
+  *(BOOLEAN *)Context = TRUE;
+  return TRUE;
+}
+
+/**
+  Allocates the FBPT, with its empty basic boot record and room for every
+  record of the run, and adds an FPDT pointing at it to the plan.
+**/
+STATIC
+EFI_STATUS
+AcpiFpdtAddTable (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  EFI_STATUS                                   Status;
+  ACPI_FPDT_TABLE                              *Fpdt;
+  EFI_ACPI_5_0_FPDT_FIRMWARE_BASIC_BOOT_RECORD *Basic;
+  UINTN                                        Size;
+
+  // The OS reads the FBPT after ExitBootServices, so it lives in reserved memory
+  Size = sizeof(*mFbpt) + sizeof(*Basic) + 2 * ACPI_FPDT_SPANS * sizeof(ACPI_FPDT_NAMED_RECORD);
+  Status = AcpiAllocatePool(EfiReservedMemoryType, Size, (VOID **)&mFbpt);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  ZeroMem(mFbpt, Size);
+  mFbpt->Signature = EFI_ACPI_5_0_FPDT_BOOT_PERFORMANCE_TABLE_SIGNATURE;
+  mFbpt->Length    = sizeof(*mFbpt) + sizeof(*Basic);
+
+  Basic = (EFI_ACPI_5_0_FPDT_FIRMWARE_BASIC_BOOT_RECORD *)(mFbpt + 1);
+  Basic->Header.Type     = EFI_ACPI_5_0_FPDT_RUNTIME_RECORD_TYPE_FIRMWARE_BASIC_BOOT;
+  Basic->Header.Length   = sizeof(*Basic);
+  Basic->Header.Revision = EFI_ACPI_5_0_FPDT_RUNTIME_RECORD_REVISION_FIRMWARE_BASIC_BOOT;
+
+  Status = AcpiAllocatePool(EfiACPIReclaimMemory, sizeof(*Fpdt), (VOID **)&Fpdt);
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(mFbpt);
+    mFbpt = NULL;
+    return Status;
+  }
+  ZeroMem(Fpdt, sizeof(*Fpdt));
+  Fpdt->Header.Signature       = EFI_ACPI_5_0_FIRMWARE_PERFORMANCE_DATA_TABLE_SIGNATURE;
+  Fpdt->Header.Length          = sizeof(*Fpdt);
+  Fpdt->Header.Revision        = EFI_ACPI_5_0_FIRMWARE_PERFORMANCE_DATA_TABLE_REVISION;
+  CopyMem(Fpdt->Header.OemId, gXsdt->OemId, sizeof(Fpdt->Header.OemId));
+  CopyMem(&Fpdt->Header.OemTableId, ACPI_FPDT_OEM_TABLE_ID, sizeof(Fpdt->Header.OemTableId));
+  Fpdt->Header.OemRevision     = 1;
+  Fpdt->Header.CreatorId       = SIGNATURE_32('A', 'P', 'C', 'H');
+  Fpdt->Header.CreatorRevision = (ACPI_PATCHER_VERSION_MAJOR << 16) | ACPI_PATCHER_VERSION_MINOR;
+  Fpdt->BootPointer.Header.Type     = EFI_ACPI_5_0_FPDT_RECORD_TYPE_FIRMWARE_BASIC_BOOT_POINTER;
+  Fpdt->BootPointer.Header.Length   = sizeof(Fpdt->BootPointer);
+  Fpdt->BootPointer.Header.Revision = EFI_ACPI_5_0_FPDT_RECORD_REVISION_FIRMWARE_BASIC_BOOT_POINTER;
+  Fpdt->BootPointer.BootPerformanceTablePointer = (UINT64)(UINTN)mFbpt;
+  Fpdt->Header.Checksum        = CalculateCheckSum8((UINT8 *)Fpdt, sizeof(*Fpdt));
+
+  Status = AcpiPlanAddTable(Plan, (EFI_ACPI_SDT_HEADER *)Fpdt, FALSE);
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(Fpdt);
+    AcpiFreePool(mFbpt);
+    mFbpt = NULL;
+  }
+  return Status;
+}
+#endif
+
+VOID
+AcpiFpdtPrepare (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  EFI_STATUS  Status;
+#ifndef DXE
+  BOOLEAN     Installed;
+#endif
+
+  mFpdtMode = AcpiFpdtNone;
+  Status = gBS->LocateProtocol(&gEdkiiPerformanceMeasurementProtocolGuid, NULL, (VOID **)&mPerformance);
+  if (!EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Reporting timings through the firmware performance protocol\n");
+    mFpdtMode = AcpiFpdtProtocol;
+    return;
+  }
+
+#ifdef DXE
+  AcpiDebugPrint(DEBUG_VERBOSE, L"No firmware performance protocol, timings are not reported in the FPDT\n");
+#else
+  Installed = FALSE;
+  AcpiWalkXsdt(AcpiFpdtMatch, &Installed);
+  if (Installed) {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"FPDT present without a performance protocol, timings are not reported in it\n");
+    return;
+  }
+
+  Status = AcpiFpdtAddTable(Plan);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Could not add an FPDT for the patcher timings: %r\n", Status);
+    return;
+  }
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Reporting timings in a patcher FPDT, FBPT at " PTR_FMT L"\n", PTR_TO_INT(mFbpt));
+  mFpdtMode = AcpiFpdtOwnTable;
+#endif
+}
+
+VOID
+AcpiFpdtRelease (
+  VOID
+  )
+{
+  // The plan frees the FPDT itself
+  if (mFbpt != NULL) {
+    AcpiFreePool(mFbpt);
+    mFbpt = NULL;
+  }
+  mFpdtMode = AcpiFpdtNone;
+}
+
+/**
+  Emits one start or end record.
+
+  @param[in] Span     Index into mFpdtNames
+  @param[in] Ticks    Performance counter value of the event
+  @param[in] Start    TRUE for the start record, FALSE for the end record
+**/
+STATIC
+VOID
+AcpiFpdtEmit (
+  IN UINTN    Span,
+  IN UINT64   Ticks,
+  IN BOOLEAN  Start
+  )
+{
+  ACPI_FPDT_NAMED_RECORD  *Record;
+
+  if (mFpdtMode == AcpiFpdtProtocol) {
+    // The protocol reads 0 as "now" and 1 as "time zero"
+    mPerformance->CreatePerformanceMeasurement(&gEfiCallerIdGuid, NULL, mFpdtNames[Span], MAX(Ticks, 2), 0,
+                                               Start ? PERF_INMODULE_START_ID : PERF_INMODULE_END_ID,
+                                               Start ? PerfStartEntry : PerfEndEntry);
+    return;
+  }
+
+  Record = (ACPI_FPDT_NAMED_RECORD *)((UINT8 *)mFbpt + mFbpt->Length);
+  Record->Event.Header.Type     = FPDT_DYNAMIC_STRING_EVENT_TYPE;
+  Record->Event.Header.Length   = sizeof(*Record);
+  Record->Event.Header.Revision = FPDT_RECORD_REVISION_1;
+  Record->Event.ProgressID      = Start ? PERF_INMODULE_START_ID : PERF_INMODULE_END_ID;
+  Record->Event.ApicID          = 0;
+  Record->Event.Timestamp       = AcpiPerfTimestampNs(Ticks);
+  CopyMem(&Record->Event.Guid, &gEfiCallerIdGuid, sizeof(EFI_GUID));
+  AsciiStrCpyS(Record->Name, sizeof(Record->Name), mFpdtNames[Span]);
+  mFbpt->Length += sizeof(*Record);
+}
+
+VOID
+AcpiFpdtPublish (
+  VOID
+  )
+{
+  UINT64  Cursor;
+  UINTN   Phase;
+
+  if (mFpdtMode == AcpiFpdtNone) {
+    return;
+  }
+
+  Cursor = AcpiPerfClockStartTicks();
+  AcpiFpdtEmit(0, Cursor, TRUE);
+  for (Phase = 0; Phase < AcpiPhaseMax; Phase++) {
+    AcpiFpdtEmit(1 + Phase, Cursor, TRUE);
+    Cursor = AcpiPerfTicksAfter(Cursor, gAcpiPerf.PhaseNs[Phase]);
+    AcpiFpdtEmit(1 + Phase, Cursor, FALSE);
+  }
+  AcpiFpdtEmit(0, AcpiPerfNow(), FALSE);
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Timings reported in the FPDT\n");
+  // A second run in this boot finds the FPDT and must not append again
+  mFpdtMode = AcpiFpdtNone;
+  mFbpt     = NULL;
+}
@@ -0,0 +1,57 @@
+/** @file
+
+  Publishes the timings of a patch run as FPDT boot performance records, so
+  OS boot-time tooling sees the patcher next to the firmware phases.
+
+  When the firmware provides EDKII_PERFORMANCE_MEASUREMENT_PROTOCOL the
+  records go through it into the firmware's own FBPT. Otherwise, if no FPDT
+  is installed yet, the application adds a patcher-owned FPDT whose FBPT
+  holds an empty basic boot record and the patcher records. The DXE build
+  never adds its own table: the firmware may still install its FPDT at
+  ReadyToBoot.
+
+  Each run is reported as "ACPIPatcher" start and end records followed by
+  one start/end pair per phase, named "ACPIPatcher:<Phase>". Reads and
+  validation interleave per file, so the phase pairs carry the accumulated
+  phase times laid end to end from the start of the run. Tools/DecodeFpdt.py
+  reads them back from a running OS.
+
+**/
+
+#ifndef __ACPI_FPDT_H__
+#define __ACPI_FPDT_H__
+
+#include "AcpiInstall.h"
+
+#define ACPI_FPDT_OEM_TABLE_ID    "APFPDT  "
+#define ACPI_FPDT_NAME_SIZE       24      ///< Record name field, NUL included
+
+/**
+  Chooses how the run is published and, for a patcher-owned FPDT, adds the
+  table to the plan. Call right before the plan is committed.
+
+  @param[in,out] Plan     Plan about to be committed
+**/
+VOID
+AcpiFpdtPrepare (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  );
+
+/**
+  Drops what AcpiFpdtPrepare () set up, when the plan was not committed.
+**/
+VOID
+AcpiFpdtRelease (
+  VOID
+  );
+
+/**
+  Emits the records of the run, ending it now. Does nothing unless
+  AcpiFpdtPrepare () found a way to publish them.
+**/
+VOID
+AcpiFpdtPublish (
+  VOID
+  );
+
+#endif // __ACPI_FPDT_H__
@@ -0,0 +1,173 @@
+/** @file
+
+  Cross-boot performance history.
+
+  The history is rewritten once per committing run; at a few hundred bytes
+  per boot it costs the variable store far less than the tables of
+  AcpiNvStore.c.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include "AcpiHistory.h"
+#include "AcpiPerf.h"
+#include "AcpiLog.h"
+
+typedef struct {
+  ACPI_PATCHER_PERF_HISTORY  Header;
+  ACPI_PATCHER_PERF_RECORD   Records[ACPI_PATCHER_PERF_RECORDS];
+} ACPI_HISTORY_BUFFER;
+
+/**
+  Converts nanoseconds to microseconds, saturating at MAX_UINT32.
+**/
+STATIC
+UINT32
+AcpiHistoryUs (
+  IN UINT64  Ns
+  )
+{
+  UINT64  Us;
+
+  Us = DivU64x32(Ns, 1000);
+  return (Us > MAX_UINT32) ? MAX_UINT32 : (UINT32)Us;
+}
+
+/**
+  Reads the history, starting a new one if it is missing or of another
+  layout.
+
+  @param[out] History   History, oldest record first
+**/
+STATIC
+VOID
+AcpiHistoryLoad (
+  OUT ACPI_HISTORY_BUFFER  *History
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Size = sizeof(*History);
+  Status = gRT->GetVariable(ACPI_PATCHER_PERF_HISTORY_NAME, &gAcpiPatcherPerfHistoryGuid, NULL, &Size, History);
+  if (!EFI_ERROR(Status) &&
+      Size >= sizeof(History->Header) &&
+      History->Header.Signature == ACPI_PATCHER_PERF_SIGNATURE &&
+      History->Header.Version == ACPI_PATCHER_PERF_VERSION &&
+      History->Header.RecordSize == sizeof(ACPI_PATCHER_PERF_RECORD) &&
+      History->Header.RecordCount <= ACPI_PATCHER_PERF_RECORDS &&
+      Size == sizeof(History->Header) + History->Header.RecordCount * sizeof(ACPI_PATCHER_PERF_RECORD)) {
+    return;
+  }
+
+  if (Status != EFI_NOT_FOUND) {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Starting a new performance history (%r)\n", Status);
+  }
+  ZeroMem(History, sizeof(*History));
+  History->Header.Signature  = ACPI_PATCHER_PERF_SIGNATURE;
+  History->Header.Version    = ACPI_PATCHER_PERF_VERSION;
+  History->Header.RecordSize = sizeof(ACPI_PATCHER_PERF_RECORD);
+}
+
+/**
+  Returns the median total time of the recorded runs.
+
+  @param[in] History   History with at least one record
+**/
+STATIC
+UINT32
+AcpiHistoryMedian (
+  IN CONST ACPI_HISTORY_BUFFER  *History
+  )
+{
+  UINT32  Sorted[ACPI_PATCHER_PERF_RECORDS];
+  UINT32  Count;
+  UINT32  Index;
+  UINT32  Slot;
+  UINT32  Value;
+
+  Count = History->Header.RecordCount;
+  for (Index = 0; Index < Count; Index++) {
+    Value = History->Records[Index].TotalUs;
+    for (Slot = Index; Slot > 0 && Sorted[Slot - 1] > Value; Slot--) {
+      Sorted[Slot] = Sorted[Slot - 1];
+    }
+    Sorted[Slot] = Value;
+  }
+
+  if ((Count & 1) != 0) {
+    return Sorted[Count / 2];
+  }
+  return (UINT32)(((UINT64)Sorted[Count / 2 - 1] + Sorted[Count / 2]) / 2);
+}
+
+EFI_STATUS
+AcpiHistoryRecord (
+  IN UINT32  FirmwareRevision
+  )
+{
+  EFI_STATUS                    Status;
+  ACPI_HISTORY_BUFFER           History;
+  ACPI_PATCHER_PERF_RECORD      Record;
+  ACPI_PATCHER_PERF_REGRESSION  Regression;
+  UINTN                         Phase;
+
+  ZeroMem(&Record, sizeof(Record));
+  Record.TotalUs = AcpiHistoryUs(gAcpiPerf.TotalNs);
+  for (Phase = 0; Phase < ACPI_PATCHER_PERF_PHASES && Phase < AcpiPhaseMax; Phase++) {
+    Record.PhaseUs[Phase] = AcpiHistoryUs(gAcpiPerf.PhaseNs[Phase]);
+  }
+  Record.BytesRead        = (gAcpiPerf.BytesRead > MAX_UINT32) ? MAX_UINT32 : (UINT32)gAcpiPerf.BytesRead;
+  Record.FilesRead        = (UINT16)MIN(gAcpiPerf.FilesRead, MAX_UINT16);
+  Record.TablesInstalled  = (UINT16)MIN(gAcpiPerf.TablesInstalled, MAX_UINT16);
+  Record.FirmwareRevision = FirmwareRevision;
+#ifdef DXE
+  Record.Flags           |= ACPI_PATCHER_PERF_DXE;
+#endif
+
+  AcpiHistoryLoad(&History);
+  if (History.Header.RecordCount >= ACPI_HISTORY_BASELINE_MIN_RECORDS) {
+    Record.BaselineUs = AcpiHistoryMedian(&History);
+    if (Record.TotalUs > Record.BaselineUs + ACPI_HISTORY_REGRESSION_MIN_US &&
+        (UINT64)Record.TotalUs * 100 > (UINT64)Record.BaselineUs * (100 + ACPI_PATCHER_REGRESSION_PERCENT)) {
+      Record.Flags |= ACPI_PATCHER_PERF_REGRESSED;
+    }
+  }
+
+  // Drop the oldest record once the ring is full
+  if (History.Header.RecordCount == ACPI_PATCHER_PERF_RECORDS) {
+    CopyMem(&History.Records[0], &History.Records[1], (ACPI_PATCHER_PERF_RECORDS - 1) * sizeof(Record));
+    History.Header.RecordCount--;
+  }
+  CopyMem(&History.Records[History.Header.RecordCount++], &Record, sizeof(Record));
+  History.Header.RunCount++;
+
+  Status = gRT->SetVariable(ACPI_PATCHER_PERF_HISTORY_NAME, &gAcpiPatcherPerfHistoryGuid,
+                            ACPI_PATCHER_PERF_HISTORY_ATTRIBUTES,
+                            sizeof(History.Header) + History.Header.RecordCount * sizeof(Record), &History);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Could not record run timings: %r\n", Status);
+  }
+
+  if ((Record.Flags & ACPI_PATCHER_PERF_REGRESSED) != 0) {
+    AcpiDebugPrint(DEBUG_WARN, L"Run took %u us, more than %u%% over the %u us baseline of the last %u runs\n",
+                   Record.TotalUs, ACPI_PATCHER_REGRESSION_PERCENT, Record.BaselineUs,
+                   History.Header.RecordCount - 1);
+    ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_PERF_REGRESSED, Record.TotalUs, Record.BaselineUs);
+    Regression.TotalUs          = Record.TotalUs;
+    Regression.BaselineUs       = Record.BaselineUs;
+    Regression.ThresholdPercent = ACPI_PATCHER_REGRESSION_PERCENT;
+    gRT->SetVariable(ACPI_PATCHER_PERF_REGRESSED_NAME, &gAcpiPatcherPerfHistoryGuid,
+                     ACPI_PATCHER_PERF_REGRESSED_ATTRIBUTES, sizeof(Regression), &Regression);
+  } else {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Run took %u us, baseline %u us\n", Record.TotalUs, Record.BaselineUs);
+    gRT->SetVariable(ACPI_PATCHER_PERF_REGRESSED_NAME, &gAcpiPatcherPerfHistoryGuid,
+                     ACPI_PATCHER_PERF_REGRESSED_ATTRIBUTES, 0, NULL);
+  }
+
+  return Status;
+}
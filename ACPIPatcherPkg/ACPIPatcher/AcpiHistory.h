@@ -0,0 +1,44 @@
+/** @file
+
+  Cross-boot performance history (see Include/Guid/AcpiPatcherPerfHistory.h).
+
+  The baseline is the median total time of the earlier records, so a
+  single slow or fast boot does not move it, while a lasting change becomes
+  the new baseline once it fills half the ring.
+
+**/
+
+#ifndef __ACPI_HISTORY_H__
+#define __ACPI_HISTORY_H__
+
+#include <Guid/AcpiPatcherPerfHistory.h>
+
+#include "ACPIPatcher.h"
+
+//
+// Records needed before runs are compared against the baseline
+//
+#define ACPI_HISTORY_BASELINE_MIN_RECORDS  4
+
+//
+// Slowdowns below this are timer and cache noise, whatever the percentage
+//
+#define ACPI_HISTORY_REGRESSION_MIN_US     1000
+
+/**
+  Appends the timings of the run that just committed, in gAcpiPerf, to the
+  history and compares them against the baseline. A regression beyond
+  ACPI_PATCHER_REGRESSION_PERCENT is reported as a warning and published in
+  AcpiPerfRegressed; otherwise that variable is deleted.
+
+  @param[in] FirmwareRevision   EFI_SYSTEM_TABLE.FirmwareRevision
+
+  @retval EFI_SUCCESS     Run recorded
+  @retval Other           Variable services failed; the run is not recorded
+**/
+EFI_STATUS
+AcpiHistoryRecord (
+  IN UINT32  FirmwareRevision
+  );
+
+#endif // __ACPI_HISTORY_H__
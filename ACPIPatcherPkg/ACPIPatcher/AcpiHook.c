@@ -0,0 +1,645 @@
+/** @file
+
+  EFI_ACPI_TABLE_PROTOCOL install hook for the DXE build.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Protocol/AcpiTable.h>
+#include <Protocol/AcpiSystemDescriptionTable.h>
+
+#include "AcpiHook.h"
+#include "AcpiInstall.h"
+#include "AcpiManifest.h"
+#include "AcpiDelta.h"
+#include "AcpiAml.h"
+#include "AcpiProfile.h"
+#include "AcpiSource.h"
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+
+STATIC EFI_ACPI_SDT_HEADER                **mHookTables;    ///< Loaded tables, NULL once installed
+STATIC UINTN                              mHookCount;
+STATIC VOID                               *mHookDelta;      ///< DSDT delta waiting for the firmware DSDT, or NULL
+STATIC UINTN                              mHookDeltaSize;
+STATIC UINT64                             mHookDeltaName;   ///< AcpiLogPackName() of the delta file
+STATIC EFI_ACPI_TABLE_PROTOCOL            *mAcpiTable;
+STATIC EFI_ACPI_TABLE_INSTALL_ACPI_TABLE  mOriginalInstall;
+STATIC VOID                               *mProtocolRegistration;
+STATIC EFI_EVENT                          mProtocolEvent;
+STATIC EFI_EVENT                          mReadyToBootEvent;
+
+//
+// XSDT search for the published counterpart of a loaded table
+//
+typedef struct {
+  CONST EFI_ACPI_SDT_HEADER  *Table;
+  UINT64                     Address;
+} ACPI_HOOK_PUBLISHED;
+
+/**
+  Finds the loaded table that takes the place of a table being installed.
+
+  @param[in] Table    Table the firmware installs
+
+  @return Index into mHookTables, or mHookCount if nothing matches
+**/
+STATIC
+UINTN
+AcpiHookMatch (
+  IN CONST EFI_ACPI_SDT_HEADER  *Table
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mHookCount; Index++) {
+    if (mHookTables[Index] == NULL || mHookTables[Index]->Signature != Table->Signature) {
+      continue;
+    }
+    // There is only one DSDT, whatever its OEM Table ID says
+    if (Table->Signature == EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE ||
+        CompareMem(mHookTables[Index]->OemTableId, Table->OemTableId, sizeof(Table->OemTableId)) == 0) {
+      return Index;
+    }
+  }
+  return mHookCount;
+}
+
+/**
+  XSDT visitor that stops at the table with the signature and OEM Table ID
+  of the loaded one.
+**/
+STATIC
+BOOLEAN
+AcpiHookMatchPublished (
+  IN EFI_ACPI_SDT_HEADER  *Table,
+  IN UINTN                Index,
+  IN VOID                 *Context
+  )
+{
+  ACPI_HOOK_PUBLISHED  *Published;
+
+  Published = Context;
+  if (Table->Signature != Published->Table->Signature ||
+      CompareMem(Table->OemTableId, Published->Table->OemTableId, sizeof(Table->OemTableId)) != 0) {
+    return FALSE;
+  }
+
+  Published->Address = (UINT64)(UINTN)Table;
+  return TRUE;
+}
+
+/**
+  Returns the address of the published DSDT from gFacp, or 0 if no FADT
+  was found.
+**/
+STATIC
+UINT64
+AcpiHookPublishedDsdt (
+  VOID
+  )
+{
+  if (gFacp == NULL) {
+    return 0;
+  }
+  if (gFacp->Header.Length >= OFFSET_OF(EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE, XDsdt) + sizeof(UINT64) &&
+      gFacp->XDsdt != 0) {
+    return gFacp->XDsdt;
+  }
+  return gFacp->Dsdt;
+}
+
+/**
+  Finds the published table a loaded table stands for, using the root
+  tables in gXsdt and gFacp.
+
+  @param[in] Table    Loaded table
+
+  @return Address of the published table (the DSDT for a DSDT), or 0
+**/
+STATIC
+UINT64
+AcpiHookFindPublished (
+  IN CONST EFI_ACPI_SDT_HEADER  *Table
+  )
+{
+  ACPI_HOOK_PUBLISHED  Published;
+
+  if (Table->Signature == EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+    return AcpiHookPublishedDsdt();
+  }
+
+  Published.Table   = Table;
+  Published.Address = 0;
+  AcpiWalkXsdt(AcpiHookMatchPublished, &Published);
+  return Published.Address;
+}
+
+/**
+  Rebuilds the DSDT from the pending delta against the DSDT the firmware
+  installs, and adds it to the loaded tables. The delta is released either
+  way.
+
+  @param[in] Table    DSDT the firmware installs
+
+  @return Index of the rebuilt DSDT in mHookTables, or mHookCount if the
+          delta does not apply
+**/
+STATIC
+UINTN
+AcpiHookApplyDelta (
+  IN CONST EFI_ACPI_SDT_HEADER  *Table
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Rebuilt;
+  UINTN       RebuiltSize;
+
+  Status = AcpiDeltaApply(Table, mHookDelta, mHookDeltaSize, &Rebuilt, &RebuiltSize);
+  AcpiFreePool(mHookDelta);
+  mHookDelta = NULL;
+  if (!EFI_ERROR(Status)) {
+    Status = ValidateAcpiTable(Rebuilt, RebuiltSize);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(Rebuilt);
+    }
+  }
+  if (EFI_ERROR(Status)) {
+    ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_DELTA_REFUSED, mHookDeltaName, Status);
+    AcpiDebugPrint(DEBUG_WARN, L"Hook: DSDT delta does not apply to the firmware DSDT: %r\n", Status);
+    return mHookCount;
+  }
+
+  // The delta took a file slot without adding a table, so there is room
+  AcpiDebugPrint(DEBUG_INFO, L"Hook: rebuilt %u byte DSDT from the delta\n", (UINT32)RebuiltSize);
+  mHookTables[mHookCount] = Rebuilt;
+  return mHookCount++;
+}
+
+/**
+  InstallAcpiTable wrapper: installs the matching loaded table in place of
+  the firmware's, or passes the firmware's table through. The firmware DSDT
+  is the base of a pending delta.
+
+  @param[in]  This                  Protocol instance
+  @param[in]  AcpiTableBuffer       Table the firmware installs
+  @param[in]  AcpiTableBufferSize   Size of AcpiTableBuffer
+  @param[out] TableKey              Key of the installed table
+
+  @return Status of the original InstallAcpiTable
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiHookInstallAcpiTable (
+  IN  EFI_ACPI_TABLE_PROTOCOL  *This,
+  IN  VOID                     *AcpiTableBuffer,
+  IN  UINTN                    AcpiTableBufferSize,
+  OUT UINTN                    *TableKey
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Table;
+  EFI_ACPI_SDT_HEADER  *Loaded;
+  UINTN                Index;
+
+  Table = AcpiTableBuffer;
+  if (Table == NULL || AcpiTableBufferSize < sizeof(EFI_ACPI_SDT_HEADER)) {
+    return mOriginalInstall(This, AcpiTableBuffer, AcpiTableBufferSize, TableKey);
+  }
+
+  Index = AcpiHookMatch(Table);
+  if (Index == mHookCount && mHookDelta != NULL && Table->Length <= AcpiTableBufferSize &&
+      Table->Signature == EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+    Index = AcpiHookApplyDelta(Table);
+  }
+  if (Index == mHookCount) {
+    return mOriginalInstall(This, AcpiTableBuffer, AcpiTableBufferSize, TableKey);
+  }
+
+  // The protocol copies the table, so the loaded one is freed either way
+  Loaded = mHookTables[Index];
+  Status = mOriginalInstall(This, Loaded, Loaded->Length, TableKey);
+  ACPI_LOG3(EFI_ERROR(Status) ? DEBUG_WARN : DEBUG_INFO, ACPI_LOG_MSG_HOOK_REPLACED,
+            Loaded->Signature, ReadUnaligned64((UINT64 *)Loaded->OemTableId), Status);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Hook: replacement %.4a failed (%r), installing the firmware table\n",
+                   (CHAR8 *)&Loaded->Signature, Status);
+    Status = mOriginalInstall(This, AcpiTableBuffer, AcpiTableBufferSize, TableKey);
+  } else {
+    AcpiDebugPrint(DEBUG_INFO, L"Hook: replaced %.4a '%.8a' (%u -> %u bytes)\n",
+                   (CHAR8 *)&Loaded->Signature, Loaded->OemTableId,
+                   (UINT32)AcpiTableBufferSize, Loaded->Length);
+  }
+
+  AcpiFreePool(Loaded);
+  mHookTables[Index] = NULL;
+  return Status;
+}
+
+/**
+  Uninstalls a table published before the hook was armed, so the loaded
+  table can be installed in its place through the same protocol. The key
+  of the published table is looked up with EFI_ACPI_SDT_PROTOCOL.
+
+  @param[in] Published    Address of the published table
+
+  @retval EFI_SUCCESS     Published table uninstalled
+  @retval EFI_NOT_FOUND   No EFI_ACPI_SDT_PROTOCOL, or it does not list the table
+  @return Status of UninstallAcpiTable
+**/
+STATIC
+EFI_STATUS
+AcpiHookUninstallPublished (
+  IN UINT64  Published
+  )
+{
+  EFI_STATUS              Status;
+  EFI_ACPI_SDT_PROTOCOL   *AcpiSdt;
+  EFI_ACPI_SDT_HEADER     *Listed;
+  EFI_ACPI_TABLE_VERSION  Version;
+  UINTN                   TableKey;
+  UINTN                   Index;
+
+  if (EFI_ERROR(gBS->LocateProtocol(&gEfiAcpiSdtProtocolGuid, NULL, (VOID **)&AcpiSdt))) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Index = 0; !EFI_ERROR(AcpiSdt->GetAcpiTable(Index, &Listed, &Version, &TableKey)); Index++) {
+    if ((UINT64)(UINTN)Listed == Published) {
+      Status = mAcpiTable->UninstallAcpiTable(mAcpiTable, TableKey);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_WARN, L"Hook: could not uninstall %.4a at 0x%llx: %r\n",
+                       (CHAR8 *)&Listed->Signature, Published, Status);
+      }
+      return Status;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Wraps InstallAcpiTable of a protocol instance.
+
+  @param[in] AcpiTable    Protocol instance to wrap
+**/
+STATIC
+VOID
+AcpiHookAttach (
+  IN EFI_ACPI_TABLE_PROTOCOL  *AcpiTable
+  )
+{
+  mAcpiTable                  = AcpiTable;
+  mOriginalInstall            = AcpiTable->InstallAcpiTable;
+  AcpiTable->InstallAcpiTable = AcpiHookInstallAcpiTable;
+  AcpiDebugPrint(DEBUG_INFO, L"Hook: wrapped InstallAcpiTable at " PTR_FMT L"\n", PTR_TO_INT(mOriginalInstall));
+}
+
+/**
+  Attaches the hook once EFI_ACPI_TABLE_PROTOCOL is installed.
+
+  @param[in] Event      Protocol notify event
+  @param[in] Context    Unused
+**/
+STATIC
+VOID
+EFIAPI
+AcpiHookProtocolNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_ACPI_TABLE_PROTOCOL  *AcpiTable;
+
+  if (EFI_ERROR(gBS->LocateProtocol(&gEfiAcpiTableProtocolGuid, mProtocolRegistration, (VOID **)&AcpiTable))) {
+    return;
+  }
+
+  gBS->CloseEvent(Event);
+  mProtocolEvent = NULL;
+  AcpiHookAttach(AcpiTable);
+}
+
+/**
+  Installs the loaded tables nothing replaced and unwraps the protocol.
+
+  A loaded table whose counterpart is already in the XSDT was published
+  before the hook was armed. The published table is uninstalled and the
+  loaded one installed through EFI_ACPI_TABLE_PROTOCOL, so the protocol
+  keeps owning the XSDT. Only without the protocol, or when it does not
+  list the published table, does the loaded table take over that XSDT
+  entry (or the FADT DSDT pointer) through the installation plan, as the
+  application does. The protocol may reallocate the XSDT on every install,
+  so the root tables are located again before they are next used.
+
+  @param[in] Event      ReadyToBoot event
+  @param[in] Context    Unused
+**/
+STATIC
+VOID
+EFIAPI
+AcpiHookReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Table;
+  ACPI_TABLE_PLAN      Plan;
+  UINTN                Index;
+  UINTN                TableKey;
+  UINT32               Signature;
+  UINT64               OemTableId;
+  UINT64               Published;
+  BOOLEAN              IsDsdt;
+  BOOLEAN              Located;
+  BOOLEAN              Stale;
+
+  gBS->CloseEvent(Event);
+  mReadyToBootEvent = NULL;
+  if (mProtocolEvent != NULL) {
+    gBS->CloseEvent(mProtocolEvent);
+    mProtocolEvent = NULL;
+  }
+
+  // The protocol may have rebuilt the XSDT since the driver started, and does on every install below
+  Located = FALSE;
+  Stale   = TRUE;
+
+  AcpiPlanInit(&Plan);
+  for (Index = 0; Index < mHookCount; Index++) {
+    Table = mHookTables[Index];
+    if (Table == NULL) {
+      continue;
+    }
+    mHookTables[Index] = NULL;
+    if (Stale) {
+      Located = (BOOLEAN)!EFI_ERROR(AcpiLocateRootTables());
+      Stale   = FALSE;
+    }
+    Signature          = Table->Signature;
+    OemTableId         = ReadUnaligned64((UINT64 *)Table->OemTableId);
+    IsDsdt             = (BOOLEAN)(Signature == EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE);
+    Published          = Located ? AcpiHookFindPublished(Table) : 0;
+
+    if (Published != 0) {
+      AcpiDebugPrint(DEBUG_INFO, L"Hook: %.4a '%.8a' was published before the hook, replacing it\n",
+                     (CHAR8 *)&Table->Signature, Table->OemTableId);
+      if (mAcpiTable != NULL && !EFI_ERROR(AcpiHookUninstallPublished(Published))) {
+        Published = 0;
+        Stale     = TRUE;
+      }
+    }
+
+    if (mAcpiTable != NULL && Published == 0) {
+      Status = mOriginalInstall(mAcpiTable, Table, Table->Length, &TableKey);
+      Stale  = TRUE;
+      AcpiFreePool(Table);
+    } else {
+      if (IsDsdt) {
+        Status = AcpiPlanAddTable(&Plan, Table, TRUE);
+      } else if (Published != 0) {
+        Status = AcpiPlanReplaceTable(&Plan, Table, Published);
+      } else {
+        Status = AcpiPlanAddTable(&Plan, Table, FALSE);
+      }
+      if (EFI_ERROR(Status)) {
+        AcpiFreePool(Table);
+      }
+    }
+    ACPI_LOG3(EFI_ERROR(Status) ? DEBUG_WARN : DEBUG_INFO, ACPI_LOG_MSG_HOOK_UNMATCHED,
+              Signature, OemTableId, Status);
+  }
+
+  if (Plan.TableCount > 0 || Plan.Dsdt != NULL) {
+    if (Stale) {
+      Located = (BOOLEAN)!EFI_ERROR(AcpiLocateRootTables());
+    }
+    Status = Located ? AcpiPlanCommit(&Plan) : EFI_NOT_FOUND;
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Hook: XSDT update failed: %r\n", Status);
+    }
+  }
+  AcpiPlanRelease(&Plan);
+
+  // Leave the protocol as it was found if nobody wrapped it after us
+  if (mAcpiTable != NULL && mAcpiTable->InstallAcpiTable == AcpiHookInstallAcpiTable) {
+    mAcpiTable->InstallAcpiTable = mOriginalInstall;
+  }
+
+  // The firmware never installed a DSDT through the protocol
+  if (mHookDelta != NULL) {
+    AcpiDebugPrint(DEBUG_WARN, L"Hook: no firmware DSDT was installed through the hook, DSDT delta not applied\n");
+    ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_DELTA_REFUSED, mHookDeltaName, EFI_NOT_FOUND);
+    AcpiFreePool(mHookDelta);
+    mHookDelta = NULL;
+  }
+
+  AcpiFreePool(mHookTables);
+  mHookTables = NULL;
+  mHookCount  = 0;
+}
+
+/**
+  Reads, validates and, under a digest policy, verifies the collected
+  tables into mHookTables. A DSDT delta is rebuilt against the published
+  DSDT, or kept in mHookDelta until the firmware installs its DSDT; a
+  device property config is compiled to an SSDT.
+
+  @param[in] Directory    ACPI folder, for the manifest; NULL if not opened
+  @param[in] Files        Collected tables
+
+  @retval EFI_SUCCESS             Tables loaded; unusable ones are skipped
+  @retval EFI_SECURITY_VIOLATION  Closed digest policy and no usable manifest
+  @retval EFI_OUT_OF_RESOURCES    Table array could not be allocated
+**/
+STATIC
+EFI_STATUS
+AcpiHookLoad (
+  IN EFI_FILE_PROTOCOL  *Directory  OPTIONAL,
+  IN ACPI_FILE_LIST     *Files
+  )
+{
+  EFI_STATUS       Status;
+  ACPI_MANIFEST    Manifest;
+  ACPI_FILE_ENTRY  *File;
+  VOID             *Buffer;
+  VOID             *Source;
+  UINTN            TableSize;
+  BOOLEAN          CheckDigests;
+  UINTN            Index;
+
+  ZeroMem(&Manifest, sizeof(Manifest));
+  CheckDigests = FALSE;
+  if (gOptions.Verify != ACPI_VERIFY_OFF) {
+    Status = AcpiManifestLoad(Directory, &Manifest);
+    CheckDigests = (BOOLEAN)!EFI_ERROR(Status);
+    if (EFI_ERROR(Status)) {
+      ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_MANIFEST_MISSING, Status, gOptions.Verify);
+      if (gOptions.Verify == ACPI_VERIFY_CLOSED) {
+        return EFI_SECURITY_VIOLATION;
+      }
+    }
+  }
+
+  Status = AcpiAllocatePool(EfiBootServicesData, MAX(Files->Count, 1) * sizeof(*mHookTables), (VOID **)&mHookTables);
+  if (EFI_ERROR(Status)) {
+    AcpiManifestRelease(&Manifest);
+    return Status;
+  }
+
+  for (Index = 0; Index < Files->Count; Index++) {
+    File = &Files->Entries[Index];
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_FILE_PROCESS, AcpiLogPackName(File->Name), File->Size);
+    if (File->Size > MAX_UINT32 || EFI_ERROR(AcpiSourceRead(File, &Buffer))) {
+      continue;
+    }
+
+    // The digest covers the file as read, so a delta or config is checked before it is used
+    if (CheckDigests) {
+      Status = AcpiManifestVerify(&Manifest, File, Buffer);
+      if (EFI_ERROR(Status)) {
+        ACPI_LOG3(DEBUG_WARN, ACPI_LOG_MSG_DIGEST_FAILED, AcpiLogPackName(File->Name), Status, gOptions.Verify);
+        if (gOptions.Verify == ACPI_VERIFY_CLOSED) {
+          AcpiFreePool(Buffer);
+          continue;
+        }
+      }
+    }
+
+    // Without a published DSDT the delta waits for the one the firmware installs
+    TableSize = (UINTN)File->Size;
+    if (AcpiDeltaIsDelta(File->Name)) {
+      if (AcpiHookPublishedDsdt() == 0) {
+        if (mHookDelta != NULL) {
+          AcpiFreePool(mHookDelta);
+        }
+        mHookDelta     = Buffer;
+        mHookDeltaSize = TableSize;
+        mHookDeltaName = AcpiLogPackName(File->Name);
+        AcpiDebugPrint(DEBUG_INFO, L"Hook: %s waits for the firmware DSDT\n", File->Name);
+        continue;
+      }
+
+      Source = Buffer;
+      Status = AcpiDeltaApply((EFI_ACPI_SDT_HEADER *)(UINTN)AcpiHookPublishedDsdt(), Source, TableSize,
+                              &Buffer, &TableSize);
+      AcpiFreePool(Source);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_ERROR, L"Hook: delta %s not applied: %r\n", File->Name, Status);
+        ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_DELTA_REFUSED, AcpiLogPackName(File->Name), Status);
+        continue;
+      }
+    }
+
+    if (AcpiAmlIsConfig(File->Name)) {
+      Source = Buffer;
+      Status = AcpiAmlBuildSsdt(Source, TableSize, &Buffer, &TableSize);
+      AcpiFreePool(Source);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_ERROR, L"Hook: config %s not compiled: %r\n", File->Name, Status);
+        ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_CONFIG_REFUSED, AcpiLogPackName(File->Name), Status);
+        continue;
+      }
+    }
+
+    Status = ValidateAcpiTable(Buffer, TableSize);
+    if (EFI_ERROR(Status)) {
+      ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_TABLE_INVALID, AcpiLogPackName(File->Name), Status);
+      AcpiFreePool(Buffer);
+      continue;
+    }
+
+    AcpiDebugPrint(DEBUG_INFO, L"Hook: %s loaded\n", File->Name);
+    mHookTables[mHookCount++] = Buffer;
+  }
+
+  AcpiManifestRelease(&Manifest);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiHookStart (
+  IN EFI_FILE_PROTOCOL  *Directory  OPTIONAL
+  )
+{
+  EFI_STATUS               Status;
+  ACPI_PROFILE_IDENTITY    Identity;
+  ACPI_FILE_LIST           Files;
+  EFI_ACPI_TABLE_PROTOCOL  *AcpiTable;
+  UINTN                    Published;
+  UINTN                    Index;
+
+  // The identity comes from the XSDT and FADT, which may not exist yet
+  if (gXsdt != NULL) {
+    AcpiProfileIdentify(&Identity);
+  } else {
+    ZeroMem(&Identity, sizeof(Identity));
+    AcpiDebugPrint(DEBUG_INFO, L"Hook: no tables published yet, loading common tables only\n");
+  }
+
+  Status = AcpiSourceCollect(Directory, &Identity, &Files);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = AcpiHookLoad(Directory, &Files);
+  AcpiSourceRelease(&Files);
+  if (EFI_ERROR(Status) || (mHookCount == 0 && mHookDelta == NULL)) {
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_HOOK_ARMED, mHookCount, Status);
+    if (mHookTables != NULL) {
+      AcpiFreePool(mHookTables);
+      mHookTables = NULL;
+    }
+    return Status;
+  }
+
+  // Installs already made never reach the hook; those tables are replaced at ReadyToBoot
+  if (gXsdt != NULL) {
+    Published = 0;
+    for (Index = 0; Index < mHookCount; Index++) {
+      if (AcpiHookFindPublished(mHookTables[Index]) != 0) {
+        Published++;
+      }
+    }
+    if (Published != 0) {
+      AcpiDebugPrint(DEBUG_WARN, L"Hook: firmware tables already published, %u loaded tables replace them at ReadyToBoot\n",
+                     (UINT32)Published);
+    }
+  }
+
+  Status = EfiCreateEventReadyToBootEx(TPL_CALLBACK, AcpiHookReadyToBoot, NULL, &mReadyToBootEvent);
+  if (!EFI_ERROR(Status)) {
+    if (!EFI_ERROR(gBS->LocateProtocol(&gEfiAcpiTableProtocolGuid, NULL, (VOID **)&AcpiTable))) {
+      AcpiHookAttach(AcpiTable);
+    } else {
+      mProtocolEvent = EfiCreateProtocolNotifyEvent(&gEfiAcpiTableProtocolGuid, TPL_CALLBACK,
+                                                    AcpiHookProtocolNotify, NULL, &mProtocolRegistration);
+      Status = (mProtocolEvent == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+    }
+  }
+
+  ACPI_LOG2(EFI_ERROR(Status) ? DEBUG_ERROR : DEBUG_INFO, ACPI_LOG_MSG_HOOK_ARMED, mHookCount, Status);
+  AcpiDebugPrint(EFI_ERROR(Status) ? DEBUG_ERROR : DEBUG_INFO, L"Hook: %u tables waiting for install: %r\n",
+                 (UINT32)mHookCount, Status);
+
+  if (EFI_ERROR(Status)) {
+    if (mReadyToBootEvent != NULL) {
+      gBS->CloseEvent(mReadyToBootEvent);
+      mReadyToBootEvent = NULL;
+    }
+    while (mHookCount > 0) {
+      AcpiFreePool(mHookTables[--mHookCount]);
+    }
+    if (mHookDelta != NULL) {
+      AcpiFreePool(mHookDelta);
+      mHookDelta = NULL;
+    }
+    AcpiFreePool(mHookTables);
+    mHookTables = NULL;
+  }
+  return Status;
+}
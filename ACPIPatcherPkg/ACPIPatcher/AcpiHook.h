@@ -0,0 +1,59 @@
+/** @file
+
+  EFI_ACPI_TABLE_PROTOCOL install hook for the DXE build.
+
+  Instead of rescanning the published tables and rebuilding the XSDT, the
+  driver loads its tables first and wraps InstallAcpiTable. A table the
+  firmware installs with the signature and OEM Table ID of a loaded table
+  (any DSDT for a loaded DSDT) is swapped for the loaded one before the
+  protocol copies it, so the firmware's own protocol places it and no
+  XSDT entry is rewritten afterwards. Loaded tables nothing matched are
+  installed through the protocol at ReadyToBoot. When the firmware
+  published the counterpart before the hook was armed, that table is first
+  uninstalled through the protocol, its key found with
+  EFI_ACPI_SDT_PROTOCOL, so the table is replaced rather than installed
+  twice. Only if either protocol is missing does the loaded table take over
+  the published table's XSDT entry (or the FADT DSDT pointer) through the
+  installation plan, as in the application; a later install through the
+  protocol rebuilds its XSDT without it, so arming the hook early remains
+  the supported setup.
+
+  A DSDT delta (see AcpiDelta.h) is rebuilt against the published DSDT
+  when there is one; otherwise it waits for the DSDT the firmware installs
+  through the hook and is rebuilt against that. If the firmware installs
+  no DSDT through the protocol before ReadyToBoot, the delta is dropped
+  with a warning. A device property config (see AcpiAml.h) is compiled to
+  an SSDT when it is loaded, and installed like any other loaded table.
+
+  Enabled by building ACPIPatcherDxe with -D ACPI_PATCHER_HOOK_INSTALL=TRUE.
+  The driver has to be dispatched before the platform ACPI driver installs
+  its tables; under OVMF, which installs them once the PCI root bridges are
+  connected, loading it as a Driver#### option is early enough.
+
+**/
+
+#ifndef __ACPI_HOOK_H__
+#define __ACPI_HOOK_H__
+
+#include "ACPIPatcher.h"
+
+/**
+  Loads the tables of the ACPI folder and wraps InstallAcpiTable, now or
+  once the protocol is installed.
+
+  The platform profile is chosen from the published tables when there are
+  any; before the firmware publishes its tables only common tables are
+  loaded.
+
+  @param[in] Directory    ACPI folder, or NULL to load the NVRAM table store only
+
+  @retval EFI_SUCCESS             Hook armed, or no tables to load
+  @retval EFI_SECURITY_VIOLATION  Closed digest policy and no usable manifest
+  @retval Other                   Tables could not be collected or the events created
+**/
+EFI_STATUS
+AcpiHookStart (
+  IN EFI_FILE_PROTOCOL  *Directory  OPTIONAL
+  );
+
+#endif // __ACPI_HOOK_H__
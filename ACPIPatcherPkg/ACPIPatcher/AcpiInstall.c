@@ -0,0 +1,438 @@
+/** @file
+
+  Table installation plan and single-pass XSDT rebuild.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "AcpiInstall.h"
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+
+//
+// XSDT allocated by a previous commit of this image. The firmware XSDT is
+// never freed, but one we built ourselves is replaced on the next commit.
+//
+STATIC EFI_ACPI_SDT_HEADER  *mOwnedXsdt = NULL;
+
+UINT32
+AcpiXsdtEntryCount (
+  VOID
+  )
+{
+  if (gXsdt == NULL) {
+    return 0;
+  }
+
+  return (gXsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
+}
+
+VOID
+AcpiPlanInit (
+  OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  ZeroMem(Plan, sizeof(*Plan));
+
+  Plan->MaxTables = gIsEfi1x ? ACPI_EFI1X_MAX_ADDITIONAL_TABLES : MAX_ADDITIONAL_TABLES;
+}
+
+EFI_STATUS
+AcpiPlanAddTable (
+  IN OUT ACPI_TABLE_PLAN      *Plan,
+  IN     EFI_ACPI_SDT_HEADER  *Table,
+  IN     BOOLEAN              IsDsdt
+  )
+{
+  if (Plan == NULL || Table == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (IsDsdt) {
+    if (Plan->Dsdt != NULL) {
+      AcpiDebugPrint(DEBUG_WARN, L"DSDT already planned, replacing previous one\n");
+      AcpiFreePool(Plan->Dsdt);
+    }
+    Plan->Dsdt = Table;
+    return EFI_SUCCESS;
+  }
+
+  if (Plan->TableCount >= Plan->MaxTables) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Plan->Spans[Plan->TableCount]    = 1;
+  Plan->Tables[Plan->TableCount++] = Table;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiPlanReplaceTable (
+  IN OUT ACPI_TABLE_PLAN      *Plan,
+  IN     EFI_ACPI_SDT_HEADER  *Table,
+  IN     UINT64               Address
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = AcpiPlanAddTable(Plan, Table, FALSE);
+  if (!EFI_ERROR(Status)) {
+    Plan->Replaces[Plan->TableCount - 1] = Address;
+    Plan->Firmware[Plan->TableCount - 1] = TRUE;
+  }
+  return Status;
+}
+
+/**
+  Recomputes both RSDP checksums after the XSDT address changed.
+
+  @param[in,out] Rsdp   RSDP to update
+**/
+STATIC
+VOID
+AcpiUpdateRsdpChecksums (
+  IN OUT EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  *Rsdp
+  )
+{
+  Rsdp->Checksum = 0;
+  Rsdp->Checksum = CalculateCheckSum8((UINT8 *)Rsdp,
+                                      OFFSET_OF(EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER, Length));
+
+  if (Rsdp->Revision >= 2) {
+    Rsdp->ExtendedChecksum = 0;
+    Rsdp->ExtendedChecksum = CalculateCheckSum8((UINT8 *)Rsdp, Rsdp->Length);
+  }
+}
+
+/**
+  Points a FADT at a new DSDT and fixes the FADT checksum.
+
+  @param[in,out] Facp     FADT to update
+  @param[in]     Dsdt     Replacement DSDT
+  @param[in]     DryRun   TRUE when Facp is a scratch copy
+**/
+STATIC
+VOID
+AcpiReplaceDsdt (
+  IN OUT EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE  *Facp,
+  IN     EFI_ACPI_SDT_HEADER                        *Dsdt,
+  IN     BOOLEAN                                    DryRun
+  )
+{
+  UINT64  Address;
+
+  Address = (UINT64)(UINTN)Dsdt;
+
+  AcpiDebugPrint(DEBUG_INFO, L"  Processing as DSDT replacement\n");
+  AcpiDebugPrint(DEBUG_VERBOSE, L"  Old DSDT address (32-bit): 0x%x\n", Facp->Dsdt);
+  AcpiDebugPrint(DEBUG_VERBOSE, L"  Old DSDT address (64-bit): 0x%llx\n", Facp->XDsdt);
+  if (!DryRun) {
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_DSDT_REPLACED, Facp->XDsdt, Address);
+  }
+
+  // The 32-bit field cannot describe a table above 4 GB; leave it to XDsdt then
+  Facp->Dsdt = (Address < BASE_4GB) ? (UINT32)Address : 0;
+
+  // ACPI 1.0 FADTs end before X_DSDT
+  if (Facp->Header.Length >= OFFSET_OF(EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE, XDsdt) + sizeof(UINT64)) {
+    Facp->XDsdt = Address;
+  }
+
+  Facp->Header.Checksum = 0;
+  Facp->Header.Checksum = CalculateCheckSum8((UINT8 *)Facp, Facp->Header.Length);
+
+  AcpiDebugPrint(DEBUG_INFO, L"  Updated DSDT address: 0x%llx\n", Address);
+}
+
+/**
+  Returns TRUE if the plan drops the table at Address from the XSDT.
+**/
+STATIC
+BOOLEAN
+AcpiPlanIsRemoved (
+  IN ACPI_TABLE_PLAN  *Plan,
+  IN UINT64           Address
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < Plan->RemovedCount; Index++) {
+    if (Plan->Removed[Index] == Address) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Applies a plan to a set of root tables: builds a new XSDT holding the old
+  entries minus the removed ones, with replaced entries pointing at their
+  planned tables and the other planned tables appended, repoints the RSDP at
+  it and replaces the DSDT. The plan and the previous XSDT are left untouched.
+
+  @param[in]     Plan      Plan to apply
+  @param[in,out] Root      Root tables to update
+  @param[in]     DryRun    TRUE when Root holds scratch copies
+  @param[out]    NewXsdt   Rebuilt XSDT, or NULL when no table was appended
+
+  @retval EFI_SUCCESS            Plan applied
+  @retval EFI_OUT_OF_RESOURCES   New XSDT could not be allocated
+**/
+STATIC
+EFI_STATUS
+AcpiPlanApply (
+  IN     ACPI_TABLE_PLAN      *Plan,
+  IN OUT ACPI_ROOT_TABLES     *Root,
+  IN     BOOLEAN              DryRun,
+  OUT    EFI_ACPI_SDT_HEADER  **NewXsdt
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Xsdt;
+  UINT64               *OldEntries;
+  UINT64               *Entries;
+  UINT64               Address;
+  BOOLEAN              Placed[MAX_ADDITIONAL_TABLES];
+  UINT32               OldCount;
+  UINT32               Count;
+  UINT32               NewLength;
+  UINT32               Old;
+  UINT32               Index;
+
+  *NewXsdt = NULL;
+
+  if (Plan->TableCount > 0 || Plan->RemovedCount > 0) {
+    OldCount   = (Root->Xsdt->Length - sizeof(EFI_ACPI_SDT_HEADER)) / sizeof(UINT64);
+    OldEntries = (UINT64 *)(Root->Xsdt + 1);
+
+    // Sized for the worst case, nothing removed or replaced
+    NewLength = sizeof(EFI_ACPI_SDT_HEADER) + (OldCount + Plan->TableCount) * sizeof(UINT64);
+
+    Status = AcpiAllocatePool(DryRun ? EfiBootServicesData : EfiACPIReclaimMemory, NewLength, (VOID **)&Xsdt);
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate new XSDT (%u bytes): %r\n", NewLength, Status);
+      return Status;
+    }
+
+    CopyMem(Xsdt, Root->Xsdt, sizeof(EFI_ACPI_SDT_HEADER));
+    Entries = (UINT64 *)(Xsdt + 1);
+    Count   = 0;
+    ZeroMem(Placed, sizeof(Placed));
+
+    for (Old = 0; Old < OldCount; Old++) {
+      Address = ReadUnaligned64(&OldEntries[Old]);
+      if (Address != 0 && AcpiPlanIsRemoved(Plan, Address)) {
+        AcpiDebugPrint(DEBUG_INFO, L"  Removed table at address: 0x%llx\n", Address);
+        continue;
+      }
+
+      for (Index = 0; Index < Plan->TableCount; Index++) {
+        if (!Placed[Index] && Address != 0 && Plan->Replaces[Index] == Address) {
+          break;
+        }
+      }
+      if (Index < Plan->TableCount) {
+        Placed[Index] = TRUE;
+        Address       = (UINT64)(UINTN)Plan->Tables[Index];
+        if (!DryRun) {
+          ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_TABLE_ADDED, Plan->Tables[Index]->Signature,
+                    PTR_TO_INT(Plan->Tables[Index]), Plan->Tables[Index]->Length);
+        }
+        AcpiDebugPrint(DEBUG_INFO, L"  Replaced table in XSDT entry %u with " PTR_FMT L"\n",
+                       Count, PTR_TO_INT(Plan->Tables[Index]));
+      }
+
+      WriteUnaligned64(&Entries[Count++], Address);
+    }
+
+    for (Index = 0; Index < Plan->TableCount; Index++) {
+      if (Placed[Index]) {
+        continue;
+      }
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Adding table to XSDT entry %u\n", Count);
+      WriteUnaligned64(&Entries[Count++], (UINT64)(UINTN)Plan->Tables[Index]);
+      if (!DryRun) {
+        ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_TABLE_ADDED, Plan->Tables[Index]->Signature,
+                  PTR_TO_INT(Plan->Tables[Index]), Plan->Tables[Index]->Length);
+      }
+      AcpiDebugPrint(DEBUG_INFO, L"  Added table at address: " PTR_FMT L"\n", PTR_TO_INT(Plan->Tables[Index]));
+    }
+
+    NewLength      = sizeof(EFI_ACPI_SDT_HEADER) + Count * sizeof(UINT64);
+    Xsdt->Length   = NewLength;
+    Xsdt->Checksum = 0;
+    Xsdt->Checksum = CalculateCheckSum8((UINT8 *)Xsdt, NewLength);
+
+    if (!DryRun) {
+      ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_XSDT_REBUILT, PTR_TO_INT(Root->Xsdt), PTR_TO_INT(Xsdt), Count);
+    }
+    AcpiDebugPrint(DEBUG_INFO, L"Rebuilt XSDT at " PTR_FMT L" with %u entries\n", PTR_TO_INT(Xsdt), Count);
+
+    Root->Rsdp->XsdtAddress = (UINT64)(UINTN)Xsdt;
+    AcpiUpdateRsdpChecksums(Root->Rsdp);
+    Root->Xsdt = Xsdt;
+    *NewXsdt   = Xsdt;
+  }
+
+  if (Plan->Dsdt != NULL) {
+    AcpiReplaceDsdt(Root->Facp, Plan->Dsdt, DryRun);
+  } else if (Plan->RestoreDsdt != 0) {
+    AcpiDebugPrint(DEBUG_INFO, L"Restoring the firmware DSDT\n");
+    AcpiReplaceDsdt(Root->Facp, (EFI_ACPI_SDT_HEADER *)(UINTN)Plan->RestoreDsdt, DryRun);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiPlanCommit (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  EFI_STATUS           Status;
+  ACPI_ROOT_TABLES     Root;
+  EFI_ACPI_SDT_HEADER  *NewXsdt;
+  UINT32               Index;
+
+  if (Plan == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (gRsdp == NULL || gXsdt == NULL || gFacp == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  Root.Rsdp = gRsdp;
+  Root.Xsdt = gXsdt;
+  Root.Facp = gFacp;
+
+  Status = AcpiPlanApply(Plan, &Root, FALSE, &NewXsdt);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (NewXsdt != NULL) {
+    if (mOwnedXsdt != NULL) {
+      AcpiFreePool(mOwnedXsdt);
+    } else if (Plan->ReleaseXsdt) {
+      AcpiFreePool(gXsdt);
+    }
+    mOwnedXsdt = NewXsdt;
+    gXsdt      = NewXsdt;
+    gXsdtEnd   = gRsdp->XsdtAddress + gXsdt->Length;
+  }
+
+  // Nothing points at the superseded tables of earlier runs any more
+  for (Index = 0; Index < Plan->RemovedCount; Index++) {
+    AcpiFreePool((VOID *)(UINTN)Plan->Removed[Index]);
+  }
+  for (Index = 0; Index < Plan->TableCount; Index++) {
+    if (Plan->Replaces[Index] != 0 && !Plan->Firmware[Index]) {
+      AcpiFreePool((VOID *)(UINTN)Plan->Replaces[Index]);
+    }
+  }
+
+  // Tables now belong to the firmware
+  ZeroMem(Plan->Tables, sizeof(Plan->Tables));
+  ZeroMem(Plan->Replaces, sizeof(Plan->Replaces));
+  ZeroMem(Plan->Firmware, sizeof(Plan->Firmware));
+  Plan->Dsdt         = NULL;
+  Plan->TableCount   = 0;
+  Plan->RemovedCount = 0;
+  Plan->RestoreDsdt  = 0;
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiPlanDryRun (
+  IN ACPI_TABLE_PLAN  *Plan
+  )
+{
+  EFI_STATUS                                    Status;
+  ACPI_ROOT_TABLES                              Scratch;
+  EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  RsdpCopy;
+  EFI_ACPI_SDT_HEADER                           *XsdtCopy;
+  EFI_ACPI_SDT_HEADER                           *NewXsdt;
+  EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE     *FacpCopy;
+
+  if (Plan == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (gRsdp == NULL || gXsdt == NULL || gFacp == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  XsdtCopy = NULL;
+  FacpCopy = NULL;
+
+  // A revision 0 RSDP is only 20 bytes long
+  ZeroMem(&RsdpCopy, sizeof(RsdpCopy));
+  CopyMem(&RsdpCopy, gRsdp, gRsdp->Revision >= 2 ? MIN(gRsdp->Length, sizeof(RsdpCopy))
+                                                 : OFFSET_OF(EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER, Length));
+
+  Status = AcpiAllocatePool(EfiBootServicesData, gXsdt->Length, (VOID **)&XsdtCopy);
+  if (!EFI_ERROR(Status)) {
+    Status = AcpiAllocatePool(EfiBootServicesData, gFacp->Header.Length, (VOID **)&FacpCopy);
+  }
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate scratch root tables: %r\n", Status);
+    goto Done;
+  }
+
+  CopyMem(XsdtCopy, gXsdt, gXsdt->Length);
+  CopyMem(FacpCopy, gFacp, gFacp->Header.Length);
+
+  Scratch.Rsdp = &RsdpCopy;
+  Scratch.Xsdt = XsdtCopy;
+  Scratch.Facp = FacpCopy;
+
+  Status = AcpiPlanApply(Plan, &Scratch, TRUE, &NewXsdt);
+  if (!EFI_ERROR(Status)) {
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_DRY_RUN, Plan->TableCount, Plan->Dsdt != NULL);
+    AcpiDebugPrint(DEBUG_INFO, L"Dry run: %u tables planned, %u removed, DSDT %a, live tables unchanged\n",
+                   Plan->TableCount, Plan->RemovedCount,
+                   Plan->Dsdt != NULL ? "replaced" : (Plan->RestoreDsdt != 0 ? "restored" : "kept"));
+    if (NewXsdt != NULL) {
+      AcpiFreePool(NewXsdt);
+    }
+  }
+
+Done:
+  if (FacpCopy != NULL) {
+    AcpiFreePool(FacpCopy);
+  }
+  if (XsdtCopy != NULL) {
+    AcpiFreePool(XsdtCopy);
+  }
+
+  return Status;
+}
+
+VOID
+AcpiPlanRelease (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  UINT32  Index;
+
+  if (Plan == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < Plan->TableCount; Index++) {
+    AcpiFreePool(Plan->Tables[Index]);
+    Plan->Tables[Index] = NULL;
+  }
+  if (Plan->Dsdt != NULL) {
+    AcpiFreePool(Plan->Dsdt);
+    Plan->Dsdt = NULL;
+  }
+  Plan->TableCount = 0;
+}
@@ -0,0 +1,140 @@
+/** @file
+
+  Table installation plan.
+
+  Tables from every source are first collected into a plan and then
+  installed with a single XSDT rebuild, so the firmware XSDT is never grown
+  in place past the end of its allocation. The same rebuild drops or
+  replaces in place the tables an earlier run installed.
+
+**/
+
+#ifndef __ACPI_INSTALL_H__
+#define __ACPI_INSTALL_H__
+
+#include "ACPIPatcher.h"
+
+//
+// Tables of an earlier run a plan can remove: every additional table plus the DSDT
+//
+#define ACPI_PLAN_MAX_REMOVED   (MAX_ADDITIONAL_TABLES + 1)
+
+typedef struct {
+  EFI_ACPI_SDT_HEADER  *Dsdt;                            ///< Replacement DSDT, or NULL
+  EFI_ACPI_SDT_HEADER  *Tables[MAX_ADDITIONAL_TABLES];   ///< Tables to append to the XSDT
+  UINT64               Replaces[MAX_ADDITIONAL_TABLES];  ///< XSDT entry each table takes over, 0 to append
+  BOOLEAN              Firmware[MAX_ADDITIONAL_TABLES];  ///< Replaces[] entry is a firmware table, left allocated
+  UINT32               Spans[MAX_ADDITIONAL_TABLES];     ///< Queued tables each table was built from
+  UINT32               TableCount;
+  UINT32               MaxTables;                        ///< Append limit for this firmware
+  UINT64               Removed[ACPI_PLAN_MAX_REMOVED];   ///< Earlier tables to drop from the XSDT and free
+  UINT32               RemovedCount;
+  UINT64               RestoreDsdt;                      ///< Firmware DSDT to put back when Dsdt is NULL, or 0
+  BOOLEAN              ReleaseXsdt;                      ///< Current XSDT was built by an earlier run; free it once replaced
+} ACPI_TABLE_PLAN;
+
+//
+// Root tables a plan is applied to: the live ones, or scratch copies for a dry run
+//
+typedef struct {
+  EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  *Rsdp;
+  EFI_ACPI_SDT_HEADER                           *Xsdt;
+  EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE     *Facp;
+} ACPI_ROOT_TABLES;
+
+/**
+  Initializes an empty plan, applying the EFI 1.x table limit when needed.
+
+  @param[out] Plan    Plan to initialize
+**/
+VOID
+AcpiPlanInit (
+  OUT ACPI_TABLE_PLAN  *Plan
+  );
+
+/**
+  Adds a validated table to the plan. The plan takes ownership of the buffer,
+  which must have been allocated with gBS->AllocatePool ().
+
+  @param[in,out] Plan     Plan to add to
+  @param[in]     Table    Table to install
+  @param[in]     IsDsdt   TRUE to replace the DSDT instead of appending
+
+  @retval EFI_SUCCESS            Table queued
+  @retval EFI_OUT_OF_RESOURCES   Plan already holds MaxTables tables
+**/
+EFI_STATUS
+AcpiPlanAddTable (
+  IN OUT ACPI_TABLE_PLAN      *Plan,
+  IN     EFI_ACPI_SDT_HEADER  *Table,
+  IN     BOOLEAN              IsDsdt
+  );
+
+/**
+  Adds a validated table that takes over the XSDT entry of a table the
+  firmware published. The firmware table is left allocated once replaced.
+
+  @param[in,out] Plan       Plan to add to
+  @param[in]     Table      Table to install; the plan takes ownership
+  @param[in]     Address    Address of the published table in the XSDT
+
+  @retval EFI_SUCCESS            Table queued
+  @retval EFI_OUT_OF_RESOURCES   Plan already holds MaxTables tables
+**/
+EFI_STATUS
+AcpiPlanReplaceTable (
+  IN OUT ACPI_TABLE_PLAN      *Plan,
+  IN     EFI_ACPI_SDT_HEADER  *Table,
+  IN     UINT64               Address
+  );
+
+/**
+  Installs every table in the plan: points the FADT at the replacement DSDT
+  and rebuilds the XSDT once with all appended tables, then fixes up the
+  FADT, XSDT and RSDP checksums. On success the plan is emptied, the tables
+  belong to the firmware and the removed and replaced tables are freed.
+
+  @param[in,out] Plan     Plan to commit
+
+  @retval EFI_SUCCESS            All tables installed
+  @retval EFI_NOT_READY          Root tables have not been located
+  @retval EFI_OUT_OF_RESOURCES   New XSDT could not be allocated
+**/
+EFI_STATUS
+AcpiPlanCommit (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  );
+
+/**
+  Applies the plan to scratch copies of the RSDP, XSDT and FADT, exercising
+  the same rebuild as AcpiPlanCommit () without touching the live tables.
+  The plan keeps ownership of its tables.
+
+  @param[in] Plan     Plan to apply
+
+  @retval EFI_SUCCESS            Plan applied to the scratch copies
+  @retval EFI_NOT_READY          Root tables have not been located
+  @retval EFI_OUT_OF_RESOURCES   Scratch tables could not be allocated
+**/
+EFI_STATUS
+AcpiPlanDryRun (
+  IN ACPI_TABLE_PLAN  *Plan
+  );
+
+/**
+  Frees every table still owned by the plan and empties it.
+
+  @param[in,out] Plan     Plan to release
+**/
+VOID
+AcpiPlanRelease (
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  );
+
+/** Returns the number of entries in the current XSDT. */
+UINT32
+AcpiXsdtEntryCount (
+  VOID
+  );
+
+#endif // __ACPI_INSTALL_H__
@@ -0,0 +1,604 @@
+/** @file
+
+  I/O latency profiles: recording them from the firmware file system driver
+  and replaying them over any directory.
+
+  The replay wrapper forwards every call to the real handle and then stalls
+  for what the profile says the call would have cost, so the data read is
+  real while the timing follows the recorded machine.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Guid/FileInfo.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiIoSim.h"
+#include "AcpiMemory.h"
+#include "AcpiPerf.h"
+
+#define ACPI_IO_SIM_SIGNATURE       SIGNATURE_32('i','o','s','m')
+#define ACPI_IO_PROFILE_FIELDS      5
+#define ACPI_IO_RECORD_PASSES       3     // Each measurement keeps the fastest pass
+#define ACPI_IO_RECORD_OPENS        8
+#define ACPI_IO_RECORD_SMALL_READS  16
+#define ACPI_IO_RECORD_MIN_CHUNK    512
+#define ACPI_IO_RECORD_FLAT_PERCENT 110   // Chunk timings within this share of one whole read are "flat"
+
+typedef struct {
+  UINT32             Signature;
+  EFI_FILE_PROTOCOL  Protocol;
+  EFI_FILE_PROTOCOL  *Real;
+  BOOLEAN            IsDirectory;
+} ACPI_IO_SIM_FILE;
+
+#define ACPI_IO_SIM_FROM_PROTOCOL(a)  CR(a, ACPI_IO_SIM_FILE, Protocol, ACPI_IO_SIM_SIGNATURE)
+
+ACPI_IO_PROFILE    gAcpiIoProfile;
+ACPI_IO_SIM_STATS  gAcpiIoSimStats;
+
+STATIC UINT64  mDelayDebtNs = 0;
+
+/**
+  Adds simulated latency, stalling in whole microseconds and carrying the rest.
+**/
+STATIC
+VOID
+AcpiIoSimDelay (
+  IN UINT64  Ns
+  )
+{
+  UINT64  Us;
+  UINT32  RestNs;
+
+  gAcpiIoSimStats.DelayNs += Ns;
+  mDelayDebtNs            += Ns;
+  if (mDelayDebtNs >= 1000) {
+    Us = DivU64x32Remainder(mDelayDebtNs, 1000, &RestNs);
+    gBS->Stall((UINTN)Us);
+    mDelayDebtNs = RestNs;
+  }
+}
+
+STATIC
+EFI_STATUS
+AcpiIoSimCreate (
+  IN  EFI_FILE_PROTOCOL  *Real,
+  OUT EFI_FILE_PROTOCOL  **Wrapped
+  );
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  EFI_STATUS         Status;
+  ACPI_IO_SIM_FILE   *File;
+  EFI_FILE_PROTOCOL  *Real;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  gAcpiIoSimStats.Opens++;
+  AcpiIoSimDelay(MultU64x32(gAcpiIoProfile.OpenUs, 1000));
+
+  Status = File->Real->Open(File->Real, &Real, FileName, OpenMode, Attributes);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = AcpiIoSimCreate(Real, NewHandle);
+  if (EFI_ERROR(Status)) {
+    Real->Close(Real);
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+  EFI_STATUS        Status;
+
+  File   = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  Status = File->Real->Close(File->Real);
+  File->Signature = 0;
+  AcpiFreePool(File);
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimDelete (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+  EFI_STATUS        Status;
+
+  File   = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  Status = File->Real->Delete(File->Real);
+  File->Signature = 0;
+  AcpiFreePool(File);
+  return Status;
+}
+
+/**
+  Reads through the real handle in one call, charging the directory entry
+  cost, or one fixed cost per MaxTransfer piece plus the per-byte cost.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+  EFI_STATUS        Status;
+  UINT64            Calls;
+
+  File   = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  Status = File->Real->Read(File->Real, BufferSize, Buffer);
+
+  if (File->IsDirectory) {
+    gAcpiIoSimStats.DirReads++;
+    AcpiIoSimDelay(MultU64x32(gAcpiIoProfile.DirEntryUs, 1000));
+    return Status;
+  }
+
+  Calls = 1;
+  if (!EFI_ERROR(Status) && gAcpiIoProfile.MaxTransfer != 0 && *BufferSize > gAcpiIoProfile.MaxTransfer) {
+    Calls = DivU64x32(*BufferSize + gAcpiIoProfile.MaxTransfer - 1, gAcpiIoProfile.MaxTransfer);
+  }
+  gAcpiIoSimStats.Reads += (UINT32)Calls;
+  AcpiIoSimDelay(MultU64x32(MultU64x32(Calls, gAcpiIoProfile.ReadCallUs), 1000) +
+                 (EFI_ERROR(Status) ? 0 : DivU64x32(MultU64x32(*BufferSize, gAcpiIoProfile.NsPerKb), 1024)));
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimWrite (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  IN     VOID               *Buffer
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->Write(File->Real, BufferSize, Buffer);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimGetPosition (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT UINT64             *Position
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->GetPosition(File->Real, Position);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimSetPosition (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN UINT64             Position
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->SetPosition(File->Real, Position);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimGetInfo (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN     EFI_GUID           *InformationType,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->GetInfo(File->Real, InformationType, BufferSize, Buffer);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimSetInfo (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN EFI_GUID           *InformationType,
+  IN UINTN              BufferSize,
+  IN VOID               *Buffer
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->SetInfo(File->Real, InformationType, BufferSize, Buffer);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiIoSimFlush (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  ACPI_IO_SIM_FILE  *File;
+
+  File = ACPI_IO_SIM_FROM_PROTOCOL(This);
+  return File->Real->Flush(File->Real);
+}
+
+STATIC EFI_FILE_PROTOCOL  mAcpiIoSimProtocol = {
+  EFI_FILE_PROTOCOL_REVISION,
+  AcpiIoSimOpen,
+  AcpiIoSimClose,
+  AcpiIoSimDelete,
+  AcpiIoSimRead,
+  AcpiIoSimWrite,
+  AcpiIoSimGetPosition,
+  AcpiIoSimSetPosition,
+  AcpiIoSimGetInfo,
+  AcpiIoSimSetInfo,
+  AcpiIoSimFlush
+};
+
+/**
+  Wraps a real handle; whether it is a directory is looked up once, free of
+  simulated cost.
+**/
+STATIC
+EFI_STATUS
+AcpiIoSimCreate (
+  IN  EFI_FILE_PROTOCOL  *Real,
+  OUT EFI_FILE_PROTOCOL  **Wrapped
+  )
+{
+  EFI_STATUS        Status;
+  ACPI_IO_SIM_FILE  *File;
+  EFI_FILE_INFO     *Info;
+  UINTN             InfoSize;
+
+  Status = AcpiAllocatePool(EfiBootServicesData, sizeof(ACPI_IO_SIM_FILE), (VOID **)&File);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  File->Signature   = ACPI_IO_SIM_SIGNATURE;
+  File->Real        = Real;
+  File->IsDirectory = FALSE;
+  CopyMem(&File->Protocol, &mAcpiIoSimProtocol, sizeof(EFI_FILE_PROTOCOL));
+
+  InfoSize = 0;
+  Status = Real->GetInfo(Real, &gEfiFileInfoGuid, &InfoSize, NULL);
+  if (Status == EFI_BUFFER_TOO_SMALL &&
+      !EFI_ERROR(AcpiAllocatePool(EfiBootServicesData, InfoSize, (VOID **)&Info))) {
+    if (!EFI_ERROR(Real->GetInfo(Real, &gEfiFileInfoGuid, &InfoSize, Info))) {
+      File->IsDirectory = (BOOLEAN)((Info->Attribute & EFI_FILE_DIRECTORY) != 0);
+    }
+    AcpiFreePool(Info);
+  }
+
+  *Wrapped = &File->Protocol;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiIoSimWrap (
+  IN  EFI_FILE_PROTOCOL  *Real,
+  OUT EFI_FILE_PROTOCOL  **Wrapped
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = AcpiIoSimCreate(Real, Wrapped);
+  if (!EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_INFO, L"Replaying I/O profile: open %u us, read %u us + %u ns/KB, max transfer %u, dir entry %u us\n",
+                   gAcpiIoProfile.OpenUs, gAcpiIoProfile.ReadCallUs, gAcpiIoProfile.NsPerKb,
+                   gAcpiIoProfile.MaxTransfer, gAcpiIoProfile.DirEntryUs);
+  }
+  return Status;
+}
+
+EFI_STATUS
+AcpiIoSimParse (
+  IN  CONST CHAR16     *Text,
+  OUT ACPI_IO_PROFILE  *Profile
+  )
+{
+  UINT32  Fields[ACPI_IO_PROFILE_FIELDS];
+  UINTN   Count;
+  UINT64  Value;
+
+  Count = 0;
+  while (Count < ACPI_IO_PROFILE_FIELDS) {
+    if (*Text < L'0' || *Text > L'9') {
+      return EFI_INVALID_PARAMETER;
+    }
+    for (Value = 0; *Text >= L'0' && *Text <= L'9'; Text++) {
+      Value = Value * 10 + (*Text - L'0');
+      if (Value > MAX_UINT32) {
+        return EFI_INVALID_PARAMETER;
+      }
+    }
+    Fields[Count++] = (UINT32)Value;
+    if (*Text != L',' || Count == ACPI_IO_PROFILE_FIELDS) {
+      break;
+    }
+    Text++;
+  }
+
+  if (Count != ACPI_IO_PROFILE_FIELDS || *Text != L'\0') {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Profile->Enabled     = TRUE;
+  Profile->OpenUs      = Fields[0];
+  Profile->ReadCallUs  = Fields[1];
+  Profile->NsPerKb     = Fields[2];
+  Profile->MaxTransfer = Fields[3];
+  Profile->DirEntryUs  = Fields[4];
+  return EFI_SUCCESS;
+}
+
+/**
+  Times reading a whole file from the start in Chunk-sized requests,
+  keeping the fastest of ACPI_IO_RECORD_PASSES passes.
+
+  @param[in]  File      Open file
+  @param[in]  Size      File size
+  @param[in]  Chunk     Request size
+  @param[out] Buffer    Buffer of Size bytes
+  @param[out] Ns        Fastest pass
+
+  @retval EFI_END_OF_FILE   The file ended before Size bytes
+**/
+STATIC
+EFI_STATUS
+AcpiIoSimTimeRead (
+  IN  EFI_FILE_PROTOCOL  *File,
+  IN  UINTN              Size,
+  IN  UINTN              Chunk,
+  OUT UINT8              *Buffer,
+  OUT UINT64             *Ns
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Start;
+  UINT64      Elapsed;
+  UINTN       Pass;
+  UINTN       Offset;
+  UINTN       Length;
+
+  *Ns = MAX_UINT64;
+  for (Pass = 0; Pass < ACPI_IO_RECORD_PASSES; Pass++) {
+    Status = File->SetPosition(File, 0);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    Start = AcpiPerfNow();
+    for (Offset = 0; Offset < Size; Offset += Length) {
+      Length = MIN(Chunk, Size - Offset);
+      Status = File->Read(File, &Length, Buffer + Offset);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      if (Length == 0) {
+        return EFI_END_OF_FILE;
+      }
+    }
+    Elapsed = AcpiPerfElapsedNs(Start);
+    *Ns = MIN(*Ns, Elapsed);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Times listing the directory and finds its largest .aml file.
+
+  @param[in]  Directory   Directory to list
+  @param[out] Name        Largest .aml file, ACPI_FILE_NAME_LENGTH characters
+  @param[out] Size        Its size, 0 if none was found
+  @param[out] EntryNs     Fastest listing time per entry
+**/
+STATIC
+EFI_STATUS
+AcpiIoSimTimeListing (
+  IN  EFI_FILE_PROTOCOL  *Directory,
+  OUT CHAR16             *Name,
+  OUT UINTN              *Size,
+  OUT UINT64             *EntryNs
+  )
+{
+  EFI_STATUS     Status;
+  EFI_FILE_INFO  *Info;
+  UINTN          InfoSize;
+  UINTN          ReadSize;
+  UINTN          Entries;
+  UINTN          Pass;
+  UINT64         Start;
+  UINT64         Elapsed;
+
+  InfoSize = SIZE_OF_EFI_FILE_INFO + FILE_NAME_BUFFER_SIZE * sizeof(CHAR16);
+  Status = AcpiAllocatePool(EfiBootServicesData, InfoSize, (VOID **)&Info);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  *Size    = 0;
+  *EntryNs = MAX_UINT64;
+  for (Pass = 0; Pass < ACPI_IO_RECORD_PASSES && !EFI_ERROR(Status); Pass++) {
+    Status = Directory->SetPosition(Directory, 0);
+    Entries = 0;
+    Start   = AcpiPerfNow();
+    while (!EFI_ERROR(Status)) {
+      ReadSize = InfoSize;
+      Status = Directory->Read(Directory, &ReadSize, Info);
+      Entries++;
+      if (EFI_ERROR(Status) || ReadSize == 0) {
+        break;
+      }
+      if ((Info->Attribute & EFI_FILE_DIRECTORY) == 0 && StrStr(Info->FileName, L".aml") != NULL &&
+          Info->FileSize > *Size && Info->FileSize <= MAX_UINT32 &&
+          StrLen(Info->FileName) < ACPI_FILE_NAME_LENGTH) {
+        *Size = (UINTN)Info->FileSize;
+        StrCpyS(Name, ACPI_FILE_NAME_LENGTH, Info->FileName);
+      }
+    }
+    // The terminating empty read is a request like any other
+    Elapsed  = AcpiPerfElapsedNs(Start);
+    *EntryNs = MIN(*EntryNs, DivU64x32(Elapsed, (UINT32)Entries));
+  }
+
+  AcpiFreePool(Info);
+  return Status;
+}
+
+EFI_STATUS
+AcpiIoSimRecord (
+  IN  EFI_FILE_PROTOCOL  *Directory,
+  OUT ACPI_IO_PROFILE    *Profile
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  CHAR16             Name[ACPI_FILE_NAME_LENGTH];
+  UINT8              *Buffer;
+  UINTN              Size;
+  UINTN              Index;
+  UINTN              Chunk;
+  UINT64             EntryNs;
+  UINT64             OpenNs;
+  UINT64             CallNs;
+  UINT64             WholeNs;
+  UINT64             ChunkNs;
+  UINT64             Start;
+  UINT64             Calls;
+
+  ZeroMem(Profile, sizeof(*Profile));
+
+  Status = AcpiIoSimTimeListing(Directory, Name, &Size, &EntryNs);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  if (Size == 0) {
+    AcpiDebugPrint(DEBUG_ERROR, L"No .aml file to measure the file system with\n");
+    return EFI_NOT_FOUND;
+  }
+  AcpiDebugPrint(DEBUG_INFO, L"Recording I/O profile with %s (%u bytes)\n", Name, (UINT32)Size);
+
+  // Open plus close, as every table load pays both
+  Start = AcpiPerfNow();
+  for (Index = 0; Index < ACPI_IO_RECORD_OPENS; Index++) {
+    Status = Directory->Open(Directory, &File, Name, EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    File->Close(File);
+  }
+  OpenNs = DivU64x32(AcpiPerfElapsedNs(Start), ACPI_IO_RECORD_OPENS);
+
+  Status = Directory->Open(Directory, &File, Name, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Status = AcpiAllocatePool(EfiBootServicesData, Size, (VOID **)&Buffer);
+  if (EFI_ERROR(Status)) {
+    File->Close(File);
+    return Status;
+  }
+
+  // One-byte reads are all fixed cost
+  Status = AcpiIoSimTimeRead(File, MIN(Size, ACPI_IO_RECORD_SMALL_READS), 1, Buffer, &CallNs);
+  if (!EFI_ERROR(Status)) {
+    CallNs = DivU64x32(CallNs, (UINT32)MIN(Size, ACPI_IO_RECORD_SMALL_READS));
+    Status = AcpiIoSimTimeRead(File, Size, Size, Buffer, &WholeNs);
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Profile->OpenUs     = (UINT32)DivU64x32(OpenNs, 1000);
+    Profile->ReadCallUs = (UINT32)DivU64x32(CallNs, 1000);
+    Profile->DirEntryUs = (UINT32)DivU64x32(EntryNs, 1000);
+
+    // A driver that splits requests at M bytes costs the same for any chunk of M or more
+    if (Profile->ReadCallUs > 0) {
+      for (Chunk = ACPI_IO_RECORD_MIN_CHUNK; Chunk < Size; Chunk *= 2) {
+        Status = AcpiIoSimTimeRead(File, Size, Chunk, Buffer, &ChunkNs);
+        if (EFI_ERROR(Status)) {
+          break;
+        }
+        if (MultU64x32(ChunkNs, 100) <= MultU64x32(WholeNs, ACPI_IO_RECORD_FLAT_PERCENT)) {
+          Profile->MaxTransfer = (UINT32)Chunk;
+          break;
+        }
+      }
+    }
+
+    // The whole read paid the fixed cost once per piece the driver split it into
+    Calls = (Profile->MaxTransfer != 0) ? DivU64x32(Size + Profile->MaxTransfer - 1, Profile->MaxTransfer) : 1;
+    if (!EFI_ERROR(Status) && WholeNs > MultU64x64(Calls, CallNs)) {
+      Profile->NsPerKb = (UINT32)DivU64x64Remainder(MultU64x32(WholeNs - MultU64x64(Calls, CallNs), 1024), Size, NULL);
+    }
+  }
+
+  AcpiFreePool(Buffer);
+  File->Close(File);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"I/O profile measurement failed: %r\n", Status);
+    return Status;
+  }
+
+  SelectivePrint(L"I/O profile of the file system driver:\n");
+  SelectivePrint(L"  Open + close:       %u us\n", Profile->OpenUs);
+  SelectivePrint(L"  Read request:       %u us\n", Profile->ReadCallUs);
+  SelectivePrint(L"  Transfer:           %u ns/KB\n", Profile->NsPerKb);
+  SelectivePrint(L"  Max transfer:       %u bytes%s\n", Profile->MaxTransfer,
+                 Profile->MaxTransfer == 0 ? L" (no split seen)" : L"");
+  SelectivePrint(L"  Directory entry:    %u us\n", Profile->DirEntryUs);
+  SelectivePrint(L"Replay with: --latency %u,%u,%u,%u,%u\n", Profile->OpenUs, Profile->ReadCallUs,
+                 Profile->NsPerKb, Profile->MaxTransfer, Profile->DirEntryUs);
+  return EFI_SUCCESS;
+}
+
+VOID
+AcpiIoSimReport (
+  VOID
+  )
+{
+  AcpiDebugPrint(DEBUG_INFO, L"I/O replay: %u opens, %u reads, %u directory reads, %llu us added\n",
+                 gAcpiIoSimStats.Opens, gAcpiIoSimStats.Reads, gAcpiIoSimStats.DirReads,
+                 DivU64x32(gAcpiIoSimStats.DelayNs, 1000));
+}
@@ -0,0 +1,100 @@
+/** @file
+
+  I/O latency profiles: recording them from the firmware file system driver
+  and replaying them over any directory.
+
+  A profile recorded on a slow machine can be replayed on a fast one, so
+  read strategies can be compared under the latency that matters without
+  access to the original hardware.
+
+**/
+
+#ifndef __ACPI_IO_SIM_H__
+#define __ACPI_IO_SIM_H__
+
+#include <Protocol/SimpleFileSystem.h>
+
+//
+// Latency model of a file system driver
+//
+typedef struct {
+  BOOLEAN  Enabled;       ///< Replay this profile over the ACPI folder
+  UINT32   OpenUs;        ///< Cost of opening and closing a file
+  UINT32   ReadCallUs;    ///< Fixed cost of one read request
+  UINT32   NsPerKb;       ///< Transfer cost per KB
+  UINT32   MaxTransfer;   ///< Driver splits reads above this many bytes, 0 for no limit
+  UINT32   DirEntryUs;    ///< Cost of reading one directory entry
+} ACPI_IO_PROFILE;
+
+//
+// What a replay cost
+//
+typedef struct {
+  UINT32  Opens;
+  UINT32  Reads;          ///< Read requests after splitting at MaxTransfer
+  UINT32  DirReads;
+  UINT64  DelayNs;        ///< Simulated latency added
+} ACPI_IO_SIM_STATS;
+
+extern ACPI_IO_PROFILE    gAcpiIoProfile;
+extern ACPI_IO_SIM_STATS  gAcpiIoSimStats;
+
+/**
+  Parses a profile in the form printed by AcpiIoSimRecord:
+  OpenUs,ReadCallUs,NsPerKb,MaxTransfer,DirEntryUs.
+
+  @param[in]  Text      Profile text
+  @param[out] Profile   Parsed profile, enabled
+
+  @retval EFI_SUCCESS             Profile parsed
+  @retval EFI_INVALID_PARAMETER   Wrong number of fields or not a number
+**/
+EFI_STATUS
+AcpiIoSimParse (
+  IN  CONST CHAR16     *Text,
+  OUT ACPI_IO_PROFILE  *Profile
+  );
+
+/**
+  Wraps an open directory so that it and everything opened through it
+  delay each call as gAcpiIoProfile describes. The wrapper owns Real and
+  closes it when closed itself.
+
+  @param[in]  Real      Directory to wrap
+  @param[out] Wrapped   Wrapping handle
+
+  @retval EFI_SUCCESS             Directory wrapped
+  @retval EFI_OUT_OF_RESOURCES    Allocation failed; Real is left open
+**/
+EFI_STATUS
+AcpiIoSimWrap (
+  IN  EFI_FILE_PROTOCOL  *Real,
+  OUT EFI_FILE_PROTOCOL  **Wrapped
+  );
+
+/**
+  Measures the latency profile of the driver behind Directory using its
+  largest .aml file, and prints it in the form AcpiIoSimParse accepts.
+
+  @param[in]  Directory   ACPI folder, read through the firmware driver
+  @param[out] Profile     Recorded profile
+
+  @retval EFI_SUCCESS     Profile recorded
+  @retval EFI_NOT_FOUND   No .aml file to measure with
+  @retval Other           A file operation failed
+**/
+EFI_STATUS
+AcpiIoSimRecord (
+  IN  EFI_FILE_PROTOCOL  *Directory,
+  OUT ACPI_IO_PROFILE    *Profile
+  );
+
+/**
+  Prints the calls made and latency added by the replay so far.
+**/
+VOID
+AcpiIoSimReport (
+  VOID
+  );
+
+#endif // __ACPI_IO_SIM_H__
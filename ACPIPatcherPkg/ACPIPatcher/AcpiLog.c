@@ -0,0 +1,154 @@
+/** @file
+
+  Binary log ring published as a UEFI configuration table.
+
+  The ring lives in EfiRuntimeServicesData so it survives the application
+  exiting and can be read from the shell or from the OS after boot. A later
+  run attaches to the ring installed by an earlier one instead of replacing
+  it, so the history of several runs is kept until the ring wraps.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+
+STATIC ACPI_PATCHER_LOG_HEADER  *mLogRing    = NULL;
+STATIC ACPI_PATCHER_LOG_ENTRY   *mLogEntries = NULL;
+STATIC UINT32                   mLogRun      = 0;
+
+/**
+  Checks that a ring found in the configuration table has the layout this
+  build expects.
+
+  @param[in] Ring   Candidate ring
+
+  @retval TRUE      Ring can be reused
+  @retval FALSE     Ring is from an incompatible build or corrupted
+**/
+STATIC
+BOOLEAN
+AcpiLogRingIsCompatible (
+  IN ACPI_PATCHER_LOG_HEADER  *Ring
+  )
+{
+  return (BOOLEAN)(Ring->Signature == ACPI_PATCHER_LOG_SIGNATURE &&
+                   Ring->Version == ACPI_PATCHER_LOG_VERSION &&
+                   Ring->EntrySize == sizeof(ACPI_PATCHER_LOG_ENTRY) &&
+                   Ring->EntryCount == ACPI_PATCHER_LOG_ENTRIES);
+}
+
+EFI_STATUS
+AcpiLogInit (
+  VOID
+  )
+{
+  EFI_STATUS               Status;
+  ACPI_PATCHER_LOG_HEADER  *Ring;
+  UINTN                    RingSize;
+  UINT64                   CounterStart;
+  UINT64                   CounterEnd;
+
+  if (mLogRing != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Ring   = NULL;
+  Status = EfiGetSystemConfigurationTable(&gAcpiPatcherLogTableGuid, (VOID **)&Ring);
+  if (EFI_ERROR(Status) || Ring == NULL || !AcpiLogRingIsCompatible(Ring)) {
+    RingSize = sizeof(ACPI_PATCHER_LOG_HEADER) +
+               ACPI_PATCHER_LOG_ENTRIES * sizeof(ACPI_PATCHER_LOG_ENTRY);
+
+    Status = AcpiAllocatePool(EfiRuntimeServicesData, RingSize, (VOID **)&Ring);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    ZeroMem(Ring, RingSize);
+    Ring->Signature  = ACPI_PATCHER_LOG_SIGNATURE;
+    Ring->Version    = ACPI_PATCHER_LOG_VERSION;
+    Ring->EntrySize  = sizeof(ACPI_PATCHER_LOG_ENTRY);
+    Ring->EntryCount = ACPI_PATCHER_LOG_ENTRIES;
+
+    Ring->CounterFrequency = GetPerformanceCounterProperties(&CounterStart, &CounterEnd);
+    Ring->CounterStart     = CounterStart;
+    Ring->CounterEnd       = CounterEnd;
+
+    Status = gBS->InstallConfigurationTable(&gAcpiPatcherLogTableGuid, Ring);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(Ring);
+      return Status;
+    }
+  }
+
+  Ring->RunCount++;
+  mLogRun     = Ring->RunCount;
+  mLogEntries = (ACPI_PATCHER_LOG_ENTRY *)(Ring + 1);
+  mLogRing    = Ring;
+
+  return EFI_SUCCESS;
+}
+
+VOID
+AcpiLogRecord (
+  IN UINT8   Level,
+  IN UINT16  MessageId,
+  IN UINT8   ArgCount,
+  IN UINT64  Arg0,
+  IN UINT64  Arg1,
+  IN UINT64  Arg2,
+  IN UINT64  Arg3
+  )
+{
+  ACPI_PATCHER_LOG_ENTRY  *Entry;
+
+  if (mLogRing == NULL) {
+    return;
+  }
+
+  Entry = &mLogEntries[mLogRing->WriteIndex & (ACPI_PATCHER_LOG_ENTRIES - 1)];
+  mLogRing->WriteIndex++;
+
+  Entry->Timestamp = GetPerformanceCounter();
+  Entry->MessageId = MessageId;
+  Entry->Level     = Level;
+  Entry->ArgCount  = ArgCount;
+  Entry->Run       = mLogRun;
+  Entry->Args[0]   = Arg0;
+  Entry->Args[1]   = Arg1;
+  Entry->Args[2]   = Arg2;
+  Entry->Args[3]   = Arg3;
+}
+
+UINT64
+AcpiLogPackName (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINT64  Packed;
+  UINTN   Index;
+
+  Packed = 0;
+  if (Name == NULL) {
+    return 0;
+  }
+
+  for (Index = 0; Index < sizeof(UINT64) && Name[Index] != L'\0'; Index++) {
+    Packed |= LShiftU64((UINT8)Name[Index], Index * 8);
+  }
+
+  return Packed;
+}
+
+ACPI_PATCHER_LOG_HEADER *
+AcpiLogGetRing (
+  VOID
+  )
+{
+  return mLogRing;
+}
@@ -0,0 +1,71 @@
+/** @file
+
+  Binary log ring helpers.
+
+  Events are recorded without any formatting so that logging stays enabled
+  in DXE builds, where console output is compiled out.
+
+**/
+
+#ifndef __ACPI_LOG_H__
+#define __ACPI_LOG_H__
+
+#include <Guid/AcpiPatcherLog.h>
+
+/**
+  Attaches to the log ring published by a previous run, or allocates and
+  publishes a new one.
+
+  @retval EFI_SUCCESS   Ring is ready for recording.
+  @retval Other         Ring could not be allocated or published; recording
+                        becomes a no-op.
+**/
+EFI_STATUS
+AcpiLogInit (
+  VOID
+  );
+
+/**
+  Records one event into the log ring.
+
+  @param[in] Level      Debug level (DEBUG_ERROR .. DEBUG_VERBOSE)
+  @param[in] MessageId  ACPI_LOG_MSG_* identifier
+  @param[in] ArgCount   Number of valid arguments
+  @param[in] Arg0-Arg3  Raw integer arguments
+**/
+VOID
+AcpiLogRecord (
+  IN UINT8   Level,
+  IN UINT16  MessageId,
+  IN UINT8   ArgCount,
+  IN UINT64  Arg0,
+  IN UINT64  Arg1,
+  IN UINT64  Arg2,
+  IN UINT64  Arg3
+  );
+
+/**
+  Packs up to the first eight characters of a file name into an argument.
+
+  @param[in] Name   File name
+
+  @return Packed ASCII name, zero padded.
+**/
+UINT64
+AcpiLogPackName (
+  IN CONST CHAR16  *Name
+  );
+
+/** Returns the published log ring, or NULL if logging is unavailable. */
+ACPI_PATCHER_LOG_HEADER *
+AcpiLogGetRing (
+  VOID
+  );
+
+#define ACPI_LOG0(Level, Id)                  AcpiLogRecord((UINT8)(Level), (Id), 0, 0, 0, 0, 0)
+#define ACPI_LOG1(Level, Id, A0)              AcpiLogRecord((UINT8)(Level), (Id), 1, (UINT64)(A0), 0, 0, 0)
+#define ACPI_LOG2(Level, Id, A0, A1)          AcpiLogRecord((UINT8)(Level), (Id), 2, (UINT64)(A0), (UINT64)(A1), 0, 0)
+#define ACPI_LOG3(Level, Id, A0, A1, A2)      AcpiLogRecord((UINT8)(Level), (Id), 3, (UINT64)(A0), (UINT64)(A1), (UINT64)(A2), 0)
+#define ACPI_LOG4(Level, Id, A0, A1, A2, A3)  AcpiLogRecord((UINT8)(Level), (Id), 4, (UINT64)(A0), (UINT64)(A1), (UINT64)(A2), (UINT64)(A3))
+
+#endif // __ACPI_LOG_H__
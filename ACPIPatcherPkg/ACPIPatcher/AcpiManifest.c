@@ -0,0 +1,271 @@
+/** @file
+
+  Table digest manifest: loading Manifest.sha256 and checking tables
+  against it.
+
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+
+#include "AcpiManifest.h"
+#include "FsHelpers.h"
+#include "AcpiMemory.h"
+
+/**
+  Returns the value of a hex digit, or 0xFF if Char is not one.
+**/
+STATIC
+UINT8
+AcpiManifestHexValue (
+  IN CHAR8  Char
+  )
+{
+  if (Char >= '0' && Char <= '9') {
+    return (UINT8)(Char - '0');
+  }
+  Char = AsciiCharToUpper(Char);
+  if (Char >= 'A' && Char <= 'F') {
+    return (UINT8)(Char - 'A' + 10);
+  }
+  return 0xFF;
+}
+
+/**
+  Parses one manifest line.
+
+  @param[in]  Line      Line text, without the line break
+  @param[in]  Length    Line length
+  @param[out] Entry     Parsed entry
+
+  @retval TRUE    Entry filled
+  @retval FALSE   Line is malformed
+**/
+STATIC
+BOOLEAN
+AcpiManifestParseLine (
+  IN  CONST CHAR8          *Line,
+  IN  UINTN                Length,
+  OUT ACPI_MANIFEST_ENTRY  *Entry
+  )
+{
+  UINTN  Index;
+  UINTN  NameLength;
+  UINT8  High;
+  UINT8  Low;
+
+  if (Length < ACPI_SHA256_DIGEST_SIZE * 2 + 2) {
+    return FALSE;
+  }
+
+  for (Index = 0; Index < ACPI_SHA256_DIGEST_SIZE; Index++) {
+    High = AcpiManifestHexValue(Line[Index * 2]);
+    Low  = AcpiManifestHexValue(Line[Index * 2 + 1]);
+    if (High > 0xF || Low > 0xF) {
+      return FALSE;
+    }
+    Entry->Digest[Index] = (UINT8)((High << 4) | Low);
+  }
+
+  Index = ACPI_SHA256_DIGEST_SIZE * 2;
+  if (Line[Index] != ' ' && Line[Index] != '\t') {
+    return FALSE;
+  }
+  while (Index < Length && (Line[Index] == ' ' || Line[Index] == '\t')) {
+    Index++;
+  }
+  if (Index < Length && Line[Index] == '*') {
+    Index++;
+  }
+
+  NameLength = Length - Index;
+  if (NameLength == 0 || NameLength >= ACPI_MANIFEST_NAME_LENGTH) {
+    return FALSE;
+  }
+
+  for (Length = 0; Length < NameLength; Length++) {
+    Entry->Name[Length] = (Line[Index + Length] == '\\') ? L'/' : (CHAR16)Line[Index + Length];
+  }
+  Entry->Name[NameLength] = L'\0';
+  return TRUE;
+}
+
+/**
+  Parses the manifest text.
+
+  @param[in]  Text        Manifest contents
+  @param[in]  Size        Size of Text
+  @param[out] Entries     Parsed entries, or NULL to only count them
+  @param[out] Ignored     Malformed lines, may be NULL
+
+  @return Number of entries, at most ACPI_MANIFEST_MAX_ENTRIES
+**/
+STATIC
+UINT32
+AcpiManifestParse (
+  IN  CONST CHAR8          *Text,
+  IN  UINTN                Size,
+  OUT ACPI_MANIFEST_ENTRY  *Entries  OPTIONAL,
+  OUT UINT32               *Ignored  OPTIONAL
+  )
+{
+  ACPI_MANIFEST_ENTRY  Scratch;
+  UINTN                Start;
+  UINTN                End;
+  UINTN                Length;
+  UINT32               Count;
+
+  Count = 0;
+  for (Start = 0; Start < Size && Count < ACPI_MANIFEST_MAX_ENTRIES; Start = End + 1) {
+    End = Start;
+    while (End < Size && Text[End] != '\n') {
+      End++;
+    }
+
+    Length = End - Start;
+    while (Length > 0 && (Text[Start + Length - 1] == '\r' || Text[Start + Length - 1] == ' ')) {
+      Length--;
+    }
+    if (Length == 0 || Text[Start] == '#') {
+      continue;
+    }
+
+    if (!AcpiManifestParseLine(&Text[Start], Length, (Entries != NULL) ? &Entries[Count] : &Scratch)) {
+      if (Ignored != NULL) {
+        (*Ignored)++;
+      }
+      continue;
+    }
+    Count++;
+  }
+
+  return Count;
+}
+
+EFI_STATUS
+AcpiManifestLoad (
+  IN  EFI_FILE_PROTOCOL  *Directory  OPTIONAL,
+  OUT ACPI_MANIFEST      *Manifest
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  CHAR8              *Text;
+  UINTN              Size;
+  UINTN              Length;
+  UINT32             Count;
+
+  ZeroMem(Manifest, sizeof(*Manifest));
+  if (Directory == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = FsOpenFile(Directory, ACPI_MANIFEST_FILE_NAME, &File);
+  if (EFI_ERROR(Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  // One byte beyond the limit tells an oversized manifest from a full one
+  Status = AcpiAllocatePool(EfiBootServicesData, ACPI_MANIFEST_MAX_SIZE + 1, (VOID**)&Text);
+  if (EFI_ERROR(Status)) {
+    File->Close(File);
+    return Status;
+  }
+
+  Size = 0;
+  do {
+    Length = ACPI_MANIFEST_MAX_SIZE + 1 - Size;
+    Status = File->Read(File, &Length, Text + Size);
+    Size  += Length;
+  } while (!EFI_ERROR(Status) && Length > 0 && Size <= ACPI_MANIFEST_MAX_SIZE);
+  File->Close(File);
+
+  if (!EFI_ERROR(Status) && Size > ACPI_MANIFEST_MAX_SIZE) {
+    Status = EFI_UNSUPPORTED;
+  }
+
+  Count = 0;
+  if (!EFI_ERROR(Status)) {
+    Count = AcpiManifestParse(Text, Size, NULL, NULL);
+  }
+  if (!EFI_ERROR(Status) && Count > 0) {
+    Status = AcpiAllocatePool(EfiBootServicesData, Count * sizeof(ACPI_MANIFEST_ENTRY), (VOID**)&Manifest->Entries);
+  }
+  if (!EFI_ERROR(Status) && Count > 0) {
+    Manifest->Count = AcpiManifestParse(Text, Size, Manifest->Entries, &Manifest->Ignored);
+  }
+
+  AcpiFreePool(Text);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Failed to load %s: %r\n", ACPI_MANIFEST_FILE_NAME, Status);
+    return Status;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"%s lists %u tables, %u lines ignored\n",
+                 ACPI_MANIFEST_FILE_NAME, Manifest->Count, Manifest->Ignored);
+  return EFI_SUCCESS;
+}
+
+/**
+  Compares two names ignoring case, as FAT does.
+**/
+STATIC
+BOOLEAN
+AcpiManifestNameEqual (
+  IN CONST CHAR16  *Left,
+  IN CONST CHAR16  *Right
+  )
+{
+  while (*Left != L'\0' && CharToUpper(*Left) == CharToUpper(*Right)) {
+    Left++;
+    Right++;
+  }
+  return (BOOLEAN)(CharToUpper(*Left) == CharToUpper(*Right));
+}
+
+EFI_STATUS
+AcpiManifestVerify (
+  IN CONST ACPI_MANIFEST    *Manifest,
+  IN CONST ACPI_FILE_ENTRY  *Entry,
+  IN CONST VOID             *Table
+  )
+{
+  CHAR16  Name[ACPI_MANIFEST_NAME_LENGTH];
+  UINT8   Digest[ACPI_SHA256_DIGEST_SIZE];
+  UINT32  Index;
+
+  if (Entry->Tier == AcpiTierOptional) {
+    UnicodeSPrint(Name, sizeof(Name), ACPI_SOURCE_OPTIONAL_DIR L"/%s", Entry->Name);
+  } else if (Entry->ProfileKey == ACPI_PROFILE_COMMON_KEY) {
+    StrCpyS(Name, ACPI_MANIFEST_NAME_LENGTH, Entry->Name);
+  } else {
+    UnicodeSPrint(Name, sizeof(Name), ACPI_PROFILE_DIR_FORMAT L"/%s", Entry->ProfileKey, Entry->Name);
+  }
+
+  for (Index = 0; Index < Manifest->Count; Index++) {
+    if (AcpiManifestNameEqual(Manifest->Entries[Index].Name, Name)) {
+      break;
+    }
+  }
+  if (Index == Manifest->Count) {
+    return EFI_NOT_FOUND;
+  }
+
+  AcpiSha256(Table, (UINTN)Entry->Size, Digest);
+  if (CompareMem(Digest, Manifest->Entries[Index].Digest, sizeof(Digest)) != 0) {
+    return EFI_SECURITY_VIOLATION;
+  }
+  return EFI_SUCCESS;
+}
+
+VOID
+AcpiManifestRelease (
+  IN OUT ACPI_MANIFEST  *Manifest
+  )
+{
+  if (Manifest->Entries != NULL) {
+    AcpiFreePool(Manifest->Entries);
+  }
+  ZeroMem(Manifest, sizeof(*Manifest));
+}
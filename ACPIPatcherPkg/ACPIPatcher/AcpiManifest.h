@@ -0,0 +1,90 @@
+/** @file
+
+  Table digest manifest.
+
+  Manifest.sha256 in the ACPI folder lists the expected SHA-256 of each
+  table in sha256sum format, one "<64 hex digits> <name>" line per table;
+  a '*' before the name and '#' comment lines are accepted. Tables of a
+  profile are listed as P-XXXXXXXX/<name>, whether they come from the
+  profile subdirectory or the bundle, and optional tables as
+  Optional/<name>. Tools/AcpiBundle.py digest writes it.
+
+  The manifest lives next to the tables, so it catches corrupt or
+  half-copied table sets, not deliberate edits by someone who can also
+  rewrite the manifest.
+
+**/
+
+#ifndef __ACPI_MANIFEST_H__
+#define __ACPI_MANIFEST_H__
+
+#include "ACPIPatcher.h"
+#include "AcpiSha256.h"
+#include "AcpiSource.h"
+
+#define ACPI_MANIFEST_FILE_NAME     L"Manifest.sha256"
+#define ACPI_MANIFEST_MAX_SIZE      SIZE_64KB
+#define ACPI_MANIFEST_MAX_ENTRIES   256
+
+//
+// "P-XXXXXXXX/" followed by a file name
+//
+#define ACPI_MANIFEST_NAME_LENGTH   (ACPI_PROFILE_DIR_LENGTH + 1 + ACPI_FILE_NAME_LENGTH)
+
+typedef struct {
+  CHAR16  Name[ACPI_MANIFEST_NAME_LENGTH];
+  UINT8   Digest[ACPI_SHA256_DIGEST_SIZE];
+} ACPI_MANIFEST_ENTRY;
+
+typedef struct {
+  ACPI_MANIFEST_ENTRY  *Entries;
+  UINT32               Count;
+  UINT32               Ignored;     ///< Malformed lines
+} ACPI_MANIFEST;
+
+/**
+  Reads Manifest.sha256 from the ACPI folder.
+
+  @param[in]  Directory   ACPI folder, NULL when only the NVRAM store is loaded
+  @param[out] Manifest    Parsed entries; release with AcpiManifestRelease
+
+  @retval EFI_SUCCESS             Manifest loaded
+  @retval EFI_NOT_FOUND           No manifest in Directory, or no Directory
+  @retval EFI_UNSUPPORTED         Manifest is larger than ACPI_MANIFEST_MAX_SIZE
+  @retval Other                   Read or allocation failed
+**/
+EFI_STATUS
+AcpiManifestLoad (
+  IN  EFI_FILE_PROTOCOL  *Directory  OPTIONAL,
+  OUT ACPI_MANIFEST      *Manifest
+  );
+
+/**
+  Checks a table read from a collected file against the manifest.
+
+  @param[in] Manifest   Loaded manifest
+  @param[in] Entry      File the table was read from
+  @param[in] Table      Table data, Entry->Size bytes
+
+  @retval EFI_SUCCESS             Digest matches
+  @retval EFI_NOT_FOUND           File is not listed
+  @retval EFI_SECURITY_VIOLATION  Digest differs
+**/
+EFI_STATUS
+AcpiManifestVerify (
+  IN CONST ACPI_MANIFEST    *Manifest,
+  IN CONST ACPI_FILE_ENTRY  *Entry,
+  IN CONST VOID             *Table
+  );
+
+/**
+  Frees the manifest entries.
+
+  @param[in,out] Manifest   Manifest filled by AcpiManifestLoad
+**/
+VOID
+AcpiManifestRelease (
+  IN OUT ACPI_MANIFEST  *Manifest
+  );
+
+#endif // __ACPI_MANIFEST_H__
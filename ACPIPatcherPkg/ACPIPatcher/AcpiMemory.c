@@ -0,0 +1,290 @@
+/** @file
+
+  Pool allocation accounting.
+
+  The site and live-allocation tables are fixed arrays so that recording an
+  allocation never allocates. Allocations that do not fit are still made,
+  and only counted as untracked.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiMemory.h"
+#include "AcpiLog.h"
+
+#define ACPI_MEM_NO_SITE   MAX_UINT32
+
+//
+// Spare descriptors for the map buffer splitting a free range
+//
+#define ACPI_MEM_MAP_SLACK  4
+
+typedef struct {
+  VOID    *Buffer;
+  UINTN   Size;
+  UINT32  Site;
+} ACPI_MEM_LIVE;
+
+STATIC ACPI_MEM_SITE  mSites[ACPI_MEM_MAX_SITES];
+STATIC UINT32         mSiteCount  = 0;
+STATIC ACPI_MEM_LIVE  mLive[ACPI_MEM_MAX_LIVE];
+STATIC UINT32         mLiveCount  = 0;
+STATIC UINT64         mLiveBytes  = 0;
+STATIC UINT64         mPeakBytes  = 0;
+STATIC UINT32         mFailed     = 0;
+STATIC UINT32         mUntracked  = 0;
+
+STATIC CONST CHAR16  *mMemoryTypeNames[] = {
+  L"Reserved",            L"LoaderCode",          L"LoaderData",
+  L"BootServicesCode",    L"BootServicesData",    L"RuntimeServicesCode",
+  L"RuntimeServicesData", L"Conventional",        L"Unusable",
+  L"ACPIReclaim",         L"ACPINVS",             L"MMIO",
+  L"MMIOPortSpace",       L"PalCode",             L"Persistent"
+};
+
+/**
+  Returns a printable name for a memory type.
+**/
+STATIC
+CONST CHAR16 *
+AcpiMemTypeName (
+  IN UINT32  Type
+  )
+{
+  return (Type < ARRAY_SIZE(mMemoryTypeNames)) ? mMemoryTypeNames[Type] : L"Other";
+}
+
+/**
+  Returns the file name part of a __FILE__ path.
+**/
+STATIC
+CONST CHAR8 *
+AcpiMemBaseName (
+  IN CONST CHAR8  *Path
+  )
+{
+  CONST CHAR8  *Name;
+
+  for (Name = Path; *Path != '\0'; Path++) {
+    if (*Path == '/' || *Path == '\\') {
+      Name = Path + 1;
+    }
+  }
+
+  return Name;
+}
+
+/**
+  Finds or adds the statistics slot for a call site.
+
+  @return Index into mSites, or ACPI_MEM_NO_SITE if the table is full
+**/
+STATIC
+UINT32
+AcpiMemFindSite (
+  IN CONST CHAR8      *File,
+  IN UINT32           Line,
+  IN EFI_MEMORY_TYPE  Type
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < mSiteCount; Index++) {
+    if (mSites[Index].Line == Line && mSites[Index].Type == Type && mSites[Index].File == File) {
+      return Index;
+    }
+  }
+
+  if (mSiteCount == ACPI_MEM_MAX_SITES) {
+    return ACPI_MEM_NO_SITE;
+  }
+
+  ZeroMem(&mSites[mSiteCount], sizeof(ACPI_MEM_SITE));
+  mSites[mSiteCount].File = File;
+  mSites[mSiteCount].Line = Line;
+  mSites[mSiteCount].Type = Type;
+  return mSiteCount++;
+}
+
+EFI_STATUS
+AcpiMemAllocatePool (
+  IN  EFI_MEMORY_TYPE  Type,
+  IN  UINTN            Size,
+  OUT VOID             **Buffer,
+  IN  CONST CHAR8      *File,
+  IN  UINT32           Line
+  )
+{
+  EFI_STATUS     Status;
+  UINT32         Site;
+  ACPI_MEM_SITE  *Stats;
+
+  Status = gBS->AllocatePool(Type, Size, Buffer);
+  if (EFI_ERROR(Status)) {
+    mFailed++;
+    return Status;
+  }
+
+  Site = AcpiMemFindSite(File, Line, Type);
+  if (Site == ACPI_MEM_NO_SITE || mLiveCount == ACPI_MEM_MAX_LIVE) {
+    mUntracked++;
+    return Status;
+  }
+
+  mLive[mLiveCount].Buffer = *Buffer;
+  mLive[mLiveCount].Size   = Size;
+  mLive[mLiveCount].Site   = Site;
+  mLiveCount++;
+
+  Stats = &mSites[Site];
+  Stats->Allocations++;
+  Stats->Bytes     += Size;
+  Stats->LiveBytes += Size;
+  if (Stats->LiveBytes > Stats->PeakBytes) {
+    Stats->PeakBytes = Stats->LiveBytes;
+  }
+
+  mLiveBytes += Size;
+  if (mLiveBytes > mPeakBytes) {
+    mPeakBytes = mLiveBytes;
+  }
+
+  return Status;
+}
+
+EFI_STATUS
+AcpiMemFreePool (
+  IN VOID  *Buffer
+  )
+{
+  UINT32         Index;
+  ACPI_MEM_SITE  *Stats;
+
+  // Most buffers are short-lived, so search from the newest
+  for (Index = mLiveCount; Index-- > 0; ) {
+    if (mLive[Index].Buffer == Buffer) {
+      Stats = &mSites[mLive[Index].Site];
+      Stats->Frees++;
+      Stats->LiveBytes -= mLive[Index].Size;
+      mLiveBytes       -= mLive[Index].Size;
+      mLive[Index] = mLive[--mLiveCount];
+      break;
+    }
+  }
+
+  return gBS->FreePool(Buffer);
+}
+
+EFI_STATUS
+AcpiMemSnapshot (
+  OUT ACPI_MEM_SNAPSHOT  *Snapshot
+  )
+{
+  EFI_STATUS             Status;
+  EFI_MEMORY_DESCRIPTOR  *Map;
+  EFI_MEMORY_DESCRIPTOR  *Descriptor;
+  UINTN                  MapSize;
+  UINTN                  MapKey;
+  UINTN                  DescriptorSize;
+  UINT32                 DescriptorVersion;
+  UINTN                  Index;
+
+  ZeroMem(Snapshot, sizeof(*Snapshot));
+
+  MapSize = 0;
+  Status = gBS->GetMemoryMap(&MapSize, NULL, &MapKey, &DescriptorSize, &DescriptorVersion);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return EFI_ERROR(Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  // Not tracked: the map buffer is present in both snapshots and freed right away
+  MapSize += ACPI_MEM_MAP_SLACK * DescriptorSize;
+  Status = gBS->AllocatePool(EfiBootServicesData, MapSize, (VOID **)&Map);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  Status = gBS->GetMemoryMap(&MapSize, Map, &MapKey, &DescriptorSize, &DescriptorVersion);
+  if (!EFI_ERROR(Status)) {
+    Snapshot->Descriptors = MapSize / DescriptorSize;
+    Descriptor = Map;
+    for (Index = 0; Index < Snapshot->Descriptors; Index++) {
+      if (Descriptor->Type < EfiMaxMemoryType) {
+        Snapshot->Pages[Descriptor->Type] += Descriptor->NumberOfPages;
+      }
+      Descriptor = NEXT_MEMORY_DESCRIPTOR(Descriptor, DescriptorSize);
+    }
+  }
+
+  gBS->FreePool(Map);
+  return Status;
+}
+
+VOID
+AcpiMemReport (
+  IN CONST ACPI_MEM_SNAPSHOT  *Before,
+  IN CONST ACPI_MEM_SNAPSHOT  *After
+  )
+{
+  UINT64         Resident[EfiMaxMemoryType];
+  UINT64         LiveBytes;
+  UINT64         PeakBytes;
+  UINT32         LiveCount;
+  UINT32         Allocations;
+  UINT32         Frees;
+  UINT32         SiteCount;
+  UINT32         Index;
+  ACPI_MEM_SITE  *Site;
+
+  // Capture first; the report's own print buffers are tracked too
+  LiveBytes   = mLiveBytes;
+  PeakBytes   = mPeakBytes;
+  LiveCount   = mLiveCount;
+  SiteCount   = mSiteCount;
+  Allocations = 0;
+  Frees       = 0;
+  ZeroMem(Resident, sizeof(Resident));
+  for (Index = 0; Index < SiteCount; Index++) {
+    Allocations += mSites[Index].Allocations;
+    Frees       += mSites[Index].Frees;
+    if (mSites[Index].Type < EfiMaxMemoryType) {
+      Resident[mSites[Index].Type] += mSites[Index].LiveBytes;
+    }
+  }
+
+  AcpiDebugPrint(DEBUG_INFO, L"Memory accounting:\n");
+  AcpiDebugPrint(DEBUG_INFO, L"  Pool allocations: %u (%u freed, %u failed, %u untracked)\n",
+                 Allocations, Frees, mFailed, mUntracked);
+  AcpiDebugPrint(DEBUG_INFO, L"  Peak pool in use: %llu bytes\n", PeakBytes);
+  AcpiDebugPrint(DEBUG_INFO, L"  Still allocated: %llu bytes in %u buffers\n", LiveBytes, LiveCount);
+  for (Index = 0; Index < EfiMaxMemoryType; Index++) {
+    if (Resident[Index] != 0) {
+      AcpiDebugPrint(DEBUG_INFO, L"    %s: %llu bytes\n", AcpiMemTypeName(Index), Resident[Index]);
+    }
+  }
+
+  if (Before != NULL && After != NULL) {
+    AcpiDebugPrint(DEBUG_INFO, L"  Memory map: %u -> %u descriptors\n",
+                   (UINT32)Before->Descriptors, (UINT32)After->Descriptors);
+    for (Index = 0; Index < EfiMaxMemoryType; Index++) {
+      if (Before->Pages[Index] != After->Pages[Index]) {
+        AcpiDebugPrint(DEBUG_VERBOSE, L"    %s: %llu -> %llu pages\n", AcpiMemTypeName(Index),
+                       Before->Pages[Index], After->Pages[Index]);
+      }
+    }
+    ACPI_LOG4(DEBUG_INFO, ACPI_LOG_MSG_MEMORY, PeakBytes, LiveBytes, Before->Descriptors, After->Descriptors);
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"  Allocation sites:\n");
+  for (Index = 0; Index < SiteCount; Index++) {
+    Site = &mSites[Index];
+    AcpiDebugPrint(DEBUG_VERBOSE, L"    %a:%u %s: %u allocs, %u frees, %llu bytes, peak %llu, live %llu\n",
+                   AcpiMemBaseName(Site->File), Site->Line, AcpiMemTypeName(Site->Type),
+                   Site->Allocations, Site->Frees, Site->Bytes, Site->PeakBytes, Site->LiveBytes);
+  }
+}
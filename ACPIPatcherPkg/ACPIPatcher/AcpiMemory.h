@@ -0,0 +1,102 @@
+/** @file
+
+  Pool allocation accounting.
+
+  Every pool allocation of the patcher goes through AcpiAllocatePool and
+  AcpiFreePool, which record counts, bytes and peak usage per call site.
+  Together with memory map snapshots this shows what a run leaves resident.
+
+**/
+
+#ifndef __ACPI_MEMORY_H__
+#define __ACPI_MEMORY_H__
+
+#define ACPI_MEM_MAX_SITES   48
+#define ACPI_MEM_MAX_LIVE    256
+
+#define AcpiAllocatePool(Type, Size, Buffer)  AcpiMemAllocatePool ((Type), (Size), (Buffer), __FILE__, __LINE__)
+#define AcpiFreePool(Buffer)                  AcpiMemFreePool (Buffer)
+
+//
+// Statistics for one allocating call site
+//
+typedef struct {
+  CONST CHAR8      *File;
+  UINT32           Line;
+  EFI_MEMORY_TYPE  Type;
+  UINT32           Allocations;
+  UINT32           Frees;
+  UINT64           Bytes;         ///< Bytes requested over all allocations
+  UINT64           LiveBytes;     ///< Bytes currently allocated
+  UINT64           PeakBytes;     ///< Highest LiveBytes
+} ACPI_MEM_SITE;
+
+//
+// Memory map summary taken with GetMemoryMap
+//
+typedef struct {
+  UINTN   Descriptors;
+  UINT64  Pages[EfiMaxMemoryType];
+} ACPI_MEM_SNAPSHOT;
+
+/**
+  Allocates pool memory and records it against the calling site.
+
+  @param[in]  Type      Memory type
+  @param[in]  Size      Bytes to allocate
+  @param[out] Buffer    Allocated buffer
+  @param[in]  File      Source file of the caller
+  @param[in]  Line      Source line of the caller
+
+  @return Status of gBS->AllocatePool
+**/
+EFI_STATUS
+AcpiMemAllocatePool (
+  IN  EFI_MEMORY_TYPE  Type,
+  IN  UINTN            Size,
+  OUT VOID             **Buffer,
+  IN  CONST CHAR8      *File,
+  IN  UINT32           Line
+  );
+
+/**
+  Frees pool memory and updates the statistics of the site that allocated
+  it. Buffers allocated outside the tracking layer are freed as well.
+
+  @param[in] Buffer   Buffer to free
+
+  @return Status of gBS->FreePool
+**/
+EFI_STATUS
+AcpiMemFreePool (
+  IN VOID  *Buffer
+  );
+
+/**
+  Summarizes the current memory map.
+
+  @param[out] Snapshot    Descriptor count and pages per memory type
+
+  @retval EFI_SUCCESS     Snapshot taken
+  @retval Other           GetMemoryMap or the map buffer allocation failed
+**/
+EFI_STATUS
+AcpiMemSnapshot (
+  OUT ACPI_MEM_SNAPSHOT  *Snapshot
+  );
+
+/**
+  Reports allocation totals, what stayed allocated and how the memory map
+  changed between two snapshots. Per-site and per-type detail is printed
+  at verbose level.
+
+  @param[in] Before   Snapshot taken at the start of the run, or NULL
+  @param[in] After    Snapshot taken at the end of the run, or NULL
+**/
+VOID
+AcpiMemReport (
+  IN CONST ACPI_MEM_SNAPSHOT  *Before,
+  IN CONST ACPI_MEM_SNAPSHOT  *After
+  );
+
+#endif // __ACPI_MEMORY_H__
@@ -0,0 +1,450 @@
+/** @file
+
+  Tables kept in UEFI variables.
+
+  The index variable is written last when adding a table and first when
+  removing one, so an interrupted change leaves at worst a table whose
+  CRC32 no longer matches the index; such a table is skipped, not
+  installed.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include "AcpiNvStore.h"
+#include "FsHelpers.h"
+#include "AcpiMemory.h"
+
+//
+// Room for "AcpiTableNN"
+//
+#define ACPI_NV_VARIABLE_NAME_LENGTH  16
+
+//
+// Bytes a variable store spends per variable besides its name and data;
+// generous enough for authenticated variable headers
+//
+#define ACPI_NV_VARIABLE_OVERHEAD     96
+
+/**
+  Formats the variable name of a table slot.
+
+  @param[out] Name   Buffer of ACPI_NV_VARIABLE_NAME_LENGTH characters
+  @param[in]  Slot   Table number in the index
+**/
+STATIC
+VOID
+AcpiNvTableName (
+  OUT CHAR16  *Name,
+  IN  UINT32  Slot
+  )
+{
+  UnicodeSPrint(Name, ACPI_NV_VARIABLE_NAME_LENGTH * sizeof(CHAR16), ACPI_PATCHER_NV_TABLE_FORMAT, Slot);
+}
+
+EFI_STATUS
+AcpiNvReadIndex (
+  OUT ACPI_NV_INDEX_BUFFER  *Index
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Size = sizeof(*Index);
+  Status = gRT->GetVariable(ACPI_PATCHER_NV_INDEX_NAME, &gAcpiPatcherNvTablesGuid, NULL, &Size, Index);
+  if (Status == EFI_BUFFER_TOO_SMALL) {
+    return EFI_UNSUPPORTED;
+  }
+  if (EFI_ERROR(Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Size < sizeof(Index->Header) ||
+      Index->Header.Signature != ACPI_PATCHER_NV_SIGNATURE ||
+      Index->Header.Version != ACPI_PATCHER_NV_VERSION ||
+      Index->Header.EntrySize != sizeof(ACPI_PATCHER_NV_ENTRY) ||
+      Index->Header.TableCount > ACPI_PATCHER_NV_MAX_TABLES ||
+      Size != sizeof(Index->Header) + Index->Header.TableCount * sizeof(ACPI_PATCHER_NV_ENTRY)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Ignoring malformed NVRAM table index\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiNvReadTable (
+  IN  UINT32  Slot,
+  IN  UINTN   Size,
+  IN  UINT32  Crc32,
+  OUT VOID    **Buffer
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      Name[ACPI_NV_VARIABLE_NAME_LENGTH];
+  UINTN       ReadSize;
+  UINT32      Actual;
+
+  Status = AcpiAllocatePool(EfiRuntimeServicesData, Size, Buffer);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  AcpiNvTableName(Name, Slot);
+  ReadSize = Size;
+  Status = gRT->GetVariable(Name, &gAcpiPatcherNvTablesGuid, NULL, &ReadSize, *Buffer);
+  if (Status == EFI_BUFFER_TOO_SMALL || (!EFI_ERROR(Status) && ReadSize != Size)) {
+    Status = EFI_CRC_ERROR;
+  }
+  if (!EFI_ERROR(Status)) {
+    gBS->CalculateCrc32(*Buffer, Size, &Actual);
+    if (Actual != Crc32) {
+      Status = EFI_CRC_ERROR;
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(*Buffer);
+    *Buffer = NULL;
+  }
+  return Status;
+}
+
+BOOLEAN
+AcpiNvSkipsFolder (
+  VOID
+  )
+{
+  ACPI_NV_INDEX_BUFFER  Index;
+
+  if (EFI_ERROR(AcpiNvReadIndex(&Index))) {
+    return FALSE;
+  }
+
+  return (BOOLEAN)(Index.Header.TableCount > 0 &&
+                   (Index.Header.Flags & ACPI_PATCHER_NV_LOAD_FOLDER) == 0);
+}
+
+/**
+  Writes the index variable.
+
+  @param[in] Index   Index to store
+**/
+STATIC
+EFI_STATUS
+AcpiNvWriteIndex (
+  IN ACPI_NV_INDEX_BUFFER  *Index
+  )
+{
+  return gRT->SetVariable(ACPI_PATCHER_NV_INDEX_NAME, &gAcpiPatcherNvTablesGuid, ACPI_PATCHER_NV_ATTRIBUTES,
+                          sizeof(Index->Header) + Index->Header.TableCount * sizeof(ACPI_PATCHER_NV_ENTRY),
+                          Index);
+}
+
+/**
+  Checks that a new variable of Size bytes fits the firmware limits.
+
+  @param[in] Size     Data size of the new variable
+  @param[in] Freed    Data size of the variable it replaces, 0 if none
+
+  @retval EFI_SUCCESS             Variable fits, or the firmware cannot tell
+  @retval EFI_BAD_BUFFER_SIZE     Larger than the largest variable
+  @retval EFI_OUT_OF_RESOURCES    Would eat into the storage reserve
+**/
+STATIC
+EFI_STATUS
+AcpiNvCheckStorage (
+  IN UINTN  Size,
+  IN UINTN  Freed
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      MaxStorage;
+  UINT64      Remaining;
+  UINT64      MaxVariable;
+  UINT64      Needed;
+
+  if (Size > ACPI_PATCHER_NV_MAX_TABLE_SIZE) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  // QueryVariableInfo is a UEFI 2.0 service
+  if (gIsEfi1x) {
+    return EFI_SUCCESS;
+  }
+  Status = gRT->QueryVariableInfo(ACPI_PATCHER_NV_ATTRIBUTES, &MaxStorage, &Remaining, &MaxVariable);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Variable storage size unknown: %r\n", Status);
+    return EFI_SUCCESS;
+  }
+
+  Needed = Size + ACPI_NV_VARIABLE_NAME_LENGTH * sizeof(CHAR16) + ACPI_NV_VARIABLE_OVERHEAD;
+  if (Needed > MaxVariable) {
+    AcpiDebugPrint(DEBUG_ERROR, L"%u byte table exceeds the %llu byte variable limit\n", Size, MaxVariable);
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  if (Freed < Size && Remaining < Size - Freed + MaxStorage / ACPI_PATCHER_NV_RESERVE_DIVISOR) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Only %llu of %llu bytes of variable storage free, keeping 1/%u in reserve\n",
+                   Remaining, MaxStorage, ACPI_PATCHER_NV_RESERVE_DIVISOR);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the slot of a stored table by file name, or MAX_UINT32.
+**/
+STATIC
+UINT32
+AcpiNvFind (
+  IN ACPI_NV_INDEX_BUFFER  *Index,
+  IN CONST CHAR8           *Name
+  )
+{
+  UINT32  Slot;
+
+  for (Slot = 0; Slot < Index->Header.TableCount; Slot++) {
+    if (AsciiStrnCmp(Index->Entries[Slot].Name, Name, ACPI_PATCHER_NV_NAME_SIZE) == 0) {
+      return Slot;
+    }
+  }
+  return MAX_UINT32;
+}
+
+/**
+  Prints the stored tables and the variable storage limits.
+**/
+STATIC
+VOID
+AcpiNvList (
+  IN ACPI_NV_INDEX_BUFFER  *Index
+  )
+{
+  ACPI_PATCHER_NV_ENTRY  *Entry;
+  UINT32                 Slot;
+  UINT64                 MaxStorage;
+  UINT64                 Remaining;
+  UINT64                 MaxVariable;
+
+  SelectivePrint(L"NVRAM table store: %u of %u tables, ACPI folder %s\n",
+                 Index->Header.TableCount, ACPI_PATCHER_NV_MAX_TABLES,
+                 (Index->Header.Flags & ACPI_PATCHER_NV_LOAD_FOLDER) ? L"also loaded" : L"not touched");
+  for (Slot = 0; Slot < Index->Header.TableCount; Slot++) {
+    Entry = &Index->Entries[Slot];
+    Entry->Name[ACPI_PATCHER_NV_NAME_SIZE - 1] = '\0';
+    SelectivePrint(L"  %02u  %-4.4a  %6u bytes  crc %08x  %a\n", Slot, (CHAR8 *)&Entry->Signature,
+                   Entry->Length, Entry->Crc32, Entry->Name);
+  }
+
+  if (!gIsEfi1x &&
+      !EFI_ERROR(gRT->QueryVariableInfo(ACPI_PATCHER_NV_ATTRIBUTES, &MaxStorage, &Remaining, &MaxVariable))) {
+    SelectivePrint(L"Variable storage: %llu of %llu bytes free, largest variable %llu bytes\n",
+                   Remaining, MaxStorage, MaxVariable);
+  }
+}
+
+/**
+  Reads a table file from the ACPI folder and stores it.
+
+  @param[in,out] Index       Store index, updated on success
+  @param[in]     Directory   ACPI folder
+  @param[in]     Name        File name, also the name in the index
+**/
+STATIC
+EFI_STATUS
+AcpiNvAdd (
+  IN OUT ACPI_NV_INDEX_BUFFER  *Index,
+  IN     EFI_FILE_PROTOCOL     *Directory,
+  IN     CONST CHAR8           *Name
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_FILE_PROTOCOL            *File;
+  EFI_ACPI_DESCRIPTION_HEADER  *Table;
+  ACPI_PATCHER_NV_ENTRY        *Entry;
+  CHAR16                       VariableName[ACPI_NV_VARIABLE_NAME_LENGTH];
+  UINTN                        Size;
+  UINTN                        Extra;
+  UINT8                        Probe;
+  UINT32                       Slot;
+
+  Status = FsOpenFile(Directory, gOptions.NvName, &File);
+  if (EFI_ERROR(Status)) {
+    SelectivePrint(L"Could not open %s: %r\n", gOptions.NvName, Status);
+    return EFI_NOT_FOUND;
+  }
+
+  // Tables larger than the store allows are rejected without sizing the file first
+  Status = AcpiAllocatePool(EfiBootServicesData, ACPI_PATCHER_NV_MAX_TABLE_SIZE, (VOID **)&Table);
+  if (EFI_ERROR(Status)) {
+    File->Close(File);
+    return Status;
+  }
+  Size  = ACPI_PATCHER_NV_MAX_TABLE_SIZE;
+  Extra = sizeof(Probe);
+  Status = File->Read(File, &Size, Table);
+  if (!EFI_ERROR(Status) && Size == ACPI_PATCHER_NV_MAX_TABLE_SIZE) {
+    Status = File->Read(File, &Extra, &Probe);
+    if (!EFI_ERROR(Status) && Extra != 0) {
+      Status = EFI_BAD_BUFFER_SIZE;
+    }
+  }
+  File->Close(File);
+
+  if (!EFI_ERROR(Status)) {
+    Status = ValidateAcpiTable(Table, Size);
+  }
+  Slot = AcpiNvFind(Index, Name);
+  if (!EFI_ERROR(Status) && Slot == MAX_UINT32 && Index->Header.TableCount == ACPI_PATCHER_NV_MAX_TABLES) {
+    Status = EFI_OUT_OF_RESOURCES;
+  }
+  if (!EFI_ERROR(Status)) {
+    Status = AcpiNvCheckStorage(Table->Length, (Slot == MAX_UINT32) ? 0 : Index->Entries[Slot].Length);
+  }
+  if (EFI_ERROR(Status)) {
+    SelectivePrint(L"Cannot store %s: %r\n", gOptions.NvName, Status);
+    AcpiFreePool(Table);
+    return Status;
+  }
+
+  if (Slot == MAX_UINT32) {
+    Slot = Index->Header.TableCount++;
+  }
+  AcpiNvTableName(VariableName, Slot);
+  Status = gRT->SetVariable(VariableName, &gAcpiPatcherNvTablesGuid, ACPI_PATCHER_NV_ATTRIBUTES, Table->Length, Table);
+  if (!EFI_ERROR(Status)) {
+    Entry = &Index->Entries[Slot];
+    ZeroMem(Entry, sizeof(*Entry));
+    Entry->Signature = Table->Signature;
+    Entry->Length    = Table->Length;
+    gBS->CalculateCrc32(Table, Table->Length, &Entry->Crc32);
+    AsciiStrCpyS(Entry->Name, ACPI_PATCHER_NV_NAME_SIZE, Name);
+    Status = AcpiNvWriteIndex(Index);
+  }
+
+  if (EFI_ERROR(Status)) {
+    SelectivePrint(L"Failed to store %s: %r\n", gOptions.NvName, Status);
+  } else {
+    SelectivePrint(L"Stored %s (%u bytes) as %s\n", gOptions.NvName, Table->Length, VariableName);
+  }
+  AcpiFreePool(Table);
+  return Status;
+}
+
+/**
+  Removes a table, moving the last stored table into its slot.
+
+  @param[in,out] Index   Store index, updated on success
+  @param[in]     Name    File name in the index
+**/
+STATIC
+EFI_STATUS
+AcpiNvRemove (
+  IN OUT ACPI_NV_INDEX_BUFFER  *Index,
+  IN     CONST CHAR8           *Name
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      VariableName[ACPI_NV_VARIABLE_NAME_LENGTH];
+  VOID        *Table;
+  UINT32      Slot;
+  UINT32      Last;
+
+  Slot = AcpiNvFind(Index, Name);
+  if (Slot == MAX_UINT32) {
+    SelectivePrint(L"%s is not in the NVRAM table store\n", gOptions.NvName);
+    return EFI_NOT_FOUND;
+  }
+
+  Last = Index->Header.TableCount - 1;
+  if (Slot != Last) {
+    Status = AcpiNvReadTable(Last, Index->Entries[Last].Length, Index->Entries[Last].Crc32, &Table);
+    if (!EFI_ERROR(Status)) {
+      AcpiNvTableName(VariableName, Slot);
+      Status = gRT->SetVariable(VariableName, &gAcpiPatcherNvTablesGuid, ACPI_PATCHER_NV_ATTRIBUTES,
+                                Index->Entries[Last].Length, Table);
+      AcpiFreePool(Table);
+    }
+    if (EFI_ERROR(Status)) {
+      SelectivePrint(L"Failed to move the last stored table: %r\n", Status);
+      return Status;
+    }
+    CopyMem(&Index->Entries[Slot], &Index->Entries[Last], sizeof(ACPI_PATCHER_NV_ENTRY));
+  }
+
+  Index->Header.TableCount = Last;
+  Status = AcpiNvWriteIndex(Index);
+  if (EFI_ERROR(Status)) {
+    SelectivePrint(L"Failed to update the NVRAM table index: %r\n", Status);
+    return Status;
+  }
+
+  AcpiNvTableName(VariableName, Last);
+  gRT->SetVariable(VariableName, &gAcpiPatcherNvTablesGuid, ACPI_PATCHER_NV_ATTRIBUTES, 0, NULL);
+  SelectivePrint(L"Removed %s\n", gOptions.NvName);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiNvRunCommand (
+  IN EFI_FILE_PROTOCOL  *Directory  OPTIONAL
+  )
+{
+  EFI_STATUS            Status;
+  ACPI_NV_INDEX_BUFFER  Index;
+  CHAR8                 Name[ACPI_PATCHER_NV_NAME_SIZE];
+
+  Status = AcpiNvReadIndex(&Index);
+  if (Status == EFI_NOT_FOUND) {
+    ZeroMem(&Index, sizeof(Index));
+    Index.Header.Signature = ACPI_PATCHER_NV_SIGNATURE;
+    Index.Header.Version   = ACPI_PATCHER_NV_VERSION;
+    Index.Header.EntrySize = sizeof(ACPI_PATCHER_NV_ENTRY);
+  } else if (EFI_ERROR(Status)) {
+    SelectivePrint(L"NVRAM table index is malformed; remove it with Tools/AcpiNvStore.py or dmpstore -d\n");
+    return Status;
+  }
+
+  if ((gOptions.NvCommand == AcpiNvCommandAdd || gOptions.NvCommand == AcpiNvCommandRemove) &&
+      EFI_ERROR(UnicodeStrToAsciiStrS(gOptions.NvName, Name, sizeof(Name)))) {
+    SelectivePrint(L"Stored table names are limited to %u characters\n", ACPI_PATCHER_NV_NAME_SIZE - 1);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  switch (gOptions.NvCommand) {
+  case AcpiNvCommandList:
+    AcpiNvList(&Index);
+    return EFI_SUCCESS;
+
+  case AcpiNvCommandAdd:
+    if (Directory == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    return AcpiNvAdd(&Index, Directory, Name);
+
+  case AcpiNvCommandRemove:
+    return AcpiNvRemove(&Index, Name);
+
+  case AcpiNvCommandFolderOn:
+  case AcpiNvCommandFolderOff:
+    if (gOptions.NvCommand == AcpiNvCommandFolderOn) {
+      Index.Header.Flags |= ACPI_PATCHER_NV_LOAD_FOLDER;
+    } else {
+      Index.Header.Flags &= ~(UINT32)ACPI_PATCHER_NV_LOAD_FOLDER;
+    }
+    Status = AcpiNvWriteIndex(&Index);
+    if (EFI_ERROR(Status)) {
+      SelectivePrint(L"Failed to update the NVRAM table index: %r\n", Status);
+    }
+    return Status;
+
+  default:
+    return EFI_INVALID_PARAMETER;
+  }
+}
@@ -0,0 +1,101 @@
+/** @file
+
+  Tables kept in UEFI variables (see Include/Guid/AcpiPatcherNvTables.h).
+
+  A couple of small SSDTs needed on every machine cost far less to read
+  with GetVariable than to find through the file system: locating the
+  image directory, opening ACPI\ and scanning it dwarf the table data. When
+  the store holds tables and its index does not ask for the ACPI folder,
+  the patcher loads them without touching a file system at all.
+
+**/
+
+#ifndef __ACPI_NV_STORE_H__
+#define __ACPI_NV_STORE_H__
+
+#include <Guid/AcpiPatcherNvTables.h>
+
+#include "ACPIPatcher.h"
+
+//
+// Store maintenance requested with --nv-*
+//
+typedef enum {
+  AcpiNvCommandNone,
+  AcpiNvCommandList,        ///< Print the index and the variable storage limits
+  AcpiNvCommandAdd,         ///< Store gOptions.NvName from the ACPI folder
+  AcpiNvCommandRemove,      ///< Delete gOptions.NvName from the store
+  AcpiNvCommandFolderOn,    ///< Load the ACPI folder as well as the store
+  AcpiNvCommandFolderOff    ///< Load the store only
+} ACPI_NV_COMMAND;
+
+typedef struct {
+  ACPI_PATCHER_NV_INDEX  Header;
+  ACPI_PATCHER_NV_ENTRY  Entries[ACPI_PATCHER_NV_MAX_TABLES];
+} ACPI_NV_INDEX_BUFFER;
+
+/**
+  Reads and checks the store index.
+
+  @param[out] Index   Index; Header.TableCount entries are valid
+
+  @retval EFI_SUCCESS     Index read
+  @retval EFI_NOT_FOUND   No store
+  @retval EFI_UNSUPPORTED Index is malformed or of another version
+**/
+EFI_STATUS
+AcpiNvReadIndex (
+  OUT ACPI_NV_INDEX_BUFFER  *Index
+  );
+
+/**
+  Reads one stored table into a pool buffer and checks its length and CRC32
+  against the index.
+
+  @param[in]  Slot      Table number in the index
+  @param[in]  Size      Table length from the index
+  @param[in]  Crc32     Table CRC32 from the index
+  @param[out] Buffer    Table data; freed by the caller
+
+  @retval EFI_SUCCESS     Table read
+  @retval EFI_CRC_ERROR   Variable does not match the index
+  @retval Other           Variable missing or allocation failed
+**/
+EFI_STATUS
+AcpiNvReadTable (
+  IN  UINT32  Slot,
+  IN  UINTN   Size,
+  IN  UINT32  Crc32,
+  OUT VOID    **Buffer
+  );
+
+/**
+  Returns TRUE if the store holds tables and does not ask for the ACPI
+  folder, so the run needs no file system.
+**/
+BOOLEAN
+AcpiNvSkipsFolder (
+  VOID
+  );
+
+/**
+  Runs the store command in gOptions.NvCommand.
+
+  Tables are limited to ACPI_PATCHER_NV_MAX_TABLE_SIZE and to the largest
+  variable the firmware accepts, and a table is only added while
+  1/ACPI_PATCHER_NV_RESERVE_DIVISOR of the variable storage stays free.
+
+  @param[in] Directory   ACPI folder holding the table to add, NULL otherwise
+
+  @retval EFI_SUCCESS             Command done
+  @retval EFI_NOT_FOUND           No such table or file
+  @retval EFI_OUT_OF_RESOURCES    Store full or variable storage limit reached
+  @retval EFI_BAD_BUFFER_SIZE     Table too large for a variable
+  @retval Other                   Variable or file access failed
+**/
+EFI_STATUS
+AcpiNvRunCommand (
+  IN EFI_FILE_PROTOCOL  *Directory  OPTIONAL
+  );
+
+#endif // __ACPI_NV_STORE_H__
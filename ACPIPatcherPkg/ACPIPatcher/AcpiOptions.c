@@ -0,0 +1,325 @@
+/** @file
+
+  Command-line options for the ACPIPatcher application.
+
+  Arguments come from EFI_SHELL_PARAMETERS_PROTOCOL when started from a UEFI
+  shell, otherwise from the raw LoadOptions string of a boot entry or an
+  EFI 1.x shell, which may or may not start with the image name.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Protocol/LoadedImage.h>
+#include <Protocol/ShellParameters.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiMemory.h"
+#include "AcpiSource.h"
+#include "AcpiIoSim.h"
+#include "AcpiNvStore.h"
+
+#define MAX_LOAD_OPTION_ARGS  16
+
+//
+// --verify values, indexed by ACPI_VERIFY_*
+//
+STATIC CONST CHAR16  *mVerifyNames[] = {
+  L"off",
+  L"open",
+  L"closed"
+};
+
+/**
+  Prints the option summary.
+**/
+STATIC
+VOID
+AcpiPrintUsage (
+  VOID
+  )
+{
+  SelectivePrint(L"Usage: ACPIPatcher.efi [options]\n");
+  SelectivePrint(L"  -n, --dry-run      Plan against scratch copies of the XSDT and FADT, do not commit\n");
+  SelectivePrint(L"  -r, --repeat N     Dry-run N times (1-%u) and print per-phase timings\n", MAX_REPEAT_COUNT);
+  SelectivePrint(L"  -a, --reload-all   Reread every table, not only those changed since the last run\n");
+  SelectivePrint(L"  -c, --consolidate  Merge small compatible SSDTs into one table\n");
+  SelectivePrint(L"  -f, --fat          Read tables straight from the FAT volume, bypassing the file system driver\n");
+  SelectivePrint(L"  -s, --strategy S   Read table files whole, header first, chunked or auto (the default); all compares them under --repeat\n");
+  SelectivePrint(L"  -l, --latency P    Replay the latency profile O,R,B,M,D over the ACPI folder\n");
+  SelectivePrint(L"  -i, --record-io    Record the latency profile of the file system driver instead of patching\n");
+  SelectivePrint(L"  -d, --deadline MS  Defer tables in ACPI\\Optional that would finish reading after MS ms\n");
+  SelectivePrint(L"  -m, --verify P     Check tables against Manifest.sha256: off, open (warn) or closed (skip)\n");
+  SelectivePrint(L"  -x, --export DIR   Export the live firmware tables into DIR instead of patching\n");
+  SelectivePrint(L"  -b, --bundle       With --export, write one bundle file instead of one file per table\n");
+  SelectivePrint(L"      --nv-list      List the tables stored in NVRAM and the variable storage left\n");
+  SelectivePrint(L"      --nv-add F     Store table F from the ACPI folder in NVRAM (up to %u bytes)\n", ACPI_PATCHER_NV_MAX_TABLE_SIZE);
+  SelectivePrint(L"      --nv-remove F  Remove table F from NVRAM\n");
+  SelectivePrint(L"      --nv-folder S  Also load the ACPI folder (on) or only the NVRAM tables (off)\n");
+  SelectivePrint(L"  -q, --quiet        Print errors only\n");
+  SelectivePrint(L"  -v, --verbose      Print debug output\n");
+  SelectivePrint(L"  -h, --help         Show this help\n");
+}
+
+/**
+  Returns TRUE if an argument looks like the image path rather than an option.
+
+  @param[in] Arg    Argument to test
+**/
+STATIC
+BOOLEAN
+AcpiIsImageName (
+  IN CONST CHAR16  *Arg
+  )
+{
+  UINTN  Length;
+
+  Length = StrLen(Arg);
+  if (Length < 4) {
+    return FALSE;
+  }
+
+  return (BOOLEAN)(Arg[Length - 4] == L'.' &&
+                   CharToUpper(Arg[Length - 3]) == L'E' &&
+                   CharToUpper(Arg[Length - 2]) == L'F' &&
+                   CharToUpper(Arg[Length - 1]) == L'I');
+}
+
+/**
+  Applies parsed arguments to gOptions.
+
+  @param[in] Argc   Number of arguments, excluding the image name
+  @param[in] Argv   Arguments
+
+  @retval EFI_SUCCESS             Options applied
+  @retval EFI_ABORTED             Help was requested
+  @retval EFI_INVALID_PARAMETER   Unknown option or bad value
+**/
+STATIC
+EFI_STATUS
+AcpiApplyArguments (
+  IN UINTN   Argc,
+  IN CHAR16  **Argv
+  )
+{
+  UINTN   Index;
+  UINTN   Value;
+  UINT32  Strategy;
+  UINT32  Policy;
+  CHAR16  *Arg;
+
+  for (Index = 0; Index < Argc; Index++) {
+    Arg = Argv[Index];
+
+    if (StrCmp(Arg, L"-n") == 0 || StrCmp(Arg, L"--dry-run") == 0) {
+      gOptions.DryRun = TRUE;
+    } else if (StrCmp(Arg, L"-r") == 0 || StrCmp(Arg, L"--repeat") == 0) {
+      Value = (Index + 1 < Argc) ? StrDecimalToUintn(Argv[++Index]) : 0;
+      if (Value == 0 || Value > MAX_REPEAT_COUNT) {
+        SelectivePrint(L"%s expects a count between 1 and %u\n", Arg, MAX_REPEAT_COUNT);
+        return EFI_INVALID_PARAMETER;
+      }
+      gOptions.Repeat = (UINT32)Value;
+      gOptions.DryRun = TRUE;
+    } else if (StrCmp(Arg, L"-a") == 0 || StrCmp(Arg, L"--reload-all") == 0) {
+      gOptions.ReloadAll = TRUE;
+    } else if (StrCmp(Arg, L"-c") == 0 || StrCmp(Arg, L"--consolidate") == 0) {
+      gOptions.Consolidate = TRUE;
+    } else if (StrCmp(Arg, L"-f") == 0 || StrCmp(Arg, L"--fat") == 0) {
+      gOptions.DirectFat = TRUE;
+    } else if (StrCmp(Arg, L"-s") == 0 || StrCmp(Arg, L"--strategy") == 0) {
+      Strategy = 0;
+      if (Index + 1 < Argc) {
+        while (Strategy < AcpiReadStrategyMax && StrCmp(Argv[Index + 1], gAcpiReadStrategyNames[Strategy]) != 0) {
+          Strategy++;
+        }
+      }
+      if (Index + 1 >= Argc || (Strategy == AcpiReadStrategyMax && StrCmp(Argv[Index + 1], L"all") != 0)) {
+        SelectivePrint(L"%s expects whole, header, chunked, auto or all\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      gOptions.ReadStrategy = Strategy;
+      Index++;
+    } else if (StrCmp(Arg, L"-l") == 0 || StrCmp(Arg, L"--latency") == 0) {
+      if (Index + 1 >= Argc || EFI_ERROR(AcpiIoSimParse(Argv[Index + 1], &gAcpiIoProfile))) {
+        SelectivePrint(L"%s expects OpenUs,ReadCallUs,NsPerKb,MaxTransfer,DirEntryUs\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      Index++;
+    } else if (StrCmp(Arg, L"-i") == 0 || StrCmp(Arg, L"--record-io") == 0) {
+      gOptions.RecordIo = TRUE;
+    } else if (StrCmp(Arg, L"-d") == 0 || StrCmp(Arg, L"--deadline") == 0) {
+      Value = (Index + 1 < Argc) ? StrDecimalToUintn(Argv[++Index]) : 0;
+      if (Value == 0 || Value > MAX_DEADLINE_MS) {
+        SelectivePrint(L"%s expects milliseconds between 1 and %u\n", Arg, MAX_DEADLINE_MS);
+        return EFI_INVALID_PARAMETER;
+      }
+      gOptions.DeadlineMs = (UINT32)Value;
+    } else if (StrCmp(Arg, L"-m") == 0 || StrCmp(Arg, L"--verify") == 0) {
+      Policy = 0;
+      if (Index + 1 < Argc) {
+        while (Policy < ARRAY_SIZE(mVerifyNames) && StrCmp(Argv[Index + 1], mVerifyNames[Policy]) != 0) {
+          Policy++;
+        }
+      }
+      if (Index + 1 >= Argc || Policy == ARRAY_SIZE(mVerifyNames)) {
+        SelectivePrint(L"%s expects off, open or closed\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      gOptions.Verify = Policy;
+      Index++;
+    } else if (StrCmp(Arg, L"-x") == 0 || StrCmp(Arg, L"--export") == 0) {
+      if (Index + 1 >= Argc || EFI_ERROR(StrCpyS(gOptions.ExportDir, ACPI_FILE_NAME_LENGTH, Argv[Index + 1]))) {
+        SelectivePrint(L"%s expects a directory name\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      Index++;
+    } else if (StrCmp(Arg, L"-b") == 0 || StrCmp(Arg, L"--bundle") == 0) {
+      gOptions.ExportBundle = TRUE;
+    } else if (StrCmp(Arg, L"--nv-list") == 0) {
+      gOptions.NvCommand = AcpiNvCommandList;
+    } else if (StrCmp(Arg, L"--nv-add") == 0 || StrCmp(Arg, L"--nv-remove") == 0) {
+      if (Index + 1 >= Argc || EFI_ERROR(StrCpyS(gOptions.NvName, ACPI_FILE_NAME_LENGTH, Argv[Index + 1]))) {
+        SelectivePrint(L"%s expects a table file name\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      gOptions.NvCommand = (StrCmp(Arg, L"--nv-add") == 0) ? AcpiNvCommandAdd : AcpiNvCommandRemove;
+      Index++;
+    } else if (StrCmp(Arg, L"--nv-folder") == 0) {
+      if (Index + 1 < Argc && StrCmp(Argv[Index + 1], L"on") == 0) {
+        gOptions.NvCommand = AcpiNvCommandFolderOn;
+      } else if (Index + 1 < Argc && StrCmp(Argv[Index + 1], L"off") == 0) {
+        gOptions.NvCommand = AcpiNvCommandFolderOff;
+      } else {
+        SelectivePrint(L"%s expects on or off\n", Arg);
+        return EFI_INVALID_PARAMETER;
+      }
+      Index++;
+    } else if (StrCmp(Arg, L"-q") == 0 || StrCmp(Arg, L"--quiet") == 0) {
+      gOptions.DebugLevel = DEBUG_ERROR;
+    } else if (StrCmp(Arg, L"-v") == 0 || StrCmp(Arg, L"--verbose") == 0) {
+      gOptions.DebugLevel = DEBUG_VERBOSE;
+    } else if (StrCmp(Arg, L"-h") == 0 || StrCmp(Arg, L"--help") == 0 || StrCmp(Arg, L"-?") == 0) {
+      AcpiPrintUsage();
+      return EFI_ABORTED;
+    } else {
+      SelectivePrint(L"Unknown option: %s\n", Arg);
+      AcpiPrintUsage();
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (gOptions.ExportBundle && gOptions.ExportDir[0] == L'\0') {
+    SelectivePrint(L"--bundle requires --export\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (gOptions.NvCommand != AcpiNvCommandNone &&
+      (gOptions.Repeat > 0 || gOptions.RecordIo || gOptions.ExportDir[0] != L'\0')) {
+    SelectivePrint(L"--nv-* cannot be combined with --repeat, --record-io or --export\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (gOptions.ReadStrategy == AcpiReadStrategyMax && gOptions.Repeat == 0) {
+    SelectivePrint(L"--strategy all requires --repeat\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Splits the LoadOptions string of the image into arguments and applies them.
+
+  @param[in] LoadedImage    Loaded image protocol of this application
+
+  @retval EFI_SUCCESS       No options, or options applied
+  @retval Other             See AcpiApplyArguments
+**/
+STATIC
+EFI_STATUS
+AcpiParseLoadOptions (
+  IN EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      *Buffer;
+  CHAR16      *Cursor;
+  CHAR16      *Argv[MAX_LOAD_OPTION_ARGS];
+  UINTN       Argc;
+  UINTN       Length;
+
+  // Boot entries may carry binary optional data; only accept a UCS-2 string
+  if (LoadedImage->LoadOptions == NULL ||
+      LoadedImage->LoadOptionsSize < sizeof(CHAR16) ||
+      (LoadedImage->LoadOptionsSize % sizeof(CHAR16)) != 0) {
+    return EFI_SUCCESS;
+  }
+
+  Length = LoadedImage->LoadOptionsSize / sizeof(CHAR16);
+  Status = AcpiAllocatePool(EfiBootServicesData, (Length + 1) * sizeof(CHAR16), (VOID**)&Buffer);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  CopyMem(Buffer, LoadedImage->LoadOptions, Length * sizeof(CHAR16));
+  Buffer[Length] = L'\0';
+
+  Argc   = 0;
+  Cursor = Buffer;
+  while (*Cursor != L'\0' && Argc < MAX_LOAD_OPTION_ARGS) {
+    while (*Cursor == L' ' || *Cursor == L'\t') {
+      *Cursor++ = L'\0';
+    }
+    if (*Cursor == L'\0') {
+      break;
+    }
+    Argv[Argc++] = Cursor;
+    while (*Cursor != L'\0' && *Cursor != L' ' && *Cursor != L'\t') {
+      Cursor++;
+    }
+  }
+
+  // EFI 1.x shells pass the command line including the image name
+  if (Argc > 0 && AcpiIsImageName(Argv[0])) {
+    Status = AcpiApplyArguments(Argc - 1, &Argv[1]);
+  } else {
+    Status = AcpiApplyArguments(Argc, Argv);
+  }
+
+  AcpiFreePool(Buffer);
+  return Status;
+}
+
+/**
+  Parses the command line into gOptions.
+
+  @param[in] ImageHandle    Handle of this application
+
+  @retval EFI_SUCCESS             Options parsed, or none given
+  @retval EFI_ABORTED             Usage was printed, nothing else to do
+  @retval EFI_INVALID_PARAMETER   Unknown option or bad value
+**/
+EFI_STATUS
+AcpiParseOptions (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  EFI_LOADED_IMAGE_PROTOCOL      *LoadedImage;
+
+  Status = gBS->HandleProtocol(ImageHandle, &gEfiShellParametersProtocolGuid, (VOID**)&ShellParameters);
+  if (!EFI_ERROR(Status) && ShellParameters->Argc > 0) {
+    return AcpiApplyArguments(ShellParameters->Argc - 1, &ShellParameters->Argv[1]);
+  }
+
+  Status = gBS->HandleProtocol(ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID**)&LoadedImage);
+  if (EFI_ERROR(Status)) {
+    return EFI_SUCCESS;
+  }
+
+  return AcpiParseLoadOptions(LoadedImage);
+}
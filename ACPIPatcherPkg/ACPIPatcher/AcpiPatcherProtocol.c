@@ -0,0 +1,180 @@
+/** @file
+
+  ACPI_PATCHER_PROTOCOL implementation for the DXE build.
+
+  Tables submitted by other drivers are queued in a plan without copying and
+  installed by Commit() with the same single XSDT rebuild used for tables
+  loaded from the ACPI folder.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Protocol/AcpiPatcher.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiInstall.h"
+#include "AcpiLog.h"
+
+STATIC ACPI_TABLE_PLAN  mPendingPlan;
+STATIC UINTN            mPendingSizes[MAX_ADDITIONAL_TABLES];  ///< Buffer size of each mPendingPlan.Tables entry
+STATIC UINTN            mPendingDsdtSize;
+
+/**
+  Queues tables for installation without copying them.
+
+  @param[in] This         Protocol instance
+  @param[in] TableCount   Number of entries in Tables and TableSizes
+  @param[in] Tables       Tables to queue
+  @param[in] TableSizes   Size in bytes of each buffer in Tables
+
+  @retval EFI_SUCCESS             All tables queued
+  @retval EFI_INVALID_PARAMETER   Invalid input parameters, or a buffer smaller than a table header
+  @retval EFI_OUT_OF_RESOURCES    Batch does not fit into the remaining XSDT slots
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiPatcherSubmitTables (
+  IN ACPI_PATCHER_PROTOCOL        *This,
+  IN UINTN                        TableCount,
+  IN EFI_ACPI_DESCRIPTION_HEADER  **Tables,
+  IN CONST UINTN                  *TableSizes
+  )
+{
+  UINTN    Index;
+  UINTN    Appended;
+  BOOLEAN  IsDsdt;
+
+  if (This == NULL || Tables == NULL || TableSizes == NULL || TableCount == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Check the whole batch first so a failure leaves ownership with the caller
+  Appended = 0;
+  for (Index = 0; Index < TableCount; Index++) {
+    if (Tables[Index] == NULL || TableSizes[Index] < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if (Tables[Index]->Signature != EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+      Appended++;
+    }
+  }
+
+  if (mPendingPlan.TableCount + Appended > mPendingPlan.MaxTables) {
+    AcpiDebugPrint(DEBUG_WARN, L"SubmitTables: %u tables exceed %u free slots\n",
+                   Appended, mPendingPlan.MaxTables - mPendingPlan.TableCount);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < TableCount; Index++) {
+    IsDsdt = (BOOLEAN)(Tables[Index]->Signature == EFI_ACPI_6_4_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE);
+    if (IsDsdt) {
+      mPendingDsdtSize = TableSizes[Index];
+    } else {
+      mPendingSizes[mPendingPlan.TableCount] = TableSizes[Index];
+    }
+    AcpiPlanAddTable(&mPendingPlan, (EFI_ACPI_SDT_HEADER *)Tables[Index], IsDsdt);
+  }
+
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_PROTOCOL_SUBMIT, TableCount,
+            mPendingPlan.TableCount + (mPendingPlan.Dsdt != NULL ? 1 : 0));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Validates every queued table and installs them with one XSDT rebuild.
+
+  @param[in] This         Protocol instance
+
+  @retval EFI_SUCCESS             All queued tables installed, or queue empty
+  @retval EFI_INVALID_PARAMETER   This is NULL, or a queued table failed validation; the queue is discarded
+  @retval EFI_NOT_READY           ACPI root tables could not be located; the queue is kept
+  @retval EFI_OUT_OF_RESOURCES    New XSDT could not be allocated; the queue is kept
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+AcpiPatcherCommit (
+  IN ACPI_PATCHER_PROTOCOL  *This
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Index;
+  UINT32      Count;
+
+  if (This == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Count = mPendingPlan.TableCount + (mPendingPlan.Dsdt != NULL ? 1 : 0);
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < mPendingPlan.TableCount && !EFI_ERROR(Status); Index++) {
+    Status = ValidateAcpiTable(mPendingPlan.Tables[Index], mPendingSizes[Index]);
+  }
+  if (!EFI_ERROR(Status) && mPendingPlan.Dsdt != NULL) {
+    Status = ValidateAcpiTable(mPendingPlan.Dsdt, mPendingDsdtSize);
+  }
+
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Commit: submitted table failed validation, discarding batch\n");
+    AcpiPlanRelease(&mPendingPlan);
+    ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_PROTOCOL_COMMIT, Count, EFI_INVALID_PARAMETER);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Firmware may have republished its tables since the driver started. A
+  // malformed RSDP or XSDT is reported as not ready too, so that
+  // EFI_INVALID_PARAMETER always means a submitted table was at fault
+  Status = AcpiLocateRootTables();
+  if (EFI_ERROR(Status)) {
+    Status = EFI_NOT_READY;
+  } else {
+    Status = AcpiPlanCommit(&mPendingPlan);
+  }
+
+  ACPI_LOG2(EFI_ERROR(Status) ? DEBUG_ERROR : DEBUG_INFO, ACPI_LOG_MSG_PROTOCOL_COMMIT, Count, Status);
+  return Status;
+}
+
+STATIC ACPI_PATCHER_PROTOCOL  mAcpiPatcherProtocol = {
+  ACPI_PATCHER_PROTOCOL_REVISION,
+  AcpiPatcherSubmitTables,
+  AcpiPatcherCommit
+};
+
+/**
+  Installs ACPI_PATCHER_PROTOCOL on the driver image handle.
+
+  @param[in] ImageHandle    Handle of this driver
+
+  @retval EFI_SUCCESS       Protocol installed
+  @retval Other             Protocol could not be installed
+**/
+EFI_STATUS
+AcpiPatcherInstallProtocol (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS  Status;
+
+  AcpiPlanInit(&mPendingPlan);
+
+  Status = gBS->InstallMultipleProtocolInterfaces(
+                  &ImageHandle,
+                  &gAcpiPatcherProtocolGuid,
+                  &mAcpiPatcherProtocol,
+                  NULL
+                  );
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to install ACPI Patcher protocol: %r\n", Status);
+  }
+
+  return Status;
+}
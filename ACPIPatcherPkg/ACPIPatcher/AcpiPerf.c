@@ -0,0 +1,209 @@
+/** @file
+
+  Per-run timing and throughput accounting.
+
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+
+#include "AcpiPerf.h"
+
+ACPI_PATCHER_PERF  gAcpiPerf;
+
+CONST CHAR16  *gAcpiPhaseNames[AcpiPhaseMax] = {
+  L"Enumerate",
+  L"Read",
+  L"Validate",
+  L"Merge",
+  L"Plan"
+};
+
+CONST CHAR16  *gAcpiSizeClassNames[ACPI_SIZE_CLASS_COUNT] = {
+  L"< 4 KB",
+  L"4-16 KB",
+  L"16-64 KB",
+  L">= 64 KB"
+};
+
+STATIC BOOLEAN  mCounterCountsDown = FALSE;
+STATIC BOOLEAN  mCounterProbed     = FALSE;
+STATIC UINT64   mCounterFirst      = 0;
+STATIC UINT64   mCounterHz         = 0;
+STATIC UINT64   mClockStart        = 0;
+
+/**
+  Returns the size class of a file.
+**/
+STATIC
+UINTN
+AcpiPerfSizeClass (
+  IN UINT64  Size
+  )
+{
+  if (Size < SIZE_4KB) {
+    return 0;
+  } else if (Size < SIZE_16KB) {
+    return 1;
+  } else if (Size < SIZE_64KB) {
+    return 2;
+  }
+  return 3;
+}
+
+VOID
+AcpiPerfReset (
+  VOID
+  )
+{
+  ZeroMem(&gAcpiPerf, sizeof(gAcpiPerf));
+}
+
+VOID
+AcpiPerfStartClock (
+  VOID
+  )
+{
+  mClockStart = AcpiPerfNow();
+}
+
+UINT64
+AcpiPerfClockNs (
+  VOID
+  )
+{
+  return AcpiPerfElapsedNs(mClockStart);
+}
+
+UINT64
+AcpiPerfPredictReadNs (
+  IN UINT64  Size
+  )
+{
+  UINTN   Class;
+  UINT64  PerFile;
+  UINT64  BySize;
+
+  Class = AcpiPerfSizeClass(Size);
+  if (gAcpiPerf.ClassFiles[Class] == 0) {
+    // No file of this size read yet; fall back to the run average
+    if (gAcpiPerf.FilesRead == 0) {
+      return 0;
+    }
+    return DivU64x32(gAcpiPerf.PhaseNs[AcpiPhaseRead], gAcpiPerf.FilesRead);
+  }
+
+  PerFile = DivU64x32(gAcpiPerf.ClassNs[Class], gAcpiPerf.ClassFiles[Class]);
+  BySize  = 0;
+  if (gAcpiPerf.ClassBytes[Class] != 0) {
+    BySize = DivU64x64Remainder(MultU64x64(gAcpiPerf.ClassNs[Class], Size), gAcpiPerf.ClassBytes[Class], NULL);
+  }
+  return MAX(PerFile, BySize);
+}
+
+UINT64
+AcpiPerfClockStartTicks (
+  VOID
+  )
+{
+  return mClockStart;
+}
+
+UINT64
+AcpiPerfTicksAfter (
+  IN UINT64  StartTicks,
+  IN UINT64  Ns
+  )
+{
+  UINT64  Ticks;
+
+  AcpiPerfNow();
+  // Microseconds keep the product in range for counters of a few GHz
+  Ticks = DivU64x32(MultU64x64(DivU64x32(Ns, 1000), mCounterHz), 1000000);
+  return mCounterCountsDown ? StartTicks - Ticks : StartTicks + Ticks;
+}
+
+UINT64
+AcpiPerfTimestampNs (
+  IN UINT64  Ticks
+  )
+{
+  AcpiPerfNow();
+  return GetTimeInNanoSecond(mCounterCountsDown ? mCounterFirst - Ticks : Ticks - mCounterFirst);
+}
+
+UINT64
+AcpiPerfNow (
+  VOID
+  )
+{
+  UINT64  CounterEnd;
+
+  if (!mCounterProbed) {
+    mCounterHz         = GetPerformanceCounterProperties(&mCounterFirst, &CounterEnd);
+    mCounterCountsDown = (BOOLEAN)(mCounterFirst > CounterEnd);
+    mCounterProbed     = TRUE;
+  }
+
+  return GetPerformanceCounter();
+}
+
+UINT64
+AcpiPerfElapsedNs (
+  IN UINT64  StartTicks
+  )
+{
+  UINT64  Now;
+
+  Now = AcpiPerfNow();
+  return GetTimeInNanoSecond(mCounterCountsDown ? StartTicks - Now : Now - StartTicks);
+}
+
+UINT64
+AcpiPerfAddPhase (
+  IN ACPI_PATCHER_PHASE  Phase,
+  IN UINT64              StartTicks
+  )
+{
+  UINT64  Ns;
+
+  Ns = AcpiPerfElapsedNs(StartTicks);
+  gAcpiPerf.PhaseNs[Phase] += Ns;
+  gAcpiPerf.TotalNs        += Ns;
+
+  return Ns;
+}
+
+VOID
+AcpiPerfRecordRead (
+  IN UINT64  Size,
+  IN UINT64  Ns
+  )
+{
+  UINTN  Class;
+
+  Class = AcpiPerfSizeClass(Size);
+  gAcpiPerf.BytesRead += Size;
+  gAcpiPerf.FilesRead++;
+  gAcpiPerf.ClassBytes[Class] += Size;
+  gAcpiPerf.ClassNs[Class]    += Ns;
+  gAcpiPerf.ClassFiles[Class]++;
+}
+
+UINT64
+AcpiPerfKbPerSecond (
+  IN UINT64  Bytes,
+  IN UINT64  Ns
+  )
+{
+  UINT64  Us;
+
+  Us = DivU64x32(Ns, 1000);
+  if (Us == 0) {
+    Us = 1;
+  }
+
+  // bytes/us * 1000000 / 1024 = KB/s
+  return DivU64x64Remainder(MultU64x32(Bytes, 1000000 / 64), MultU64x32(Us, 1024 / 64), NULL);
+}
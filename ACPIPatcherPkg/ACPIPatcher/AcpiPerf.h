@@ -0,0 +1,161 @@
+/** @file
+
+  Per-run timing and throughput accounting.
+
+**/
+
+#ifndef __ACPI_PERF_H__
+#define __ACPI_PERF_H__
+
+//
+// Phases of a patch run, in execution order
+//
+typedef enum {
+  AcpiPhaseEnumerate,
+  AcpiPhaseRead,
+  AcpiPhaseValidate,
+  AcpiPhaseMerge,
+  AcpiPhasePlan,
+  AcpiPhaseMax
+} ACPI_PATCHER_PHASE;
+
+//
+// File size classes used for read throughput: <4 KB, <16 KB, <64 KB, larger
+//
+#define ACPI_SIZE_CLASS_COUNT   4
+
+typedef struct {
+  UINT64  PhaseNs[AcpiPhaseMax];
+  UINT64  TotalNs;
+  UINT64  BytesRead;
+  UINT32  FilesRead;
+  UINT32  TablesInstalled;
+  UINT64  ClassBytes[ACPI_SIZE_CLASS_COUNT];
+  UINT64  ClassNs[ACPI_SIZE_CLASS_COUNT];
+  UINT32  ClassFiles[ACPI_SIZE_CLASS_COUNT];
+  UINT64  TransferBytes;
+  UINT64  TransferNs;
+  UINT32  Transfers;
+} ACPI_PATCHER_PERF;
+
+extern ACPI_PATCHER_PERF  gAcpiPerf;
+extern CONST CHAR16       *gAcpiPhaseNames[AcpiPhaseMax];
+extern CONST CHAR16       *gAcpiSizeClassNames[ACPI_SIZE_CLASS_COUNT];
+
+/** Clears the counters of the current run. */
+VOID
+AcpiPerfReset (
+  VOID
+  );
+
+/** Starts the clock --deadline is measured against. */
+VOID
+AcpiPerfStartClock (
+  VOID
+  );
+
+/** Returns the nanoseconds since AcpiPerfStartClock(). */
+UINT64
+AcpiPerfClockNs (
+  VOID
+  );
+
+/**
+  Predicts how long reading a file will take from the reads of this run:
+  the average time per file of its size class, or the class throughput
+  for a file larger than the class average.
+
+  @param[in] Size   File size in bytes
+
+  @return Predicted nanoseconds, 0 before the first read
+**/
+UINT64
+AcpiPerfPredictReadNs (
+  IN UINT64  Size
+  );
+
+/** Returns the counter value recorded by AcpiPerfStartClock(). */
+UINT64
+AcpiPerfClockStartTicks (
+  VOID
+  );
+
+/**
+  Returns the counter value Ns nanoseconds after StartTicks, at microsecond
+  resolution.
+
+  @param[in] StartTicks   Counter value to start from
+  @param[in] Ns           Nanoseconds to add
+**/
+UINT64
+AcpiPerfTicksAfter (
+  IN UINT64  StartTicks,
+  IN UINT64  Ns
+  );
+
+/**
+  Converts a counter value to nanoseconds since the counter started, the
+  time base of FPDT records.
+
+  @param[in] Ticks        Counter value
+**/
+UINT64
+AcpiPerfTimestampNs (
+  IN UINT64  Ticks
+  );
+
+/** Returns the raw performance counter value. */
+UINT64
+AcpiPerfNow (
+  VOID
+  );
+
+/**
+  Returns the nanoseconds elapsed since a value returned by AcpiPerfNow().
+
+  @param[in] StartTicks   Counter value at the start of the interval
+**/
+UINT64
+AcpiPerfElapsedNs (
+  IN UINT64  StartTicks
+  );
+
+/**
+  Adds the time since StartTicks to a phase.
+
+  @param[in] Phase        Phase to charge
+  @param[in] StartTicks   Counter value at the start of the interval
+
+  @return Nanoseconds charged to the phase
+**/
+UINT64
+AcpiPerfAddPhase (
+  IN ACPI_PATCHER_PHASE  Phase,
+  IN UINT64              StartTicks
+  );
+
+/**
+  Records one completed file read for throughput reporting.
+
+  @param[in] Size         Bytes read
+  @param[in] Ns           Time spent opening and reading the file
+**/
+VOID
+AcpiPerfRecordRead (
+  IN UINT64  Size,
+  IN UINT64  Ns
+  );
+
+/**
+  Converts a byte count and duration into KB/s.
+
+  @param[in] Bytes        Bytes transferred
+  @param[in] Ns           Duration in nanoseconds
+**/
+UINT64
+AcpiPerfKbPerSecond (
+  IN UINT64  Bytes,
+  IN UINT64  Ns
+  );
+
+#endif // __ACPI_PERF_H__
@@ -0,0 +1,115 @@
+/** @file
+
+  Platform identity used to select a per-platform table profile.
+
+  One ESP image can carry tables for several machine models. The identity
+  is reduced to a short list of hash keys, and each key names exactly one
+  profile subdirectory or bundle section, so selecting a profile costs one
+  lookup instead of a scan of every profile on the volume.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include <IndustryStandard/SmBios.h>
+#include <Guid/SmBios.h>
+
+#include "AcpiProfile.h"
+
+/**
+  Reads the SMBIOS type 1 product name.
+
+  @param[out] Product   Buffer of ACPI_PROFILE_PRODUCT_SIZE bytes; empty if not found
+**/
+STATIC
+VOID
+AcpiProfileReadProduct (
+  OUT CHAR8  *Product
+  )
+{
+  SMBIOS_TABLE_3_0_ENTRY_POINT  *Smbios3;
+  SMBIOS_TABLE_ENTRY_POINT      *Smbios;
+  SMBIOS_STRUCTURE              *Header;
+  UINT8                         *Cursor;
+  UINT8                         *End;
+  UINT8                         Wanted;
+  UINTN                         Index;
+  UINTN                         Length;
+
+  Product[0] = '\0';
+
+  if (!EFI_ERROR(EfiGetSystemConfigurationTable(&gEfiSmbios3TableGuid, (VOID **)&Smbios3)) && Smbios3 != NULL) {
+    Cursor = (UINT8 *)(UINTN)Smbios3->TableAddress;
+    End    = Cursor + Smbios3->TableMaximumSize;
+  } else if (!EFI_ERROR(EfiGetSystemConfigurationTable(&gEfiSmbiosTableGuid, (VOID **)&Smbios)) && Smbios != NULL) {
+    Cursor = (UINT8 *)(UINTN)Smbios->TableAddress;
+    End    = Cursor + Smbios->TableLength;
+  } else {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"No SMBIOS table, profile keys use OEM fields only\n");
+    return;
+  }
+
+  while (Cursor != NULL && Cursor + sizeof(SMBIOS_STRUCTURE) <= End) {
+    Header = (SMBIOS_STRUCTURE *)Cursor;
+    if (Header->Type == SMBIOS_TYPE_END_OF_TABLE || Header->Length < sizeof(SMBIOS_STRUCTURE)) {
+      break;
+    }
+
+    Wanted = 0;
+    if (Header->Type == SMBIOS_TYPE_SYSTEM_INFORMATION &&
+        Header->Length > OFFSET_OF(SMBIOS_TABLE_TYPE1, ProductName)) {
+      Wanted = ((SMBIOS_TABLE_TYPE1 *)Header)->ProductName;
+    }
+
+    // The string set follows the formatted area and ends with a double NUL
+    Cursor += Header->Length;
+    for (Index = 1; Cursor < End && *Cursor != 0; Index++) {
+      Length = AsciiStrnLenS((CHAR8 *)Cursor, End - Cursor);
+      if (Index == Wanted) {
+        AcpiRulesCopyField(Product, (CHAR8 *)Cursor, MIN(Length, ACPI_PROFILE_PRODUCT_SIZE - 1));
+        return;
+      }
+      Cursor += Length + 1;
+    }
+    if (Header->Type == SMBIOS_TYPE_SYSTEM_INFORMATION) {
+      return;
+    }
+    Cursor += (Index == 1) ? 2 : 1;
+  }
+}
+
+VOID
+AcpiProfileIdentify (
+  OUT ACPI_PROFILE_IDENTITY  *Identity
+  )
+{
+  EFI_ACPI_SDT_HEADER  *Source;
+  UINTN                Index;
+
+  ZeroMem(Identity, sizeof(*Identity));
+
+  // Some firmware leaves the XSDT OEM table ID blank; the FADT is always filled in
+  Source = gXsdt;
+  AcpiRulesCopyField(Identity->OemTableId, (CHAR8 *)Source->OemTableId, ACPI_PROFILE_OEM_TABLE_SIZE);
+  if (Identity->OemTableId[0] == '\0' && gFacp != NULL) {
+    Source = (EFI_ACPI_SDT_HEADER *)gFacp;
+    AcpiRulesCopyField(Identity->OemTableId, (CHAR8 *)Source->OemTableId, ACPI_PROFILE_OEM_TABLE_SIZE);
+  }
+  AcpiRulesCopyField(Identity->OemId, (CHAR8 *)Source->OemId, ACPI_PROFILE_OEM_ID_SIZE);
+
+  AcpiProfileReadProduct(Identity->Product);
+
+  if (Identity->Product[0] != '\0') {
+    Identity->Keys[Identity->KeyCount++] = AcpiRulesProfileKey(Identity->OemId, Identity->OemTableId, Identity->Product);
+  }
+  Identity->Keys[Identity->KeyCount++] = AcpiRulesProfileKey(Identity->OemId, Identity->OemTableId, NULL);
+
+  AcpiDebugPrint(DEBUG_INFO, L"Platform identity: OEM '%a' '%a', product '%a'\n",
+                 Identity->OemId, Identity->OemTableId, Identity->Product);
+  for (Index = 0; Index < Identity->KeyCount; Index++) {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Profile key %u: " ACPI_PROFILE_DIR_FORMAT L"\n",
+                   (UINT32)Index, Identity->Keys[Index]);
+  }
+}
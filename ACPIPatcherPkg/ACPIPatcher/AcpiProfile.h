@@ -0,0 +1,48 @@
+/** @file
+
+  Platform identity used to select a per-platform table profile.
+
+**/
+
+#ifndef __ACPI_PROFILE_H__
+#define __ACPI_PROFILE_H__
+
+#include "ACPIPatcher.h"
+
+//
+// Profile subdirectory of the ACPI folder: "P-" followed by the key in hex
+//
+#define ACPI_PROFILE_DIR_FORMAT       L"P-%08X"
+#define ACPI_PROFILE_DIR_LENGTH       11
+
+#define ACPI_PROFILE_OEM_ID_SIZE      6
+#define ACPI_PROFILE_OEM_TABLE_SIZE   8
+#define ACPI_PROFILE_PRODUCT_SIZE     64
+#define ACPI_PROFILE_MAX_KEYS         2
+
+typedef struct {
+  CHAR8   OemId[ACPI_PROFILE_OEM_ID_SIZE + 1];
+  CHAR8   OemTableId[ACPI_PROFILE_OEM_TABLE_SIZE + 1];
+  CHAR8   Product[ACPI_PROFILE_PRODUCT_SIZE];       ///< SMBIOS product name, empty if unavailable
+  UINT32  Keys[ACPI_PROFILE_MAX_KEYS];              ///< Candidate profile keys, most specific first
+  UINT32  KeyCount;
+} ACPI_PROFILE_IDENTITY;
+
+/**
+  Builds the platform identity from the firmware XSDT (or FADT) OEM fields
+  and the SMBIOS type 1 product name.
+
+  Two keys are derived: OEM ID + OEM table ID + product name, and OEM ID +
+  OEM table ID alone, so a profile can target one model or a whole board
+  family. Each key is the FNV-1a hash of the fields with trailing blanks
+  removed, each field followed by a NUL byte; Tools/AcpiBundle.py hash
+  computes the same value offline.
+
+  @param[out] Identity    Identity and candidate keys
+**/
+VOID
+AcpiProfileIdentify (
+  OUT ACPI_PROFILE_IDENTITY  *Identity
+  );
+
+#endif // __ACPI_PROFILE_H__
@@ -0,0 +1,354 @@
+/** @file
+
+  Adaptive transfer size for table file reads.
+
+  The variable is rewritten only when a sample, a failure or the choice
+  changes, so once a size is chosen a run costs the variable store nothing.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+#include "AcpiReadTune.h"
+#include "AcpiPerf.h"
+#include "AcpiLog.h"
+
+typedef struct {
+  ACPI_PATCHER_READ_TUNING         Header;
+  ACPI_PATCHER_READ_TUNING_VOLUME  Volumes[ACPI_PATCHER_READ_TUNING_VOLUMES];
+} ACPI_READ_TUNE_BUFFER;
+
+//
+// Transfer sizes, smallest first, indexed like SampleBytes; 0 reads the whole file
+//
+STATIC CONST UINT32  mTransferSizes[ACPI_PATCHER_READ_TUNING_SIZES] = {
+  SIZE_4KB,
+  SIZE_16KB,
+  SIZE_64KB,
+  0
+};
+
+STATIC ACPI_READ_TUNE_BUFFER            mTuning;
+STATIC ACPI_PATCHER_READ_TUNING_VOLUME  mUnsaved;       ///< Volume that is not remembered
+STATIC ACPI_PATCHER_READ_TUNING_VOLUME  *mVolume;       ///< Volume being read, NULL before the first read
+STATIC BOOLEAN                          mDirty;
+
+/**
+  Clears what is known about a volume.
+**/
+STATIC
+VOID
+AcpiReadTuneResetVolume (
+  OUT ACPI_PATCHER_READ_TUNING_VOLUME  *Volume
+  )
+{
+  ZeroMem(Volume->SampleBytes, sizeof(Volume->SampleBytes));
+  ZeroMem(Volume->SampleNs, sizeof(Volume->SampleNs));
+  Volume->Chosen           = ACPI_PATCHER_READ_TUNING_SAMPLING;
+  Volume->FailedSizes      = 0;
+  Volume->FirmwareRevision = gST->FirmwareRevision;
+}
+
+/**
+  Reads AcpiReadTuning, starting over if it is missing or of another layout.
+**/
+STATIC
+VOID
+AcpiReadTuneLoad (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Size = sizeof(mTuning);
+  Status = gRT->GetVariable(ACPI_PATCHER_READ_TUNING_NAME, &gAcpiPatcherReadTuningGuid, NULL, &Size, &mTuning);
+  if (!EFI_ERROR(Status) &&
+      Size >= sizeof(mTuning.Header) &&
+      mTuning.Header.Signature == ACPI_PATCHER_READ_TUNING_SIGNATURE &&
+      mTuning.Header.Version == ACPI_PATCHER_READ_TUNING_VERSION &&
+      mTuning.Header.VolumeSize == sizeof(ACPI_PATCHER_READ_TUNING_VOLUME) &&
+      mTuning.Header.VolumeCount <= ACPI_PATCHER_READ_TUNING_VOLUMES &&
+      Size == sizeof(mTuning.Header) + mTuning.Header.VolumeCount * sizeof(ACPI_PATCHER_READ_TUNING_VOLUME)) {
+    return;
+  }
+
+  if (Status != EFI_NOT_FOUND) {
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Starting new read tuning (%r)\n", Status);
+  }
+  ZeroMem(&mTuning, sizeof(mTuning));
+  mTuning.Header.Signature  = ACPI_PATCHER_READ_TUNING_SIGNATURE;
+  mTuning.Header.Version    = ACPI_PATCHER_READ_TUNING_VERSION;
+  mTuning.Header.VolumeSize = sizeof(ACPI_PATCHER_READ_TUNING_VOLUME);
+}
+
+VOID
+AcpiReadTuneStart (
+  IN EFI_HANDLE  Device  OPTIONAL,
+  IN UINT8       Reader
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL         *DevicePath;
+  ACPI_PATCHER_READ_TUNING_VOLUME  *Volume;
+  UINT32                           Crc32;
+  UINT16                           PathSize;
+  UINT32                           Index;
+
+  mVolume = &mUnsaved;
+  AcpiReadTuneResetVolume(mVolume);
+  DevicePath = (Device != NULL) ? DevicePathFromHandle(Device) : NULL;
+  if (DevicePath == NULL) {
+    return;
+  }
+  PathSize = (UINT16)GetDevicePathSize(DevicePath);
+  gBS->CalculateCrc32(DevicePath, PathSize, &Crc32);
+
+  AcpiReadTuneLoad();
+
+  Volume = NULL;
+  for (Index = 0; Index < mTuning.Header.VolumeCount; Index++) {
+    if (mTuning.Volumes[Index].DevicePathCrc32 == Crc32 &&
+        mTuning.Volumes[Index].DevicePathSize == PathSize &&
+        mTuning.Volumes[Index].Reader == Reader) {
+      Volume = &mTuning.Volumes[Index];
+      break;
+    }
+  }
+
+  if (Volume == NULL) {
+    if (mTuning.Header.VolumeCount < ACPI_PATCHER_READ_TUNING_VOLUMES) {
+      Volume = &mTuning.Volumes[mTuning.Header.VolumeCount++];
+    } else {
+      Volume = &mTuning.Volumes[0];
+      for (Index = 1; Index < ACPI_PATCHER_READ_TUNING_VOLUMES; Index++) {
+        if (mTuning.Volumes[Index].LastUpdate < Volume->LastUpdate) {
+          Volume = &mTuning.Volumes[Index];
+        }
+      }
+    }
+    ZeroMem(Volume, sizeof(*Volume));
+    Volume->DevicePathCrc32 = Crc32;
+    Volume->DevicePathSize  = PathSize;
+    Volume->Reader          = Reader;
+    AcpiReadTuneResetVolume(Volume);
+  } else if (Volume->FirmwareRevision != gST->FirmwareRevision) {
+    // A firmware update may bring another file system driver
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Firmware changed, sampling read sizes again\n");
+    AcpiReadTuneResetVolume(Volume);
+  }
+  mVolume = Volume;
+}
+
+/**
+  Returns the size to read the next file with: the chosen one, or else the
+  usable size with the fewest bytes sampled.
+**/
+STATIC
+UINT32
+AcpiReadTuneNextIndex (
+  VOID
+  )
+{
+  UINT32  Index;
+  UINT32  Best;
+
+  if (mVolume->Chosen < ACPI_PATCHER_READ_TUNING_SIZES) {
+    return mVolume->Chosen;
+  }
+
+  Best = ACPI_PATCHER_READ_TUNING_SIZES;
+  for (Index = 0; Index < ACPI_PATCHER_READ_TUNING_SIZES; Index++) {
+    if ((mVolume->FailedSizes & (1 << Index)) == 0 &&
+        (Best == ACPI_PATCHER_READ_TUNING_SIZES || mVolume->SampleBytes[Index] < mVolume->SampleBytes[Best])) {
+      Best = Index;
+    }
+  }
+  return Best;
+}
+
+/**
+  Chooses the fastest size once every usable size is sampled.
+**/
+STATIC
+VOID
+AcpiReadTuneChoose (
+  VOID
+  )
+{
+  UINT32  Index;
+  UINT32  Best;
+  UINT64  Rate;
+  UINT64  BestRate;
+
+  Best     = ACPI_PATCHER_READ_TUNING_SAMPLING;
+  BestRate = 0;
+  for (Index = 0; Index < ACPI_PATCHER_READ_TUNING_SIZES; Index++) {
+    if ((mVolume->FailedSizes & (1 << Index)) != 0) {
+      continue;
+    }
+    if (mVolume->SampleBytes[Index] < ACPI_READ_TUNE_SAMPLE_BYTES) {
+      return;
+    }
+    Rate = AcpiPerfKbPerSecond(mVolume->SampleBytes[Index], mVolume->SampleNs[Index]);
+    if (Best == ACPI_PATCHER_READ_TUNING_SAMPLING || Rate > BestRate) {
+      Best     = Index;
+      BestRate = Rate;
+    }
+  }
+
+  if (Best != ACPI_PATCHER_READ_TUNING_SAMPLING) {
+    mVolume->Chosen = (UINT8)Best;
+    AcpiDebugPrint(DEBUG_INFO, L"Read transfer size chosen for this volume: %u bytes (0 for whole files), %llu KB/s\n",
+                   mTransferSizes[Best], BestRate);
+    ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_READ_SIZE_CHOSEN, mTransferSizes[Best], BestRate);
+  }
+}
+
+EFI_STATUS
+AcpiReadTuneRead (
+  IN  EFI_FILE_PROTOCOL  *File,
+  IN  UINTN              Size,
+  OUT VOID               *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Start;
+  UINT64      Ns;
+  UINT64      Position;
+  UINTN       Offset;
+  UINTN       Length;
+  UINT32      Index;
+  BOOLEAN     Sample;
+
+  if (mVolume == NULL) {
+    AcpiReadTuneStart(NULL, ACPI_PATCHER_READ_TUNING_DRIVER);
+  }
+
+  Status = File->GetPosition(File, &Position);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  // Every size failed on an earlier read; the volume may have recovered
+  Index = AcpiReadTuneNextIndex();
+  if (Index == ACPI_PATCHER_READ_TUNING_SIZES) {
+    AcpiReadTuneResetVolume(mVolume);
+    mDirty = TRUE;
+    Index  = AcpiReadTuneNextIndex();
+  }
+
+  // Only files that need more than one request at the smallest size tell the sizes apart
+  Sample = (BOOLEAN)(mVolume->Chosen == ACPI_PATCHER_READ_TUNING_SAMPLING && Size > mTransferSizes[0]);
+  Offset = 0;
+  Start  = AcpiPerfNow();
+  while (Offset < Size) {
+    Length = Size - Offset;
+    if (mTransferSizes[Index] != 0) {
+      Length = MIN(Length, mTransferSizes[Index]);
+    }
+    Status = File->Read(File, &Length, (UINT8 *)Buffer + Offset);
+    gAcpiPerf.Transfers++;
+    if (!EFI_ERROR(Status) && Length == 0) {
+      return EFI_END_OF_FILE;
+    }
+
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_WARN, L"Read of %u bytes failed (%r), retrying with smaller transfers\n",
+                     (UINT32)(Size - Offset), Status);
+      ACPI_LOG2(DEBUG_WARN, ACPI_LOG_MSG_READ_SIZE_FAILED, mTransferSizes[Index], Status);
+      mVolume->FailedSizes |= (UINT8)(1 << Index);
+      if (mVolume->Chosen == Index) {
+        mVolume->Chosen = ACPI_PATCHER_READ_TUNING_SAMPLING;
+      }
+      mDirty = TRUE;
+      Sample = FALSE;
+
+      // Next smaller usable size, from where the failed request started
+      while (Index > 0 && (mVolume->FailedSizes & (1 << --Index)) != 0) {
+      }
+      if ((mVolume->FailedSizes & (1 << Index)) != 0) {
+        return Status;
+      }
+      Status = File->SetPosition(File, Position + Offset);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      continue;
+    }
+    Offset += Length;
+  }
+
+  Ns = AcpiPerfElapsedNs(Start);
+  gAcpiPerf.TransferBytes += Size;
+  gAcpiPerf.TransferNs    += Ns;
+  if (Sample) {
+    mVolume->SampleBytes[Index] += Size;
+    mVolume->SampleNs[Index]    += Ns;
+    mDirty = TRUE;
+    AcpiReadTuneChoose();
+  }
+  return EFI_SUCCESS;
+}
+
+VOID
+AcpiReadTuneReport (
+  VOID
+  )
+{
+  UINT32  Index;
+  UINT32  Sampled;
+
+  if (mVolume == NULL || gAcpiPerf.Transfers == 0) {
+    return;
+  }
+
+  if (mVolume->Chosen < ACPI_PATCHER_READ_TUNING_SIZES) {
+    if (mTransferSizes[mVolume->Chosen] == 0) {
+      AcpiDebugPrint(DEBUG_INFO, L"  Read transfers: whole files (tuned), %u requests, %llu KB/s\n",
+                     gAcpiPerf.Transfers, AcpiPerfKbPerSecond(gAcpiPerf.TransferBytes, gAcpiPerf.TransferNs));
+    } else {
+      AcpiDebugPrint(DEBUG_INFO, L"  Read transfers: %u KB (tuned), %u requests, %llu KB/s\n",
+                     mTransferSizes[mVolume->Chosen] / SIZE_1KB, gAcpiPerf.Transfers,
+                     AcpiPerfKbPerSecond(gAcpiPerf.TransferBytes, gAcpiPerf.TransferNs));
+    }
+    return;
+  }
+
+  Sampled = 0;
+  for (Index = 0; Index < ACPI_PATCHER_READ_TUNING_SIZES; Index++) {
+    if ((mVolume->FailedSizes & (1 << Index)) != 0 || mVolume->SampleBytes[Index] >= ACPI_READ_TUNE_SAMPLE_BYTES) {
+      Sampled++;
+    }
+  }
+  AcpiDebugPrint(DEBUG_INFO, L"  Read transfers: sampling sizes (%u of %u done), %u requests, %llu KB/s\n",
+                 Sampled, ACPI_PATCHER_READ_TUNING_SIZES, gAcpiPerf.Transfers,
+                 AcpiPerfKbPerSecond(gAcpiPerf.TransferBytes, gAcpiPerf.TransferNs));
+}
+
+VOID
+AcpiReadTuneSave (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  if (!mDirty || mVolume == NULL || mVolume == &mUnsaved) {
+    return;
+  }
+
+  mTuning.Header.Updates++;
+  mVolume->LastUpdate = mTuning.Header.Updates;
+  Status = gRT->SetVariable(ACPI_PATCHER_READ_TUNING_NAME, &gAcpiPatcherReadTuningGuid,
+                            ACPI_PATCHER_READ_TUNING_ATTRIBUTES,
+                            sizeof(mTuning.Header) + mTuning.Header.VolumeCount * sizeof(ACPI_PATCHER_READ_TUNING_VOLUME),
+                            &mTuning);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Could not save the read tuning: %r\n", Status);
+  }
+  mDirty = FALSE;
+}
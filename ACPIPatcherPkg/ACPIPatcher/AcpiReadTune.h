@@ -0,0 +1,78 @@
+/** @file
+
+  Adaptive transfer size for table file reads (see
+  Include/Guid/AcpiPatcherReadTuning.h).
+
+  Some file system drivers split or fail single large reads, as the EFI 1.x
+  64 KB note in PatchAcpi() warns, while others are fastest with one
+  request per file. The auto read strategy times the first files read on a
+  volume with each transfer size and keeps the fastest. A size whose read
+  fails is retried from the same offset with the next smaller size and is
+  not used on that volume again. Files no larger than the smallest size
+  are read with one request whatever the size, so they are not sampled.
+
+**/
+
+#ifndef __ACPI_READ_TUNE_H__
+#define __ACPI_READ_TUNE_H__
+
+#include <Guid/AcpiPatcherReadTuning.h>
+
+#include "ACPIPatcher.h"
+
+//
+// Bytes read with every size before the fastest is chosen
+//
+#define ACPI_READ_TUNE_SAMPLE_BYTES   SIZE_128KB
+
+/**
+  Selects the volume later reads come from and loads what earlier boots
+  learned about it. Without a call, or with no Device, reads are still
+  tuned but nothing is remembered.
+
+  @param[in] Device      Volume handle, or NULL if the volume must not be remembered
+  @param[in] Reader      ACPI_PATCHER_READ_TUNING_DRIVER or ACPI_PATCHER_READ_TUNING_FAT
+**/
+VOID
+AcpiReadTuneStart (
+  IN EFI_HANDLE  Device  OPTIONAL,
+  IN UINT8       Reader
+  );
+
+/**
+  Reads an open file from its current position with the transfer size
+  chosen for the volume, or the size being sampled.
+
+  @param[in]  File      Open table file
+  @param[in]  Size      Bytes to read
+  @param[out] Buffer    Receives Size bytes
+
+  @retval EFI_SUCCESS       File read
+  @retval EFI_END_OF_FILE   The file ended early
+  @retval Other             Reads failed with every size
+**/
+EFI_STATUS
+AcpiReadTuneRead (
+  IN  EFI_FILE_PROTOCOL  *File,
+  IN  UINTN              Size,
+  OUT VOID               *Buffer
+  );
+
+/**
+  Prints the transfer size used in this run and the throughput measured
+  with it, from gAcpiPerf.
+**/
+VOID
+AcpiReadTuneReport (
+  VOID
+  );
+
+/**
+  Writes the samples and choice back to AcpiReadTuning if they changed.
+**/
+VOID
+AcpiReadTuneSave (
+  VOID
+  );
+
+#endif // __ACPI_READ_TUNE_H__
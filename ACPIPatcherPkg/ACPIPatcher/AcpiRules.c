@@ -0,0 +1,116 @@
+/** @file
+
+  Table and platform rules shared by the firmware modules and the host
+  tools.
+
+**/
+
+#include "AcpiRules.h"
+
+#define FNV32_OFFSET_BASIS  0x811C9DC5
+#define FNV32_PRIME         0x01000193
+
+CONST CHAR8  *gAcpiTableDefectNames[AcpiTableDefectMax] = {
+  "sound",
+  "truncated",
+  "zero signature",
+  "length below header size",
+  "length beyond file"
+};
+
+ACPI_TABLE_DEFECT
+AcpiRulesCheckTable (
+  IN  CONST VOID  *Table,
+  IN  UINTN       BufferSize,
+  OUT UINT8       *Checksum  OPTIONAL
+  )
+{
+  CONST EFI_ACPI_DESCRIPTION_HEADER  *Header;
+  CONST UINT8                        *Bytes;
+  UINT8                              Sum;
+  UINT32                             Index;
+
+  if (Table == NULL || BufferSize < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+    return AcpiTableTruncated;
+  }
+
+  Header = Table;
+  if (Header->Signature == 0) {
+    return AcpiTableNoSignature;
+  }
+  if (Header->Length < sizeof(EFI_ACPI_DESCRIPTION_HEADER)) {
+    return AcpiTableShortLength;
+  }
+  if (Header->Length > BufferSize) {
+    return AcpiTableOverrun;
+  }
+
+  if (Checksum != NULL) {
+    Bytes = Table;
+    Sum   = 0;
+    for (Index = 0; Index < Header->Length; Index++) {
+      Sum = (UINT8)(Sum + Bytes[Index]);
+    }
+    *Checksum = Sum;
+  }
+
+  return AcpiTableSound;
+}
+
+VOID
+AcpiRulesCopyField (
+  OUT CHAR8        *Destination,
+  IN  CONST CHAR8  *Source,
+  IN  UINTN        Size
+  )
+{
+  UINTN  Length;
+
+  for (Length = 0; Length < Size && Source[Length] != '\0'; Length++) {
+    Destination[Length] = Source[Length];
+  }
+  while (Length > 0 && Destination[Length - 1] == ' ') {
+    Length--;
+  }
+  Destination[Length] = '\0';
+}
+
+/**
+  Folds a string and its terminating NUL into an FNV-1a hash.
+
+  @param[in] Hash     Hash so far
+  @param[in] String   String to add
+
+  @return Updated hash
+**/
+STATIC
+UINT32
+AcpiRulesHashString (
+  IN UINT32       Hash,
+  IN CONST CHAR8  *String
+  )
+{
+  do {
+    Hash = (Hash ^ (UINT8)*String) * FNV32_PRIME;
+  } while (*String++ != '\0');
+
+  return Hash;
+}
+
+UINT32
+AcpiRulesProfileKey (
+  IN CONST CHAR8  *OemId,
+  IN CONST CHAR8  *OemTableId,
+  IN CONST CHAR8  *Product  OPTIONAL
+  )
+{
+  UINT32  Hash;
+
+  Hash = AcpiRulesHashString(FNV32_OFFSET_BASIS, OemId);
+  Hash = AcpiRulesHashString(Hash, OemTableId);
+  if (Product != NULL) {
+    Hash = AcpiRulesHashString(Hash, Product);
+  }
+
+  return (Hash == ACPI_PROFILE_COMMON_KEY) ? 1 : Hash;
+}
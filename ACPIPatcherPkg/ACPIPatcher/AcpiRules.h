@@ -0,0 +1,89 @@
+/** @file
+
+  Table and platform rules shared by the firmware modules and the host
+  tools: table header checks, XSDT capacity limits and profile keys.
+
+  Nothing here touches firmware services or globals, so
+  Tools/FleetValidator builds AcpiRules.c unchanged on the host.
+
+**/
+
+#ifndef __ACPI_RULES_H__
+#define __ACPI_RULES_H__
+
+#include <IndustryStandard/Acpi.h>
+
+//
+// Capacity limits
+//
+#define MAX_ADDITIONAL_TABLES             16
+#define ACPI_EFI1X_MAX_ADDITIONAL_TABLES  8           ///< EFI 1.x firmware copes with fewer extra XSDT entries
+#define ACPI_EFI1X_MAX_TABLE_SIZE         SIZE_64KB   ///< Larger tables may fail to load on EFI 1.x
+
+//
+// Key of the tables shared by every platform
+//
+#define ACPI_PROFILE_COMMON_KEY       0
+
+//
+// Why a table buffer was rejected
+//
+typedef enum {
+  AcpiTableSound,           ///< Usable; the checksum may still be wrong
+  AcpiTableTruncated,       ///< Buffer smaller than a table header
+  AcpiTableNoSignature,     ///< Signature is zero
+  AcpiTableShortLength,     ///< Header length smaller than the header
+  AcpiTableOverrun,         ///< Header length beyond the buffer
+  AcpiTableDefectMax
+} ACPI_TABLE_DEFECT;
+
+extern CONST CHAR8  *gAcpiTableDefectNames[AcpiTableDefectMax];
+
+/**
+  Checks the header of a table read from a file.
+
+  @param[in]  Table         Table data
+  @param[in]  BufferSize    Bytes available at Table
+  @param[out] Checksum      Byte sum over the table length, 0 when correct;
+                            only set for AcpiTableSound. May be NULL.
+
+  @return AcpiTableSound, or the reason the table cannot be installed
+**/
+ACPI_TABLE_DEFECT
+AcpiRulesCheckTable (
+  IN  CONST VOID  *Table,
+  IN  UINTN       BufferSize,
+  OUT UINT8       *Checksum  OPTIONAL
+  );
+
+/**
+  Copies a fixed-size header field into a NUL-terminated string, stopping
+  at the first NUL and dropping trailing blanks.
+
+  @param[out] Destination   Buffer of at least Size + 1 bytes
+  @param[in]  Source        Field to copy
+  @param[in]  Size          Field size in bytes
+**/
+VOID
+AcpiRulesCopyField (
+  OUT CHAR8        *Destination,
+  IN  CONST CHAR8  *Source,
+  IN  UINTN        Size
+  );
+
+/**
+  Returns the FNV-1a profile key of a platform identity. Each string is
+  hashed with its terminating NUL. ACPI_PROFILE_COMMON_KEY is never returned.
+
+  @param[in] OemId        OEM ID, as copied by AcpiRulesCopyField
+  @param[in] OemTableId   OEM table ID, as copied by AcpiRulesCopyField
+  @param[in] Product      SMBIOS product name, or NULL to leave it out
+**/
+UINT32
+AcpiRulesProfileKey (
+  IN CONST CHAR8  *OemId,
+  IN CONST CHAR8  *OemTableId,
+  IN CONST CHAR8  *Product  OPTIONAL
+  );
+
+#endif // __ACPI_RULES_H__
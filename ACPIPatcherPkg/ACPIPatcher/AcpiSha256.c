@@ -0,0 +1,298 @@
+/** @file
+
+  SHA-256 for table integrity checks.
+
+  The accelerated block functions live in X64/AcpiSha256Ni.nasm and
+  AArch64/AcpiSha256Ce.S (.asm for MSVC); every architecture falls back to
+  the portable one below.
+
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiSha256.h"
+
+typedef
+VOID
+(EFIAPI *ACPI_SHA256_BLOCKS) (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        Blocks
+  );
+
+#if defined (MDE_CPU_X64) || defined (MDE_CPU_AARCH64)
+/**
+  Hashes whole blocks with the CPU's SHA-256 instructions.
+
+  @param[in,out] State    Hash state
+  @param[in]     Data     Blocks * 64 bytes
+  @param[in]     Blocks   Number of blocks, at least 1
+**/
+VOID
+EFIAPI
+AcpiSha256BlocksAccel (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        Blocks
+  );
+#endif
+
+#if defined (MDE_CPU_AARCH64)
+/** Returns ID_AA64ISAR0_EL1. */
+UINT64
+EFIAPI
+AcpiSha256ReadIsar0 (
+  VOID
+  );
+#endif
+
+#define ROTR32(Value, Bits)   (((Value) >> (Bits)) | ((Value) << (32 - (Bits))))
+
+STATIC CONST UINT32  mSha256K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+STATIC CONST UINT32  mSha256Iv[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/**
+  Hashes whole blocks in C.
+
+  @param[in,out] State    Hash state
+  @param[in]     Data     Blocks * 64 bytes
+  @param[in]     Blocks   Number of blocks
+**/
+STATIC
+VOID
+EFIAPI
+AcpiSha256BlocksPortable (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        Blocks
+  )
+{
+  UINT32  W[64];
+  UINT32  V[8];
+  UINT32  T1;
+  UINT32  T2;
+  UINTN   Index;
+
+  for (; Blocks > 0; Blocks--, Data += ACPI_SHA256_BLOCK_SIZE) {
+    for (Index = 0; Index < 16; Index++) {
+      W[Index] = SwapBytes32(ReadUnaligned32((CONST UINT32 *)(Data + Index * 4)));
+    }
+    for (Index = 16; Index < 64; Index++) {
+      W[Index] = (ROTR32(W[Index - 2], 17) ^ ROTR32(W[Index - 2], 19) ^ (W[Index - 2] >> 10)) + W[Index - 7] +
+                 (ROTR32(W[Index - 15], 7) ^ ROTR32(W[Index - 15], 18) ^ (W[Index - 15] >> 3)) + W[Index - 16];
+    }
+
+    CopyMem(V, State, sizeof(V));
+    for (Index = 0; Index < 64; Index++) {
+      T1 = V[7] + (ROTR32(V[4], 6) ^ ROTR32(V[4], 11) ^ ROTR32(V[4], 25)) +
+           ((V[4] & V[5]) ^ (~V[4] & V[6])) + mSha256K[Index] + W[Index];
+      T2 = (ROTR32(V[0], 2) ^ ROTR32(V[0], 13) ^ ROTR32(V[0], 22)) +
+           ((V[0] & V[1]) ^ (V[0] & V[2]) ^ (V[1] & V[2]));
+      V[7] = V[6];
+      V[6] = V[5];
+      V[5] = V[4];
+      V[4] = V[3] + T1;
+      V[3] = V[2];
+      V[2] = V[1];
+      V[1] = V[0];
+      V[0] = T1 + T2;
+    }
+
+    for (Index = 0; Index < 8; Index++) {
+      State[Index] += V[Index];
+    }
+  }
+}
+
+STATIC ACPI_SHA256_BLOCKS  mSha256Blocks = NULL;
+STATIC ACPI_SHA256_IMPL    mSha256Impl   = AcpiSha256Portable;
+
+#if defined (MDE_CPU_X64) || defined (MDE_CPU_AARCH64)
+/**
+  Returns TRUE if the CPU has the SHA-256 instructions the accelerated
+  block function uses.
+**/
+STATIC
+BOOLEAN
+AcpiSha256HasAccel (
+  VOID
+  )
+{
+#if defined (MDE_CPU_X64)
+  UINT32  MaxLeaf;
+  UINT32  Ecx;
+  UINT32  Ebx;
+
+  // SHA-NI plus the SSSE3 and SSE4.1 shuffles around it
+  AsmCpuid(0, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < 7) {
+    return FALSE;
+  }
+  AsmCpuid(1, NULL, NULL, &Ecx, NULL);
+  AsmCpuidEx(7, 0, NULL, &Ebx, NULL, NULL);
+  return (BOOLEAN)((Ecx & BIT9) != 0 && (Ecx & BIT19) != 0 && (Ebx & BIT29) != 0);
+#elif defined (MDE_CPU_AARCH64)
+  // ID_AA64ISAR0_EL1.SHA2, bits 15:12
+  return (BOOLEAN)(((AcpiSha256ReadIsar0() >> 12) & 0xF) != 0);
+#endif
+}
+#endif
+
+EFI_STATUS
+AcpiSha256Select (
+  IN ACPI_SHA256_IMPL  Impl
+  )
+{
+  switch (Impl) {
+    case AcpiSha256Portable:
+      mSha256Blocks = AcpiSha256BlocksPortable;
+      break;
+
+#if defined (MDE_CPU_X64) || defined (MDE_CPU_AARCH64)
+    case AcpiSha256Accelerated:
+      if (!AcpiSha256HasAccel()) {
+        return EFI_UNSUPPORTED;
+      }
+      mSha256Blocks = AcpiSha256BlocksAccel;
+      break;
+#endif
+
+    default:
+      return EFI_UNSUPPORTED;
+  }
+
+  mSha256Impl = Impl;
+  return EFI_SUCCESS;
+}
+
+CONST CHAR16 *
+AcpiSha256ImplName (
+  IN ACPI_SHA256_IMPL  Impl
+  )
+{
+  if (Impl == AcpiSha256Portable) {
+    return L"portable";
+  }
+
+#if defined (MDE_CPU_X64)
+  return L"SHA-NI";
+#elif defined (MDE_CPU_AARCH64)
+  return L"ARMv8-CE";
+#else
+  return L"none";
+#endif
+}
+
+ACPI_SHA256_IMPL
+AcpiSha256Current (
+  VOID
+  )
+{
+  if (mSha256Blocks == NULL && EFI_ERROR(AcpiSha256Select(AcpiSha256Accelerated))) {
+    AcpiSha256Select(AcpiSha256Portable);
+  }
+
+  return mSha256Impl;
+}
+
+VOID
+AcpiSha256Init (
+  OUT ACPI_SHA256_CONTEXT  *Context
+  )
+{
+  AcpiSha256Current();
+  CopyMem(Context->State, mSha256Iv, sizeof(Context->State));
+  Context->Length = 0;
+}
+
+VOID
+AcpiSha256Update (
+  IN OUT ACPI_SHA256_CONTEXT  *Context,
+  IN     CONST VOID           *Data,
+  IN     UINTN                Size
+  )
+{
+  CONST UINT8  *Bytes;
+  UINTN        Used;
+  UINTN        Take;
+
+  Bytes = Data;
+  Used  = (UINTN)(Context->Length & (ACPI_SHA256_BLOCK_SIZE - 1));
+  Context->Length += Size;
+
+  if (Used > 0) {
+    Take = MIN(Size, ACPI_SHA256_BLOCK_SIZE - Used);
+    CopyMem(Context->Buffer + Used, Bytes, Take);
+    Bytes += Take;
+    Size  -= Take;
+    if (Used + Take < ACPI_SHA256_BLOCK_SIZE) {
+      return;
+    }
+    mSha256Blocks(Context->State, Context->Buffer, 1);
+  }
+
+  if (Size >= ACPI_SHA256_BLOCK_SIZE) {
+    mSha256Blocks(Context->State, Bytes, Size / ACPI_SHA256_BLOCK_SIZE);
+    Bytes += Size & ~(UINTN)(ACPI_SHA256_BLOCK_SIZE - 1);
+    Size  &= ACPI_SHA256_BLOCK_SIZE - 1;
+  }
+
+  CopyMem(Context->Buffer, Bytes, Size);
+}
+
+VOID
+AcpiSha256Final (
+  IN OUT ACPI_SHA256_CONTEXT  *Context,
+  OUT    UINT8                *Digest
+  )
+{
+  UINT64  Bits;
+  UINTN   Used;
+  UINTN   Index;
+
+  Bits = LShiftU64(Context->Length, 3);
+  Used = (UINTN)(Context->Length & (ACPI_SHA256_BLOCK_SIZE - 1));
+
+  // Padding: 0x80, zeros, then the bit length big-endian in the last 8 bytes
+  Context->Buffer[Used++] = 0x80;
+  if (Used > ACPI_SHA256_BLOCK_SIZE - 8) {
+    ZeroMem(Context->Buffer + Used, ACPI_SHA256_BLOCK_SIZE - Used);
+    mSha256Blocks(Context->State, Context->Buffer, 1);
+    Used = 0;
+  }
+  ZeroMem(Context->Buffer + Used, ACPI_SHA256_BLOCK_SIZE - 8 - Used);
+  WriteUnaligned64((UINT64 *)(Context->Buffer + ACPI_SHA256_BLOCK_SIZE - 8), SwapBytes64(Bits));
+  mSha256Blocks(Context->State, Context->Buffer, 1);
+
+  for (Index = 0; Index < 8; Index++) {
+    WriteUnaligned32((UINT32 *)(Digest + Index * 4), SwapBytes32(Context->State[Index]));
+  }
+}
+
+VOID
+AcpiSha256 (
+  IN  CONST VOID  *Data,
+  IN  UINTN       Size,
+  OUT UINT8       *Digest
+  )
+{
+  ACPI_SHA256_CONTEXT  Context;
+
+  AcpiSha256Init(&Context);
+  AcpiSha256Update(&Context, Data, Size);
+  AcpiSha256Final(&Context, Digest);
+}
@@ -0,0 +1,94 @@
+/** @file
+
+  SHA-256 for table integrity checks.
+
+  The block function is picked once per run: SHA-NI on X64 and the ARMv8
+  cryptography extensions on AARCH64 when the CPU has them, the portable
+  C implementation otherwise.
+
+**/
+
+#ifndef __ACPI_SHA256_H__
+#define __ACPI_SHA256_H__
+
+#define ACPI_SHA256_DIGEST_SIZE   32
+#define ACPI_SHA256_BLOCK_SIZE    64
+
+//
+// Block function implementations
+//
+typedef enum {
+  AcpiSha256Portable,       ///< C implementation, every architecture
+  AcpiSha256Accelerated,    ///< SHA-NI or ARMv8 cryptography extensions
+  AcpiSha256ImplMax
+} ACPI_SHA256_IMPL;
+
+typedef struct {
+  UINT32  State[8];
+  UINT64  Length;                           ///< Bytes hashed so far
+  UINT8   Buffer[ACPI_SHA256_BLOCK_SIZE];   ///< Partial block, Length % 64 bytes
+} ACPI_SHA256_CONTEXT;
+
+/**
+  Selects the block function used by later hashing.
+
+  @param[in] Impl   Implementation to use
+
+  @retval EFI_SUCCESS       Implementation selected
+  @retval EFI_UNSUPPORTED   This CPU or build does not provide it
+**/
+EFI_STATUS
+AcpiSha256Select (
+  IN ACPI_SHA256_IMPL  Impl
+  );
+
+/**
+  Returns the name of an implementation on this architecture.
+**/
+CONST CHAR16 *
+AcpiSha256ImplName (
+  IN ACPI_SHA256_IMPL  Impl
+  );
+
+/**
+  Returns the implementation in use; the fastest one available unless
+  AcpiSha256Select () chose another.
+**/
+ACPI_SHA256_IMPL
+AcpiSha256Current (
+  VOID
+  );
+
+VOID
+AcpiSha256Init (
+  OUT ACPI_SHA256_CONTEXT  *Context
+  );
+
+VOID
+AcpiSha256Update (
+  IN OUT ACPI_SHA256_CONTEXT  *Context,
+  IN     CONST VOID           *Data,
+  IN     UINTN                Size
+  );
+
+VOID
+AcpiSha256Final (
+  IN OUT ACPI_SHA256_CONTEXT  *Context,
+  OUT    UINT8                *Digest
+  );
+
+/**
+  Hashes a buffer in one call.
+
+  @param[in]  Data      Data to hash
+  @param[in]  Size      Bytes to hash
+  @param[out] Digest    ACPI_SHA256_DIGEST_SIZE bytes
+**/
+VOID
+AcpiSha256 (
+  IN  CONST VOID  *Data,
+  IN  UINTN       Size,
+  OUT UINT8       *Digest
+  );
+
+#endif // __ACPI_SHA256_H__
@@ -0,0 +1,644 @@
+/** @file
+
+  Table sources: tables linked into the image, the NVRAM table store, the
+  ACPI folder, its per-platform profile subdirectory and an optional table
+  bundle.
+
+  Tables in the root of the ACPI folder, and bundle entries with the common
+  key, load on every machine. Tables for one platform live in a P-XXXXXXXX
+  subdirectory or bundle section named by a profile key (see
+  AcpiProfile.h). Only the profile matching this machine is opened, so other
+  platforms' tables cost neither directory reads nor file reads. Tables in
+  the NVRAM store (see AcpiNvStore.h) load on every machine too, and the
+  bundle linked into the image is split into common and profile tables like
+  TABLES.BND.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Guid/FileInfo.h>
+
+#include <AcpiPatcherBundle.h>
+
+#include "AcpiSource.h"
+#include "AcpiNvStore.h"
+#include "FsHelpers.h"
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+#include "AcpiReadTune.h"
+
+CONST CHAR16  *gAcpiReadStrategyNames[AcpiReadStrategyMax] = {
+  L"whole",
+  L"header",
+  L"chunked",
+  L"auto"
+};
+
+//
+// Upper bound on bundle directory size, to reject corrupt headers early
+//
+#define ACPI_SOURCE_MAX_BUNDLE_ENTRIES  1024
+
+/**
+  Appends a table to the list, or replaces a table of the same name.
+
+  @param[in,out] List         List to update
+  @param[in]     Name         File name of the table
+  @param[in]     Size         Table size in bytes
+  @param[in]     Source       Directory or bundle holding the table, NULL for the NVRAM store
+  @param[in]     Offset       Offset in the bundle, 0 for a plain file, NVRAM slot
+  @param[in]     Crc32        Expected CRC32 of a bundle or NVRAM entry
+  @param[in]     ProfileKey   Profile the table belongs to
+  @param[in]     ModificationTime   Time of a plain file, NULL for a bundle entry
+
+  @return The added or replaced entry, or NULL if the list could not grow
+**/
+STATIC
+ACPI_FILE_ENTRY *
+AcpiSourceAdd (
+  IN OUT ACPI_FILE_LIST     *List,
+  IN     CONST CHAR16       *Name,
+  IN     UINT64             Size,
+  IN     EFI_FILE_PROTOCOL  *Source,
+  IN     UINT32             Offset,
+  IN     UINT32             Crc32,
+  IN     UINT32             ProfileKey,
+  IN     CONST EFI_TIME     *ModificationTime  OPTIONAL
+  )
+{
+  EFI_STATUS       Status;
+  ACPI_FILE_ENTRY  *Entry;
+  ACPI_FILE_ENTRY  *Grown;
+  UINTN            Index;
+
+  Entry = NULL;
+  for (Index = 0; Index < List->Count; Index++) {
+    if (StrCmp(List->Entries[Index].Name, Name) == 0) {
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  %s replaces the earlier table of that name\n", Name);
+      Entry = &List->Entries[Index];
+      break;
+    }
+  }
+
+  if (Entry == NULL) {
+    if (List->Count == List->Capacity) {
+      List->Capacity = (List->Capacity == 0) ? MAX_ADDITIONAL_TABLES : List->Capacity * 2;
+      Status = AcpiAllocatePool(EfiBootServicesData, List->Capacity * sizeof(ACPI_FILE_ENTRY), (VOID**)&Grown);
+      if (EFI_ERROR(Status)) {
+        AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate file list: %r\n", Status);
+        return NULL;
+      }
+      if (List->Entries != NULL) {
+        CopyMem(Grown, List->Entries, List->Count * sizeof(ACPI_FILE_ENTRY));
+        AcpiFreePool(List->Entries);
+      }
+      List->Entries = Grown;
+    }
+    Entry = &List->Entries[List->Count++];
+  }
+
+  ZeroMem(Entry, sizeof(*Entry));
+  StrCpyS(Entry->Name, ACPI_FILE_NAME_LENGTH, Name);
+  Entry->Size       = Size;
+  Entry->Source     = Source;
+  Entry->Offset     = Offset;
+  Entry->Crc32      = Crc32;
+  Entry->ProfileKey = ProfileKey;
+  Entry->QueueIndex = MAX_UINT32;
+  if (ModificationTime != NULL) {
+    CopyMem(&Entry->ModificationTime, ModificationTime, sizeof(EFI_TIME));
+  }
+  return Entry;
+}
+
+/**
+  Reads a directory and adds the .aml files in it.
+
+  @param[in,out] List         List to update
+  @param[in]     Directory    Directory to scan
+  @param[in]     ProfileKey   Profile the directory belongs to
+  @param[in]     Tier         ACPI_TABLE_TIER of its tables
+
+  @retval EFI_SUCCESS             Directory scanned
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed
+  @retval Other                   Directory read failed
+**/
+STATIC
+EFI_STATUS
+AcpiSourceAddDirectory (
+  IN OUT ACPI_FILE_LIST     *List,
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN     UINT32             ProfileKey,
+  IN     ACPI_TABLE_TIER    Tier
+  )
+{
+  EFI_STATUS         Status;
+  ACPI_FILE_ENTRY    *Entry;
+  EFI_FILE_INFO      *FileInfo;
+  UINTN              BufferSize;
+  UINTN              ReadSize;
+
+  BufferSize = sizeof(EFI_FILE_INFO) + sizeof(CHAR16) * FILE_NAME_BUFFER_SIZE;
+  Status = AcpiAllocatePool(EfiBootServicesData, BufferSize, (VOID**)&FileInfo);
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to allocate memory for FileInfo: %r\n", Status);
+    return Status;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Allocated FileInfo buffer: " PTR_FMT L" (%u bytes)\n",
+             PTR_TO_INT(FileInfo), BufferSize);
+
+  while (TRUE) {
+    ReadSize = BufferSize;
+    Status = Directory->Read(Directory, &ReadSize, FileInfo);
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Directory read error: %r\n", Status);
+      ACPI_LOG1(DEBUG_ERROR, ACPI_LOG_MSG_DIR_READ_FAILED, Status);
+      break;
+    }
+
+    if (ReadSize == 0) {
+      AcpiDebugPrint(DEBUG_VERBOSE, L"End of directory reached\n");
+      break; // End of directory
+    }
+
+    AcpiDebugPrint(DEBUG_VERBOSE, L"Found directory entry: %s\n", FileInfo->FileName);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  File size: %llu bytes\n", FileInfo->FileSize);
+    AcpiDebugPrint(DEBUG_VERBOSE, L"  Attributes: 0x%llx\n", FileInfo->Attribute);
+
+    // Skip hidden files, subdirectories (profiles included), and non-AML files
+    if (StrnCmp(&FileInfo->FileName[0], L".", 1) == 0 ||
+        StrnCmp(&FileInfo->FileName[0], L"_", 1) == 0 ||
+        (FileInfo->Attribute & EFI_FILE_DIRECTORY) != 0 ||
+        StrStr(FileInfo->FileName, L".aml") == NULL) {
+      AcpiDebugPrint(DEBUG_VERBOSE, L"  Skipping file: %s\n", FileInfo->FileName);
+      List->Skipped++;
+      continue;
+    }
+
+    if (StrLen(FileInfo->FileName) >= ACPI_FILE_NAME_LENGTH) {
+      AcpiDebugPrint(DEBUG_WARN, L"File name too long, skipping %s\n", FileInfo->FileName);
+      List->Skipped++;
+      continue;
+    }
+
+    Entry = AcpiSourceAdd(List, FileInfo->FileName, FileInfo->FileSize, Directory, 0, 0, ProfileKey,
+                          &FileInfo->ModificationTime);
+    if (Entry == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+    Entry->Tier = (UINT8)Tier;
+  }
+
+  AcpiFreePool(FileInfo);
+  return Status;
+}
+
+/**
+  Checks that a bundle header has the layout this build reads.
+
+  @param[in] Header   Bundle header
+**/
+STATIC
+BOOLEAN
+AcpiSourceBundleValid (
+  IN CONST ACPI_PATCHER_BUNDLE_HEADER  *Header
+  )
+{
+  return (BOOLEAN)(Header->Signature == ACPI_PATCHER_BUNDLE_SIGNATURE &&
+                   Header->Version == ACPI_PATCHER_BUNDLE_VERSION &&
+                   Header->EntrySize == sizeof(ACPI_PATCHER_BUNDLE_ENTRY) &&
+                   Header->TableCount <= ACPI_SOURCE_MAX_BUNDLE_ENTRIES);
+}
+
+/**
+  Opens the bundle in Directory and reads its table directory.
+
+  @param[in]  Directory     ACPI folder
+  @param[out] Bundle        Open bundle file
+  @param[out] Entries       Pool-allocated bundle directory
+  @param[out] EntryCount    Number of entries
+
+  @retval EFI_SUCCESS       Bundle opened
+  @retval EFI_NOT_FOUND     No bundle in Directory
+  @retval EFI_UNSUPPORTED   Bundle is malformed or of another version
+  @retval Other             Read or allocation failed
+**/
+STATIC
+EFI_STATUS
+AcpiSourceOpenBundle (
+  IN  EFI_FILE_PROTOCOL          *Directory,
+  OUT EFI_FILE_PROTOCOL          **Bundle,
+  OUT ACPI_PATCHER_BUNDLE_ENTRY  **Entries,
+  OUT UINT32                     *EntryCount
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_FILE_PROTOCOL           *File;
+  ACPI_PATCHER_BUNDLE_HEADER  Header;
+  UINTN                       Size;
+
+  *Bundle     = NULL;
+  *Entries    = NULL;
+  *EntryCount = 0;
+
+  Status = FsOpenFile(Directory, ACPI_SOURCE_BUNDLE_NAME, &File);
+  if (EFI_ERROR(Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Size = sizeof(Header);
+  Status = File->Read(File, &Size, &Header);
+  if (!EFI_ERROR(Status) &&
+      (Size != sizeof(Header) || !AcpiSourceBundleValid(&Header))) {
+    Status = EFI_UNSUPPORTED;
+  }
+
+  if (!EFI_ERROR(Status) && Header.TableCount > 0) {
+    Size = Header.TableCount * sizeof(ACPI_PATCHER_BUNDLE_ENTRY);
+    Status = AcpiAllocatePool(EfiBootServicesData, Size, (VOID**)Entries);
+    if (!EFI_ERROR(Status)) {
+      Status = File->Read(File, &Size, *Entries);
+      if (!EFI_ERROR(Status) && Size != Header.TableCount * sizeof(ACPI_PATCHER_BUNDLE_ENTRY)) {
+        Status = EFI_UNSUPPORTED;
+      }
+      if (EFI_ERROR(Status)) {
+        AcpiFreePool(*Entries);
+        *Entries = NULL;
+      }
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    AcpiDebugPrint(DEBUG_WARN, L"Ignoring %s: %r\n", ACPI_SOURCE_BUNDLE_NAME, Status);
+    File->Close(File);
+    return Status;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Bundle %s lists %u tables\n", ACPI_SOURCE_BUNDLE_NAME, Header.TableCount);
+  *Bundle     = File;
+  *EntryCount = Header.TableCount;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the directory of the bundle linked into the image.
+
+  @param[out] EntryCount    Number of entries
+
+  @return Bundle directory, or NULL if the image carries no tables
+**/
+STATIC
+CONST ACPI_PATCHER_BUNDLE_ENTRY *
+AcpiSourceEmbeddedEntries (
+  OUT UINT32  *EntryCount
+  )
+{
+  CONST ACPI_PATCHER_BUNDLE_HEADER  *Header;
+
+  *EntryCount = 0;
+  if (gAcpiEmbeddedTablesSize < sizeof(ACPI_PATCHER_BUNDLE_HEADER)) {
+    return NULL;
+  }
+
+  // AcpiBundle.py writes a consistent bundle; the checks catch a stale generator
+  Header = (CONST ACPI_PATCHER_BUNDLE_HEADER *)gAcpiEmbeddedTables;
+  if (!AcpiSourceBundleValid(Header) || Header->TotalSize > gAcpiEmbeddedTablesSize ||
+      sizeof(*Header) + Header->TableCount * sizeof(ACPI_PATCHER_BUNDLE_ENTRY) > gAcpiEmbeddedTablesSize) {
+    AcpiDebugPrint(DEBUG_WARN, L"Ignoring malformed embedded tables\n");
+    return NULL;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Image carries %u embedded tables\n", Header->TableCount);
+  *EntryCount = Header->TableCount;
+  return (CONST ACPI_PATCHER_BUNDLE_ENTRY *)(Header + 1);
+}
+
+/**
+  Adds the bundle entries of one profile to the list.
+
+  @param[in,out] List         List to update
+  @param[in]     Entries      Bundle directory
+  @param[in]     EntryCount   Number of entries
+  @param[in]     ProfileKey   Profile to add
+  @param[in]     Image        Start of a bundle linked into the image, NULL for List->Bundle
+
+  @return Number of entries with ProfileKey, or 0 if List is NULL
+**/
+STATIC
+UINT32
+AcpiSourceAddBundle (
+  IN OUT ACPI_FILE_LIST                   *List,
+  IN     CONST ACPI_PATCHER_BUNDLE_ENTRY  *Entries,
+  IN     UINT32                           EntryCount,
+  IN     UINT32                           ProfileKey,
+  IN     CONST UINT8                      *Image  OPTIONAL
+  )
+{
+  ACPI_FILE_ENTRY  *Entry;
+  CHAR8            AsciiName[ACPI_PATCHER_BUNDLE_NAME_SIZE];
+  CHAR16           Name[ACPI_PATCHER_BUNDLE_NAME_SIZE];
+  UINT32           Index;
+  UINT32           Matched;
+
+  Matched = 0;
+  for (Index = 0; Index < EntryCount; Index++) {
+    if (Entries[Index].ProfileKey != ProfileKey || Entries[Index].Offset == 0) {
+      continue;
+    }
+    Matched++;
+    if (List == NULL) {
+      continue;
+    }
+
+    CopyMem(AsciiName, Entries[Index].Name, sizeof(AsciiName));
+    AsciiName[ACPI_PATCHER_BUNDLE_NAME_SIZE - 1] = '\0';
+    UnicodeSPrint(Name, sizeof(Name), L"%a", AsciiName);
+    Entry = AcpiSourceAdd(List, Name, Entries[Index].Length, (Image != NULL) ? NULL : List->Bundle,
+                          Entries[Index].Offset, Entries[Index].Crc32, ProfileKey, NULL);
+    if (Entry == NULL) {
+      break;
+    }
+    if (Image != NULL) {
+      Entry->Image = Image + Entries[Index].Offset;
+    }
+  }
+
+  return Matched;
+}
+
+/**
+  Adds the tables of the NVRAM store to the list.
+
+  @param[in,out] List   List to update
+**/
+STATIC
+VOID
+AcpiSourceAddNvStore (
+  IN OUT ACPI_FILE_LIST  *List
+  )
+{
+  ACPI_NV_INDEX_BUFFER   Index;
+  ACPI_PATCHER_NV_ENTRY  *Entry;
+  CHAR16                 Name[ACPI_PATCHER_NV_NAME_SIZE];
+  UINT32                 Slot;
+
+  if (EFI_ERROR(AcpiNvReadIndex(&Index))) {
+    return;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"NVRAM store lists %u tables\n", Index.Header.TableCount);
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_NV_LOADED, Index.Header.TableCount, Index.Header.Flags);
+  for (Slot = 0; Slot < Index.Header.TableCount; Slot++) {
+    Entry = &Index.Entries[Slot];
+    Entry->Name[ACPI_PATCHER_NV_NAME_SIZE - 1] = '\0';
+    UnicodeSPrint(Name, sizeof(Name), L"%a", Entry->Name);
+    if (AcpiSourceAdd(List, Name, Entry->Length, NULL, Slot, Entry->Crc32, ACPI_PROFILE_COMMON_KEY, NULL) == NULL) {
+      break;
+    }
+  }
+}
+
+EFI_STATUS
+AcpiSourceCollect (
+  IN  EFI_FILE_PROTOCOL            *Directory  OPTIONAL,
+  IN  CONST ACPI_PROFILE_IDENTITY  *Identity,
+  OUT ACPI_FILE_LIST               *List
+  )
+{
+  EFI_STATUS                       Status;
+  ACPI_PATCHER_BUNDLE_ENTRY        *BundleEntries;
+  UINT32                           BundleCount;
+  CONST ACPI_PATCHER_BUNDLE_ENTRY  *Embedded;
+  UINT32                           EmbeddedCount;
+  CONST UINT8                      *Image;
+  UINT32                           ProfileTables;
+  UINT32                           Key;
+  UINTN                            Index;
+  CHAR16                           DirName[ACPI_PROFILE_DIR_LENGTH];
+
+  ZeroMem(List, sizeof(*List));
+  Image         = (CONST UINT8 *)gAcpiEmbeddedTables;
+  Embedded      = AcpiSourceEmbeddedEntries(&EmbeddedCount);
+  BundleEntries = NULL;
+  BundleCount   = 0;
+  if (Directory != NULL) {
+    AcpiSourceOpenBundle(Directory, &List->Bundle, &BundleEntries, &BundleCount);
+  } else {
+    AcpiDebugPrint(DEBUG_INFO, L"Loading embedded and NVRAM tables only\n");
+  }
+
+  // The most specific key with a bundle section or subdirectory wins
+  for (Index = 0; Index < Identity->KeyCount; Index++) {
+    Key = Identity->Keys[Index];
+    if (Directory != NULL) {
+      UnicodeSPrint(DirName, sizeof(DirName), ACPI_PROFILE_DIR_FORMAT, Key);
+      if (EFI_ERROR(FsOpenFile(Directory, DirName, &List->ProfileDir))) {
+        List->ProfileDir = NULL;
+      }
+    }
+    if (List->ProfileDir != NULL ||
+        AcpiSourceAddBundle(NULL, BundleEntries, BundleCount, Key, NULL) > 0 ||
+        AcpiSourceAddBundle(NULL, Embedded, EmbeddedCount, Key, Image) > 0) {
+      List->ProfileKey = Key;
+      break;
+    }
+  }
+
+  if (List->ProfileKey != ACPI_PROFILE_COMMON_KEY) {
+    AcpiDebugPrint(DEBUG_INFO, L"Using platform profile " ACPI_PROFILE_DIR_FORMAT L"\n", List->ProfileKey);
+  } else {
+    AcpiDebugPrint(DEBUG_INFO, L"No platform profile for this machine, loading common tables only\n");
+  }
+
+  AcpiSourceAddBundle(List, Embedded, EmbeddedCount, ACPI_PROFILE_COMMON_KEY, Image);
+  if (List->ProfileKey != ACPI_PROFILE_COMMON_KEY) {
+    AcpiSourceAddBundle(List, Embedded, EmbeddedCount, List->ProfileKey, Image);
+  }
+  AcpiSourceAddNvStore(List);
+
+  AcpiSourceAddBundle(List, BundleEntries, BundleCount, ACPI_PROFILE_COMMON_KEY, NULL);
+  if (List->ProfileKey != ACPI_PROFILE_COMMON_KEY) {
+    AcpiSourceAddBundle(List, BundleEntries, BundleCount, List->ProfileKey, NULL);
+  }
+  if (BundleEntries != NULL) {
+    AcpiFreePool(BundleEntries);
+  }
+
+  Status = EFI_SUCCESS;
+  if (Directory != NULL) {
+    if (EFI_ERROR(FsOpenFile(Directory, ACPI_SOURCE_OPTIONAL_DIR, &List->OptionalDir))) {
+      List->OptionalDir = NULL;
+    } else {
+      Status = AcpiSourceAddDirectory(List, List->OptionalDir, ACPI_PROFILE_COMMON_KEY, AcpiTierOptional);
+    }
+    if (!EFI_ERROR(Status)) {
+      Status = AcpiSourceAddDirectory(List, Directory, ACPI_PROFILE_COMMON_KEY, AcpiTierRequired);
+    }
+  }
+  if (!EFI_ERROR(Status) && List->ProfileDir != NULL) {
+    Status = AcpiSourceAddDirectory(List, List->ProfileDir, List->ProfileKey, AcpiTierRequired);
+  }
+  if (EFI_ERROR(Status)) {
+    AcpiSourceRelease(List);
+    return Status;
+  }
+
+  ProfileTables = 0;
+  for (Index = 0; Index < List->Count; Index++) {
+    if (List->Entries[Index].ProfileKey != ACPI_PROFILE_COMMON_KEY) {
+      ProfileTables++;
+    }
+  }
+  ACPI_LOG2(DEBUG_INFO, ACPI_LOG_MSG_PROFILE, List->ProfileKey, ProfileTables);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads a table file with the selected strategy.
+
+  @param[in]  File      Open table file
+  @param[in]  Size      File size
+  @param[out] Buffer    File contents; freed by the caller
+**/
+STATIC
+EFI_STATUS
+AcpiSourceReadFile (
+  IN  EFI_FILE_PROTOCOL  *File,
+  IN  UINTN              Size,
+  OUT VOID               **Buffer
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Header;
+  UINTN                Offset;
+  UINTN                Length;
+
+  if (gOptions.ReadStrategy != AcpiReadHeaderFirst && gOptions.ReadStrategy != AcpiReadChunked &&
+      gOptions.ReadStrategy != AcpiReadAdaptive) {
+    return FsReadFileToBuffer(File, Size, Buffer);
+  }
+
+  Status = AcpiAllocatePool(EfiRuntimeServicesData, Size, Buffer);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  if (gOptions.ReadStrategy == AcpiReadAdaptive) {
+    Status = AcpiReadTuneRead(File, Size, *Buffer);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(*Buffer);
+    }
+    return Status;
+  }
+
+  Offset = 0;
+  if (gOptions.ReadStrategy == AcpiReadHeaderFirst && Size >= sizeof(EFI_ACPI_SDT_HEADER)) {
+    Length = sizeof(EFI_ACPI_SDT_HEADER);
+    Status = File->Read(File, &Length, *Buffer);
+    Header = *Buffer;
+    if (!EFI_ERROR(Status) &&
+        (Length != sizeof(EFI_ACPI_SDT_HEADER) || Header->Length < sizeof(EFI_ACPI_SDT_HEADER) || Header->Length > Size)) {
+      Status = EFI_LOAD_ERROR;
+    }
+    Offset = Length;
+  }
+
+  while (!EFI_ERROR(Status) && Offset < Size) {
+    Length = Size - Offset;
+    if (gOptions.ReadStrategy == AcpiReadChunked) {
+      Length = MIN(Length, ACPI_READ_CHUNK_SIZE);
+    }
+    Status = File->Read(File, &Length, (UINT8 *)*Buffer + Offset);
+    if (!EFI_ERROR(Status) && Length == 0) {
+      Status = EFI_END_OF_FILE;
+    }
+    Offset += Length;
+  }
+
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(*Buffer);
+  }
+  return Status;
+}
+
+EFI_STATUS
+AcpiSourceRead (
+  IN  ACPI_FILE_ENTRY  *Entry,
+  OUT VOID             **Buffer
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINT32             Crc32;
+
+  *Buffer = NULL;
+
+  if (Entry->Image != NULL) {
+    Status = EFI_LOAD_ERROR;
+    if (Entry->Offset + Entry->Size <= gAcpiEmbeddedTablesSize) {
+      Status = AcpiAllocatePool(EfiRuntimeServicesData, (UINTN)Entry->Size, Buffer);
+    }
+    if (!EFI_ERROR(Status)) {
+      CopyMem(*Buffer, Entry->Image, (UINTN)Entry->Size);
+    }
+  } else if (Entry->Source == NULL) {
+    Status = AcpiNvReadTable(Entry->Offset, (UINTN)Entry->Size, Entry->Crc32, Buffer);
+  } else if (Entry->Offset == 0) {
+    Status = FsOpenFile(Entry->Source, Entry->Name, &File);
+    if (EFI_ERROR(Status)) {
+      AcpiDebugPrint(DEBUG_ERROR, L"Failed to open file %s: %r\n", Entry->Name, Status);
+      ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_FILE_OPEN_FAILED, AcpiLogPackName(Entry->Name), Status);
+      return Status;
+    }
+    Status = AcpiSourceReadFile(File, (UINTN)Entry->Size, Buffer);
+    File->Close(File);
+  } else {
+    Status = Entry->Source->SetPosition(Entry->Source, Entry->Offset);
+    if (!EFI_ERROR(Status)) {
+      Status = FsReadFileToBuffer(Entry->Source, (UINTN)Entry->Size, Buffer);
+    }
+    if (!EFI_ERROR(Status)) {
+      gBS->CalculateCrc32(*Buffer, (UINTN)Entry->Size, &Crc32);
+      if (Crc32 != Entry->Crc32) {
+        AcpiFreePool(*Buffer);
+        Status = EFI_CRC_ERROR;
+      }
+    }
+  }
+
+  if (EFI_ERROR(Status)) {
+    *Buffer = NULL;
+    AcpiDebugPrint(DEBUG_ERROR, L"Failed to read file %s: %r\n", Entry->Name, Status);
+    ACPI_LOG2(DEBUG_ERROR, ACPI_LOG_MSG_FILE_READ_FAILED, AcpiLogPackName(Entry->Name), Status);
+  }
+
+  return Status;
+}
+
+VOID
+AcpiSourceRelease (
+  IN OUT ACPI_FILE_LIST  *List
+  )
+{
+  if (List->Entries != NULL) {
+    AcpiFreePool(List->Entries);
+  }
+  if (List->ProfileDir != NULL) {
+    List->ProfileDir->Close(List->ProfileDir);
+  }
+  if (List->OptionalDir != NULL) {
+    List->OptionalDir->Close(List->OptionalDir);
+  }
+  if (List->Bundle != NULL) {
+    List->Bundle->Close(List->Bundle);
+  }
+  ZeroMem(List, sizeof(*List));
+}
@@ -0,0 +1,142 @@
+/** @file
+
+  Table sources: tables linked into the image, the NVRAM table store, the
+  ACPI folder, its per-platform profile subdirectory and an optional table
+  bundle.
+
+**/
+
+#ifndef __ACPI_SOURCE_H__
+#define __ACPI_SOURCE_H__
+
+#include "ACPIPatcher.h"
+#include "AcpiProfile.h"
+
+#define ACPI_SOURCE_BUNDLE_NAME   L"TABLES.BND"
+#define ACPI_SOURCE_OPTIONAL_DIR  L"Optional"
+#define ACPI_READ_CHUNK_SIZE      SIZE_4KB
+
+//
+// How table files are read; bundle entries are always read whole
+//
+typedef enum {
+  AcpiReadWhole,            ///< One request for the whole file
+  AcpiReadHeaderFirst,      ///< Header first, so a bad table is rejected before reading the rest
+  AcpiReadChunked,          ///< ACPI_READ_CHUNK_SIZE requests
+  AcpiReadAdaptive,         ///< Transfer size tuned per volume (see AcpiReadTune.h)
+  AcpiReadStrategyMax
+} ACPI_READ_STRATEGY;
+
+#ifndef ACPI_PATCHER_READ_STRATEGY
+#define ACPI_PATCHER_READ_STRATEGY AcpiReadAdaptive  // Default for --strategy; DXE builds may set it with -D
+#endif
+
+extern CONST CHAR16  *gAcpiReadStrategyNames[AcpiReadStrategyMax];
+
+//
+// Load priority under --deadline; tables in ACPI\Optional are optional,
+// tables from every other source are required
+//
+typedef enum {
+  AcpiTierRequired,         ///< Always loaded
+  AcpiTierOptional,         ///< Deferred once the deadline would be missed
+  AcpiTierMax
+} ACPI_TABLE_TIER;
+
+//
+// Bundle linked into the image, from EmbeddedTables.c as written by
+// Tools/AcpiBundle.py embed. gAcpiEmbeddedOnly builds never open the ACPI
+// folder; the NVRAM store is still read.
+//
+extern CONST UINT64   gAcpiEmbeddedTables[];
+extern CONST UINTN    gAcpiEmbeddedTablesSize;
+extern CONST BOOLEAN  gAcpiEmbeddedOnly;
+
+//
+// Table selected for loading
+//
+typedef struct {
+  CHAR16             Name[ACPI_FILE_NAME_LENGTH];
+  UINT64             Size;
+  EFI_FILE_PROTOCOL  *Source;       ///< Directory holding Name, the open bundle, or NULL for the NVRAM store
+  UINT32             Offset;        ///< Table offset in the bundle, 0 for a plain file, slot in the NVRAM store
+  CONST UINT8        *Image;        ///< Table linked into the image, or NULL
+  UINT32             Crc32;         ///< Expected CRC32 of a bundle or NVRAM entry
+  UINT32             ProfileKey;    ///< ACPI_PROFILE_COMMON_KEY or the profile it came from
+  EFI_TIME           ModificationTime;  ///< Zero for bundle entries
+  UINT64             Installed;     ///< Table holding this file: kept from an earlier run, or planned in this one
+  UINT64             Superseded;    ///< Table of an earlier version of this file, to be replaced
+  UINT32             QueueIndex;    ///< Order the table was queued in the plan, MAX_UINT32 if not queued
+  BOOLEAN            Verified;      ///< Table matched its Manifest.sha256 digest
+  UINT8              Tier;          ///< ACPI_TABLE_TIER
+} ACPI_FILE_ENTRY;
+
+typedef struct {
+  ACPI_FILE_ENTRY    *Entries;
+  UINTN              Count;
+  UINTN              Capacity;
+  UINT32             Skipped;       ///< Directory entries ignored
+  UINT32             ProfileKey;    ///< Selected profile, ACPI_PROFILE_COMMON_KEY if none matched
+  EFI_FILE_PROTOCOL  *ProfileDir;   ///< Open profile subdirectory, or NULL
+  EFI_FILE_PROTOCOL  *OptionalDir;  ///< Open Optional subdirectory, or NULL
+  EFI_FILE_PROTOCOL  *Bundle;       ///< Open bundle file, or NULL
+} ACPI_FILE_LIST;
+
+/**
+  Collects the tables to load for this platform.
+
+  The first key of Identity that names a bundle section or a P-XXXXXXXX
+  subdirectory selects the profile; no other profile is opened or read.
+  Tables are gathered from, in increasing precedence: common and profile
+  tables linked into the image, the NVRAM table store, common bundle
+  entries, profile bundle entries, .aml files in Directory\Optional, .aml
+  files in Directory and .aml files in the profile subdirectory. A later source replaces an earlier table
+  with the same file name in place, keeping its load position. Without
+  Directory only the image and the NVRAM store are read.
+
+  @param[in]  Directory   ACPI folder, or NULL to skip the file system
+  @param[in]  Identity    Platform identity and candidate keys
+  @param[out] List        Selected tables; release with AcpiSourceRelease
+
+  @retval EFI_SUCCESS             Tables collected
+  @retval EFI_OUT_OF_RESOURCES    Memory allocation failed
+  @retval Other                   Directory read failed
+**/
+EFI_STATUS
+AcpiSourceCollect (
+  IN  EFI_FILE_PROTOCOL            *Directory  OPTIONAL,
+  IN  CONST ACPI_PROFILE_IDENTITY  *Identity,
+  OUT ACPI_FILE_LIST               *List
+  );
+
+/**
+  Reads a collected table into a pool buffer, using gOptions.ReadStrategy
+  for plain files. Tables linked into the image are copied, as the image
+  does not outlive the application or, for the driver, boot services.
+
+  @param[in]  Entry     Table to read
+  @param[out] Buffer    Table data; freed by the caller
+
+  @retval EFI_SUCCESS     Table read
+  @retval EFI_CRC_ERROR   Bundle or NVRAM entry does not match its CRC32
+  @retval EFI_LOAD_ERROR  Header-first read found a header that does not fit the file
+  @retval Other           Open or read failed
+**/
+EFI_STATUS
+AcpiSourceRead (
+  IN  ACPI_FILE_ENTRY  *Entry,
+  OUT VOID             **Buffer
+  );
+
+/**
+  Frees the list and closes the profile and optional directories and the
+  bundle.
+
+  @param[in,out] List   List filled by AcpiSourceCollect
+**/
+VOID
+AcpiSourceRelease (
+  IN OUT ACPI_FILE_LIST  *List
+  );
+
+#endif // __ACPI_SOURCE_H__
@@ -0,0 +1,436 @@
+/** @file
+
+  Record of the tables installed by earlier runs in this boot.
+
+  The record is published as a UEFI configuration table in
+  EfiBootServicesData: table addresses are only meaningful until the OS
+  takes over, so nothing needs to outlive ExitBootServices ().
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "AcpiState.h"
+#include "AcpiLog.h"
+#include "AcpiMemory.h"
+
+STATIC ACPI_PATCHER_STATE_HEADER  *mState       = NULL;
+STATIC BOOLEAN                    mReusable[ACPI_PATCHER_STATE_ENTRIES];
+STATIC BOOLEAN                    mDsdtStale    = FALSE;
+STATIC UINT64                     mFirmwareDsdt = 0;
+STATIC UINT64                     mXsdtBefore   = 0;
+
+/**
+  Checks that a record found in the configuration table has the layout this
+  build expects.
+
+  @param[in] State   Candidate record
+
+  @retval TRUE      Record can be used
+  @retval FALSE     Record is from an incompatible build or corrupted
+**/
+STATIC
+BOOLEAN
+AcpiStateIsCompatible (
+  IN ACPI_PATCHER_STATE_HEADER  *State
+  )
+{
+  return (BOOLEAN)(State->Signature == ACPI_PATCHER_STATE_SIGNATURE &&
+                   State->Version == ACPI_PATCHER_STATE_VERSION &&
+                   State->EntrySize == sizeof(ACPI_PATCHER_STATE_ENTRY) &&
+                   State->EntryCapacity == ACPI_PATCHER_STATE_ENTRIES &&
+                   State->EntryCount <= State->EntryCapacity);
+}
+
+/**
+  Returns TRUE if the file is loaded as the DSDT.
+**/
+STATIC
+BOOLEAN
+AcpiStateIsDsdtFile (
+  IN CONST CHAR16  *Name
+  )
+{
+  return (BOOLEAN)(StrnCmp(Name, DSDT_FILE_NAME, 8) == 0);
+}
+
+/**
+  Returns the address of the DSDT the FADT currently points at.
+**/
+STATIC
+UINT64
+AcpiStateCurrentDsdt (
+  VOID
+  )
+{
+  if (gFacp->Header.Length >= OFFSET_OF(EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE, XDsdt) + sizeof(UINT64) &&
+      gFacp->XDsdt != 0) {
+    return gFacp->XDsdt;
+  }
+
+  return gFacp->Dsdt;
+}
+
+/**
+  Returns TRUE if a recorded table is still installed where the record says.
+  A table someone else has since replaced or removed is left alone.
+
+  @param[in] Entry   Recorded file
+**/
+STATIC
+BOOLEAN
+AcpiStateIsInstalled (
+  IN CONST ACPI_PATCHER_STATE_ENTRY  *Entry
+  )
+{
+  UINT64  *Entries;
+  UINT32  Count;
+  UINT32  Index;
+
+  if (Entry->Address == 0) {
+    return FALSE;
+  }
+
+  if ((Entry->Flags & ACPI_PATCHER_STATE_DSDT) != 0) {
+    return (BOOLEAN)(AcpiStateCurrentDsdt() == Entry->Address);
+  }
+
+  Count   = AcpiXsdtEntryCount();
+  Entries = (UINT64 *)(gXsdt + 1);
+  for (Index = 0; Index < Count; Index++) {
+    if (ReadUnaligned64(&Entries[Index]) == Entry->Address) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Returns TRUE if a collected file is the one the record describes.
+
+  @param[in] Entry   Recorded file
+  @param[in] File    Collected file with the same name
+**/
+STATIC
+BOOLEAN
+AcpiStateMatches (
+  IN CONST ACPI_PATCHER_STATE_ENTRY  *Entry,
+  IN CONST ACPI_FILE_ENTRY           *File
+  )
+{
+  return (BOOLEAN)(Entry->Size == File->Size &&
+                   Entry->Crc32 == File->Crc32 &&
+                   Entry->ProfileKey == File->ProfileKey &&
+                   CompareMem(&Entry->ModificationTime, &File->ModificationTime, sizeof(EFI_TIME)) == 0);
+}
+
+/**
+  Finds the recorded file of the given name.
+
+  @return Index into the record, or ACPI_PATCHER_STATE_ENTRIES if not recorded
+**/
+STATIC
+UINT32
+AcpiStateFind (
+  IN CONST CHAR16  *Name
+  )
+{
+  ACPI_PATCHER_STATE_ENTRY  *Entries;
+  UINT32                    Index;
+
+  Entries = (ACPI_PATCHER_STATE_ENTRY *)(mState + 1);
+  for (Index = 0; Index < mState->EntryCount; Index++) {
+    if (StrnCmp(Entries[Index].Name, Name, ACPI_PATCHER_STATE_NAME_LENGTH) == 0) {
+      return Index;
+    }
+  }
+
+  return ACPI_PATCHER_STATE_ENTRIES;
+}
+
+/**
+  Takes an address off the plan's removal list.
+
+  @retval TRUE    Address was listed and is now removed from the list
+  @retval FALSE   Address was not listed
+**/
+STATIC
+BOOLEAN
+AcpiStateTakeRemoved (
+  IN OUT ACPI_TABLE_PLAN  *Plan,
+  IN     UINT64           Address
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < Plan->RemovedCount; Index++) {
+    if (Plan->Removed[Index] == Address) {
+      Plan->Removed[Index] = Plan->Removed[--Plan->RemovedCount];
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+EFI_STATUS
+AcpiStatePrepare (
+  IN OUT ACPI_FILE_LIST      *Files,
+  IN OUT ACPI_TABLE_PLAN     *Plan,
+  OUT    ACPI_STATE_SUMMARY  *Summary
+  )
+{
+  EFI_STATUS                 Status;
+  ACPI_PATCHER_STATE_HEADER  *State;
+  ACPI_PATCHER_STATE_ENTRY   *Entries;
+  BOOLEAN                    Present[ACPI_PATCHER_STATE_ENTRIES];
+  ACPI_FILE_ENTRY            *File;
+  UINTN                      FileIndex;
+  UINT32                     Index;
+  UINT32                     Other;
+  BOOLEAN                    Seen;
+
+  ZeroMem(Summary, sizeof(*Summary));
+  for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+    Files->Entries[FileIndex].Installed  = 0;
+    Files->Entries[FileIndex].Superseded = 0;
+  }
+
+  mState        = NULL;
+  mDsdtStale    = FALSE;
+  mXsdtBefore   = (UINT64)(UINTN)gXsdt;
+  mFirmwareDsdt = AcpiStateCurrentDsdt();
+
+  State  = NULL;
+  Status = EfiGetSystemConfigurationTable(&gAcpiPatcherStateTableGuid, (VOID **)&State);
+  if (EFI_ERROR(Status) || State == NULL || !AcpiStateIsCompatible(State)) {
+    return EFI_NOT_FOUND;
+  }
+
+  mState  = State;
+  Entries = (ACPI_PATCHER_STATE_ENTRY *)(State + 1);
+  if (State->FirmwareDsdt != 0) {
+    mFirmwareDsdt = State->FirmwareDsdt;
+  }
+  Plan->ReleaseXsdt = (BOOLEAN)(State->Xsdt != 0 && State->Xsdt == (UINT64)(UINTN)gXsdt);
+
+  // A recorded table is reusable when it is still installed and its file is unchanged
+  for (Index = 0; Index < State->EntryCount; Index++) {
+    Entries[Index].Name[ACPI_PATCHER_STATE_NAME_LENGTH - 1] = L'\0';
+    Present[Index]   = AcpiStateIsInstalled(&Entries[Index]);
+    mReusable[Index] = FALSE;
+    if (!Present[Index] || gOptions.ReloadAll) {
+      continue;
+    }
+    for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+      File = &Files->Entries[FileIndex];
+      if (StrCmp(File->Name, Entries[Index].Name) == 0) {
+        // Under a closed digest policy only tables that passed the check are kept
+        mReusable[Index] = (BOOLEAN)(AcpiStateMatches(&Entries[Index], File) &&
+                                     (gOptions.Verify != ACPI_VERIFY_CLOSED ||
+                                      (Entries[Index].Flags & ACPI_PATCHER_STATE_VERIFIED) != 0));
+        break;
+      }
+    }
+  }
+
+  // Files merged into one SSDT are kept or reloaded together
+  for (Index = 0; Index < State->EntryCount; Index++) {
+    if (mReusable[Index]) {
+      continue;
+    }
+    for (Other = 0; Other < State->EntryCount; Other++) {
+      if (Entries[Other].Address == Entries[Index].Address) {
+        mReusable[Other] = FALSE;
+      }
+    }
+  }
+
+  for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+    File  = &Files->Entries[FileIndex];
+    Index = AcpiStateFind(File->Name);
+    if (Index == ACPI_PATCHER_STATE_ENTRIES || !Present[Index]) {
+      continue;
+    }
+    if (mReusable[Index]) {
+      File->Installed = Entries[Index].Address;
+      File->Verified  = (BOOLEAN)((Entries[Index].Flags & ACPI_PATCHER_STATE_VERIFIED) != 0);
+      Summary->Kept++;
+    } else {
+      File->Superseded = Entries[Index].Address;
+    }
+  }
+
+  // Count each installed table once; stale ones are removed unless a new table takes their place
+  for (Index = 0; Index < State->EntryCount; Index++) {
+    if (!Present[Index]) {
+      continue;
+    }
+
+    Seen = FALSE;
+    for (Other = 0; Other < Index && !Seen; Other++) {
+      Seen = (BOOLEAN)(Present[Other] && Entries[Other].Address == Entries[Index].Address);
+    }
+    if (Seen) {
+      continue;
+    }
+
+    if (mReusable[Index]) {
+      if ((Entries[Index].Flags & ACPI_PATCHER_STATE_DSDT) == 0) {
+        Summary->KeptTables++;
+      }
+      continue;
+    }
+
+    if (Plan->RemovedCount == ACPI_PLAN_MAX_REMOVED) {
+      AcpiDebugPrint(DEBUG_WARN, L"Too many stale tables, leaving %s installed\n", Entries[Index].Name);
+      continue;
+    }
+
+    Plan->Removed[Plan->RemovedCount++] = Entries[Index].Address;
+    if ((Entries[Index].Flags & ACPI_PATCHER_STATE_DSDT) != 0) {
+      mDsdtStale = TRUE;
+    } else {
+      Summary->StaleTables++;
+    }
+  }
+
+  // Kept tables still occupy additional XSDT entries
+  Plan->MaxTables -= MIN(Summary->KeptTables, Plan->MaxTables);
+
+  ACPI_LOG3(DEBUG_INFO, ACPI_LOG_MSG_STATE_REUSED, Summary->Kept, Summary->KeptTables, Summary->StaleTables);
+  return EFI_SUCCESS;
+}
+
+VOID
+AcpiStateAssign (
+  IN OUT ACPI_FILE_LIST   *Files,
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  )
+{
+  ACPI_FILE_ENTRY  *File;
+  UINTN            FileIndex;
+  UINT32           Table;
+  UINT32           First;
+
+  // Consolidation keeps queue order, so table Table holds the next Spans[Table] queued files
+  First = 0;
+  for (Table = 0; Table < Plan->TableCount; Table++) {
+    for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+      File = &Files->Entries[FileIndex];
+      if (File->QueueIndex < First || File->QueueIndex - First >= Plan->Spans[Table]) {
+        continue;
+      }
+
+      File->Installed = (UINT64)(UINTN)Plan->Tables[Table];
+      if (Plan->Replaces[Table] == 0 && File->Superseded != 0 && AcpiStateTakeRemoved(Plan, File->Superseded)) {
+        Plan->Replaces[Table] = File->Superseded;
+      }
+    }
+    First += Plan->Spans[Table];
+  }
+
+  for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+    File = &Files->Entries[FileIndex];
+    if (Plan->Dsdt != NULL && File->Installed == 0 && AcpiStateIsDsdtFile(File->Name)) {
+      File->Installed = (UINT64)(UINTN)Plan->Dsdt;
+    }
+  }
+
+  // Our DSDT is going away without a successor
+  if (mDsdtStale && Plan->Dsdt == NULL && mState != NULL && mState->FirmwareDsdt != 0) {
+    Plan->RestoreDsdt = mState->FirmwareDsdt;
+  }
+}
+
+UINT64
+AcpiStateFirmwareDsdt (
+  VOID
+  )
+{
+  return mFirmwareDsdt;
+}
+
+EFI_STATUS
+AcpiStateSave (
+  IN ACPI_FILE_LIST  *Files
+  )
+{
+  EFI_STATUS                 Status;
+  ACPI_PATCHER_STATE_HEADER  *State;
+  ACPI_PATCHER_STATE_ENTRY   *Entry;
+  ACPI_FILE_ENTRY            *File;
+  UINTN                      FileIndex;
+  UINT32                     Count;
+  BOOLEAN                    HasDsdt;
+
+  State = mState;
+  if (State == NULL) {
+    Status = AcpiAllocatePool(EfiBootServicesData,
+                              sizeof(ACPI_PATCHER_STATE_HEADER) + ACPI_PATCHER_STATE_ENTRIES * sizeof(ACPI_PATCHER_STATE_ENTRY),
+                              (VOID **)&State);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    ZeroMem(State, sizeof(ACPI_PATCHER_STATE_HEADER));
+    State->Signature     = ACPI_PATCHER_STATE_SIGNATURE;
+    State->Version       = ACPI_PATCHER_STATE_VERSION;
+    State->EntrySize     = sizeof(ACPI_PATCHER_STATE_ENTRY);
+    State->EntryCapacity = ACPI_PATCHER_STATE_ENTRIES;
+
+    Status = gBS->InstallConfigurationTable(&gAcpiPatcherStateTableGuid, State);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(State);
+      return Status;
+    }
+    mState = State;
+  }
+
+  Count   = 0;
+  HasDsdt = FALSE;
+  for (FileIndex = 0; FileIndex < Files->Count; FileIndex++) {
+    File = &Files->Entries[FileIndex];
+    if (File->Installed == 0) {
+      continue;
+    }
+    if (Count == ACPI_PATCHER_STATE_ENTRIES) {
+      AcpiDebugPrint(DEBUG_WARN, L"Installed table record is full, the next run reloads %s and later files\n",
+                     File->Name);
+      break;
+    }
+
+    Entry = (ACPI_PATCHER_STATE_ENTRY *)(State + 1) + Count++;
+    ZeroMem(Entry, sizeof(*Entry));
+    StrCpyS(Entry->Name, ACPI_PATCHER_STATE_NAME_LENGTH, File->Name);
+    Entry->Size       = File->Size;
+    Entry->Crc32      = File->Crc32;
+    Entry->ProfileKey = File->ProfileKey;
+    Entry->Address    = File->Installed;
+    CopyMem(&Entry->ModificationTime, &File->ModificationTime, sizeof(EFI_TIME));
+    if (AcpiStateIsDsdtFile(File->Name)) {
+      Entry->Flags |= ACPI_PATCHER_STATE_DSDT;
+      HasDsdt       = TRUE;
+    }
+    if (File->Verified) {
+      Entry->Flags |= ACPI_PATCHER_STATE_VERIFIED;
+    }
+  }
+
+  // The XSDT is ours if this run rebuilt it or an earlier run did and nobody replaced it since
+  if ((UINT64)(UINTN)gXsdt != mXsdtBefore) {
+    State->Xsdt = (UINT64)(UINTN)gXsdt;
+  } else if (State->Xsdt != (UINT64)(UINTN)gXsdt) {
+    State->Xsdt = 0;
+  }
+  State->FirmwareDsdt = HasDsdt ? mFirmwareDsdt : 0;
+  State->EntryCount   = Count;
+  State->RunCount++;
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"Recorded %u installed files for the next run\n", Count);
+  return EFI_SUCCESS;
+}
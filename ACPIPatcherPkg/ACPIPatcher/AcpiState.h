@@ -0,0 +1,92 @@
+/** @file
+
+  Record of the tables installed by earlier runs in this boot.
+
+  Running the patcher again, for example after editing one SSDT, reuses the
+  tables of unchanged files, replaces those of modified files in place in
+  the XSDT and removes those of deleted files. A file is unchanged when its
+  name, size, modification time, profile and bundle CRC32 all match the
+  record and its table is still installed.
+
+**/
+
+#ifndef __ACPI_STATE_H__
+#define __ACPI_STATE_H__
+
+#include <Guid/AcpiPatcherState.h>
+
+#include "AcpiInstall.h"
+#include "AcpiSource.h"
+
+//
+// What AcpiStatePrepare found
+//
+typedef struct {
+  UINT32  Kept;           ///< Files whose installed table is reused
+  UINT32  KeptTables;     ///< Distinct XSDT entries those files occupy
+  UINT32  StaleTables;    ///< XSDT entries to be replaced or removed
+} ACPI_STATE_SUMMARY;
+
+/**
+  Matches the collected files against the record of an earlier run.
+
+  Unchanged files get their table in Installed and need not be read; with
+  gOptions.ReloadAll no file is treated as unchanged, and under the closed
+  digest policy only files verified when installed are. Tables of changed or
+  deleted files go to the plan's removal list, and files merged into one
+  SSDT are reused or superseded together. Reused tables count against the
+  plan's append limit.
+
+  @param[in,out] Files     Collected files
+  @param[in,out] Plan      Freshly initialized plan
+  @param[out]    Summary   Reuse counts
+
+  @retval EFI_SUCCESS     Files matched
+  @retval EFI_NOT_FOUND   No usable record; every file is read and appended
+**/
+EFI_STATUS
+AcpiStatePrepare (
+  IN OUT ACPI_FILE_LIST      *Files,
+  IN OUT ACPI_TABLE_PLAN     *Plan,
+  OUT    ACPI_STATE_SUMMARY  *Summary
+  );
+
+/**
+  Links the final plan back to the files it was built from: records each
+  planned table in Installed, moves it into the XSDT entry of the table it
+  supersedes, and restores the firmware DSDT when the replacement is gone.
+  Call once the plan will not change any more, before committing it.
+
+  @param[in,out] Files   Files matched by AcpiStatePrepare
+  @param[in,out] Plan    Final plan
+**/
+VOID
+AcpiStateAssign (
+  IN OUT ACPI_FILE_LIST   *Files,
+  IN OUT ACPI_TABLE_PLAN  *Plan
+  );
+
+/**
+  Returns the DSDT the firmware installed, looking through a replacement
+  installed by an earlier run. Valid after AcpiStatePrepare ().
+**/
+UINT64
+AcpiStateFirmwareDsdt (
+  VOID
+  );
+
+/**
+  Publishes the record of the installed tables for the next run. Call
+  after a successful commit.
+
+  @param[in] Files   Files linked by AcpiStateAssign
+
+  @retval EFI_SUCCESS   Record published
+  @retval Other         Allocation or configuration table install failed
+**/
+EFI_STATUS
+AcpiStateSave (
+  IN ACPI_FILE_LIST  *Files
+  );
+
+#endif // __ACPI_STATE_H__
@@ -0,0 +1,14 @@
+/** @file
+
+  Tables linked into the ACPIPatcher image.
+
+  Tools/AcpiBundle.py embed replaces this file with one carrying an ACPI
+  folder or bundle; this copy embeds no tables.
+
+**/
+
+#include "AcpiSource.h"
+
+CONST BOOLEAN  gAcpiEmbeddedOnly       = FALSE;
+CONST UINTN    gAcpiEmbeddedTablesSize = 0;
+CONST UINT64   gAcpiEmbeddedTables[]   = { 0 };
@@ -0,0 +1,1391 @@
+/** @file
+
+  Read-only FAT12/16/32 reader working directly on the disk of a volume.
+
+  The whole FAT is cached when the volume is mounted, so following a cluster
+  chain never touches the disk. Directories are loaded in one piece when
+  opened, and file reads merge every run of consecutive clusters into one
+  transfer. Only what the patcher needs is implemented: opening by path,
+  listing directories, reading files and their EFI_FILE_INFO.
+
+**/
+
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include <Guid/FileInfo.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiMemory.h"
+#include "FatReader.h"
+
+#define FAT_VOLUME_SIGNATURE    SIGNATURE_32('f','a','t','v')
+#define FAT_FILE_SIGNATURE      SIGNATURE_32('f','a','t','f')
+
+#define FAT_BOOT_SECTOR_SIZE    512
+#define FAT_BOOT_SIGNATURE      0xAA55
+#define FAT_DIR_ENTRY_SIZE      32
+#define FAT_ROOT_CLUSTER        0       // Directory cluster value meaning the root directory
+#define FAT12_MAX_CLUSTERS      4084
+#define FAT16_MAX_CLUSTERS      65524
+#define FAT32_CLUSTER_MASK      0x0FFFFFFF
+
+#define FAT_ATTR_VOLUME_ID      0x08
+#define FAT_ATTR_DIRECTORY      0x10
+#define FAT_ATTR_LFN            0x0F
+#define FAT_ATTR_LFN_MASK       0x3F
+
+#define FAT_ENTRY_END           0x00
+#define FAT_ENTRY_DELETED       0xE5
+#define FAT_ENTRY_KANJI_E5      0x05    // First name byte stored for a real 0xE5
+
+#define FAT_CASE_LOWER_BASE     0x08
+#define FAT_CASE_LOWER_EXT      0x10
+
+#define FAT_LFN_LAST            0x40
+#define FAT_LFN_ORDER_MASK      0x1F
+#define FAT_LFN_CHARS           13
+#define FAT_LFN_MAX_ENTRIES     20
+#define FAT_NAME_LENGTH         (FAT_LFN_MAX_ENTRIES * FAT_LFN_CHARS + 1)
+
+#define FAT32_MIRROR_DISABLED   0x80
+#define FAT32_ACTIVE_FAT_MASK   0x0F
+
+#pragma pack(1)
+typedef struct {
+  UINT8   Jump[3];
+  CHAR8   OemName[8];
+  UINT16  BytesPerSector;
+  UINT8   SectorsPerCluster;
+  UINT16  ReservedSectors;
+  UINT8   NumberOfFats;
+  UINT16  RootEntries;
+  UINT16  Sectors16;
+  UINT8   Media;
+  UINT16  FatSize16;
+  UINT16  SectorsPerTrack;
+  UINT16  Heads;
+  UINT32  HiddenSectors;
+  UINT32  Sectors32;
+  UINT32  FatSize32;          ///< FAT32 only from here on
+  UINT16  ExtendedFlags;
+  UINT16  Version;
+  UINT32  RootCluster;
+} FAT_BOOT_SECTOR;
+
+typedef struct {
+  UINT8   Name[11];
+  UINT8   Attributes;
+  UINT8   CaseFlags;
+  UINT8   CreateTenths;
+  UINT16  CreateTime;
+  UINT16  CreateDate;
+  UINT16  AccessDate;
+  UINT16  ClusterHigh;
+  UINT16  ModifyTime;
+  UINT16  ModifyDate;
+  UINT16  ClusterLow;
+  UINT32  Size;
+} FAT_DIR_ENTRY;
+
+typedef struct {
+  UINT8   Order;
+  UINT16  Name1[5];
+  UINT8   Attributes;
+  UINT8   Type;
+  UINT8   Checksum;
+  UINT16  Name2[6];
+  UINT16  Cluster;
+  UINT16  Name3[2];
+} FAT_LFN_ENTRY;
+#pragma pack()
+
+typedef struct {
+  UINT32                 Signature;
+  UINTN                  OpenHandles;
+  EFI_DISK_IO_PROTOCOL   *DiskIo;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  UINT32                 MediaId;
+  UINT32                 BlockSize;
+  UINT32                 IoAlign;
+  UINT8                  *BounceBuffer;     ///< Allocation behind Bounce
+  UINT8                  *Bounce;           ///< IoAlign-aligned staging area for BlockIo
+  UINTN                  BounceSize;
+  UINT8                  FatBits;           ///< 12, 16 or 32
+  UINT32                 ClusterSize;
+  UINT32                 ClusterCount;      ///< Data clusters; valid numbers are 2 .. ClusterCount + 1
+  UINT64                 RootOffset;        ///< FAT12/16 fixed root directory
+  UINT32                 RootSize;
+  UINT32                 RootCluster;       ///< FAT32 root directory
+  UINT64                 DataOffset;        ///< Byte offset of cluster 2
+  UINT8                  *Fat;
+  UINT32                 FatSize;
+  FAT_READ_STATS         Stats;
+} FAT_VOLUME;
+
+typedef struct {
+  UINT32             Signature;
+  EFI_FILE_PROTOCOL  Protocol;
+  FAT_VOLUME         *Volume;
+  BOOLEAN            IsDirectory;
+  UINT32             Cluster;           ///< First cluster; FAT_ROOT_CLUSTER for the root, 0 for an empty file
+  UINT32             Parent;            ///< Directory holding a file, used for relative opens
+  FAT_DIR_ENTRY      Entry;             ///< Directory entry, zeroed for the root
+  CHAR16             Name[FAT_NAME_LENGTH];
+  UINT64             Position;          ///< File offset, or offset of the next entry in DirData
+  UINT8              *DirData;          ///< Whole directory, loaded on open
+  UINT32             DirSize;
+  UINT32             CursorCluster;     ///< Cluster number CursorIndex of the chain, 0 if unset
+  UINT32             CursorIndex;
+} FAT_FILE;
+
+#define FAT_FILE_FROM_PROTOCOL(a)   CR(a, FAT_FILE, Protocol, FAT_FILE_SIGNATURE)
+#define FAT_IS_ROOT(File)           ((File)->IsDirectory && (File)->Cluster == FAT_ROOT_CLUSTER)
+
+/**
+  Reads bytes from the volume with a single DiskIo call, or with as few
+  BlockIo calls as alignment allows.
+
+  @param[in]  Volume    Mounted volume
+  @param[in]  Offset    Byte offset on the volume
+  @param[in]  Size      Bytes to read
+  @param[out] Buffer    Destination
+**/
+STATIC
+EFI_STATUS
+FatReadVolume (
+  IN  FAT_VOLUME  *Volume,
+  IN  UINT64      Offset,
+  IN  UINTN       Size,
+  OUT VOID        *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Destination;
+  EFI_LBA     Lba;
+  UINT32      Skip;
+  UINTN       Length;
+  UINTN       Copied;
+
+  Volume->Stats.Bytes += Size;
+
+  if (Volume->DiskIo != NULL) {
+    Volume->Stats.Transfers++;
+    return Volume->DiskIo->ReadDisk(Volume->DiskIo, Volume->MediaId, Offset, Size, Buffer);
+  }
+
+  Destination = Buffer;
+  while (Size > 0) {
+    Lba = DivU64x32Remainder(Offset, Volume->BlockSize, &Skip);
+    if (Skip == 0 && Size >= Volume->BlockSize &&
+        (Volume->IoAlign <= 1 || ((UINTN)Destination & (Volume->IoAlign - 1)) == 0)) {
+      // Whole blocks straight into the caller's buffer
+      Length = Size - (Size % Volume->BlockSize);
+      Status = Volume->BlockIo->ReadBlocks(Volume->BlockIo, Volume->MediaId, Lba, Length, Destination);
+      Copied = Length;
+    } else {
+      Length = MIN(ALIGN_VALUE(Skip + Size, Volume->BlockSize), Volume->BounceSize);
+      Status = Volume->BlockIo->ReadBlocks(Volume->BlockIo, Volume->MediaId, Lba, Length, Volume->Bounce);
+      Copied = MIN(Length - Skip, Size);
+      CopyMem(Destination, Volume->Bounce + Skip, Copied);
+    }
+    Volume->Stats.Transfers++;
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    Offset      += Copied;
+    Destination += Copied;
+    Size        -= Copied;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns TRUE if Cluster is a data cluster of the volume.
+**/
+STATIC
+BOOLEAN
+FatIsDataCluster (
+  IN FAT_VOLUME  *Volume,
+  IN UINT32      Cluster
+  )
+{
+  return (BOOLEAN)(Cluster >= 2 && Cluster <= Volume->ClusterCount + 1);
+}
+
+/**
+  Returns the FAT entry of a data cluster from the cached FAT.
+**/
+STATIC
+UINT32
+FatNextCluster (
+  IN FAT_VOLUME  *Volume,
+  IN UINT32      Cluster
+  )
+{
+  UINT32  Value;
+
+  switch (Volume->FatBits) {
+    case 12:
+      Value = ReadUnaligned16((UINT16 *)(Volume->Fat + Cluster + Cluster / 2));
+      return (Cluster & 1) ? (Value >> 4) : (Value & 0xFFF);
+    case 16:
+      return ReadUnaligned16((UINT16 *)(Volume->Fat + Cluster * 2));
+    default:
+      return ReadUnaligned32((UINT32 *)(Volume->Fat + Cluster * 4)) & FAT32_CLUSTER_MASK;
+  }
+}
+
+/**
+  Reads a byte range of a cluster chain, one transfer per run of
+  consecutive clusters.
+
+  @param[in]     Volume     Mounted volume
+  @param[in,out] Cluster    In: cluster holding the first byte. Out: cluster holding the last byte
+  @param[in]     Offset     Offset of the first byte within *Cluster
+  @param[in]     Size       Bytes to read; must be non-zero
+  @param[out]    Buffer     Destination
+  @param[out]    Advanced   Number of clusters moved along the chain
+
+  @retval EFI_VOLUME_CORRUPTED    The chain ends before Size bytes
+**/
+STATIC
+EFI_STATUS
+FatReadChain (
+  IN     FAT_VOLUME  *Volume,
+  IN OUT UINT32      *Cluster,
+  IN     UINT32      Offset,
+  IN     UINTN       Size,
+  OUT    UINT8       *Buffer,
+  OUT    UINT32      *Advanced
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Current;
+  UINT32      RunStart;
+  UINT32      Next;
+  UINTN       RunBytes;
+  UINTN       Chunk;
+
+  Current   = *Cluster;
+  *Advanced = 0;
+
+  while (TRUE) {
+    if (!FatIsDataCluster(Volume, Current)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    RunStart = Current;
+    RunBytes = Volume->ClusterSize - Offset;
+    while (RunBytes < Size) {
+      Next = FatNextCluster(Volume, Current);
+      if (Next != Current + 1 || !FatIsDataCluster(Volume, Next)) {
+        break;
+      }
+      Current = Next;
+      (*Advanced)++;
+      RunBytes += Volume->ClusterSize;
+    }
+
+    Chunk  = MIN(RunBytes, Size);
+    Status = FatReadVolume(Volume,
+                           Volume->DataOffset + MultU64x32(RunStart - 2, Volume->ClusterSize) + Offset,
+                           Chunk, Buffer);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+
+    Buffer += Chunk;
+    Size   -= Chunk;
+    if (Size == 0) {
+      break;
+    }
+
+    Current = FatNextCluster(Volume, Current);
+    (*Advanced)++;
+    Offset = 0;
+  }
+
+  *Cluster = Current;
+  return EFI_SUCCESS;
+}
+
+/**
+  Loads a whole directory into a pool buffer.
+
+  @param[in]  Volume    Mounted volume
+  @param[in]  Cluster   First cluster, or FAT_ROOT_CLUSTER
+  @param[out] Data      Directory entries; freed by the caller
+  @param[out] Size      Size of Data in bytes
+**/
+STATIC
+EFI_STATUS
+FatLoadDirectory (
+  IN  FAT_VOLUME  *Volume,
+  IN  UINT32      Cluster,
+  OUT UINT8       **Data,
+  OUT UINT32      *Size
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Current;
+  UINT32      Count;
+  UINT32      Advanced;
+
+  if (Cluster == FAT_ROOT_CLUSTER && Volume->FatBits != 32) {
+    *Size  = Volume->RootSize;
+    Status = AcpiAllocatePool(EfiBootServicesData, *Size, (VOID **)Data);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    Status = FatReadVolume(Volume, Volume->RootOffset, *Size, *Data);
+  } else {
+    if (Cluster == FAT_ROOT_CLUSTER) {
+      Cluster = Volume->RootCluster;
+    }
+
+    // Size the buffer first so the chain is read in as few transfers as possible
+    Count = 0;
+    for (Current = Cluster; FatIsDataCluster(Volume, Current); Current = FatNextCluster(Volume, Current)) {
+      Count++;
+      if ((UINT64)Count * Volume->ClusterSize > FAT_MAX_DIRECTORY) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+    }
+    if (Count == 0) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+
+    *Size  = Count * Volume->ClusterSize;
+    Status = AcpiAllocatePool(EfiBootServicesData, *Size, (VOID **)Data);
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+    Status = FatReadChain(Volume, &Cluster, 0, *Size, *Data, &Advanced);
+  }
+
+  if (EFI_ERROR(Status)) {
+    AcpiFreePool(*Data);
+    *Data = NULL;
+  }
+  return Status;
+}
+
+/**
+  Returns the first cluster of a directory entry.
+**/
+STATIC
+UINT32
+FatEntryCluster (
+  IN FAT_VOLUME           *Volume,
+  IN CONST FAT_DIR_ENTRY  *Entry
+  )
+{
+  UINT32  Cluster;
+
+  Cluster = Entry->ClusterLow;
+  if (Volume->FatBits == 32) {
+    Cluster |= (UINT32)Entry->ClusterHigh << 16;
+  }
+  return Cluster;
+}
+
+/**
+  Builds the 8.3 name of an entry, applying the lowercase flags set by
+  Windows for names that fit 8.3 without a long name.
+
+  @param[in]  Entry   Short directory entry
+  @param[out] Name    Buffer of at least 13 characters
+**/
+STATIC
+VOID
+FatShortName (
+  IN  CONST FAT_DIR_ENTRY  *Entry,
+  OUT CHAR16               *Name
+  )
+{
+  UINTN   Index;
+  UINTN   BaseLength;
+  UINTN   ExtLength;
+  UINTN   Length;
+  CHAR16  Char;
+
+  for (BaseLength = 8; BaseLength > 0 && Entry->Name[BaseLength - 1] == ' '; BaseLength--) {
+    ;
+  }
+  for (ExtLength = 3; ExtLength > 0 && Entry->Name[8 + ExtLength - 1] == ' '; ExtLength--) {
+    ;
+  }
+
+  Length = 0;
+  for (Index = 0; Index < 11; Index++) {
+    if (Index == 8 && ExtLength > 0) {
+      Name[Length++] = L'.';
+    }
+    if ((Index < 8 && Index >= BaseLength) || (Index >= 8 && Index - 8 >= ExtLength)) {
+      continue;
+    }
+
+    Char = Entry->Name[Index];
+    if (Index == 0 && Char == FAT_ENTRY_KANJI_E5) {
+      Char = FAT_ENTRY_DELETED;
+    }
+    if ((Entry->CaseFlags & ((Index < 8) ? FAT_CASE_LOWER_BASE : FAT_CASE_LOWER_EXT)) != 0 &&
+        Char >= L'A' && Char <= L'Z') {
+      Char += L'a' - L'A';
+    }
+    Name[Length++] = Char;
+  }
+
+  Name[Length] = L'\0';
+}
+
+/**
+  Returns the checksum of a short name that long name entries carry.
+**/
+STATIC
+UINT8
+FatShortNameChecksum (
+  IN CONST UINT8  *ShortName
+  )
+{
+  UINTN  Index;
+  UINT8  Sum;
+
+  Sum = 0;
+  for (Index = 0; Index < 11; Index++) {
+    Sum = (UINT8)(((Sum & 1) << 7) + (Sum >> 1) + ShortName[Index]);
+  }
+  return Sum;
+}
+
+/**
+  Returns the next live entry of a loaded directory with its long name, or
+  its 8.3 name when no valid long name precedes it. Volume labels and
+  deleted entries are skipped.
+
+  @param[in]     Data       Directory data
+  @param[in]     Size       Size of Data
+  @param[in,out] Offset     Offset to continue from; left at the end marker when done
+  @param[in]     WantDots   Return the "." and ".." entries too
+  @param[out]    Entry      Short entry found
+  @param[out]    Name       Buffer of FAT_NAME_LENGTH characters
+
+  @return FALSE at the end of the directory
+**/
+STATIC
+BOOLEAN
+FatNextEntry (
+  IN     UINT8          *Data,
+  IN     UINT32         Size,
+  IN OUT UINT64         *Offset,
+  IN     BOOLEAN        WantDots,
+  OUT    FAT_DIR_ENTRY  **Entry,
+  OUT    CHAR16         *Name
+  )
+{
+  FAT_DIR_ENTRY  *Raw;
+  FAT_LFN_ENTRY  *Lfn;
+  CHAR16         *Part;
+  UINT8          Order;
+  UINT8          Expected;
+  UINT8          Checksum;
+  BOOLEAN        HaveLongName;
+  UINTN          Index;
+
+  Expected     = 0;
+  Checksum     = 0;
+  HaveLongName = FALSE;
+
+  while (*Offset + FAT_DIR_ENTRY_SIZE <= Size) {
+    Raw = (FAT_DIR_ENTRY *)(Data + *Offset);
+    if (Raw->Name[0] == FAT_ENTRY_END) {
+      return FALSE;
+    }
+    *Offset += FAT_DIR_ENTRY_SIZE;
+
+    if (Raw->Name[0] == FAT_ENTRY_DELETED) {
+      Expected     = 0;
+      HaveLongName = FALSE;
+      continue;
+    }
+
+    if ((Raw->Attributes & FAT_ATTR_LFN_MASK) == FAT_ATTR_LFN) {
+      // Long name parts are stored last part first, counting down to 1
+      Lfn   = (FAT_LFN_ENTRY *)Raw;
+      Order = Lfn->Order & FAT_LFN_ORDER_MASK;
+      if ((Lfn->Order & FAT_LFN_LAST) != 0 && Order > 0 && Order <= FAT_LFN_MAX_ENTRIES) {
+        Expected = Order;
+        Checksum = Lfn->Checksum;
+        Name[Order * FAT_LFN_CHARS] = L'\0';
+      }
+      if (Expected == 0 || Order != Expected || Lfn->Checksum != Checksum) {
+        Expected     = 0;
+        HaveLongName = FALSE;
+        continue;
+      }
+
+      Part = &Name[(Order - 1) * FAT_LFN_CHARS];
+      for (Index = 0; Index < 5; Index++) {
+        *Part++ = ReadUnaligned16(&Lfn->Name1[Index]);
+      }
+      for (Index = 0; Index < 6; Index++) {
+        *Part++ = ReadUnaligned16(&Lfn->Name2[Index]);
+      }
+      for (Index = 0; Index < 2; Index++) {
+        *Part++ = ReadUnaligned16(&Lfn->Name3[Index]);
+      }
+      Expected--;
+      HaveLongName = (BOOLEAN)(Expected == 0);
+      continue;
+    }
+
+    if ((Raw->Attributes & FAT_ATTR_VOLUME_ID) != 0 || (Raw->Name[0] == '.' && !WantDots)) {
+      Expected     = 0;
+      HaveLongName = FALSE;
+      continue;
+    }
+
+    if (!HaveLongName || FatShortNameChecksum(Raw->Name) != Checksum) {
+      FatShortName(Raw, Name);
+    }
+    *Entry = Raw;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  Compares two names without regard to case.
+**/
+STATIC
+BOOLEAN
+FatNameEqual (
+  IN CONST CHAR16  *First,
+  IN CONST CHAR16  *Second
+  )
+{
+  while (*First != L'\0' && CharToUpper(*First) == CharToUpper(*Second)) {
+    First++;
+    Second++;
+  }
+  return (BOOLEAN)(*First == L'\0' && *Second == L'\0');
+}
+
+/**
+  Looks up a name in a loaded directory, by long name or 8.3 name.
+
+  @param[in]  Data    Directory data
+  @param[in]  Size    Size of Data
+  @param[in]  Wanted  Name to find; "." and ".." match the dot entries
+  @param[out] Entry   Copy of the entry found
+  @param[out] Name    Name of the entry as stored, FAT_NAME_LENGTH characters
+**/
+STATIC
+BOOLEAN
+FatFindEntry (
+  IN  UINT8          *Data,
+  IN  UINT32         Size,
+  IN  CONST CHAR16   *Wanted,
+  OUT FAT_DIR_ENTRY  *Entry,
+  OUT CHAR16         *Name
+  )
+{
+  FAT_DIR_ENTRY  *Found;
+  CHAR16         ShortName[13];
+  UINT64         Offset;
+
+  Offset = 0;
+  while (FatNextEntry(Data, Size, &Offset, TRUE, &Found, Name)) {
+    FatShortName(Found, ShortName);
+    if (FatNameEqual(Wanted, Name) || FatNameEqual(Wanted, ShortName)) {
+      CopyMem(Entry, Found, sizeof(*Entry));
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Converts a FAT date and time to EFI_TIME; a zero date gives a zeroed time.
+**/
+STATIC
+VOID
+FatToEfiTime (
+  IN  UINT16    Date,
+  IN  UINT16    Time,
+  IN  UINT8     Tenths,
+  OUT EFI_TIME  *EfiTime
+  )
+{
+  ZeroMem(EfiTime, sizeof(*EfiTime));
+  if (Date == 0) {
+    return;
+  }
+
+  EfiTime->Year       = (UINT16)(1980 + (Date >> 9));
+  EfiTime->Month      = (UINT8)((Date >> 5) & 0x0F);
+  EfiTime->Day        = (UINT8)(Date & 0x1F);
+  EfiTime->Hour       = (UINT8)(Time >> 11);
+  EfiTime->Minute     = (UINT8)((Time >> 5) & 0x3F);
+  EfiTime->Second     = (UINT8)((Time & 0x1F) * 2 + Tenths / 100);
+  EfiTime->Nanosecond = (UINT32)(Tenths % 100) * 10000000;
+  EfiTime->TimeZone   = EFI_UNSPECIFIED_TIMEZONE;
+}
+
+/**
+  Fills EFI_FILE_INFO for a directory entry.
+
+  @param[in]     Volume       Mounted volume
+  @param[in]     Entry        Entry, or NULL for the root directory
+  @param[in]     Name         File name
+  @param[in,out] BufferSize   In: size of Buffer. Out: size needed or used
+  @param[out]    Buffer       EFI_FILE_INFO
+
+  @retval EFI_BUFFER_TOO_SMALL    *BufferSize was updated with the size needed
+**/
+STATIC
+EFI_STATUS
+FatFillInfo (
+  IN     FAT_VOLUME           *Volume,
+  IN     CONST FAT_DIR_ENTRY  *Entry  OPTIONAL,
+  IN     CONST CHAR16         *Name,
+  IN OUT UINTN                *BufferSize,
+  OUT    VOID                 *Buffer
+  )
+{
+  EFI_FILE_INFO  *Info;
+  UINTN          Needed;
+
+  Needed = SIZE_OF_EFI_FILE_INFO + StrSize(Name);
+  if (*BufferSize < Needed) {
+    *BufferSize = Needed;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  Info = Buffer;
+  ZeroMem(Info, SIZE_OF_EFI_FILE_INFO);
+  Info->Size = Needed;
+  if (Entry == NULL) {
+    Info->Attribute = EFI_FILE_DIRECTORY;
+  } else {
+    Info->Attribute = Entry->Attributes & EFI_FILE_VALID_ATTR;
+    if ((Entry->Attributes & FAT_ATTR_DIRECTORY) == 0) {
+      Info->FileSize     = Entry->Size;
+      Info->PhysicalSize = ALIGN_VALUE((UINT64)Entry->Size, Volume->ClusterSize);
+    }
+    FatToEfiTime(Entry->CreateDate, Entry->CreateTime, Entry->CreateTenths, &Info->CreateTime);
+    FatToEfiTime(Entry->AccessDate, 0, 0, &Info->LastAccessTime);
+    FatToEfiTime(Entry->ModifyDate, Entry->ModifyTime, 0, &Info->ModificationTime);
+  }
+  StrCpyS(Info->FileName, (*BufferSize - SIZE_OF_EFI_FILE_INFO) / sizeof(CHAR16), Name);
+
+  *BufferSize = Needed;
+  return EFI_SUCCESS;
+}
+
+/**
+  Drops one handle reference and unmounts the volume with the last one.
+**/
+STATIC
+VOID
+FatReleaseVolume (
+  IN FAT_VOLUME  *Volume
+  )
+{
+  // A volume that never produced a handle failed to mount and has nothing to report
+  if (Volume->OpenHandles > 0) {
+    if (--Volume->OpenHandles > 0) {
+      return;
+    }
+    AcpiDebugPrint(DEBUG_INFO, L"FAT reader: %u opens, %u transfers, %llu bytes\n",
+                   Volume->Stats.FilesOpened, Volume->Stats.Transfers, Volume->Stats.Bytes);
+  }
+
+  if (Volume->Fat != NULL) {
+    AcpiFreePool(Volume->Fat);
+  }
+  if (Volume->BounceBuffer != NULL) {
+    AcpiFreePool(Volume->BounceBuffer);
+  }
+  AcpiFreePool(Volume);
+}
+
+/**
+  Closes a handle; the volume is unmounted with its last handle.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  FAT_FILE    *File;
+  FAT_VOLUME  *Volume;
+
+  File   = FAT_FILE_FROM_PROTOCOL(This);
+  Volume = File->Volume;
+
+  if (File->DirData != NULL) {
+    AcpiFreePool(File->DirData);
+  }
+  File->Signature = 0;
+  AcpiFreePool(File);
+
+  FatReleaseVolume(Volume);
+  return EFI_SUCCESS;
+}
+
+/**
+  Closes the handle; nothing is deleted from a read-only volume.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileDelete (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  FatFileClose(This);
+  return EFI_WARN_DELETE_FAILURE;
+}
+
+/**
+  Reads file data, or the EFI_FILE_INFO of the next directory entry.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  EFI_STATUS     Status;
+  FAT_FILE       *File;
+  FAT_VOLUME     *Volume;
+  FAT_DIR_ENTRY  *Entry;
+  CHAR16         Name[FAT_NAME_LENGTH];
+  UINT64         Offset;
+  UINT32         Index;
+  UINT32         Cluster;
+  UINT32         Advanced;
+  UINTN          Size;
+
+  if (This == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  File   = FAT_FILE_FROM_PROTOCOL(This);
+  Volume = File->Volume;
+
+  if (File->IsDirectory) {
+    Offset = File->Position;
+    if (!FatNextEntry(File->DirData, File->DirSize, &Offset, FALSE, &Entry, Name)) {
+      File->Position = Offset;
+      *BufferSize    = 0;
+      return EFI_SUCCESS;
+    }
+    Status = FatFillInfo(Volume, Entry, Name, BufferSize, Buffer);
+    if (!EFI_ERROR(Status)) {
+      File->Position = Offset;
+    }
+    return Status;
+  }
+
+  if (File->Position > File->Entry.Size) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Size = (UINTN)MIN((UINT64)*BufferSize, File->Entry.Size - File->Position);
+  *BufferSize = 0;
+  if (Size == 0) {
+    return EFI_SUCCESS;
+  }
+
+  // Walk the chain from the cluster of the previous read when moving forward
+  Index = (UINT32)DivU64x32(File->Position, Volume->ClusterSize);
+  if (File->CursorCluster == 0 || Index < File->CursorIndex) {
+    File->CursorCluster = File->Cluster;
+    File->CursorIndex   = 0;
+  }
+  while (File->CursorIndex < Index) {
+    if (!FatIsDataCluster(Volume, File->CursorCluster)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    File->CursorCluster = FatNextCluster(Volume, File->CursorCluster);
+    File->CursorIndex++;
+  }
+
+  Cluster = File->CursorCluster;
+  Status  = FatReadChain(Volume, &Cluster, (UINT32)(File->Position - MultU64x32(Index, Volume->ClusterSize)),
+                         Size, Buffer, &Advanced);
+  if (EFI_ERROR(Status)) {
+    File->CursorCluster = 0;
+    return Status;
+  }
+
+  File->CursorCluster = Cluster;
+  File->CursorIndex   = Index + Advanced;
+  File->Position     += Size;
+  *BufferSize         = Size;
+  return EFI_SUCCESS;
+}
+
+/**
+  Fails; the volume is read-only.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileWrite (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  IN     VOID               *Buffer
+  )
+{
+  return EFI_WRITE_PROTECTED;
+}
+
+/**
+  Returns the file position; not defined for directories.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileGetPosition (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT UINT64             *Position
+  )
+{
+  FAT_FILE  *File;
+
+  File = FAT_FILE_FROM_PROTOCOL(This);
+  if (File->IsDirectory) {
+    return EFI_UNSUPPORTED;
+  }
+
+  *Position = File->Position;
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets the file position; MAX_UINT64 moves to the end. Directories can only
+  be rewound to 0.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileSetPosition (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN UINT64             Position
+  )
+{
+  FAT_FILE  *File;
+
+  File = FAT_FILE_FROM_PROTOCOL(This);
+  if (File->IsDirectory) {
+    if (Position != 0) {
+      return EFI_UNSUPPORTED;
+    }
+  } else if (Position == MAX_UINT64) {
+    Position = File->Entry.Size;
+  }
+
+  File->Position = Position;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns EFI_FILE_INFO of the handle; other information types are not supported.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileGetInfo (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN     EFI_GUID           *InformationType,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  FAT_FILE  *File;
+
+  if (This == NULL || InformationType == NULL || BufferSize == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (!CompareGuid(InformationType, &gEfiFileInfoGuid)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  File = FAT_FILE_FROM_PROTOCOL(This);
+  return FatFillInfo(File->Volume, FAT_IS_ROOT(File) ? NULL : &File->Entry, File->Name, BufferSize, Buffer);
+}
+
+/**
+  Fails; the volume is read-only.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileSetInfo (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN EFI_GUID           *InformationType,
+  IN UINTN              BufferSize,
+  IN VOID               *Buffer
+  )
+{
+  return EFI_WRITE_PROTECTED;
+}
+
+/**
+  Nothing is ever dirty on a read-only volume.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileFlush (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  );
+
+STATIC EFI_FILE_PROTOCOL  mFatFileProtocol = {
+  EFI_FILE_PROTOCOL_REVISION,
+  FatFileOpen,
+  FatFileClose,
+  FatFileDelete,
+  FatFileRead,
+  FatFileWrite,
+  FatFileGetPosition,
+  FatFileSetPosition,
+  FatFileGetInfo,
+  FatFileSetInfo,
+  FatFileFlush
+};
+
+/**
+  Creates a handle for a file or directory, loading directory contents.
+
+  @param[in]  Volume      Mounted volume
+  @param[in]  Entry       Directory entry, or NULL for the root directory
+  @param[in]  Name        Entry name
+  @param[in]  Parent      Directory holding the entry
+  @param[out] File        New handle
+**/
+STATIC
+EFI_STATUS
+FatCreateFile (
+  IN  FAT_VOLUME           *Volume,
+  IN  CONST FAT_DIR_ENTRY  *Entry  OPTIONAL,
+  IN  CONST CHAR16         *Name,
+  IN  UINT32               Parent,
+  OUT FAT_FILE             **File
+  )
+{
+  EFI_STATUS  Status;
+  FAT_FILE    *NewFile;
+
+  Status = AcpiAllocatePool(EfiBootServicesData, sizeof(FAT_FILE), (VOID **)&NewFile);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  ZeroMem(NewFile, sizeof(FAT_FILE));
+  NewFile->Signature = FAT_FILE_SIGNATURE;
+  CopyMem(&NewFile->Protocol, &mFatFileProtocol, sizeof(EFI_FILE_PROTOCOL));
+  NewFile->Volume = Volume;
+  NewFile->Parent = Parent;
+  StrCpyS(NewFile->Name, FAT_NAME_LENGTH, Name);
+
+  if (Entry == NULL) {
+    NewFile->IsDirectory = TRUE;
+    NewFile->Cluster     = FAT_ROOT_CLUSTER;
+  } else {
+    CopyMem(&NewFile->Entry, Entry, sizeof(FAT_DIR_ENTRY));
+    NewFile->IsDirectory = (BOOLEAN)((Entry->Attributes & FAT_ATTR_DIRECTORY) != 0);
+    NewFile->Cluster     = FatEntryCluster(Volume, Entry);
+  }
+
+  if (NewFile->IsDirectory) {
+    Status = FatLoadDirectory(Volume, NewFile->Cluster, &NewFile->DirData, &NewFile->DirSize);
+    if (EFI_ERROR(Status)) {
+      AcpiFreePool(NewFile);
+      return Status;
+    }
+  }
+
+  Volume->OpenHandles++;
+  Volume->Stats.FilesOpened++;
+  *File = NewFile;
+  return EFI_SUCCESS;
+}
+
+/**
+  Opens a file or directory relative to This, or from the root for paths
+  starting with a backslash. Only EFI_FILE_MODE_READ is accepted.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+FatFileOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  EFI_STATUS     Status;
+  FAT_FILE       *File;
+  FAT_FILE       *NewFile;
+  FAT_VOLUME     *Volume;
+  FAT_DIR_ENTRY  Entry;
+  BOOLEAN        HaveEntry;
+  BOOLEAN        IsDirectory;
+  UINT32         Cluster;
+  UINT32         Parent;
+  CHAR16         Name[FAT_NAME_LENGTH];
+  CHAR16         Component[FAT_NAME_LENGTH];
+  CHAR16         *Path;
+  UINTN          Length;
+  UINT8          *Data;
+  UINT8          *Cached;
+  UINT32         DataSize;
+
+  if (This == NULL || NewHandle == NULL || FileName == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if ((OpenMode & (EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE)) != 0) {
+    return EFI_WRITE_PROTECTED;
+  }
+  if (OpenMode != EFI_FILE_MODE_READ) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  File   = FAT_FILE_FROM_PROTOCOL(This);
+  Volume = File->Volume;
+  Path   = FileName;
+  Cached = NULL;
+
+  // Current target of the walk: starts at the root, This, or the directory holding This
+  if (*Path == L'\\') {
+    HaveEntry = FALSE;
+    Cluster   = FAT_ROOT_CLUSTER;
+    Parent    = FAT_ROOT_CLUSTER;
+    Name[0]   = L'\0';
+  } else if (File->IsDirectory) {
+    HaveEntry = !FAT_IS_ROOT(File);
+    Cluster   = File->Cluster;
+    Parent    = File->Parent;
+    CopyMem(&Entry, &File->Entry, sizeof(Entry));
+    StrCpyS(Name, FAT_NAME_LENGTH, File->Name);
+    // The first lookup uses the entries the handle holds instead of reading the directory again
+    Cached = File->DirData;
+  } else {
+    HaveEntry = FALSE;
+    Cluster   = File->Parent;
+    Parent    = FAT_ROOT_CLUSTER;
+    Name[0]   = L'\0';
+    if (Cluster != FAT_ROOT_CLUSTER) {
+      // Only the ".." entry inside the directory describes it; good enough for relative opens
+      Status = FatLoadDirectory(Volume, Cluster, &Data, &DataSize);
+      if (EFI_ERROR(Status)) {
+        return Status;
+      }
+      HaveEntry = FatFindEntry(Data, DataSize, L".", &Entry, Name);
+      AcpiFreePool(Data);
+      if (!HaveEntry) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+    }
+  }
+  IsDirectory = TRUE;
+  Data        = NULL;
+  DataSize    = 0;
+  Status      = EFI_SUCCESS;
+
+  while (*Path != L'\0') {
+    while (*Path == L'\\') {
+      Path++;
+    }
+    for (Length = 0; Path[Length] != L'\0' && Path[Length] != L'\\'; Length++) {
+      ;
+    }
+    if (Length == 0 || (Length == 1 && Path[0] == L'.')) {
+      Path += Length;
+      continue;
+    }
+    if (Length >= FAT_NAME_LENGTH || !IsDirectory) {
+      Status = EFI_NOT_FOUND;
+      break;
+    }
+    CopyMem(Component, Path, Length * sizeof(CHAR16));
+    Component[Length] = L'\0';
+    Path += Length;
+
+    if (Cached != NULL) {
+      Data     = Cached;
+      DataSize = File->DirSize;
+    } else {
+      Status = FatLoadDirectory(Volume, Cluster, &Data, &DataSize);
+      if (EFI_ERROR(Status)) {
+        break;
+      }
+    }
+    if (!FatFindEntry(Data, DataSize, Component, &Entry, Name)) {
+      Status = EFI_NOT_FOUND;
+      break;
+    }
+    if (Data != Cached) {
+      AcpiFreePool(Data);
+    }
+    Data   = NULL;
+    Cached = NULL;
+
+    // ".." of a first-level directory stores cluster 0, which is the root here as well
+    Parent      = Cluster;
+    HaveEntry   = TRUE;
+    IsDirectory = (BOOLEAN)((Entry.Attributes & FAT_ATTR_DIRECTORY) != 0);
+    Cluster     = FatEntryCluster(Volume, &Entry);
+    if (IsDirectory && Cluster == FAT_ROOT_CLUSTER) {
+      HaveEntry = FALSE;
+      Name[0]   = L'\0';
+    }
+  }
+
+  if (!EFI_ERROR(Status)) {
+    Status = FatCreateFile(Volume, HaveEntry ? &Entry : NULL, Name, Parent, &NewFile);
+    if (!EFI_ERROR(Status)) {
+      *NewHandle = &NewFile->Protocol;
+    }
+  }
+
+  if (Data != NULL && Data != Cached) {
+    AcpiFreePool(Data);
+  }
+  return Status;
+}
+
+/**
+  Parses the boot sector and fills in the volume geometry.
+
+  @param[in,out] Volume   Volume with BlockSize set
+  @param[in]     Sector   First 512 bytes of the volume
+  @param[out]    FatStart Byte offset of the FAT to cache
+**/
+STATIC
+EFI_STATUS
+FatParseBootSector (
+  IN OUT FAT_VOLUME  *Volume,
+  IN     UINT8       *Sector,
+  OUT    UINT64      *FatStart
+  )
+{
+  FAT_BOOT_SECTOR  *Boot;
+  UINT32           BytesPerSector;
+  UINT32           FatSectors;
+  UINT32           TotalSectors;
+  UINT32           RootSectors;
+  UINT32           MetaSectors;
+  UINT32           ActiveFat;
+  UINT64           FatBytes;
+
+  Boot = (FAT_BOOT_SECTOR *)Sector;
+  if (ReadUnaligned16((UINT16 *)(Sector + 510)) != FAT_BOOT_SIGNATURE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  BytesPerSector = Boot->BytesPerSector;
+  if (BytesPerSector < 512 || BytesPerSector > SIZE_4KB || (BytesPerSector & (BytesPerSector - 1)) != 0 ||
+      Boot->SectorsPerCluster == 0 || (Boot->SectorsPerCluster & (Boot->SectorsPerCluster - 1)) != 0 ||
+      Boot->ReservedSectors == 0 || Boot->NumberOfFats == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  FatSectors   = (Boot->FatSize16 != 0) ? Boot->FatSize16 : Boot->FatSize32;
+  TotalSectors = (Boot->Sectors16 != 0) ? Boot->Sectors16 : Boot->Sectors32;
+  RootSectors  = (Boot->RootEntries * FAT_DIR_ENTRY_SIZE + BytesPerSector - 1) / BytesPerSector;
+  MetaSectors  = Boot->ReservedSectors + Boot->NumberOfFats * FatSectors + RootSectors;
+  if (FatSectors == 0 || TotalSectors <= MetaSectors) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Volume->ClusterSize  = BytesPerSector * Boot->SectorsPerCluster;
+  Volume->ClusterCount = (TotalSectors - MetaSectors) / Boot->SectorsPerCluster;
+  Volume->DataOffset   = MultU64x32(MetaSectors, BytesPerSector);
+
+  // The cluster count alone decides the FAT type
+  ActiveFat = 0;
+  if (Volume->ClusterCount <= FAT12_MAX_CLUSTERS) {
+    Volume->FatBits = 12;
+  } else if (Volume->ClusterCount <= FAT16_MAX_CLUSTERS) {
+    Volume->FatBits = 16;
+  } else {
+    Volume->FatBits = 32;
+    if (Boot->RootEntries != 0 || Boot->FatSize16 != 0) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    if ((Boot->ExtendedFlags & FAT32_MIRROR_DISABLED) != 0) {
+      ActiveFat = Boot->ExtendedFlags & FAT32_ACTIVE_FAT_MASK;
+      if (ActiveFat >= Boot->NumberOfFats) {
+        return EFI_VOLUME_CORRUPTED;
+      }
+    }
+    Volume->RootCluster = Boot->RootCluster;
+    if (!FatIsDataCluster(Volume, Volume->RootCluster)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+  }
+
+  if (Volume->FatBits != 32) {
+    if (Boot->RootEntries == 0) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Volume->RootOffset = MultU64x32(Boot->ReservedSectors + Boot->NumberOfFats * FatSectors, BytesPerSector);
+    Volume->RootSize   = Boot->RootEntries * FAT_DIR_ENTRY_SIZE;
+  }
+
+  // Only the part of the FAT that maps existing clusters is cached
+  FatBytes = DivU64x32(MultU64x32(Volume->ClusterCount + 2, Volume->FatBits) + 7, 8);
+  if (FatBytes > MultU64x32(FatSectors, BytesPerSector)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  if (FatBytes > FAT_MAX_CACHE) {
+    return EFI_UNSUPPORTED;
+  }
+
+  // One spare byte keeps FAT12 two-byte reads of the last entry in bounds
+  Volume->FatSize = (UINT32)FatBytes + 1;
+  *FatStart = MultU64x32(Boot->ReservedSectors + ActiveFat * FatSectors, BytesPerSector);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+FatOpenVolumeIo (
+  IN  EFI_DISK_IO_PROTOCOL   *DiskIo  OPTIONAL,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  OUT EFI_FILE_PROTOCOL      **Root
+  )
+{
+  EFI_STATUS  Status;
+  FAT_VOLUME  *Volume;
+  FAT_FILE    *RootFile;
+  UINT8       Sector[FAT_BOOT_SECTOR_SIZE];
+  UINT64      FatStart;
+
+  if (BlockIo == NULL || Root == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (!BlockIo->Media->MediaPresent) {
+    return EFI_NO_MEDIA;
+  }
+  if (BlockIo->Media->BlockSize == 0 || (BlockIo->Media->BlockSize & (BlockIo->Media->BlockSize - 1)) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = AcpiAllocatePool(EfiBootServicesData, sizeof(FAT_VOLUME), (VOID **)&Volume);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+
+  ZeroMem(Volume, sizeof(FAT_VOLUME));
+  Volume->Signature = FAT_VOLUME_SIGNATURE;
+  Volume->DiskIo    = DiskIo;
+  Volume->BlockIo   = BlockIo;
+  Volume->MediaId   = BlockIo->Media->MediaId;
+  Volume->BlockSize = BlockIo->Media->BlockSize;
+  Volume->IoAlign   = BlockIo->Media->IoAlign;
+
+  if (DiskIo == NULL) {
+    Volume->BounceSize = MAX(FAT_BOUNCE_SIZE, Volume->BlockSize);
+    Status = AcpiAllocatePool(EfiBootServicesData, Volume->BounceSize + Volume->IoAlign,
+                              (VOID **)&Volume->BounceBuffer);
+    if (EFI_ERROR(Status)) {
+      goto Failed;
+    }
+    Volume->Bounce = (Volume->IoAlign > 1) ? ALIGN_POINTER(Volume->BounceBuffer, Volume->IoAlign)
+                                           : Volume->BounceBuffer;
+  }
+
+  Status = FatReadVolume(Volume, 0, sizeof(Sector), Sector);
+  if (EFI_ERROR(Status)) {
+    goto Failed;
+  }
+
+  Status = FatParseBootSector(Volume, Sector, &FatStart);
+  if (EFI_ERROR(Status)) {
+    goto Failed;
+  }
+
+  Status = AcpiAllocatePool(EfiBootServicesData, Volume->FatSize, (VOID **)&Volume->Fat);
+  if (EFI_ERROR(Status)) {
+    goto Failed;
+  }
+  Volume->Fat[Volume->FatSize - 1] = 0;
+  Status = FatReadVolume(Volume, FatStart, Volume->FatSize - 1, Volume->Fat);
+  if (EFI_ERROR(Status)) {
+    goto Failed;
+  }
+
+  AcpiDebugPrint(DEBUG_VERBOSE, L"FAT%u volume: %u clusters of %u bytes, %u byte FAT cached\n",
+                 Volume->FatBits, Volume->ClusterCount, Volume->ClusterSize, Volume->FatSize - 1);
+
+  Status = FatCreateFile(Volume, NULL, L"", FAT_ROOT_CLUSTER, &RootFile);
+  if (EFI_ERROR(Status)) {
+    goto Failed;
+  }
+
+  *Root = &RootFile->Protocol;
+  return EFI_SUCCESS;
+
+Failed:
+  FatReleaseVolume(Volume);
+  return Status;
+}
+
+EFI_STATUS
+FatOpenVolume (
+  IN  EFI_HANDLE         DeviceHandle,
+  OUT EFI_FILE_PROTOCOL  **Root
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  EFI_DISK_IO_PROTOCOL   *DiskIo;
+
+  if (DeviceHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = gBS->HandleProtocol(DeviceHandle, &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
+  if (EFI_ERROR(Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (EFI_ERROR(gBS->HandleProtocol(DeviceHandle, &gEfiDiskIoProtocolGuid, (VOID **)&DiskIo))) {
+    DiskIo = NULL;
+  }
+
+  return FatOpenVolumeIo(DiskIo, BlockIo, Root);
+}
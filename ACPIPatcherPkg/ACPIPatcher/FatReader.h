@@ -0,0 +1,71 @@
+/** @file
+
+  Read-only FAT12/16/32 reader working directly on the disk of a volume.
+
+  Some firmware file system drivers, notably on EFI 1.x Macs, split every
+  read into small requests with a high per-call cost. This reader caches the
+  FAT once and reads each run of contiguous clusters with a single transfer.
+  The volume is exposed as an ordinary EFI_FILE_PROTOCOL so the rest of the
+  patcher does not need to know which path it is using.
+
+**/
+
+#ifndef __FAT_READER_H__
+#define __FAT_READER_H__
+
+#include <Protocol/BlockIo.h>
+#include <Protocol/DiskIo.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define FAT_MAX_CACHE       SIZE_4MB    // Largest FAT that is cached; bigger volumes are not handled
+#define FAT_MAX_DIRECTORY   SIZE_2MB    // 65536 entries, the FAT limit for one directory
+#define FAT_BOUNCE_SIZE     SIZE_64KB   // Staging buffer for unaligned BlockIo transfers
+
+//
+// Transfer counters of one mounted volume
+//
+typedef struct {
+  UINT32  Transfers;      ///< DiskIo or BlockIo calls made
+  UINT64  Bytes;          ///< Bytes requested from the caller's side
+  UINT32  FilesOpened;
+} FAT_READ_STATS;
+
+/**
+  Mounts a FAT volume from the given disk protocols.
+
+  DiskIo is used when present; otherwise whole blocks are read through
+  BlockIo, staging partial blocks and misaligned buffers.
+
+  @param[in]  DiskIo    Disk I/O of the volume, or NULL
+  @param[in]  BlockIo   Block I/O of the volume
+  @param[out] Root      Root directory; the volume goes away when its last handle is closed
+
+  @retval EFI_SUCCESS             Volume mounted
+  @retval EFI_NO_MEDIA            No media present
+  @retval EFI_UNSUPPORTED         Not a FAT volume, or the FAT exceeds FAT_MAX_CACHE
+  @retval EFI_VOLUME_CORRUPTED    Boot sector values are inconsistent
+  @retval Other                   Read or allocation failed
+**/
+EFI_STATUS
+FatOpenVolumeIo (
+  IN  EFI_DISK_IO_PROTOCOL   *DiskIo  OPTIONAL,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  OUT EFI_FILE_PROTOCOL      **Root
+  );
+
+/**
+  Mounts the FAT volume on a device handle.
+
+  @param[in]  DeviceHandle    Handle with EFI_BLOCK_IO_PROTOCOL, usually EFI_DISK_IO_PROTOCOL too
+  @param[out] Root            Root directory, opened read-only
+
+  @retval EFI_INVALID_PARAMETER   DeviceHandle is NULL
+  @retval Other                   See FatOpenVolumeIo
+**/
+EFI_STATUS
+FatOpenVolume (
+  IN  EFI_HANDLE         DeviceHandle,
+  OUT EFI_FILE_PROTOCOL  **Root
+  );
+
+#endif // __FAT_READER_H__
@@ -21,6 +21,7 @@
 #include <Guid/Gpt.h>
 
 #include "FsHelpers.h"
+#include "AcpiMemory.h"
 EFI_LOADED_IMAGE_PROTOCOL           *gLoadedImage;
 
 /*++
@@ -46,13 +47,13 @@ FsReadFileToBuffer (
   )
 {
     EFI_STATUS Status = EFI_SUCCESS;
-    Status = gBS->AllocatePool(EfiRuntimeServicesData, BufferSize, Buffer);
+    Status = AcpiAllocatePool(EfiRuntimeServicesData, BufferSize, Buffer);
     if(Status != EFI_SUCCESS) {
         return Status;
     }
     Status = FileProtocol->Read(FileProtocol, &BufferSize, *Buffer);
     if(Status != EFI_SUCCESS) {
-        gBS->FreePool(Buffer);
+        AcpiFreePool(*Buffer);
         return Status;
     }
     
@@ -127,7 +128,7 @@ FileDevicePathToText(EFI_DEVICE_PATH_PROTOCOL *FilePathProto)
     Size = StrSize(FilePathText);
     if (Size > 2) {
         // we are allocating mem here - should be released by caller
-        Status = gBS->AllocatePool(EfiBootServicesData, Size, (VOID*)&OutFilePathText);
+        Status = AcpiAllocatePool(EfiBootServicesData, Size, (VOID*)&OutFilePathText);
         if (Status == EFI_SUCCESS) {
             StrCpyS(OutFilePathText, Size/sizeof(CHAR16), FilePathText);
         } else {
@@ -226,12 +227,24 @@ FsGetSelfRootDir(VOID)
 	return FsGetRootDir(FsGetSelfFileSystem());
 }
 
-/** Returns dir from file system we are loaded from. */
+/** Returns device handle of volume we are loaded from. */
+EFI_HANDLE
+FsGetSelfDevice(VOID)
+{
+	
+	FsGetLoadedImage();
+	if (gLoadedImage == NULL) {
+		return NULL;
+	}
+	
+	return gLoadedImage->DeviceHandle;
+}
+
+/** Returns dir we are loaded from, opened through given root dir of our volume. Closes RootDir. */
 EFI_FILE_PROTOCOL *
-FsGetSelfDir(VOID)
+FsGetSelfDirFrom(IN EFI_FILE_PROTOCOL *RootDir)
 {
 	EFI_STATUS			Status;
-	EFI_FILE_PROTOCOL	*RootDir;
 	EFI_FILE_PROTOCOL	*File;
 	EFI_FILE_PROTOCOL	*Dir;
 	CHAR16				*FilePath;
@@ -239,14 +252,14 @@ FsGetSelfDir(VOID)
 	UINTN				Index;
 	
 	
-	// make sure we have our loaded image protocol
-	FsGetLoadedImage();
-	if (gLoadedImage == NULL) {
+	if (RootDir == NULL) {
 		return NULL;
 	}
 	
-	RootDir = FsGetSelfRootDir();
-	if (RootDir == NULL) {
+	// make sure we have our loaded image protocol
+	FsGetLoadedImage();
+	if (gLoadedImage == NULL) {
+		RootDir->Close(RootDir);
 		return NULL;
 	}
 	
@@ -254,6 +267,7 @@ FsGetSelfDir(VOID)
 	FilePath = FileDevicePathToText(gLoadedImage->FilePath);
 	if (FilePath == NULL) {
 		Print(L"FsGetSelfDir: FileDevicePathToText = NULL\n");
+		RootDir->Close(RootDir);
 		return NULL;
 	}
 	
@@ -262,7 +276,7 @@ FsGetSelfDir(VOID)
 	RootDir->Close(RootDir);
 	if (Status != EFI_SUCCESS) {
 		Print(L"FsGetSelfDir: Open(%s) = %r\n", FilePath, Status);
-		FreePool(FilePath);
+		AcpiFreePool(FilePath);
 		return NULL;
 	}
 	  
@@ -281,10 +295,18 @@ FsGetSelfDir(VOID)
 	File->Close(File);
 	if (Status != EFI_SUCCESS) {
 		Print(L"FsGetSelfDir: Open(%s) = %r\n", DirName, Status);
-		FreePool(FilePath);
+		AcpiFreePool(FilePath);
 		return NULL;
 	}
-	FreePool(FilePath);
+	AcpiFreePool(FilePath);
 	
 	return Dir;
 }
+
+/** Returns dir from file system we are loaded from. */
+EFI_FILE_PROTOCOL *
+FsGetSelfDir(VOID)
+{
+	
+	return FsGetSelfDirFrom(FsGetSelfRootDir());
+}
@@ -81,6 +81,14 @@ FsGetRootDir(IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Volume);
 EFI_FILE_PROTOCOL *
 FsGetSelfRootDir(VOID);
 
+/** Returns device handle of volume we are loaded from. */
+EFI_HANDLE
+FsGetSelfDevice(VOID);
+
+/** Returns dir we are loaded from, opened through given root dir of our volume. Closes RootDir. */
+EFI_FILE_PROTOCOL *
+FsGetSelfDirFrom(IN EFI_FILE_PROTOCOL *RootDir);
+
 /** Returns dir from file system we are loaded from. */
 EFI_FILE_PROTOCOL *
 FsGetSelfDir(VOID);
@@ -0,0 +1,50 @@
+/** @file
+
+  ACPI table bundle file format.
+
+  A bundle packs several ACPI tables into one file so they can be written or
+  read with a single large transfer instead of one file operation per table:
+
+    ACPI_PATCHER_BUNDLE_HEADER
+    ACPI_PATCHER_BUNDLE_ENTRY[TableCount]
+    table data, each table starting on an ACPI_PATCHER_BUNDLE_ALIGN boundary
+
+  All fields are little endian. Offsets are relative to the start of the file.
+
+  Each entry carries a profile key (see ACPIPatcher/AcpiProfile.h). Entries
+  with key 0 are loaded on every machine; the others only on the platform
+  whose identity hashes to that key. Version 1 bundles had no key.
+
+**/
+
+#ifndef __ACPI_PATCHER_BUNDLE_H__
+#define __ACPI_PATCHER_BUNDLE_H__
+
+#define ACPI_PATCHER_BUNDLE_SIGNATURE   SIGNATURE_32('A', 'P', 'B', 'N')
+#define ACPI_PATCHER_BUNDLE_VERSION     2
+#define ACPI_PATCHER_BUNDLE_ALIGN       8
+#define ACPI_PATCHER_BUNDLE_NAME_SIZE   24
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32  Signature;      ///< ACPI_PATCHER_BUNDLE_SIGNATURE
+  UINT16  Version;        ///< ACPI_PATCHER_BUNDLE_VERSION
+  UINT16  EntrySize;      ///< sizeof (ACPI_PATCHER_BUNDLE_ENTRY)
+  UINT32  TableCount;     ///< Number of directory entries
+  UINT32  Reserved;
+  UINT64  TotalSize;      ///< Size of the whole bundle in bytes
+} ACPI_PATCHER_BUNDLE_HEADER;
+
+typedef struct {
+  UINT32  Signature;      ///< Table signature
+  UINT32  Offset;         ///< Start of the table data
+  UINT32  Length;         ///< Table length in bytes
+  UINT32  Crc32;          ///< CRC32 of the table data
+  UINT32  ProfileKey;     ///< Platform profile, 0 for tables common to all
+  CHAR8   Name[ACPI_PATCHER_BUNDLE_NAME_SIZE];  ///< NUL-terminated file name the table came from
+} ACPI_PATCHER_BUNDLE_ENTRY;
+
+#pragma pack()
+
+#endif // __ACPI_PATCHER_BUNDLE_H__
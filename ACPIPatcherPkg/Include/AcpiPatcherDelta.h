@@ -0,0 +1,49 @@
+/** @file
+
+  ACPI table delta file format.
+
+  A delta rebuilds a table from the firmware's own copy of it, so replacing
+  a large table that differs from the firmware's in a few places only reads
+  the differences:
+
+    ACPI_PATCHER_DELTA_HEADER
+    operations, up to and including ACPI_PATCHER_DELTA_OP_END
+
+  Each operation is one opcode byte followed by its operands, encoded as
+  unsigned LEB128 numbers of at most five bytes. The operations write the
+  new table front to back. All fixed fields are little endian.
+
+  The base table is identified by its signature, OEM table ID, length and
+  SHA-256; a delta whose base does not match exactly is not applied. The
+  rebuilt table is checked against its own SHA-256.
+
+**/
+
+#ifndef __ACPI_PATCHER_DELTA_H__
+#define __ACPI_PATCHER_DELTA_H__
+
+#define ACPI_PATCHER_DELTA_SIGNATURE   SIGNATURE_32('A', 'P', 'D', 'L')
+#define ACPI_PATCHER_DELTA_VERSION     1
+#define ACPI_PATCHER_DELTA_DIGEST_SIZE 32
+
+#define ACPI_PATCHER_DELTA_OP_END      0x00  ///< End of the delta; the table must be complete
+#define ACPI_PATCHER_DELTA_OP_COPY     0x01  ///< Offset, Length: copy Length bytes of the base table from Offset
+#define ACPI_PATCHER_DELTA_OP_INSERT   0x02  ///< Length, then Length bytes to write as they are
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32  Signature;          ///< ACPI_PATCHER_DELTA_SIGNATURE
+  UINT16  Version;            ///< ACPI_PATCHER_DELTA_VERSION
+  UINT16  HeaderSize;         ///< sizeof (ACPI_PATCHER_DELTA_HEADER)
+  UINT32  BaseSignature;      ///< Signature of the base table
+  CHAR8   BaseOemTableId[8];  ///< OEM table ID of the base table
+  UINT32  BaseLength;         ///< Length of the base table
+  UINT8   BaseSha256[ACPI_PATCHER_DELTA_DIGEST_SIZE];
+  UINT32  TableLength;        ///< Length of the rebuilt table
+  UINT8   TableSha256[ACPI_PATCHER_DELTA_DIGEST_SIZE];
+} ACPI_PATCHER_DELTA_HEADER;
+
+#pragma pack()
+
+#endif // __ACPI_PATCHER_DELTA_H__
@@ -0,0 +1,119 @@
+/** @file
+  ACPIPatcher binary log ring.
+
+  The patcher records fixed-size binary events (timestamp, level, message ID
+  and up to four integer arguments) into a ring buffer allocated from
+  EfiRuntimeServicesData and published in the EFI configuration table under
+  gAcpiPatcherLogTableGuid. Nothing is formatted on the target; the message
+  IDs below are decoded by Tools/DecodeAcpiLog.py, which must be kept in sync
+  with this file.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_LOG_H__
+#define __ACPI_PATCHER_LOG_H__
+
+#define ACPI_PATCHER_LOG_TABLE_GUID \
+  { 0x1b4dcd47, 0x09fe, 0x44a6, { 0x86, 0xf3, 0x3c, 0xa2, 0x91, 0x37, 0x3c, 0xa7 } }
+
+#define ACPI_PATCHER_LOG_SIGNATURE    SIGNATURE_32 ('A', 'P', 'L', 'G')
+#define ACPI_PATCHER_LOG_VERSION      1
+
+///
+/// Number of entries in the ring. Must be a power of two.
+///
+#define ACPI_PATCHER_LOG_ENTRIES      256
+
+#define ACPI_PATCHER_LOG_MAX_ARGS     4
+
+#pragma pack(1)
+
+///
+/// Ring header. Entries follow the header immediately.
+///
+typedef struct {
+  UINT32    Signature;          ///< ACPI_PATCHER_LOG_SIGNATURE
+  UINT16    Version;            ///< ACPI_PATCHER_LOG_VERSION
+  UINT16    EntrySize;          ///< sizeof (ACPI_PATCHER_LOG_ENTRY)
+  UINT32    EntryCount;         ///< Ring capacity, power of two
+  UINT32    WriteIndex;         ///< Total entries ever written; slot is WriteIndex % EntryCount
+  UINT32    RunCount;           ///< Number of patcher runs that attached to this ring
+  UINT32    Reserved;
+  UINT64    CounterFrequency;   ///< Timestamp ticks per second, 0 if unknown
+  UINT64    CounterStart;       ///< Counter start value from GetPerformanceCounterProperties ()
+  UINT64    CounterEnd;         ///< Counter end value from GetPerformanceCounterProperties ()
+} ACPI_PATCHER_LOG_HEADER;
+
+typedef struct {
+  UINT64    Timestamp;          ///< Raw GetPerformanceCounter () value
+  UINT16    MessageId;          ///< ACPI_LOG_MSG_*
+  UINT8     Level;              ///< DEBUG_ERROR .. DEBUG_VERBOSE
+  UINT8     ArgCount;
+  UINT32    Run;                ///< Patcher run number this entry belongs to
+  UINT64    Args[ACPI_PATCHER_LOG_MAX_ARGS];
+} ACPI_PATCHER_LOG_ENTRY;
+
+#pragma pack()
+
+///
+/// Message IDs. Values are part of the on-memory format; append only.
+///
+/// Arguments are raw integers. By convention a "name" argument holds the
+/// first eight ASCII characters of a file name packed little-endian, and a
+/// "signature" argument holds an ACPI table signature.
+///
+typedef enum {
+  ACPI_LOG_MSG_START               = 1,   ///< VersionMajor, VersionMinor
+  ACPI_LOG_MSG_FIRMWARE            = 2,   ///< FirmwareRevision, IsEfi1x
+  ACPI_LOG_MSG_RSDP_FOUND          = 3,   ///< Address, Revision
+  ACPI_LOG_MSG_RSDP_NOT_FOUND      = 4,   ///< Status
+  ACPI_LOG_MSG_XSDT_FOUND          = 5,   ///< Address, Length
+  ACPI_LOG_MSG_XSDT_INVALID        = 6,   ///< Signature
+  ACPI_LOG_MSG_FADT_FOUND          = 7,   ///< Address, XDsdt
+  ACPI_LOG_MSG_FADT_NOT_FOUND      = 8,   ///< EntriesScanned
+  ACPI_LOG_MSG_ACPI_DIR_FAILED     = 9,   ///< Status
+  ACPI_LOG_MSG_DIR_READ_FAILED     = 10,  ///< Status
+  ACPI_LOG_MSG_FILE_PROCESS        = 11,  ///< Name, FileSize
+  ACPI_LOG_MSG_FILE_OPEN_FAILED    = 12,  ///< Name, Status
+  ACPI_LOG_MSG_FILE_READ_FAILED    = 13,  ///< Name, Status
+  ACPI_LOG_MSG_TABLE_INVALID       = 14,  ///< Name, Status
+  ACPI_LOG_MSG_TABLE_CHECKSUM      = 15,  ///< Signature, Checksum
+  ACPI_LOG_MSG_DSDT_REPLACED       = 16,  ///< OldAddress, NewAddress
+  ACPI_LOG_MSG_TABLE_ADDED         = 17,  ///< Signature, Address, Length
+  ACPI_LOG_MSG_XSDT_FULL           = 18,  ///< MaxEntries, Name
+  ACPI_LOG_MSG_SUMMARY             = 19,  ///< Processed, Skipped, Added, XsdtEntries
+  ACPI_LOG_MSG_FINISHED            = 20,  ///< Status
+  ACPI_LOG_MSG_XSDT_REBUILT        = 21,  ///< OldAddress, NewAddress, Entries
+  ACPI_LOG_MSG_PROTOCOL_SUBMIT     = 22,  ///< TableCount, Pending
+  ACPI_LOG_MSG_PROTOCOL_COMMIT     = 23,  ///< TableCount, Status
+  ACPI_LOG_MSG_DRY_RUN             = 24,  ///< TableCount, DsdtReplaced
+  ACPI_LOG_MSG_EXPORT_TABLE        = 25,  ///< Signature, Length, Crc32
+  ACPI_LOG_MSG_EXPORT_DONE         = 26,  ///< TableCount, BytesWritten, Status
+  ACPI_LOG_MSG_CONSOLIDATED        = 27,  ///< TablesBefore, TablesAfter, BytesSaved
+  ACPI_LOG_MSG_PROFILE             = 28,  ///< ProfileKey, ProfileTables
+  ACPI_LOG_MSG_MEMORY              = 29,  ///< PeakBytes, ResidentBytes, DescriptorsBefore, DescriptorsAfter
+  ACPI_LOG_MSG_STATE_REUSED        = 30,  ///< FilesKept, TablesKept, TablesStale
+  ACPI_LOG_MSG_DIGEST_FAILED       = 31,  ///< Name, Status, Policy
+  ACPI_LOG_MSG_MANIFEST_MISSING    = 32,  ///< Status, Policy
+  ACPI_LOG_MSG_HOOK_ARMED          = 33,  ///< TablesLoaded, Status
+  ACPI_LOG_MSG_HOOK_REPLACED       = 34,  ///< Signature, OemTableId, Status
+  ACPI_LOG_MSG_HOOK_UNMATCHED      = 35,  ///< Signature, OemTableId, Status
+  ACPI_LOG_MSG_NV_LOADED           = 36,  ///< TableCount, Flags
+  ACPI_LOG_MSG_TABLE_DEFERRED      = 37,  ///< Name, ElapsedMs
+  ACPI_LOG_MSG_PERF_REGRESSED      = 38,  ///< TotalUs, BaselineUs
+  ACPI_LOG_MSG_DELTA_REFUSED       = 39,  ///< Name, Status
+  ACPI_LOG_MSG_CONFIG_REFUSED      = 40,  ///< Name, Status
+  ACPI_LOG_MSG_READ_SIZE_FAILED    = 41,  ///< TransferSize, Status
+  ACPI_LOG_MSG_READ_SIZE_CHOSEN    = 42   ///< TransferSize, KbPerSecond
+} ACPI_PATCHER_LOG_MESSAGE_ID;
+
+extern EFI_GUID gAcpiPatcherLogTableGuid;
+
+#endif // __ACPI_PATCHER_LOG_H__
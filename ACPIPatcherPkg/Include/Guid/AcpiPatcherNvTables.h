@@ -0,0 +1,78 @@
+/** @file
+  ACPIPatcher NVRAM table store.
+
+  Small tables needed on every machine can live in UEFI variables under
+  gAcpiPatcherNvTablesGuid instead of the ACPI folder, so the patcher reads
+  them without touching a file system. The index variable lists the
+  tables; table N is stored whole in the variable AcpiTableNN.
+
+  ACPIPatcher.efi --nv-add/--nv-remove/--nv-list/--nv-folder and
+  Tools/AcpiNvStore.py (through efivarfs) maintain the store.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_NV_TABLES_H__
+#define __ACPI_PATCHER_NV_TABLES_H__
+
+#define ACPI_PATCHER_NV_TABLES_GUID \
+  { 0x25ef1f6d, 0x89e0, 0x43c4, { 0xa2, 0xd3, 0x74, 0xe2, 0x63, 0x26, 0xbd, 0xbf } }
+
+#define ACPI_PATCHER_NV_INDEX_NAME      L"AcpiTableIndex"
+#define ACPI_PATCHER_NV_TABLE_FORMAT    L"AcpiTable%02u"
+
+#define ACPI_PATCHER_NV_SIGNATURE       SIGNATURE_32 ('A', 'P', 'N', 'V')
+#define ACPI_PATCHER_NV_VERSION         1
+#define ACPI_PATCHER_NV_NAME_SIZE       24
+
+#define ACPI_PATCHER_NV_ATTRIBUTES \
+  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+///
+/// Store limits. Tables are further limited by the variable storage the
+/// firmware reports, see ACPI_PATCHER_NV_RESERVE_DIVISOR.
+///
+#define ACPI_PATCHER_NV_MAX_TABLES      16
+#define ACPI_PATCHER_NV_MAX_TABLE_SIZE  SIZE_16KB
+
+///
+/// At least 1/4 of the variable storage is left free for the firmware
+///
+#define ACPI_PATCHER_NV_RESERVE_DIVISOR 4
+
+///
+/// Index flags
+///
+#define ACPI_PATCHER_NV_LOAD_FOLDER     BIT0    ///< Also load the ACPI folder; otherwise the file system is not touched
+
+#pragma pack(1)
+
+///
+/// Index header. TableCount entries follow; entry N describes AcpiTableNN.
+///
+typedef struct {
+  UINT32    Signature;          ///< ACPI_PATCHER_NV_SIGNATURE
+  UINT16    Version;            ///< ACPI_PATCHER_NV_VERSION
+  UINT16    EntrySize;          ///< sizeof (ACPI_PATCHER_NV_ENTRY)
+  UINT32    TableCount;
+  UINT32    Flags;              ///< ACPI_PATCHER_NV_*
+} ACPI_PATCHER_NV_INDEX;
+
+typedef struct {
+  UINT32    Signature;          ///< Table signature
+  UINT32    Length;             ///< Table length, equal to the variable size
+  UINT32    Crc32;              ///< CRC32 of the table
+  CHAR8     Name[ACPI_PATCHER_NV_NAME_SIZE];  ///< NUL-terminated file name the table came from
+} ACPI_PATCHER_NV_ENTRY;
+
+#pragma pack()
+
+extern EFI_GUID gAcpiPatcherNvTablesGuid;
+
+#endif // __ACPI_PATCHER_NV_TABLES_H__
@@ -0,0 +1,91 @@
+/** @file
+  ACPIPatcher cross-boot performance history.
+
+  Every committing run appends a compact timing record to a ring kept in
+  the non-volatile AcpiPerfHistory variable under
+  gAcpiPatcherPerfHistoryGuid. A run slower than the median of the earlier
+  records by more than its threshold sets the volatile AcpiPerfRegressed
+  variable, which the OS can read through efivarfs until the next boot.
+  Tools/DecodePerfHistory.py prints both.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_PERF_HISTORY_H__
+#define __ACPI_PATCHER_PERF_HISTORY_H__
+
+#define ACPI_PATCHER_PERF_HISTORY_GUID \
+  { 0x0227d19c, 0x3da2, 0x4459, { 0x92, 0xac, 0xe3, 0x04, 0xd3, 0x62, 0xd6, 0xab } }
+
+#define ACPI_PATCHER_PERF_HISTORY_NAME      L"AcpiPerfHistory"
+#define ACPI_PATCHER_PERF_REGRESSED_NAME    L"AcpiPerfRegressed"
+
+#define ACPI_PATCHER_PERF_SIGNATURE         SIGNATURE_32 ('A', 'P', 'P', 'H')
+#define ACPI_PATCHER_PERF_VERSION           1
+
+///
+/// Records kept in the ring
+///
+#define ACPI_PATCHER_PERF_RECORDS           16
+
+///
+/// Phase times, in the order of ACPI_PATCHER_PHASE
+///
+#define ACPI_PATCHER_PERF_PHASES            5
+
+#define ACPI_PATCHER_PERF_HISTORY_ATTRIBUTES \
+  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+#define ACPI_PATCHER_PERF_REGRESSED_ATTRIBUTES \
+  (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+///
+/// Record flags
+///
+#define ACPI_PATCHER_PERF_REGRESSED         BIT0    ///< Run exceeded the baseline by more than the threshold
+#define ACPI_PATCHER_PERF_DXE               BIT1    ///< Recorded by ACPIPatcherDxe
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32    TotalUs;                              ///< Sum of the phases
+  UINT32    PhaseUs[ACPI_PATCHER_PERF_PHASES];
+  UINT32    BytesRead;
+  UINT16    FilesRead;
+  UINT16    TablesInstalled;
+  UINT32    FirmwareRevision;                     ///< EFI_SYSTEM_TABLE.FirmwareRevision
+  UINT32    BaselineUs;                           ///< Median TotalUs of the earlier records, 0 if too few
+  UINT32    Flags;                                ///< ACPI_PATCHER_PERF_*
+} ACPI_PATCHER_PERF_RECORD;
+
+///
+/// History header. RecordCount records follow, oldest first; the variable
+/// never holds more than ACPI_PATCHER_PERF_RECORDS.
+///
+typedef struct {
+  UINT32    Signature;          ///< ACPI_PATCHER_PERF_SIGNATURE
+  UINT16    Version;            ///< ACPI_PATCHER_PERF_VERSION
+  UINT16    RecordSize;         ///< sizeof (ACPI_PATCHER_PERF_RECORD)
+  UINT32    RecordCount;
+  UINT32    RunCount;           ///< Runs recorded since the history was created
+} ACPI_PATCHER_PERF_HISTORY;
+
+///
+/// Contents of AcpiPerfRegressed
+///
+typedef struct {
+  UINT32    TotalUs;
+  UINT32    BaselineUs;
+  UINT32    ThresholdPercent;
+} ACPI_PATCHER_PERF_REGRESSION;
+
+#pragma pack()
+
+extern EFI_GUID gAcpiPatcherPerfHistoryGuid;
+
+#endif // __ACPI_PATCHER_PERF_HISTORY_H__
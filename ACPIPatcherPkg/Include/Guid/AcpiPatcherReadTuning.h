@@ -0,0 +1,86 @@
+/** @file
+  ACPIPatcher per-volume read tuning.
+
+  The auto read strategy reads table files in transfers of one of
+  ACPI_PATCHER_READ_TUNING_SIZES sizes. It samples each size on a volume
+  until every size has read enough to compare, then keeps the fastest. The
+  samples and the choice are kept across boots in the non-volatile
+  AcpiReadTuning variable under gAcpiPatcherReadTuningGuid, one entry per
+  volume device path and reader, so sampling may span several boots of a
+  machine with few tables.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_READ_TUNING_H__
+#define __ACPI_PATCHER_READ_TUNING_H__
+
+#define ACPI_PATCHER_READ_TUNING_GUID \
+  { 0xe6c716b2, 0xe4bc, 0x4cd3, { 0x9b, 0x47, 0x59, 0x3e, 0x7e, 0xef, 0x1b, 0xc0 } }
+
+#define ACPI_PATCHER_READ_TUNING_NAME       L"AcpiReadTuning"
+
+#define ACPI_PATCHER_READ_TUNING_SIGNATURE  SIGNATURE_32 ('A', 'P', 'R', 'T')
+#define ACPI_PATCHER_READ_TUNING_VERSION    1
+
+///
+/// Volumes remembered; the least recently updated one makes room for a new one
+///
+#define ACPI_PATCHER_READ_TUNING_VOLUMES    8
+
+///
+/// Transfer sizes sampled: 4 KB, 16 KB, 64 KB and the whole file
+///
+#define ACPI_PATCHER_READ_TUNING_SIZES      4
+
+///
+/// Chosen while no size has been chosen yet
+///
+#define ACPI_PATCHER_READ_TUNING_SAMPLING   0xFF
+
+#define ACPI_PATCHER_READ_TUNING_ATTRIBUTES \
+  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+///
+/// Reader values
+///
+#define ACPI_PATCHER_READ_TUNING_DRIVER     0       ///< Firmware file system driver
+#define ACPI_PATCHER_READ_TUNING_FAT        1       ///< Direct FAT reader (--fat)
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32    DevicePathCrc32;                      ///< CRC32 of the volume device path
+  UINT16    DevicePathSize;
+  UINT8     Reader;                               ///< ACPI_PATCHER_READ_TUNING_DRIVER or _FAT
+  UINT8     Chosen;                               ///< Index of the chosen size, or ACPI_PATCHER_READ_TUNING_SAMPLING
+  UINT8     FailedSizes;                          ///< Bit per size whose reads failed on this volume
+  UINT8     Reserved[3];
+  UINT32    FirmwareRevision;                     ///< EFI_SYSTEM_TABLE.FirmwareRevision when sampled
+  UINT32    LastUpdate;                           ///< Updates when this entry was last written
+  UINT64    SampleBytes[ACPI_PATCHER_READ_TUNING_SIZES];
+  UINT64    SampleNs[ACPI_PATCHER_READ_TUNING_SIZES];
+} ACPI_PATCHER_READ_TUNING_VOLUME;
+
+///
+/// Tuning header. VolumeCount volumes follow.
+///
+typedef struct {
+  UINT32    Signature;          ///< ACPI_PATCHER_READ_TUNING_SIGNATURE
+  UINT16    Version;            ///< ACPI_PATCHER_READ_TUNING_VERSION
+  UINT16    VolumeSize;         ///< sizeof (ACPI_PATCHER_READ_TUNING_VOLUME)
+  UINT32    VolumeCount;
+  UINT32    Updates;            ///< Times the variable was written
+} ACPI_PATCHER_READ_TUNING;
+
+#pragma pack()
+
+extern EFI_GUID gAcpiPatcherReadTuningGuid;
+
+#endif // __ACPI_PATCHER_READ_TUNING_H__
@@ -0,0 +1,74 @@
+/** @file
+  ACPIPatcher installed table record.
+
+  After committing its tables the patcher publishes a record of every file
+  it installed in the EFI configuration table under
+  gAcpiPatcherStateTableGuid. A later run in the same boot reads it back to
+  keep the tables of unchanged files, replace those of modified files in
+  place in the XSDT and remove those of deleted files, instead of appending
+  the whole folder again.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_STATE_H__
+#define __ACPI_PATCHER_STATE_H__
+
+#define ACPI_PATCHER_STATE_TABLE_GUID \
+  { 0xb904ec6b, 0x5895, 0x4e62, { 0xa9, 0xb5, 0xd4, 0x86, 0xd6, 0xec, 0xa0, 0x22 } }
+
+#define ACPI_PATCHER_STATE_SIGNATURE    SIGNATURE_32 ('A', 'P', 'S', 'T')
+#define ACPI_PATCHER_STATE_VERSION      1
+
+///
+/// Number of files the record holds
+///
+#define ACPI_PATCHER_STATE_ENTRIES      64
+
+#define ACPI_PATCHER_STATE_NAME_LENGTH  128
+
+///
+/// Entry flags
+///
+#define ACPI_PATCHER_STATE_DSDT         BIT0    ///< Table replaced the DSDT instead of being added to the XSDT
+#define ACPI_PATCHER_STATE_VERIFIED     BIT1    ///< File matched its Manifest.sha256 digest when installed
+
+#pragma pack(1)
+
+///
+/// Record header. EntryCapacity entries follow the header immediately.
+///
+typedef struct {
+  UINT32    Signature;          ///< ACPI_PATCHER_STATE_SIGNATURE
+  UINT16    Version;            ///< ACPI_PATCHER_STATE_VERSION
+  UINT16    EntrySize;          ///< sizeof (ACPI_PATCHER_STATE_ENTRY)
+  UINT32    EntryCapacity;      ///< ACPI_PATCHER_STATE_ENTRIES
+  UINT32    EntryCount;         ///< Valid entries
+  UINT32    RunCount;           ///< Committing runs that updated the record
+  UINT32    Reserved;
+  UINT64    Xsdt;               ///< XSDT built by the patcher, 0 if the firmware XSDT is in use
+  UINT64    FirmwareDsdt;       ///< DSDT to restore when the replacement goes away, 0 if not replaced
+} ACPI_PATCHER_STATE_HEADER;
+
+typedef struct {
+  CHAR16    Name[ACPI_PATCHER_STATE_NAME_LENGTH];
+  UINT64    Size;
+  EFI_TIME  ModificationTime;   ///< Zero for bundle entries
+  UINT32    Crc32;              ///< Bundle entry CRC32, 0 for plain files
+  UINT32    ProfileKey;         ///< Profile the file was loaded from
+  UINT32    Flags;              ///< ACPI_PATCHER_STATE_*
+  UINT32    Reserved;
+  UINT64    Address;            ///< Installed table; files merged into one SSDT share it
+} ACPI_PATCHER_STATE_ENTRY;
+
+#pragma pack()
+
+extern EFI_GUID gAcpiPatcherStateTableGuid;
+
+#endif // __ACPI_PATCHER_STATE_H__
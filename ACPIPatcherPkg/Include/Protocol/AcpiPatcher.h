@@ -0,0 +1,97 @@
+/** @file
+  ACPI Patcher protocol.
+
+  Installed by ACPIPatcherDxe. Lets other drivers hand ACPI tables they built
+  in memory (for example SSDTs describing CPU power states or PCIe device
+  properties) to the patcher without writing them to a filesystem first.
+
+  Tables are submitted in batches and installed together by Commit(), which
+  validates them and rebuilds the XSDT once.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __ACPI_PATCHER_PROTOCOL_H__
+#define __ACPI_PATCHER_PROTOCOL_H__
+
+#include <IndustryStandard/Acpi.h>
+
+#define ACPI_PATCHER_PROTOCOL_GUID \
+  { 0xf3b8f4f1, 0xba89, 0x4d95, { 0x93, 0xde, 0xd2, 0xeb, 0x7d, 0x0b, 0xd3, 0x69 } }
+
+#define ACPI_PATCHER_PROTOCOL_REVISION  0x00020000
+
+typedef struct _ACPI_PATCHER_PROTOCOL ACPI_PATCHER_PROTOCOL;
+
+/**
+  Queues tables for installation without copying them.
+
+  On success the patcher takes ownership of every buffer in Tables. Buffers
+  must have been allocated with gBS->AllocatePool () from EfiACPIReclaimMemory
+  or EfiRuntimeServicesData and must not be modified or freed by the caller
+  afterwards; the patcher frees any table it rejects. A table with the DSDT
+  signature replaces the DSDT; every other table is appended to the XSDT.
+
+  TableSizes gives the size of each buffer as allocated. Commit() checks
+  every table against it, so a header Length running past the buffer is
+  rejected instead of being read.
+
+  On failure nothing is queued and the caller keeps ownership.
+
+  @param[in] This         Protocol instance
+  @param[in] TableCount   Number of entries in Tables and TableSizes
+  @param[in] Tables       Tables to queue
+  @param[in] TableSizes   Size in bytes of each buffer in Tables
+
+  @retval EFI_SUCCESS             All tables queued
+  @retval EFI_INVALID_PARAMETER   Tables or TableSizes is NULL, TableCount is zero, an entry is NULL
+                                  or a buffer is smaller than an ACPI table header
+  @retval EFI_OUT_OF_RESOURCES    Batch does not fit into the remaining XSDT slots
+**/
+typedef
+EFI_STATUS
+(EFIAPI *ACPI_PATCHER_SUBMIT_TABLES)(
+  IN ACPI_PATCHER_PROTOCOL        *This,
+  IN UINTN                        TableCount,
+  IN EFI_ACPI_DESCRIPTION_HEADER  **Tables,
+  IN CONST UINTN                  *TableSizes
+  );
+
+/**
+  Validates every queued table and installs them with one XSDT rebuild.
+
+  Installation is all or nothing: if any queued table fails validation, no
+  table is installed, the queue is discarded and its buffers are freed. On
+  EFI_NOT_READY and EFI_OUT_OF_RESOURCES nothing is installed either, but
+  the queue is kept and Commit() may be called again.
+
+  @param[in] This         Protocol instance
+
+  @retval EFI_SUCCESS             All queued tables installed, or queue empty
+  @retval EFI_INVALID_PARAMETER   This is NULL, or a queued table failed validation against its
+                                  buffer size (zero signature, or a Length shorter than the
+                                  header or past the end of the buffer)
+  @retval EFI_NOT_READY           RSDP, XSDT or FADT is not published, or is malformed
+  @retval EFI_OUT_OF_RESOURCES    New XSDT could not be allocated
+**/
+typedef
+EFI_STATUS
+(EFIAPI *ACPI_PATCHER_COMMIT)(
+  IN ACPI_PATCHER_PROTOCOL        *This
+  );
+
+struct _ACPI_PATCHER_PROTOCOL {
+  UINT64                      Revision;
+  ACPI_PATCHER_SUBMIT_TABLES  SubmitTables;
+  ACPI_PATCHER_COMMIT         Commit;
+};
+
+extern EFI_GUID gAcpiPatcherProtocolGuid;
+
+#endif // __ACPI_PATCHER_PROTOCOL_H__
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+## @file
+#  Compiles an ACPIPatcher device property config the way ACPIPatcher does.
+#
+#  A config such as SSDT-PROPS.aml.cfg in the ACPI folder (the format is
+#  described in ACPIPatcher/AcpiAml.h) is compiled to one SSDT at boot.
+#  This tool writes the same table, byte for byte, so a config can be
+#  checked before it is deployed and the result disassembled with
+#  `iasl -d`. The OEM ID comes from the firmware XSDT at boot; pass
+#  --oem-id to match it here.
+#
+#  Usage:
+#    AcpiAmlConfig.py SSDT-PROPS.aml.cfg [-o SSDT-PROPS.aml] [--oem-id ID]
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import re
+import struct
+import sys
+
+# Must match ACPIPatcher/AcpiAml.h and ACPIPatcher.h
+OEM_TABLE_ID         = b'APCONFIG'
+CREATOR_ID           = b'APCH'
+CREATOR_REVISION     = (1 << 16) | 1
+MAX_PROPERTIES       = 256
+MAX_DSM_PROPERTIES   = 127
+MAX_SEGMENTS         = 16
+
+SEGMENT = re.compile(r'^[A-Z_][A-Z0-9_]{0,3}$')
+BLANKS  = ' \t\r'
+
+
+def PkgLength(Body):
+  """Prefixes Body with its shortest PkgLength, which counts its own bytes."""
+  for Size, Limit in ((1, 0x3F), (2, 0xFFF), (3, 0xFFFFF), (4, 0xFFFFFFF)):
+    Length = len(Body) + Size
+    if Length <= Limit:
+      break
+  if Size == 1:
+    return bytes([Length]) + Body
+  Lead = ((Size - 1) << 6) | (Length & 0x0F)
+  return bytes([Lead]) + (Length >> 4).to_bytes(Size - 1, 'little') + Body
+
+
+def Integer(Value):
+  if Value == 0:
+    return b'\x00'
+  if Value == 1:
+    return b'\x01'
+  if Value == 0xFFFFFFFFFFFFFFFF:
+    return b'\xFF'
+  for Prefix, Width in ((0x0A, 1), (0x0B, 2), (0x0C, 4), (0x0E, 8)):
+    if Value < 1 << (8 * Width):
+      return bytes([Prefix]) + Value.to_bytes(Width, 'little')
+
+
+def String(Text):
+  return b'\x0D' + Text.encode('ascii') + b'\x00'
+
+
+def NameString(Path):
+  Segments = Path[1:].split('.')
+  if (not Path.startswith('\\') or len(Segments) > MAX_SEGMENTS or
+      not all(SEGMENT.match(Segment) for Segment in Segments)):
+    raise ValueError('device path must be absolute, with segments of up to four A-Z, 0-9 or _')
+  Encoded = b''.join(Segment.ljust(4, '_').encode('ascii') for Segment in Segments)
+  if len(Segments) == 1:
+    return b'\\' + Encoded
+  if len(Segments) == 2:
+    return b'\\\x2E' + Encoded
+  return b'\\\x2F' + bytes([len(Segments)]) + Encoded
+
+
+def ParseLine(Line):
+  """Returns (NameString, Property, Type, Value) for one config line."""
+  Fields = Line.split(None, 3)
+  while len(Fields) < 4:
+    Fields.append('')
+  Path, Property, Type, Value = Fields
+  Value = Value.strip(BLANKS)
+  if not Value and Type != 'string':
+    raise ValueError('expected <path> <property> <string|int|data> <value>')
+  Name = NameString(Path)
+  if any(Char < '!' or Char > '~' for Char in Property):
+    raise ValueError('property names are limited to printable ASCII')
+
+  if Type == 'string':
+    if len(Value) >= 2 and Value[0] == '"' and Value[-1] == '"':
+      Value = Value[1:-1]
+    if any(Char < ' ' or Char > '~' for Char in Value):
+      raise ValueError('strings are limited to printable ASCII')
+    Value = String(Value)
+  elif Type == 'int':
+    Match = re.match(r'^(?:0[xX]([0-9A-Fa-f]+)|([0-9]+))$', Value)
+    Number = (int(Match.group(1), 16) if Match.group(1) else int(Match.group(2))) if Match else -1
+    if Number < 0 or Number >> 64:
+      raise ValueError('int values are decimal or 0x hex and fit 64 bits')
+    Value = Integer(Number)
+  elif Type == 'data':
+    # Blanks may separate bytes, not split them
+    Chunks = re.split('[ \t\r]+', Value)
+    if not all(re.match(r'^([0-9A-Fa-f]{2})+$', Chunk) for Chunk in Chunks):
+      raise ValueError('data values are one or more hex bytes')
+    Data = bytes.fromhex(''.join(Chunks))
+    Value = b'\x11' + PkgLength(Integer(len(Data)) + Data)
+  else:
+    raise ValueError('type must be string, int or data')
+
+  if Property == '_STA' and Type != 'int':
+    raise ValueError('_STA takes an int value')
+  return Name, Property, Value
+
+
+def Compile(Text, OemId):
+  Properties = []
+  Errors = []
+  for Number, Line in enumerate(Text.split('\n'), 1):
+    Line = Line.strip(BLANKS)
+    if not Line or Line.startswith('#'):
+      continue
+    if len(Properties) == MAX_PROPERTIES:
+      raise ValueError('line %u: more than %u properties' % (Number, MAX_PROPERTIES))
+    try:
+      Name, Property, Value = ParseLine(Line)
+      Same = [Other for Other in Properties if Other[0] == Name]
+      if any(Other[1] == Property for Other in Same):
+        raise ValueError('property already set for this device')
+      if Property != '_STA' and sum(1 for Other in Same if Other[1] != '_STA') == MAX_DSM_PROPERTIES:
+        raise ValueError('too many properties for this device')
+      Properties.append((Name, Property, Value))
+    except ValueError as Error:
+      Errors.append('line %u: %s' % (Number, Error))
+  if Errors:
+    raise ValueError('\n  '.join(['config not compiled:'] + Errors))
+  if not Properties:
+    raise ValueError('the config declares no properties')
+
+  Body = b''
+  Devices = []
+  for Name, _, _ in Properties:
+    if Name not in Devices:
+      Devices.append(Name)
+  for Device in Devices:
+    Scope = Device
+    Listed = []
+    for Name, Property, Value in Properties:
+      if Name != Device:
+        continue
+      if Property == '_STA':
+        Scope += b'\x08_STA' + Value
+      else:
+        Listed.append(String(Property) + Value)
+    if Listed:
+      Probe = b'\xA0' + PkgLength(b'\x93\x6A\x00\xA4\x11' + PkgLength(b'\x01\x03'))
+      Package = b'\xA4\x12' + PkgLength(bytes([2 * len(Listed)]) + b''.join(Listed))
+      Scope += b'\x14' + PkgLength(b'_DSM\x04' + Probe + Package)
+    Body += b'\x15' + Device + b'\x06\x00' + b'\x10' + PkgLength(Scope)
+
+  Header = struct.pack('<4sIBB6s8sI4sI', b'SSDT', 36 + len(Body), 2, 0, OemId, OEM_TABLE_ID,
+                       len(Properties), CREATOR_ID, CREATOR_REVISION)
+  Table = bytearray(Header + Body)
+  Table[9] = -sum(Table) & 0xFF
+  return bytes(Table), len(Devices), len(Properties)
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='Compile an ACPIPatcher device property config to an SSDT.')
+  Parser.add_argument('Config')
+  Parser.add_argument('-o', dest='Output', help='table file, default the config name without .cfg')
+  Parser.add_argument('--oem-id', default='', help='OEM ID of the firmware XSDT, up to 6 characters')
+  Args = Parser.parse_args()
+
+  try:
+    OemId = Args.oem_id.encode('ascii')
+    if len(OemId) > 6:
+      raise ValueError('OEM IDs are at most 6 characters')
+    with open(Args.Config, 'rb') as File:
+      Text = File.read().decode('ascii')
+    Table, Devices, Properties = Compile(Text, OemId.ljust(6, b' '))
+    Output = Args.Output or (Args.Config[:-len('.cfg')] if Args.Config.endswith('.cfg') else Args.Config + '.aml')
+    with open(Output, 'wb') as File:
+      File.write(Table)
+    print('%s: %u bytes, %u properties on %u devices' % (Output, len(Table), Properties, Devices))
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+## @file
+#  Builds, lists and unpacks ACPIPatcher table bundles.
+#
+#  A bundle (see Include/AcpiPatcherBundle.h) holds several ACPI tables in
+#  one file, as written by `ACPIPatcher.efi --export DIR --bundle`. Unpacking
+#  produces the same SIG-OEMTABLEID-N.aml files and Manifest.sha256 as a plain
+#  export, so two dumps can be compared with diff regardless of how they were
+#  taken.
+#
+#  Tables for one platform model live in a P-XXXXXXXX profile subdirectory
+#  of the ACPI folder, or in the bundle section with that profile key. The
+#  hash command prints the keys ACPIPatcher derives for a machine, and build
+#  packs an ACPI folder, profile subdirectories included, into TABLES.BND.
+#  digest writes the Manifest.sha256 that ACPIPatcher --verify checks tables
+#  against, covering the same tables plus those of TABLES.BND if present.
+#
+#  embed writes ACPIPatcher/EmbeddedTables.c from an ACPI folder or bundle,
+#  linking the tables into the next build of ACPIPatcher.efi and
+#  ACPIPatcherDxe.efi. With --only the image never opens the ACPI folder.
+#
+#  Usage:
+#    AcpiBundle.py list TABLES.BND
+#    AcpiBundle.py extract TABLES.BND OutDir
+#    AcpiBundle.py hash --table XSDT.aml [--product NAME]
+#    AcpiBundle.py hash --oem-id ID --oem-table-id ID [--product NAME]
+#    AcpiBundle.py build AcpiDir TABLES.BND
+#    AcpiBundle.py digest AcpiDir
+#    AcpiBundle.py embed AcpiDir|TABLES.BND EmbeddedTables.c [--only]
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import hashlib
+import os
+import re
+import struct
+import sys
+import zlib
+
+BUNDLE_SIGNATURE = b'APBN'
+BUNDLE_VERSION   = 2
+BUNDLE_ALIGN     = 8
+NAME_SIZE        = 24
+
+HEADER_FORMAT = '<4sHHIIQ'
+HEADER_SIZE   = struct.calcsize(HEADER_FORMAT)
+
+# Version 1 entries have no profile key
+ENTRY_FORMATS = {1: '<4sIII24s', 2: '<4sIIII24s'}
+ENTRY_FORMAT  = ENTRY_FORMATS[BUNDLE_VERSION]
+ENTRY_SIZE    = struct.calcsize(ENTRY_FORMAT)
+
+# Must match AcpiRules.c
+FNV32_OFFSET_BASIS = 0x811C9DC5
+FNV32_PRIME        = 0x01000193
+OEM_ID_SIZE        = 6
+OEM_TABLE_ID_SIZE  = 8
+PRODUCT_SIZE       = 63
+PROFILE_DIR        = re.compile(r'^P-([0-9A-Fa-f]{8})$')
+
+# Must match AcpiManifest.h
+DIGEST_MANIFEST    = 'Manifest.sha256'
+BUNDLE_FILE        = 'TABLES.BND'
+
+# Must match AcpiSource.h
+OPTIONAL_DIR       = 'Optional'
+
+
+def ProfileDir(Key):
+  return 'P-%08X' % Key
+
+
+def ProfileField(Value, Size):
+  if isinstance(Value, str):
+    Value = Value.encode('ascii')
+  return Value[:Size].split(b'\0', 1)[0].rstrip(b' ')
+
+
+def ProfileKey(OemId, OemTableId, Product=None):
+  Fields = [ProfileField(OemId, OEM_ID_SIZE), ProfileField(OemTableId, OEM_TABLE_ID_SIZE)]
+  if Product is not None:
+    Fields.append(ProfileField(Product, PRODUCT_SIZE))
+  Hash = FNV32_OFFSET_BASIS
+  for Field in Fields:
+    for Byte in Field + b'\0':
+      Hash = ((Hash ^ Byte) * FNV32_PRIME) & 0xFFFFFFFF
+  # 0 is the common key
+  return Hash or 1
+
+
+def ReadBundle(Data):
+  Signature, Version, EntrySize, TableCount, _, TotalSize = struct.unpack_from(HEADER_FORMAT, Data)
+  EntryFormat = ENTRY_FORMATS.get(Version)
+  if Signature != BUNDLE_SIGNATURE or EntryFormat is None or EntrySize != struct.calcsize(EntryFormat):
+    raise ValueError('unsupported bundle (signature %r, version %d, entry size %d)' %
+                     (Signature, Version, EntrySize))
+  if TotalSize > len(Data):
+    raise ValueError('bundle truncated: %d of %d bytes' % (len(Data), TotalSize))
+
+  Tables = []
+  for Index in range(TableCount):
+    Fields = struct.unpack_from(EntryFormat, Data, HEADER_SIZE + Index * EntrySize)
+    Sig, Offset, Length, Crc = Fields[:4]
+    Key   = Fields[4] if Version >= 2 else 0
+    Name  = Fields[-1].split(b'\0', 1)[0].decode('ascii', 'replace')
+    if Key != 0:
+      Name = '%s/%s' % (ProfileDir(Key), Name)
+    Table = Data[Offset:Offset + Length]
+    if len(Table) != Length:
+      raise ValueError('%s extends past the end of the bundle' % Name)
+    if zlib.crc32(Table) != Crc:
+      raise ValueError('%s: crc32 mismatch' % Name)
+    Tables.append((Name, Sig.decode('ascii', 'replace'), Crc, Table))
+  return Tables
+
+
+def WriteBundle(Tables):
+  """Packs (Key, Name, Table) tuples, in load order, into a bundle."""
+  Offset  = HEADER_SIZE + len(Tables) * ENTRY_SIZE
+  Entries = []
+  Body    = []
+  for Key, Name, Table in Tables:
+    Pad     = -Offset % BUNDLE_ALIGN
+    Offset += Pad
+    Body.append(b'\0' * Pad + Table)
+    Entries.append(struct.pack(ENTRY_FORMAT, Table[:4], Offset, len(Table), zlib.crc32(Table), Key,
+                               Name.encode('ascii')))
+    Offset += len(Table)
+  Offset += -Offset % BUNDLE_ALIGN
+  Header = struct.pack(HEADER_FORMAT, BUNDLE_SIGNATURE, BUNDLE_VERSION, ENTRY_SIZE, len(Tables), 0, Offset)
+  Data   = Header + b''.join(Entries) + b''.join(Body)
+  return Data + b'\0' * (Offset - len(Data))
+
+
+def CollectTables(Directory, Key):
+  """Returns the tables ACPIPatcher would load from one directory, in name order."""
+  Tables = []
+  for Name in sorted(os.listdir(Directory)):
+    Path = os.path.join(Directory, Name)
+    if Name.startswith(('.', '_')) or '.aml' not in Name or not os.path.isfile(Path):
+      continue
+    if len(Name.encode('ascii')) >= NAME_SIZE:
+      raise ValueError('%s: name longer than %d characters' % (Path, NAME_SIZE - 1))
+    with open(Path, 'rb') as File:
+      Tables.append((Key, Name, File.read()))
+  return Tables
+
+
+def BuildBundle(AcpiDir):
+  Tables = CollectTables(AcpiDir, 0)
+  for Name in sorted(os.listdir(AcpiDir)):
+    Match = PROFILE_DIR.match(Name)
+    if Match and os.path.isdir(os.path.join(AcpiDir, Name)):
+      Tables += CollectTables(os.path.join(AcpiDir, Name), int(Match.group(1), 16))
+  return WriteBundle(Tables)
+
+
+def DigestManifest(AcpiDir):
+  """Returns Manifest.sha256 text for the tables ACPIPatcher would load from AcpiDir."""
+  # Plain files replace bundle entries of the same name, as in AcpiSource.c
+  Digests = {}
+  BundlePath = os.path.join(AcpiDir, BUNDLE_FILE)
+  if os.path.isfile(BundlePath):
+    with open(BundlePath, 'rb') as File:
+      for Name, _, _, Table in ReadBundle(File.read()):
+        Digests[Name.upper()] = (Name, hashlib.sha256(Table).hexdigest())
+
+  Dirs = [('', AcpiDir)]
+  if os.path.isdir(os.path.join(AcpiDir, OPTIONAL_DIR)):
+    Dirs.insert(0, (OPTIONAL_DIR + '/', os.path.join(AcpiDir, OPTIONAL_DIR)))
+  for Name in sorted(os.listdir(AcpiDir)):
+    if PROFILE_DIR.match(Name) and os.path.isdir(os.path.join(AcpiDir, Name)):
+      Dirs.append((ProfileDir(int(Name[2:], 16)) + '/', os.path.join(AcpiDir, Name)))
+  for Prefix, Directory in Dirs:
+    for Name in sorted(os.listdir(Directory)):
+      Path = os.path.join(Directory, Name)
+      if Name.startswith(('.', '_')) or '.aml' not in Name or not os.path.isfile(Path):
+        continue
+      with open(Path, 'rb') as File:
+        Digests[(Prefix + Name).upper()] = (Prefix + Name, hashlib.sha256(File.read()).hexdigest())
+
+  return DigestText(sorted(Digests.values()))
+
+
+def DigestText(Digests):
+  """Formats (name, hex digest) pairs as Manifest.sha256, as ACPIPatcher --export writes it."""
+  Lines = ['# ACPIPatcher table digests (%u tables)\n' % len(Digests)]
+  for Name, Digest in Digests:
+    Lines.append('%s  %s\n' % (Digest, Name))
+  return ''.join(Lines)
+
+
+def PrintKeys(Args):
+  if Args.table:
+    with open(Args.table, 'rb') as File:
+      Header = File.read(36)
+    if len(Header) < 36:
+      raise ValueError('%s is not an ACPI table' % Args.table)
+    OemId, OemTableId = Header[10:16], Header[16:24]
+  elif Args.oem_id is not None and Args.oem_table_id is not None:
+    OemId, OemTableId = Args.oem_id, Args.oem_table_id
+  else:
+    raise ValueError('give --table, or both --oem-id and --oem-table-id')
+
+  Label = '%s %s' % (ProfileField(OemId, OEM_ID_SIZE).decode('ascii', 'replace'),
+                     ProfileField(OemTableId, OEM_TABLE_ID_SIZE).decode('ascii', 'replace'))
+  if Args.product and ProfileField(Args.product, PRODUCT_SIZE):
+    sys.stdout.write('%s  %s, %s\n' % (ProfileDir(ProfileKey(OemId, OemTableId, Args.product)), Label,
+                                         Args.product))
+  sys.stdout.write('%s  %s\n' % (ProfileDir(ProfileKey(OemId, OemTableId)), Label))
+
+
+def EmbedSource(Data, Origin, Only):
+  """Returns EmbeddedTables.c linking bundle Data into the image."""
+  Data += b'\0' * (-len(Data) % 8)
+  Words = struct.unpack('<%uQ' % (len(Data) // 8), Data)
+  Lines = [
+    '/** @file\n',
+    '\n',
+    '  Tables linked into the ACPIPatcher image.\n',
+    '\n',
+    '  Generated by Tools/AcpiBundle.py embed from %s; do not edit.\n' % Origin,
+    '  %u tables, %u bytes.\n' % (len(ReadBundle(Data)), len(Data)),
+    '\n',
+    '**/\n',
+    '\n',
+    '#include "AcpiSource.h"\n',
+    '\n',
+    'CONST BOOLEAN  gAcpiEmbeddedOnly       = %s;\n' % ('TRUE' if Only else 'FALSE'),
+    'CONST UINTN    gAcpiEmbeddedTablesSize = %u;\n' % len(Data),
+    '\n',
+    '// Little-endian bundle; UINT64 keeps the headers aligned on every architecture\n',
+    'CONST UINT64   gAcpiEmbeddedTables[]   = {\n',
+  ]
+  for Index in range(0, len(Words), 4):
+    Lines.append('  %s,\n' % ', '.join('0x%016x' % Word for Word in Words[Index:Index + 4]))
+  Lines.append('};\n')
+  return ''.join(Lines)
+
+
+def Manifest(Tables):
+  Lines = ['# crc32   length    name (%u tables)\n' % len(Tables)]
+  for Name, _, Crc, Table in Tables:
+    Lines.append('%08x  %8u  %s\n' % (Crc, len(Table), Name))
+  return ''.join(Lines)
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='Build, list or unpack an ACPIPatcher table bundle.')
+  Sub = Parser.add_subparsers(dest='Command', required=True)
+  Sub.add_parser('list').add_argument('Bundle')
+  Extract = Sub.add_parser('extract')
+  Extract.add_argument('Bundle')
+  Extract.add_argument('OutDir')
+  Hash = Sub.add_parser('hash', help='print the profile directories a machine would use')
+  Hash.add_argument('--table', help='exported XSDT (or FACP, if the XSDT OEM table ID is blank)')
+  Hash.add_argument('--oem-id')
+  Hash.add_argument('--oem-table-id')
+  Hash.add_argument('--product', help='SMBIOS type 1 product name, e.g. from dmidecode -s system-product-name')
+  Build = Sub.add_parser('build', help='pack an ACPI folder and its profile subdirectories')
+  Build.add_argument('AcpiDir')
+  Build.add_argument('Bundle')
+  Digest = Sub.add_parser('digest', help='write Manifest.sha256 for ACPIPatcher --verify')
+  Digest.add_argument('AcpiDir')
+  Embed = Sub.add_parser('embed', help='write EmbeddedTables.c to link tables into the ACPIPatcher image')
+  Embed.add_argument('Source', help='ACPI folder or bundle')
+  Embed.add_argument('Output')
+  Embed.add_argument('--only', action='store_true', help='never open the ACPI folder on the target')
+  Args = Parser.parse_args()
+
+  try:
+    if Args.Command == 'hash':
+      PrintKeys(Args)
+      return 0
+    if Args.Command == 'build':
+      Data = BuildBundle(Args.AcpiDir)
+      with open(Args.Bundle, 'wb') as File:
+        File.write(Data)
+      sys.stdout.write(Manifest(ReadBundle(Data)))
+      return 0
+    if Args.Command == 'embed':
+      if os.path.isdir(Args.Source):
+        Data = BuildBundle(Args.Source)
+      else:
+        with open(Args.Source, 'rb') as File:
+          Data = File.read()
+      Tables = ReadBundle(Data)
+      with open(Args.Output, 'w', newline='\n') as File:
+        File.write(EmbedSource(Data, os.path.basename(os.path.normpath(Args.Source)), Args.only))
+      sys.stdout.write(Manifest(Tables))
+      return 0
+    if Args.Command == 'digest':
+      Text = DigestManifest(Args.AcpiDir)
+      with open(os.path.join(Args.AcpiDir, DIGEST_MANIFEST), 'w', newline='\n') as File:
+        File.write(Text)
+      sys.stdout.write(Text)
+      return 0
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+
+  with open(Args.Bundle, 'rb') as File:
+    Data = File.read()
+
+  try:
+    Tables = ReadBundle(Data)
+  except (ValueError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+
+  if Args.Command == 'list':
+    sys.stdout.write(Manifest(Tables))
+    return 0
+
+  os.makedirs(Args.OutDir, exist_ok=True)
+  for Name, _, _, Table in Tables:
+    os.makedirs(os.path.dirname(os.path.join(Args.OutDir, Name)), exist_ok=True)
+    with open(os.path.join(Args.OutDir, Name), 'wb') as File:
+      File.write(Table)
+  with open(os.path.join(Args.OutDir, DIGEST_MANIFEST), 'w', newline='\n') as File:
+    File.write(DigestText([(Name, hashlib.sha256(Table).hexdigest()) for Name, _, _, Table in Tables]))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+## @file
+#  Makes and applies ACPIPatcher table deltas.
+#
+#  A delta (see Include/AcpiPatcherDelta.h) rebuilds a table from the
+#  firmware's copy of it, so replacing a DSDT that differs from the
+#  firmware's in a few places only reads the differences at boot. Take the
+#  base from the machine itself, for example with
+#  `ACPIPatcher.efi --export DIR`, and put the delta in the ACPI folder as
+#  DSDT.aml.delta instead of DSDT.aml. ACPIPatcher refuses a delta whose
+#  base does not match the firmware table byte for byte.
+#
+#  Usage:
+#    AcpiDelta.py make DSDT-BASE.aml DSDT.aml [-o DSDT.aml.delta]
+#    AcpiDelta.py apply DSDT-BASE.aml DSDT.aml.delta [-o DSDT.aml]
+#    AcpiDelta.py info DSDT.aml.delta
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import hashlib
+import struct
+import sys
+
+# Must match Include/AcpiPatcherDelta.h
+DELTA_SIGNATURE = b'APDL'
+DELTA_VERSION   = 1
+OP_END          = 0x00
+OP_COPY         = 0x01
+OP_INSERT       = 0x02
+
+HEADER_FORMAT = '<4sHH4s8sI32sI32s'
+HEADER_SIZE   = struct.calcsize(HEADER_FORMAT)
+
+# Shorter matches cost more as a copy than as inserted bytes
+BLOCK_SIZE      = 8
+MIN_MATCH       = 12
+MAX_CANDIDATES  = 8
+
+
+def Number(Value):
+  Data = bytearray()
+  while True:
+    Byte = Value & 0x7F
+    Value >>= 7
+    if Value:
+      Data.append(Byte | 0x80)
+    else:
+      Data.append(Byte)
+      return bytes(Data)
+
+
+def ReadNumber(Data, Offset):
+  Value = 0
+  for Shift in range(0, 35, 7):
+    if Offset >= len(Data):
+      break
+    Byte = Data[Offset]
+    Offset += 1
+    Value |= (Byte & 0x7F) << Shift
+    if not Byte & 0x80:
+      if Value > 0xFFFFFFFF:
+        break
+      return Value, Offset
+  raise ValueError('malformed delta operand at offset %u' % Offset)
+
+
+def CheckTable(Data, Name):
+  if len(Data) < 36 or struct.unpack_from('<I', Data, 4)[0] != len(Data):
+    raise ValueError('%s is not an ACPI table' % Name)
+
+
+def Diff(Base, Table):
+  """Returns the operations rebuilding Table from Base, as (Op, Value, Length) tuples."""
+  Index = {}
+  for Offset in range(len(Base) - BLOCK_SIZE + 1):
+    Candidates = Index.setdefault(Base[Offset:Offset + BLOCK_SIZE], [])
+    if len(Candidates) < MAX_CANDIDATES:
+      Candidates.append(Offset)
+
+  Ops = []
+  Literal = bytearray()
+  Expected = 0
+  Position = 0
+  while Position < len(Table):
+    Best, BestLength = None, 0
+    # Continuing the previous copy is the most likely match
+    for Offset in [Expected] + Index.get(Table[Position:Position + BLOCK_SIZE], []):
+      Length = 0
+      while (Offset + Length < len(Base) and Position + Length < len(Table) and
+             Base[Offset + Length] == Table[Position + Length]):
+        Length += 1
+      if Length > BestLength:
+        Best, BestLength = Offset, Length
+
+    if BestLength < MIN_MATCH:
+      Literal.append(Table[Position])
+      Position += 1
+      continue
+    if Literal:
+      Ops.append((OP_INSERT, bytes(Literal), len(Literal)))
+      Literal = bytearray()
+    Ops.append((OP_COPY, Best, BestLength))
+    Position += BestLength
+    Expected  = Best + BestLength
+
+  if Literal:
+    Ops.append((OP_INSERT, bytes(Literal), len(Literal)))
+  return Ops
+
+
+def MakeDelta(Base, Table):
+  Header = struct.pack(HEADER_FORMAT, DELTA_SIGNATURE, DELTA_VERSION, HEADER_SIZE, Base[:4], Base[16:24],
+                       len(Base), hashlib.sha256(Base).digest(), len(Table), hashlib.sha256(Table).digest())
+  Body = bytearray()
+  Ops = Diff(Base, Table)
+  for Op, Value, Length in Ops:
+    if Op == OP_COPY:
+      Body += bytes([OP_COPY]) + Number(Value) + Number(Length)
+    else:
+      Body += bytes([OP_INSERT]) + Number(Length) + Value
+  Body.append(OP_END)
+  return Header + bytes(Body), Ops
+
+
+def ParseHeader(Delta):
+  if len(Delta) < HEADER_SIZE:
+    raise ValueError('delta is truncated')
+  Fields = struct.unpack_from(HEADER_FORMAT, Delta)
+  if Fields[0] != DELTA_SIGNATURE or Fields[1] != DELTA_VERSION or Fields[2] < HEADER_SIZE:
+    raise ValueError('unsupported delta (signature %r, version %d)' % (Fields[0], Fields[1]))
+  return Fields
+
+
+def ApplyDelta(Base, Delta):
+  _, _, HeaderSize, BaseSig, BaseOemTableId, BaseLength, BaseSha, Length, Sha = ParseHeader(Delta)
+  if (Base[:4] != BaseSig or Base[16:24] != BaseOemTableId or len(Base) != BaseLength or
+      hashlib.sha256(Base).digest() != BaseSha):
+    raise ValueError('the base table is not the one the delta was made against')
+
+  Table = bytearray()
+  Offset = HeaderSize
+  while True:
+    if Offset >= len(Delta):
+      raise ValueError('delta has no end')
+    Op = Delta[Offset]
+    Offset += 1
+    if Op == OP_END:
+      break
+    elif Op == OP_COPY:
+      Start, Offset = ReadNumber(Delta, Offset)
+      Count, Offset = ReadNumber(Delta, Offset)
+      if Start + Count > len(Base):
+        raise ValueError('copy beyond the base table')
+      Table += Base[Start:Start + Count]
+    elif Op == OP_INSERT:
+      Count, Offset = ReadNumber(Delta, Offset)
+      if Offset + Count > len(Delta):
+        raise ValueError('insert beyond the delta')
+      Table += Delta[Offset:Offset + Count]
+      Offset += Count
+    else:
+      raise ValueError('unknown delta operation 0x%02x' % Op)
+  if len(Table) != Length or hashlib.sha256(Table).digest() != Sha:
+    raise ValueError('the rebuilt table does not match its digest')
+  return bytes(Table)
+
+
+def Read(Path):
+  with open(Path, 'rb') as File:
+    return File.read()
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='Make or apply ACPIPatcher table deltas.')
+  Sub = Parser.add_subparsers(dest='Command', required=True)
+  Make = Sub.add_parser('make', help='write a delta rebuilding Table from Base')
+  Make.add_argument('Base')
+  Make.add_argument('Table')
+  Make.add_argument('-o', dest='Output', help='delta file, default Table.delta')
+  Apply = Sub.add_parser('apply', help='rebuild a table as ACPIPatcher would')
+  Apply.add_argument('Base')
+  Apply.add_argument('Delta')
+  Apply.add_argument('-o', dest='Output', help='rebuilt table, default the delta name without .delta')
+  Sub.add_parser('info').add_argument('Delta')
+  Args = Parser.parse_args()
+
+  try:
+    if Args.Command == 'make':
+      Base, Table = Read(Args.Base), Read(Args.Table)
+      CheckTable(Base, Args.Base)
+      CheckTable(Table, Args.Table)
+      if Base[:4] != b'DSDT':
+        sys.stderr.write('warning: ACPIPatcher only applies DSDT deltas\n')
+      Delta, Ops = MakeDelta(Base, Table)
+      # Never ship a delta that does not round trip
+      if ApplyDelta(Base, Delta) != Table:
+        raise ValueError('internal error: delta does not rebuild %s' % Args.Table)
+      Output = Args.Output or Args.Table + '.delta'
+      with open(Output, 'wb') as File:
+        File.write(Delta)
+      Copied = sum(Length for Op, _, Length in Ops if Op == OP_COPY)
+      print('%s: %u bytes read at boot instead of %u (%.1f%%), %u of %u table bytes copied from the base' %
+            (Output, len(Delta), len(Table), 100.0 * len(Delta) / len(Table), Copied, len(Table)))
+    elif Args.Command == 'apply':
+      Table = ApplyDelta(Read(Args.Base), Read(Args.Delta))
+      Output = Args.Output or (Args.Delta[:-len('.delta')] if Args.Delta.endswith('.delta') else Args.Delta + '.aml')
+      with open(Output, 'wb') as File:
+        File.write(Table)
+      print('%s: %u bytes' % (Output, len(Table)))
+    else:
+      Delta = Read(Args.Delta)
+      _, _, _, BaseSig, BaseOemTableId, BaseLength, BaseSha, Length, Sha = ParseHeader(Delta)
+      print('Base:  %s %-8s %u bytes sha256 %s' % (BaseSig.decode('ascii', 'replace'),
+            BaseOemTableId.decode('ascii', 'replace'), BaseLength, BaseSha.hex()))
+      print('Table: %u bytes sha256 %s' % (Length, Sha.hex()))
+      print('Delta: %u bytes (%.1f%% of the table)' % (len(Delta), 100.0 * len(Delta) / max(Length, 1)))
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+## @file
+#  Lists and edits the ACPIPatcher NVRAM table store from a running OS.
+#
+#  The store (see Include/Guid/AcpiPatcherNvTables.h) keeps small tables in
+#  UEFI variables so ACPIPatcher can load them without a file system. On
+#  Linux the variables appear in efivarfs as <Name>-<VendorGuid> files whose
+#  first four bytes are the variable attributes. This tool maintains the
+#  same index and table variables as `ACPIPatcher.efi --nv-*`, and applies
+#  the same limits: ACPI_PATCHER_NV_MAX_TABLES tables of at most
+#  ACPI_PATCHER_NV_MAX_TABLE_SIZE bytes, keeping a quarter of the variable
+#  storage free.
+#
+#  Usage:
+#    AcpiNvStore.py list
+#    AcpiNvStore.py add SSDT-EC.aml [--name NAME]
+#    AcpiNvStore.py remove SSDT-EC.aml
+#    AcpiNvStore.py folder on|off
+#
+#  --root points at a copy of efivarfs, for example to prepare a store
+#  offline or to try the tool out.
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import errno
+import fcntl
+import os
+import struct
+import sys
+import zlib
+
+EFIVARFS = '/sys/firmware/efi/efivars'
+
+# Must match Include/Guid/AcpiPatcherNvTables.h
+NV_GUID          = '25ef1f6d-89e0-43c4-a2d3-74e26326bdbf'
+INDEX_NAME       = 'AcpiTableIndex'
+TABLE_FORMAT     = 'AcpiTable%02u'
+NV_SIGNATURE     = b'APNV'
+NV_VERSION       = 1
+NAME_SIZE        = 24
+MAX_TABLES       = 16
+MAX_TABLE_SIZE   = 16 * 1024
+RESERVE_DIVISOR  = 4
+LOAD_FOLDER      = 0x1
+
+# EFI_VARIABLE_NON_VOLATILE | BOOTSERVICE_ACCESS | RUNTIME_ACCESS
+NV_ATTRIBUTES    = 0x7
+
+HEADER_FORMAT = '<4sHHII'
+HEADER_SIZE   = struct.calcsize(HEADER_FORMAT)
+ENTRY_FORMAT  = '<4sII24s'
+ENTRY_SIZE    = struct.calcsize(ENTRY_FORMAT)
+
+# Linux FS_IOC_GETFLAGS, FS_IOC_SETFLAGS and FS_IMMUTABLE_FL
+FS_IOC_GETFLAGS = 0x80086601
+FS_IOC_SETFLAGS = 0x40086602
+FS_IMMUTABLE_FL = 0x10
+
+
+class Store(object):
+  def __init__(self, Root):
+    self.Root = Root
+
+  def Path(self, Name):
+    return os.path.join(self.Root, '%s-%s' % (Name, NV_GUID))
+
+  def Read(self, Name):
+    try:
+      with open(self.Path(Name), 'rb') as File:
+        return File.read()[4:]
+    except FileNotFoundError:
+      return None
+
+  def MakeMutable(self, Path):
+    """efivarfs marks most variables immutable; other file systems have no such flag."""
+    try:
+      Fd = os.open(Path, os.O_RDONLY)
+    except FileNotFoundError:
+      return
+    try:
+      Flags = struct.unpack('<i', fcntl.ioctl(Fd, FS_IOC_GETFLAGS, struct.pack('<i', 0)))[0]
+      if Flags & FS_IMMUTABLE_FL:
+        fcntl.ioctl(Fd, FS_IOC_SETFLAGS, struct.pack('<i', Flags & ~FS_IMMUTABLE_FL))
+    except OSError as Error:
+      if Error.errno not in (errno.ENOTTY, errno.EOPNOTSUPP, errno.EINVAL):
+        raise
+    finally:
+      os.close(Fd)
+
+  def Write(self, Name, Data):
+    Path = self.Path(Name)
+    self.MakeMutable(Path)
+    # efivarfs takes each variable in a single write
+    with open(Path, 'wb', buffering=0) as File:
+      File.write(struct.pack('<I', NV_ATTRIBUTES) + Data)
+
+  def Delete(self, Name):
+    Path = self.Path(Name)
+    self.MakeMutable(Path)
+    try:
+      os.unlink(Path)
+    except FileNotFoundError:
+      pass
+
+  def Space(self):
+    """Returns (total, free) variable storage bytes, or None if unknown."""
+    Stat = os.statvfs(self.Root)
+    if Stat.f_blocks == 0:
+      return None
+    return Stat.f_blocks * Stat.f_frsize, Stat.f_bfree * Stat.f_frsize
+
+
+def ReadIndex(Nv):
+  Data = Nv.Read(INDEX_NAME)
+  if Data is None:
+    return 0, []
+  if len(Data) < HEADER_SIZE:
+    raise ValueError('%s is truncated' % INDEX_NAME)
+  Signature, Version, EntrySize, TableCount, Flags = struct.unpack_from(HEADER_FORMAT, Data)
+  if (Signature != NV_SIGNATURE or Version != NV_VERSION or EntrySize != ENTRY_SIZE or
+      TableCount > MAX_TABLES or len(Data) != HEADER_SIZE + TableCount * ENTRY_SIZE):
+    raise ValueError('unsupported %s (signature %r, version %d, entry size %d, %d tables)' %
+                     (INDEX_NAME, Signature, Version, EntrySize, TableCount))
+
+  Entries = []
+  for Slot in range(TableCount):
+    Sig, Length, Crc, Name = struct.unpack_from(ENTRY_FORMAT, Data, HEADER_SIZE + Slot * ENTRY_SIZE)
+    Entries.append([Sig, Length, Crc, Name.split(b'\0', 1)[0].decode('ascii', 'replace')])
+  return Flags, Entries
+
+
+def WriteIndex(Nv, Flags, Entries):
+  Data = struct.pack(HEADER_FORMAT, NV_SIGNATURE, NV_VERSION, ENTRY_SIZE, len(Entries), Flags)
+  for Sig, Length, Crc, Name in Entries:
+    Data += struct.pack(ENTRY_FORMAT, Sig, Length, Crc, Name.encode('ascii'))
+  Nv.Write(INDEX_NAME, Data)
+
+
+def FindSlot(Entries, Name):
+  for Slot, Entry in enumerate(Entries):
+    if Entry[3] == Name:
+      return Slot
+  return None
+
+
+def List(Nv):
+  Flags, Entries = ReadIndex(Nv)
+  print('NVRAM table store: %u of %u tables, ACPI folder %s' %
+        (len(Entries), MAX_TABLES, 'also loaded' if Flags & LOAD_FOLDER else 'not touched'))
+  for Slot, (Sig, Length, Crc, Name) in enumerate(Entries):
+    Table = Nv.Read(TABLE_FORMAT % Slot)
+    State = '' if Table is not None and len(Table) == Length and zlib.crc32(Table) == Crc else '  (damaged)'
+    print('  %02u  %-4s  %6u bytes  crc %08x  %s%s' % (Slot, Sig.decode('ascii', 'replace'), Length, Crc, Name, State))
+  Space = Nv.Space()
+  if Space is not None:
+    print('Variable storage: %u of %u bytes free' % (Space[1], Space[0]))
+
+
+def Add(Nv, FileName, Name):
+  Name = Name or os.path.basename(FileName)
+  if len(Name.encode('ascii')) >= NAME_SIZE:
+    raise ValueError('stored table names are limited to %u characters' % (NAME_SIZE - 1))
+  with open(FileName, 'rb') as File:
+    Data = File.read(MAX_TABLE_SIZE + 1)
+  if len(Data) > MAX_TABLE_SIZE:
+    raise ValueError('%s is larger than %u bytes' % (FileName, MAX_TABLE_SIZE))
+  if len(Data) < 36:
+    raise ValueError('%s is not an ACPI table' % FileName)
+  Length = struct.unpack_from('<I', Data, 4)[0]
+  if Length < 36 or Length > len(Data) or Data[:4] == b'\0\0\0\0':
+    raise ValueError('%s is not an ACPI table' % FileName)
+  Table = Data[:Length]
+  if sum(Table) & 0xFF:
+    sys.stderr.write('warning: %s has a bad checksum\n' % FileName)
+
+  Flags, Entries = ReadIndex(Nv)
+  Slot = FindSlot(Entries, Name)
+  if Slot is None and len(Entries) == MAX_TABLES:
+    raise ValueError('the store already holds %u tables' % MAX_TABLES)
+
+  Freed = Entries[Slot][1] if Slot is not None else 0
+  Space = Nv.Space()
+  if Space is not None and Length > Freed and Space[1] < Length - Freed + Space[0] // RESERVE_DIVISOR:
+    raise ValueError('only %u of %u bytes of variable storage free, keeping 1/%u in reserve' %
+                     (Space[1], Space[0], RESERVE_DIVISOR))
+
+  Entry = [Table[:4], Length, zlib.crc32(Table), Name]
+  if Slot is None:
+    Slot = len(Entries)
+    Entries.append(Entry)
+  else:
+    Entries[Slot] = Entry
+  # Table first, index last, as the firmware side does
+  Nv.Write(TABLE_FORMAT % Slot, Table)
+  WriteIndex(Nv, Flags, Entries)
+  print('Stored %s (%u bytes) as %s' % (Name, Length, TABLE_FORMAT % Slot))
+
+
+def Remove(Nv, Name):
+  Flags, Entries = ReadIndex(Nv)
+  Slot = FindSlot(Entries, Name)
+  if Slot is None:
+    raise ValueError('%s is not in the NVRAM table store' % Name)
+
+  Last = len(Entries) - 1
+  if Slot != Last:
+    Table = Nv.Read(TABLE_FORMAT % Last)
+    if Table is None:
+      raise ValueError('%s is missing' % (TABLE_FORMAT % Last))
+    Nv.Write(TABLE_FORMAT % Slot, Table)
+    Entries[Slot] = Entries[Last]
+  del Entries[Last]
+  WriteIndex(Nv, Flags, Entries)
+  Nv.Delete(TABLE_FORMAT % Last)
+  print('Removed %s' % Name)
+
+
+def Folder(Nv, Setting):
+  Flags, Entries = ReadIndex(Nv)
+  Flags = (Flags | LOAD_FOLDER) if Setting == 'on' else (Flags & ~LOAD_FOLDER)
+  WriteIndex(Nv, Flags, Entries)
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='List or edit the ACPIPatcher NVRAM table store.')
+  Parser.add_argument('--root', default=EFIVARFS, help='efivarfs mount point (default %s)' % EFIVARFS)
+  Sub = Parser.add_subparsers(dest='Command', required=True)
+  Sub.add_parser('list')
+  AddCmd = Sub.add_parser('add', help='store a table file')
+  AddCmd.add_argument('File')
+  AddCmd.add_argument('--name', help='name in the store, default the file name')
+  Sub.add_parser('remove').add_argument('Name')
+  Sub.add_parser('folder', help='also load the ACPI folder (on) or only the stored tables (off)').add_argument(
+    'Setting', choices=['on', 'off'])
+  Args = Parser.parse_args()
+
+  Nv = Store(Args.root)
+  try:
+    if Args.Command == 'list':
+      List(Nv)
+    elif Args.Command == 'add':
+      Add(Nv, Args.File, Args.name)
+    elif Args.Command == 'remove':
+      Remove(Nv, Args.Name)
+    else:
+      Folder(Nv, Args.Setting)
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
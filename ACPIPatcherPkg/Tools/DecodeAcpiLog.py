@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+## @file
+#  Decodes the ACPIPatcher binary log ring.
+#
+#  The ring is published by the patcher in the EFI configuration table
+#  (gAcpiPatcherLogTableGuid, see Include/Guid/AcpiPatcherLog.h). Feed this
+#  tool either a raw dump of the ring, a larger memory dump containing it
+#  (the header is located by its signature), or /dev/mem together with the
+#  ring address printed by the patcher.
+#
+#  Usage:
+#    DecodeAcpiLog.py ring.bin
+#    DecodeAcpiLog.py --address 0x7F8E1018 /dev/mem
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import struct
+import sys
+
+LOG_SIGNATURE = b'APLG'
+LOG_VERSION   = 1
+
+HEADER_FORMAT = '<4sHHIIIIQQQ'
+ENTRY_FORMAT  = '<QHBBI4Q'
+HEADER_SIZE   = struct.calcsize(HEADER_FORMAT)
+ENTRY_SIZE    = struct.calcsize(ENTRY_FORMAT)
+
+LEVELS = {1: 'ERROR', 2: 'WARN', 3: 'INFO', 4: 'DEBUG'}
+
+#
+# Argument kinds: u = unsigned, x = hex, s = EFI_STATUS, n = packed file name,
+# g = ACPI signature, b = boolean.
+#
+# Keep in sync with ACPI_PATCHER_LOG_MESSAGE_ID in Include/Guid/AcpiPatcherLog.h.
+#
+MESSAGES = {
+  1:  ('ACPIPatcher v{}.{} starting',                      'uu'),
+  2:  ('Firmware revision {} (EFI 1.x: {})',               'xb'),
+  3:  ('RSDP at {} (revision {})',                         'xu'),
+  4:  ('RSDP not found: {}',                               's'),
+  5:  ('XSDT at {} ({} bytes)',                            'xu'),
+  6:  ('Invalid XSDT signature {}',                        'g'),
+  7:  ('FADT at {} (XDsdt {})',                            'xx'),
+  8:  ('FADT not found ({} XSDT entries scanned)',         'u'),
+  9:  ('Could not open ACPI folder: {}',                   's'),
+  10: ('Directory read error: {}',                         's'),
+  11: ('Processing {} ({} bytes)',                         'nu'),
+  12: ('Failed to open {}: {}',                            'ns'),
+  13: ('Failed to read {}: {}',                            'ns'),
+  14: ('Invalid ACPI table in {}: {}',                     'ns'),
+  15: ('{} checksum mismatch (sum 0x{:02x})',              'gu'),
+  16: ('DSDT replaced: {} -> {}',                          'xx'),
+  17: ('Added {} at {} ({} bytes)',                        'gxu'),
+  18: ('XSDT full ({} entries), skipped {}',               'un'),
+  19: ('Summary: {} processed, {} skipped, {} added, {} XSDT entries', 'uuuu'),
+  20: ('Finished: {}',                                     's'),
+  21: ('XSDT rebuilt: {} -> {} ({} entries)',              'xxu'),
+  22: ('Protocol: {} tables submitted ({} pending)',       'uu'),
+  23: ('Protocol: commit of {} tables: {}',                'us'),
+  24: ('Dry run: {} tables planned, DSDT replaced: {}',    'ub'),
+  25: ('Exported {} ({} bytes, crc32 {})',                 'gux'),
+  26: ('Export of {} tables, {} bytes written: {}',        'uus'),
+  27: ('Consolidated {} tables into {} ({} bytes saved)',  'uuu'),
+  28: ('Platform profile {} selected ({} tables)',         'xu'),
+  29: ('Memory: peak {} bytes, {} bytes resident, map {} -> {} descriptors', 'uuuu'),
+  30: ('Last run: {} files unchanged in {} tables, {} tables stale', 'uuu'),
+  31: ('Digest check failed for {}: {} (policy {})',       'nsu'),
+  32: ('Manifest not loaded: {} (policy {})',              'su'),
+  33: ('Install hook armed with {} tables: {}',            'us'),
+  34: ('Install hook replaced {} {}: {}',                  'gns'),
+  35: ('Install hook added unmatched {} {}: {}',           'gns'),
+  36: ('NVRAM store holds {} tables, flags {}',           'ux'),
+  37: ('Deadline deferred {} at {} ms',                    'nu'),
+  38: ('Run took {} us, regressed from {} us baseline',    'uu'),
+  39: ('Delta {} not applied: {}',                         'ns'),
+  40: ('Config {} not compiled: {}',                       'ns'),
+  41: ('Read transfers of {} bytes failed: {}',            'us'),
+  42: ('Read transfer size {} chosen at {} KB/s',          'uu'),
+}
+
+EFI_STATUS_NAMES = {
+  0: 'Success', 1: 'Load Error', 2: 'Invalid Parameter', 3: 'Unsupported',
+  4: 'Bad Buffer Size', 5: 'Buffer Too Small', 6: 'Not Ready',
+  7: 'Device Error', 8: 'Write Protected', 9: 'Out of Resources',
+  10: 'Volume Corrupt', 11: 'Volume Full', 12: 'No Media',
+  13: 'Media changed', 14: 'Not Found', 15: 'Access Denied',
+  16: 'No Response', 17: 'No mapping', 18: 'Time out',
+  19: 'Not started', 20: 'Already started', 21: 'Aborted',
+  26: 'Security Violation', 27: 'CRC Error', 31: 'End of File',
+  33: 'Compromised Data',
+}
+
+
+def FormatStatus(Value):
+  IsError = (Value >> 63) & 1
+  Code    = Value & 0x7FFFFFFFFFFFFFFF
+  if Code == 0 and not IsError:
+    return 'Success'
+  Name = EFI_STATUS_NAMES.get(Code, '0x%x' % Code)
+  return Name if IsError else 'Warning %s' % Name
+
+
+def FormatName(Value):
+  return Value.to_bytes(8, 'little').rstrip(b'\0').decode('ascii', 'replace')
+
+
+def FormatSignature(Value):
+  return (Value & 0xFFFFFFFF).to_bytes(4, 'little').decode('ascii', 'replace')
+
+
+def FormatArg(Kind, Value):
+  if Kind == 'x':
+    return '0x%x' % Value
+  if Kind == 's':
+    return FormatStatus(Value)
+  if Kind == 'n':
+    return FormatName(Value)
+  if Kind == 'g':
+    return FormatSignature(Value)
+  if Kind == 'b':
+    return 'yes' if Value else 'no'
+  return Value
+
+
+def FindRing(Data, Offset):
+  if Offset is not None:
+    return Offset
+  Offset = Data.find(LOG_SIGNATURE)
+  while Offset >= 0:
+    Fields = struct.unpack_from(HEADER_FORMAT, Data, Offset)
+    if Fields[1] == LOG_VERSION and Fields[2] == ENTRY_SIZE:
+      return Offset
+    Offset = Data.find(LOG_SIGNATURE, Offset + 1)
+  raise ValueError('log ring signature not found')
+
+
+def Decode(Data, Offset, Out):
+  (Signature, Version, EntrySize, EntryCount, WriteIndex, RunCount, _,
+   Frequency, CounterStart, CounterEnd) = struct.unpack_from(HEADER_FORMAT, Data, Offset)
+
+  if Signature != LOG_SIGNATURE or Version != LOG_VERSION or EntrySize != ENTRY_SIZE:
+    raise ValueError('unsupported log ring (signature %r, version %d, entry size %d)' %
+                     (Signature, Version, EntrySize))
+
+  CountsDown = CounterStart > CounterEnd
+  Valid      = min(WriteIndex, EntryCount)
+  First      = WriteIndex - Valid
+  Base       = None
+
+  Out.write('Log ring: %d runs, %d entries written, %d retained, counter %d Hz\n' %
+            (RunCount, WriteIndex, Valid, Frequency))
+
+  for Index in range(First, WriteIndex):
+    EntryOffset = Offset + HEADER_SIZE + (Index % EntryCount) * ENTRY_SIZE
+    (Timestamp, MessageId, Level, ArgCount, Run,
+     A0, A1, A2, A3) = struct.unpack_from(ENTRY_FORMAT, Data, EntryOffset)
+    Args = (A0, A1, A2, A3)[:ArgCount]
+
+    if Base is None:
+      Base = Timestamp
+    Delta = (Base - Timestamp) if CountsDown else (Timestamp - Base)
+    if Frequency:
+      Stamp = '%12.3f ms' % (Delta * 1000.0 / Frequency)
+    else:
+      Stamp = '%15d' % Delta
+
+    Format, Kinds = MESSAGES.get(MessageId, (None, ''))
+    if Format is None or len(Kinds) != ArgCount:
+      Text = 'message %d args %s' % (MessageId, ' '.join('0x%x' % Arg for Arg in Args))
+    else:
+      Text = Format.format(*[FormatArg(Kind, Arg) for Kind, Arg in zip(Kinds, Args)])
+
+    Out.write('%s run %-3d %-5s %s\n' % (Stamp, Run, LEVELS.get(Level, str(Level)), Text))
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='Decode the ACPIPatcher binary log ring.')
+  Parser.add_argument('Dump', help='raw ring dump, memory dump or /dev/mem')
+  Parser.add_argument('--address', type=lambda Value: int(Value, 0),
+                      help='physical address of the ring within Dump')
+  Args = Parser.parse_args()
+
+  with open(Args.Dump, 'rb') as File:
+    if Args.address is not None:
+      File.seek(Args.address)
+      Data = File.read(HEADER_SIZE)
+      Fields = struct.unpack_from(HEADER_FORMAT, Data)
+      Data += File.read(Fields[3] * ENTRY_SIZE)
+      Offset = 0
+    else:
+      Data = File.read()
+      Offset = None
+
+  try:
+    Decode(Data, FindRing(Data, Offset), sys.stdout)
+  except (ValueError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
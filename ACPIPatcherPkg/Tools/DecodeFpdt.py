@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+## @file
+#  Lists the ACPIPatcher records of the Firmware Performance Data Table.
+#
+#  The patcher reports its run and phases as FPDT string event records (see
+#  ACPIPatcher/AcpiFpdt.h), either in the firmware's boot performance table
+#  or in a patcher-owned FPDT. Linux only exposes the basic boot record in
+#  /sys/firmware/acpi/fpdt, so this tool reads the FPDT from
+#  /sys/firmware/acpi/tables/FPDT and the boot performance table (FBPT) it
+#  points to from /dev/mem, which needs root.
+#
+#  Usage:
+#    DecodeFpdt.py
+#    DecodeFpdt.py --all
+#    DecodeFpdt.py --fpdt FPDT.bin --fbpt FBPT.bin
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import struct
+import sys
+import uuid
+
+FPDT_PATH = '/sys/firmware/acpi/tables/FPDT'
+
+# FILE_GUID of ACPIPatcher.inf and ACPIPatcherDxe.inf
+PATCHER_GUID = uuid.UUID('6987936e-ed34-44db-ae97-1fa5e4ed2116')
+
+ACPI_HEADER_SIZE      = 36
+RECORD_HEADER_FORMAT  = '<HBB'
+RECORD_HEADER_SIZE    = struct.calcsize(RECORD_HEADER_FORMAT)
+
+TYPE_BOOT_POINTER     = 0x0000
+TYPE_BASIC_BOOT       = 0x0002
+TYPE_STRING_EVENT     = 0x1011
+
+# Must match PERF_INMODULE_START_ID and PERF_INMODULE_END_ID
+INMODULE_START        = 0x40
+INMODULE_END          = 0x41
+
+BASIC_FIELDS = ['ResetEnd', 'OsLoaderLoadImageStart', 'OsLoaderStartImageStart',
+                'ExitBootServicesEntry', 'ExitBootServicesExit']
+
+
+def FindFbpt(Fpdt):
+  if len(Fpdt) < ACPI_HEADER_SIZE or Fpdt[:4] != b'FPDT':
+    raise ValueError('not an FPDT')
+  Offset = ACPI_HEADER_SIZE
+  End = min(len(Fpdt), struct.unpack_from('<I', Fpdt, 4)[0])
+  while Offset + RECORD_HEADER_SIZE <= End:
+    Type, Length, Revision = struct.unpack_from(RECORD_HEADER_FORMAT, Fpdt, Offset)
+    if Length < RECORD_HEADER_SIZE:
+      break
+    if Type == TYPE_BOOT_POINTER and Length >= 16:
+      return struct.unpack_from('<Q', Fpdt, Offset + 8)[0]
+    Offset += Length
+  raise ValueError('the FPDT has no boot performance table pointer')
+
+
+def ReadFbpt(Memory, Address):
+  with open(Memory, 'rb') as File:
+    File.seek(Address)
+    Header = File.read(8)
+    if len(Header) != 8 or Header[:4] != b'FBPT':
+      raise ValueError('no FBPT at 0x%x' % Address)
+    Length = struct.unpack_from('<I', Header, 4)[0]
+    return Header + File.read(Length - 8)
+
+
+def Records(Fbpt):
+  if len(Fbpt) < 8 or Fbpt[:4] != b'FBPT':
+    raise ValueError('not an FBPT')
+  Offset = 8
+  End = min(len(Fbpt), struct.unpack_from('<I', Fbpt, 4)[0])
+  while Offset + RECORD_HEADER_SIZE <= End:
+    Type, Length, Revision = struct.unpack_from(RECORD_HEADER_FORMAT, Fbpt, Offset)
+    if Length < RECORD_HEADER_SIZE or Offset + Length > End:
+      break
+    yield Type, Fbpt[Offset:Offset + Length]
+    Offset += Length
+
+
+def StringEvent(Record):
+  """Returns (ProgressID, Timestamp ns, GUID, name) of a string event record."""
+  ProgressId, ApicId, Timestamp = struct.unpack_from('<HIQ', Record, 4)
+  Guid = uuid.UUID(bytes_le=bytes(Record[18:34]))
+  Name = Record[34:].split(b'\0', 1)[0].decode('ascii', 'replace')
+  return ProgressId, Timestamp, Guid, Name
+
+
+def Decode(Fbpt, ShowAll):
+  Open = {}
+  Found = 0
+  for Type, Record in Records(Fbpt):
+    if Type == TYPE_BASIC_BOOT and len(Record) >= 48:
+      Values = struct.unpack_from('<5Q', Record, 8)
+      print('Basic boot record:')
+      for Name, Value in zip(BASIC_FIELDS, Values):
+        print('  %-24s %12.3f ms' % (Name, Value / 1e6))
+      continue
+    if Type != TYPE_STRING_EVENT or len(Record) < 34:
+      continue
+
+    ProgressId, Timestamp, Guid, Name = StringEvent(Record)
+    if Guid != PATCHER_GUID and not ShowAll:
+      continue
+    if Found == 0:
+      print('String events:')
+    Found += 1
+    if ProgressId == INMODULE_START:
+      Open[(Guid, Name)] = Timestamp
+      Note = 'start'
+    elif ProgressId == INMODULE_END and (Guid, Name) in Open:
+      Note = 'end, %.3f ms' % ((Timestamp - Open.pop((Guid, Name))) / 1e6)
+    else:
+      Note = 'id 0x%x' % ProgressId
+    print('  %12.3f ms  %-28s %s%s' % (Timestamp / 1e6, Name, Note,
+                                       '' if Guid == PATCHER_GUID else '  ' + str(Guid)))
+
+  if Found == 0:
+    print('No ACPIPatcher records; the patcher ran without a way to publish them or did not commit')
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='List the ACPIPatcher FPDT boot performance records.')
+  Parser.add_argument('--fpdt', default=FPDT_PATH, help='FPDT to read (default %s)' % FPDT_PATH)
+  Parser.add_argument('--fbpt', help='saved FBPT, instead of reading it from --mem')
+  Parser.add_argument('--mem', default='/dev/mem', help='physical memory device (default /dev/mem)')
+  Parser.add_argument('--all', action='store_true', help='also list string events of other modules')
+  Args = Parser.parse_args()
+
+  try:
+    if Args.fbpt:
+      with open(Args.fbpt, 'rb') as File:
+        Fbpt = File.read()
+    else:
+      with open(Args.fpdt, 'rb') as File:
+        Address = FindFbpt(File.read())
+      Fbpt = ReadFbpt(Args.mem, Address)
+    Decode(Fbpt, Args.all)
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+## @file
+#  Decodes the ACPIPatcher cross-boot performance history.
+#
+#  The patcher appends one record per committing run to the AcpiPerfHistory
+#  variable and sets AcpiPerfRegressed when a run is slower than the median
+#  of the earlier records by more than the build threshold (see
+#  Include/Guid/AcpiPatcherPerfHistory.h). On Linux both variables appear in
+#  efivarfs as <Name>-<VendorGuid> files whose first four bytes are the
+#  variable attributes.
+#
+#  Usage:
+#    DecodePerfHistory.py
+#    DecodePerfHistory.py --file AcpiPerfHistory.bin
+#
+#  --file takes the variable data without the attribute bytes, as saved by
+#  dmpstore or a firmware shell.
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+import argparse
+import os
+import struct
+import sys
+
+EFIVARFS = '/sys/firmware/efi/efivars'
+
+# Must match Include/Guid/AcpiPatcherPerfHistory.h
+PERF_GUID       = '0227d19c-3da2-4459-92ac-e304d362d6ab'
+HISTORY_NAME    = 'AcpiPerfHistory'
+REGRESSED_NAME  = 'AcpiPerfRegressed'
+PERF_SIGNATURE  = b'APPH'
+PERF_VERSION    = 1
+PERF_REGRESSED  = 0x1
+PERF_DXE        = 0x2
+
+# Must match AcpiPhase* in ACPIPatcher/AcpiPerf.h
+PHASES = ['Enumerate', 'Read', 'Validate', 'Merge', 'Plan']
+
+HEADER_FORMAT     = '<4sHHII'
+RECORD_FORMAT     = '<I5IIHHIII'
+REGRESSED_FORMAT  = '<III'
+HEADER_SIZE       = struct.calcsize(HEADER_FORMAT)
+RECORD_SIZE       = struct.calcsize(RECORD_FORMAT)
+
+
+def ReadVariable(Root, Name):
+  try:
+    with open(os.path.join(Root, '%s-%s' % (Name, PERF_GUID)), 'rb') as File:
+      return File.read()[4:]
+  except FileNotFoundError:
+    return None
+
+
+def Decode(Data):
+  if len(Data) < HEADER_SIZE:
+    raise ValueError('%s is truncated' % HISTORY_NAME)
+  Signature, Version, RecordSize, RecordCount, RunCount = struct.unpack_from(HEADER_FORMAT, Data)
+  if (Signature != PERF_SIGNATURE or Version != PERF_VERSION or RecordSize != RECORD_SIZE or
+      len(Data) != HEADER_SIZE + RecordCount * RECORD_SIZE):
+    raise ValueError('unsupported %s (signature %r, version %d, record size %d, %d records)' %
+                     (HISTORY_NAME, Signature, Version, RecordSize, RecordCount))
+
+  print('Performance history: %u records of %u runs' % (RecordCount, RunCount))
+  print('  %-5s %10s %10s  %s  %8s %5s %6s  %-10s %s' %
+        ('Run', 'Total us', 'Base us', '  '.join('%9s' % Phase for Phase in PHASES),
+         'Bytes', 'Files', 'Tables', 'Firmware', 'Flags'))
+  for Index in range(RecordCount):
+    Fields = struct.unpack_from(RECORD_FORMAT, Data, HEADER_SIZE + Index * RECORD_SIZE)
+    TotalUs, PhaseUs = Fields[0], Fields[1:6]
+    BytesRead, FilesRead, TablesInstalled, FirmwareRevision, BaselineUs, Flags = Fields[6:]
+    Notes = []
+    if Flags & PERF_REGRESSED:
+      Notes.append('REGRESSED +%u%%' % ((TotalUs - BaselineUs) * 100 // BaselineUs) if BaselineUs else 'REGRESSED')
+    if Flags & PERF_DXE:
+      Notes.append('dxe')
+    print(('  %-5u %10u %10s  %s  %8u %5u %6u  0x%08x %s' %
+          (RunCount - RecordCount + Index + 1, TotalUs, BaselineUs if BaselineUs else '-',
+           '  '.join('%9u' % Us for Us in PhaseUs), BytesRead, FilesRead, TablesInstalled,
+           FirmwareRevision, ' '.join(Notes))).rstrip())
+
+
+def Main():
+  Parser = argparse.ArgumentParser(description='Decode the ACPIPatcher performance history.')
+  Parser.add_argument('--root', default=EFIVARFS, help='efivarfs mount point (default %s)' % EFIVARFS)
+  Parser.add_argument('--file', help='history variable data saved without its attributes')
+  Args = Parser.parse_args()
+
+  try:
+    if Args.file:
+      with open(Args.file, 'rb') as File:
+        Data = File.read()
+    else:
+      Data = ReadVariable(Args.root, HISTORY_NAME)
+      if Data is None:
+        raise ValueError('no %s variable; the patcher has not committed a run yet' % HISTORY_NAME)
+    Decode(Data)
+
+    if not Args.file:
+      Regressed = ReadVariable(Args.root, REGRESSED_NAME)
+      if Regressed is not None and len(Regressed) == struct.calcsize(REGRESSED_FORMAT):
+        TotalUs, BaselineUs, Percent = struct.unpack(REGRESSED_FORMAT, Regressed)
+        print('This boot regressed: %u us against a %u us baseline (threshold %u%%)' % (TotalUs, BaselineUs, Percent))
+      else:
+        print('This boot did not regress')
+  except (ValueError, OSError, struct.error) as Error:
+    sys.stderr.write('error: %s\n' % Error)
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(Main())
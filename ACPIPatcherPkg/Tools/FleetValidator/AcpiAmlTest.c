@@ -0,0 +1,537 @@
+/** @file
+
+  Host test of the device property config compiler in ACPIPatcher/AcpiAml.c.
+
+  Small configs are compared byte for byte with hand assembled AML. Larger
+  ones, sized so the Scope, Method and Package lengths need two and three
+  byte PkgLength encodings, are decoded by a walker for the subset of AML
+  the compiler emits: every PkgLength has to end exactly where its package
+  does and use the shortest encoding, and every Package and Buffer has to
+  hold as many elements or bytes as it declares. Each table is also checked
+  for its header, length and checksum, and every pool buffer has to be
+  returned.
+
+  "make check" builds the test with -fsanitize=address,undefined, so a
+  write past the table buffer fails the run.
+
+  Usage:
+    AcpiAmlTest [-v]
+
+  Exit status is 0 when every check passes and 1 when any fails.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <HostUefi.h>
+
+#include "AcpiAml.h"
+#include "AcpiMemory.h"
+
+#define TEST_CONFIG_SIZE    (ACPI_AML_MAX_PROPERTIES * 200)
+
+//
+// Objects found by the walker
+//
+typedef struct {
+  UINT32  Scopes;
+  UINT32  Methods;
+  UINT32  Packages;
+  UINT32  Elements;           ///< Package elements, over all packages
+  UINT32  PkgLengthSizes[5];  ///< PkgLengths seen, by encoded size
+} TEST_AML_STATS;
+
+STATIC EFI_ACPI_SDT_HEADER  mXsdt = { EFI_ACPI_6_4_EXTENDED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE, sizeof(EFI_ACPI_SDT_HEADER), 1, 0,
+                                      "APTEST" };
+EFI_ACPI_SDT_HEADER         *gXsdt = &mXsdt;
+
+STATIC UINT32   mFailures;
+STATIC UINT32   mChecks;
+STATIC BOOLEAN  mVerbose;
+
+#define TEST_CHECK(Cond, ...)                               \
+  do {                                                      \
+    mChecks++;                                              \
+    if (!(Cond)) {                                          \
+      mFailures++;                                          \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);           \
+      printf(__VA_ARGS__);                                  \
+      printf("\n");                                         \
+    }                                                       \
+  } while (0)
+
+//
+// AML walker
+//
+
+STATIC BOOLEAN TestTermArg (CONST UINT8 **Cursor, CONST UINT8 *End, TEST_AML_STATS *Stats);
+
+/**
+  Decodes a PkgLength and returns the end of its package, which starts at
+  the PkgLength itself.
+**/
+STATIC
+BOOLEAN
+TestPkgLength (
+  IN OUT CONST UINT8     **Cursor,
+  IN     CONST UINT8     *End,
+  OUT    CONST UINT8     **PkgEnd,
+  IN OUT TEST_AML_STATS  *Stats
+  )
+{
+  CONST UINT8  *Start;
+  UINT32       Follow;
+  UINT32       Length;
+  UINT32       Index;
+
+  Start = *Cursor;
+  if (Start >= End) {
+    return FALSE;
+  }
+  Follow = Start[0] >> 6;
+  if (Follow == 0) {
+    Length = Start[0] & 0x3F;
+  } else {
+    if (Start + 1 + Follow > End || (Start[0] & 0x30) != 0) {
+      return FALSE;
+    }
+    Length = Start[0] & 0x0F;
+    for (Index = 0; Index < Follow; Index++) {
+      Length |= (UINT32)Start[1 + Index] << (4 + 8 * Index);
+    }
+  }
+
+  // The encoder picks the shortest form that holds the length
+  if ((Follow == 1 && Length <= 0x3F) || (Follow == 2 && Length <= 0xFFF) || (Follow == 3 && Length <= 0xFFFFF)) {
+    return FALSE;
+  }
+  if (Length < Follow + 1 || Length > (UINT32)(End - Start)) {
+    return FALSE;
+  }
+  Stats->PkgLengthSizes[Follow + 1]++;
+  *Cursor = Start + Follow + 1;
+  *PkgEnd = Start + Length;
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+TestNameString (
+  IN OUT CONST UINT8  **Cursor,
+  IN     CONST UINT8  *End
+  )
+{
+  CONST UINT8  *Name;
+  UINT32       Segments;
+
+  Name = *Cursor;
+  if (Name < End && *Name == '\\') {
+    Name++;
+  }
+  if (Name + 1 < End && Name[0] == 0x2E) {
+    Segments = 2;
+    Name++;
+  } else if (Name + 2 < End && Name[0] == 0x2F) {
+    Segments = Name[1];
+    Name    += 2;
+  } else {
+    Segments = 1;
+  }
+  if ((UINT32)(End - Name) < Segments * 4) {
+    return FALSE;
+  }
+  *Cursor = Name + Segments * 4;
+  return TRUE;
+}
+
+/**
+  Decodes a DataObject, Buffer or Package, or LEqual and Arg2 as used in
+  the generated _DSM.
+**/
+STATIC
+BOOLEAN
+TestTermArg (
+  IN OUT CONST UINT8     **Cursor,
+  IN     CONST UINT8     *End,
+  IN OUT TEST_AML_STATS  *Stats
+  )
+{
+  CONST UINT8  *Op;
+  CONST UINT8  *PkgEnd;
+  CONST UINT8  *Size;
+  UINT64       Declared;
+  UINT32       Count;
+
+  Op = *Cursor;
+  if (Op >= End) {
+    return FALSE;
+  }
+  *Cursor = Op + 1;
+  switch (*Op) {
+    case 0x00:
+    case 0x01:
+    case 0xFF:
+    case 0x6A:
+      return TRUE;
+    case 0x0A:
+    case 0x0B:
+    case 0x0C:
+    case 0x0E:
+      Count = (*Op == 0x0A) ? 1 : (*Op == 0x0B) ? 2 : (*Op == 0x0C) ? 4 : 8;
+      if ((UINT32)(End - *Cursor) < Count) {
+        return FALSE;
+      }
+      *Cursor += Count;
+      return TRUE;
+    case 0x0D:
+      while (*Cursor < End && **Cursor != 0) {
+        (*Cursor)++;
+      }
+      if (*Cursor == End) {
+        return FALSE;
+      }
+      (*Cursor)++;
+      return TRUE;
+    case 0x93:
+      return (BOOLEAN)(TestTermArg(Cursor, End, Stats) && TestTermArg(Cursor, End, Stats));
+    case 0x11:
+      if (!TestPkgLength(Cursor, End, &PkgEnd, Stats)) {
+        return FALSE;
+      }
+      Size = *Cursor;
+      if (!TestTermArg(Cursor, PkgEnd, Stats)) {
+        return FALSE;
+      }
+      Declared = 0;
+      if (*Size == 0x01) {
+        Declared = 1;
+      } else if (*Size == 0x0A || *Size == 0x0B) {
+        Declared = (*Size == 0x0A) ? Size[1] : (UINT64)(Size[1] | (Size[2] << 8));
+      } else if (*Size != 0x00) {
+        return FALSE;
+      }
+      if (Declared != (UINT64)(PkgEnd - *Cursor)) {
+        return FALSE;
+      }
+      *Cursor = PkgEnd;
+      return TRUE;
+    case 0x12:
+      if (!TestPkgLength(Cursor, End, &PkgEnd, Stats) || *Cursor >= PkgEnd) {
+        return FALSE;
+      }
+      Declared = *(*Cursor)++;
+      for (Count = 0; *Cursor < PkgEnd; Count++) {
+        if (!TestTermArg(Cursor, PkgEnd, Stats)) {
+          return FALSE;
+        }
+      }
+      Stats->Packages++;
+      Stats->Elements += Count;
+      return (BOOLEAN)(Count == Declared);
+    default:
+      return FALSE;
+  }
+}
+
+/**
+  Decodes the terms of a TermList up to End.
+**/
+STATIC
+BOOLEAN
+TestTermList (
+  IN OUT CONST UINT8     **Cursor,
+  IN     CONST UINT8     *End,
+  IN OUT TEST_AML_STATS  *Stats
+  )
+{
+  CONST UINT8  *Op;
+  CONST UINT8  *PkgEnd;
+
+  while (*Cursor < End) {
+    Op      = *Cursor;
+    *Cursor = Op + 1;
+    switch (*Op) {
+      case 0x15:    // External (Name, Type, ArgCount)
+        if (!TestNameString(Cursor, End) || End - *Cursor < 2) {
+          return FALSE;
+        }
+        *Cursor += 2;
+        break;
+      case 0x08:    // Name (NameSeg, Data)
+        if (End - *Cursor < 4) {
+          return FALSE;
+        }
+        *Cursor += 4;
+        if (!TestTermArg(Cursor, End, Stats)) {
+          return FALSE;
+        }
+        break;
+      case 0xA4:    // Return (Arg)
+        if (!TestTermArg(Cursor, End, Stats)) {
+          return FALSE;
+        }
+        break;
+      case 0x10:    // Scope (Name) { TermList }
+      case 0x14:    // Method (NameSeg, Flags) { TermList }
+      case 0xA0:    // If (Predicate) { TermList }
+        if (!TestPkgLength(Cursor, End, &PkgEnd, Stats)) {
+          return FALSE;
+        }
+        if (*Op == 0x10 && !TestNameString(Cursor, PkgEnd)) {
+          return FALSE;
+        }
+        if (*Op == 0x14) {
+          if (PkgEnd - *Cursor < 5) {
+            return FALSE;
+          }
+          *Cursor += 5;
+        }
+        if (*Op == 0xA0 && !TestTermArg(Cursor, PkgEnd, Stats)) {
+          return FALSE;
+        }
+        if (!TestTermList(Cursor, PkgEnd, Stats)) {
+          return FALSE;
+        }
+        Stats->Scopes  += (*Op == 0x10) ? 1 : 0;
+        Stats->Methods += (*Op == 0x14) ? 1 : 0;
+        break;
+      default:
+        return FALSE;
+    }
+  }
+  return (BOOLEAN)(*Cursor == End);
+}
+
+//
+// Compiler
+//
+
+/**
+  Compiles Config and checks the table header. Returns the table, or NULL
+  if it did not compile; the caller frees it with AcpiFreePool.
+**/
+STATIC
+EFI_ACPI_SDT_HEADER *
+TestCompile (
+  IN CONST char  *Title,
+  IN CONST char  *Config
+  )
+{
+  EFI_STATUS           Status;
+  EFI_ACPI_SDT_HEADER  *Table;
+  UINTN                TableSize;
+
+  Table  = NULL;
+  Status = AcpiAmlBuildSsdt(Config, strlen(Config), (VOID **)&Table, &TableSize);
+  TEST_CHECK(!EFI_ERROR(Status), "%s: not compiled (0x%lx)", Title, (unsigned long)Status);
+  if (EFI_ERROR(Status)) {
+    return NULL;
+  }
+
+  TEST_CHECK(Table->Signature == EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE, "%s: not an SSDT", Title);
+  TEST_CHECK(Table->Length == TableSize, "%s: length %u, size %zu", Title, Table->Length, (size_t)TableSize);
+  TEST_CHECK(CalculateCheckSum8((UINT8 *)Table, Table->Length) == 0, "%s: bad checksum", Title);
+  TEST_CHECK(memcmp(Table->OemId, mXsdt.OemId, sizeof(Table->OemId)) == 0, "%s: OEM ID not taken from the XSDT", Title);
+  TEST_CHECK(memcmp(Table->OemTableId, ACPI_AML_OEM_TABLE_ID, sizeof(Table->OemTableId)) == 0, "%s: bad OEM Table ID", Title);
+  if (mVerbose) {
+    printf("  %s: %u byte SSDT\n", Title, Table->Length);
+  }
+  return Table;
+}
+
+/**
+  Compiles Config and compares its definition block with Expected.
+**/
+STATIC
+VOID
+TestGolden (
+  IN CONST char   *Title,
+  IN CONST char   *Config,
+  IN CONST UINT8  *Expected,
+  IN UINTN        ExpectedSize
+  )
+{
+  EFI_ACPI_SDT_HEADER  *Table;
+  UINTN                Index;
+
+  Table = TestCompile(Title, Config);
+  if (Table == NULL) {
+    return;
+  }
+  TEST_CHECK(Table->Length == sizeof(*Table) + ExpectedSize, "%s: %u byte table, expected %zu", Title,
+             Table->Length, sizeof(*Table) + ExpectedSize);
+  if (Table->Length == sizeof(*Table) + ExpectedSize) {
+    for (Index = 0; Index < ExpectedSize && ((UINT8 *)(Table + 1))[Index] == Expected[Index]; Index++) {
+    }
+    TEST_CHECK(Index == ExpectedSize, "%s: AML differs at byte %zu", Title, (size_t)Index);
+  }
+  AcpiFreePool(Table);
+}
+
+/**
+  Compiles Config, walks its AML and checks the objects found.
+**/
+STATIC
+VOID
+TestWalk (
+  IN CONST char  *Title,
+  IN CONST char  *Config,
+  IN UINT32      Devices,
+  IN UINT32      DsmProperties,
+  IN UINT32      PkgLengthSize
+  )
+{
+  EFI_ACPI_SDT_HEADER  *Table;
+  TEST_AML_STATS       Stats;
+  CONST UINT8          *Cursor;
+  BOOLEAN              Walked;
+
+  Table = TestCompile(Title, Config);
+  if (Table == NULL) {
+    return;
+  }
+  memset(&Stats, 0, sizeof(Stats));
+  Cursor = (CONST UINT8 *)(Table + 1);
+  Walked = TestTermList(&Cursor, (CONST UINT8 *)Table + Table->Length, &Stats);
+  TEST_CHECK(Walked, "%s: AML does not decode at offset %zu", Title, (size_t)(Cursor - (CONST UINT8 *)Table));
+  TEST_CHECK(Stats.Scopes == Devices, "%s: %u scopes, expected %u", Title, Stats.Scopes, Devices);
+  TEST_CHECK(Stats.Elements == 2 * DsmProperties, "%s: %u package elements, expected %u", Title,
+             Stats.Elements, 2 * DsmProperties);
+  TEST_CHECK(Stats.PkgLengthSizes[PkgLengthSize] > 0, "%s: no %u byte PkgLength", Title, PkgLengthSize);
+  AcpiFreePool(Table);
+}
+
+/**
+  Checks that Config is refused with Expected.
+**/
+STATIC
+VOID
+TestRefused (
+  IN CONST char  *Title,
+  IN CONST char  *Config,
+  IN EFI_STATUS  Expected
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Table;
+  UINTN       TableSize;
+
+  Table  = NULL;
+  Status = AcpiAmlBuildSsdt(Config, strlen(Config), &Table, &TableSize);
+  TEST_CHECK(Status == Expected, "%s: status 0x%lx, expected 0x%lx", Title, (unsigned long)Status, (unsigned long)Expected);
+  if (!EFI_ERROR(Status)) {
+    AcpiFreePool(Table);
+  }
+}
+
+/**
+  Writes Count data properties of DataBytes bytes each for one device into
+  a config buffer of TEST_CONFIG_SIZE bytes.
+**/
+STATIC
+VOID
+TestManyProperties (
+  OUT char        *Config,
+  IN  CONST char  *Path,
+  IN  UINT32      Count,
+  IN  UINT32      DataBytes
+  )
+{
+  UINT32  Index;
+  UINT32  Byte;
+  size_t  Used;
+
+  Used = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Used += (size_t)snprintf(Config + Used, TEST_CONFIG_SIZE - Used, "%s  prop-%03u  data  ", Path, Index);
+    for (Byte = 0; Byte < DataBytes; Byte++) {
+      Used += (size_t)snprintf(Config + Used, TEST_CONFIG_SIZE - Used, "%02X", (Index + Byte) & 0xFF);
+    }
+    Used += (size_t)snprintf(Config + Used, TEST_CONFIG_SIZE - Used, "\n");
+  }
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  //
+  // External (\_SB.PCI0.RP05, DeviceObj)
+  // Scope (\_SB.PCI0.RP05) { Name (_STA, Zero) }
+  //
+  STATIC CONST UINT8  Status[] = {
+    0x15, 0x5C, 0x2F, 0x03, '_', 'S', 'B', '_', 'P', 'C', 'I', '0', 'R', 'P', '0', '5', 0x06, 0x00,
+    0x10, 0x16, 0x5C, 0x2F, 0x03, '_', 'S', 'B', '_', 'P', 'C', 'I', '0', 'R', 'P', '0', '5',
+    0x08, '_', 'S', 'T', 'A', 0x00
+  };
+  //
+  // External (\_SB.GFX0, DeviceObj)
+  // Scope (\_SB.GFX0) {
+  //   Method (_DSM, 4) {
+  //     If (LEqual (Arg2, Zero)) { Return (Buffer (One) { 0x03 }) }
+  //     Return (Package () { "model", "X", "id", Buffer (0x02) { 0x3E, 0x92 } })
+  //   }
+  // }
+  //
+  STATIC CONST UINT8  Dsm[] = {
+    0x15, 0x5C, 0x2E, '_', 'S', 'B', '_', 'G', 'F', 'X', '0', 0x06, 0x00,
+    0x10, 0x34, 0x5C, 0x2E, '_', 'S', 'B', '_', 'G', 'F', 'X', '0',
+    0x14, 0x28, '_', 'D', 'S', 'M', 0x04,
+    0xA0, 0x09, 0x93, 0x6A, 0x00, 0xA4, 0x11, 0x03, 0x01, 0x03,
+    0xA4, 0x12, 0x16, 0x04,
+    0x0D, 'm', 'o', 'd', 'e', 'l', 0x00, 0x0D, 'X', 0x00,
+    0x0D, 'i', 'd', 0x00, 0x11, 0x05, 0x0A, 0x02, 0x3E, 0x92
+  };
+  STATIC char  Config[TEST_CONFIG_SIZE];
+
+  if (argc == 2 && strcmp(argv[1], "-v") == 0) {
+    mVerbose        = TRUE;
+    gHostDebugLevel = DEBUG_INFO;
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: AcpiAmlTest [-v]\n");
+    return 1;
+  }
+
+  TestGolden("_STA", "\\_SB.PCI0.RP05  _STA  int  0\n", Status, sizeof(Status));
+  TestGolden("_DSM", "# Graphics\n\\_SB.GFX0  model  string  \"X\"\r\n  \\_SB.GFX0  id  data  3E 92  \n",
+             Dsm, sizeof(Dsm));
+
+  TestWalk("Two devices, every type",
+           "\\_SB.PCI0.GFX0  AAPL,ig-platform-id  data    0300923E\n"
+           "\\_SB.PCI0.GFX0  model                string  \"Intel UHD Graphics 630\"\n"
+           "\\_SB.PCI0.GFX0  hda-gfx              string  onboard-1\n"
+           "\\_SB.PCI0.RP05  _STA                 int     0x0F\n"
+           "\\_SB.PCI0.GFX0  small                int     7\n"
+           "\\_SB.PCI0.RP05  wide                 int     0x123456789\n"
+           "\\_SB.PCI0.GFX0  _STA                 int     0\n",
+           2, 5, 2);
+
+  TestManyProperties(Config, "\\_SB.PCI0.XHC", 20, 64);
+  TestWalk("Two byte PkgLengths", Config, 1, 20, 2);
+  TestManyProperties(Config, "\\_SB.PCI0.XHC", ACPI_AML_MAX_DSM_PROPERTIES, 96);
+  TestWalk("Three byte PkgLengths", Config, 1, ACPI_AML_MAX_DSM_PROPERTIES, 3);
+
+  TestManyProperties(Config, "\\_SB.PCI0.XHC", ACPI_AML_MAX_DSM_PROPERTIES + 1, 1);
+  TestRefused("Too many properties", Config, EFI_INVALID_PARAMETER);
+
+  TestRefused("Comments only", "# nothing\n\n", EFI_NOT_FOUND);
+  TestRefused("Relative path", "_SB.GFX0  model  string  X\n", EFI_INVALID_PARAMETER);
+  TestRefused("Duplicate property", "\\_SB.GFX0  model  string  X\n\\_SB.GFX0  model  string  Y\n",
+              EFI_INVALID_PARAMETER);
+  TestRefused("Odd data digits", "\\_SB.GFX0  id  data  3E9\n", EFI_INVALID_PARAMETER);
+  TestRefused("String _STA", "\\_SB.GFX0  _STA  string  on\n", EFI_INVALID_PARAMETER);
+
+  TEST_CHECK(gHostLivePools == 0, "%zu pool buffers left", (size_t)gHostLivePools);
+  printf("%u checks, %u failed\n", mChecks, mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
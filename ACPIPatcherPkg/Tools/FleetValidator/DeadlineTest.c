@@ -0,0 +1,421 @@
+/** @file
+
+  Host test of the --deadline tier walk in ACPIPatcher/AcpiDeadline.c.
+
+  Tables are served by a mock ACPI folder: Open() hands out mock
+  EFI_FILE_PROTOCOL instances whose Read() returns at most Request bytes
+  and charges Delay on the TimerLib clock, so every scenario is
+  deterministic and does not sleep. Each scenario drives the walk the way
+  PatchAcpi() does (AcpiDeadlineNext(), AcpiDeadlineDefers(), a timed read
+  fed to AcpiPerfRecordRead()) and checks that:
+
+    - every required table is read, before any optional one, even past the
+      deadline;
+    - optional tables are read in order until AcpiDeadlineAllows() refuses
+      one, and that one and every later one are deferred without a read;
+    - Walk.Deferred and the ACPI_LOG_MSG_TABLE_DEFERRED records both count
+      the deferred tables.
+
+  Usage:
+    DeadlineTest [-v]
+
+  Exit status is 0 when every check passes and 1 when any fails.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <HostUefi.h>
+
+#include "AcpiDeadline.h"
+#include "AcpiPerf.h"
+#include "AcpiLog.h"
+
+#define TEST_MAX_TABLES   16
+#define TEST_MS           1000000ULL
+
+//
+// Table file in the mock folder
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  Protocol;
+  UINT64             Size;
+  UINT64             Position;
+  UINT32             Reads;
+} MOCK_FILE;
+
+//
+// Mock ACPI folder; every file shares the same delay and request size
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  Protocol;
+  ACPI_FILE_ENTRY    Entries[TEST_MAX_TABLES];
+  MOCK_FILE          Files[TEST_MAX_TABLES];
+  UINTN              Count;
+  UINT64             DelayNs;
+  UINTN              Request;
+} MOCK_FOLDER;
+
+//
+// Table of a scenario
+//
+typedef struct {
+  CONST CHAR16  *Name;
+  UINT64        Size;
+  UINT8         Tier;
+  BOOLEAN       Read;       ///< Expected to be read rather than deferred
+} TEST_TABLE;
+
+STATIC MOCK_FOLDER  mFolder;
+STATIC UINT32       mLoggedDeferred;
+STATIC UINT64       mLastDeferredName;
+STATIC UINT32       mFailures;
+STATIC UINT32       mChecks;
+
+#define TEST_CHECK(Cond, ...)                               \
+  do {                                                      \
+    mChecks++;                                              \
+    if (!(Cond)) {                                          \
+      mFailures++;                                          \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);           \
+      printf(__VA_ARGS__);                                  \
+      printf("\n");                                         \
+    }                                                       \
+  } while (0)
+
+#define MOCK_FILE_FROM_PROTOCOL(a)  BASE_CR (a, MOCK_FILE, Protocol)
+
+//
+// AcpiLog.c publishes its ring through boot services; the walk only needs
+// the records, so they are counted here
+//
+
+VOID
+AcpiLogRecord (
+  IN UINT8   Level,
+  IN UINT16  MessageId,
+  IN UINT8   ArgCount,
+  IN UINT64  Arg0,
+  IN UINT64  Arg1,
+  IN UINT64  Arg2,
+  IN UINT64  Arg3
+  )
+{
+  if (MessageId == ACPI_LOG_MSG_TABLE_DEFERRED) {
+    mLoggedDeferred++;
+    mLastDeferredName = Arg0;
+  }
+}
+
+UINT64
+AcpiLogPackName (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINT64  Packed;
+  UINTN   Index;
+
+  Packed = 0;
+  for (Index = 0; Index < sizeof(UINT64) && Name[Index] != L'\0'; Index++) {
+    Packed |= LShiftU64((UINT8)Name[Index], Index * 8);
+  }
+  return Packed;
+}
+
+//
+// Mock folder
+//
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  MOCK_FILE  *File;
+  UINTN      Size;
+
+  File = MOCK_FILE_FROM_PROTOCOL(This);
+  File->Reads++;
+  HostClockAdvance(mFolder.DelayNs);
+  Size = MIN(*BufferSize, mFolder.Request);
+  Size = (UINTN)MIN((UINT64)Size, File->Size - File->Position);
+  memset(Buffer, 0x5A, Size);
+  File->Position += Size;
+  *BufferSize     = Size;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFolderOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mFolder.Count; Index++) {
+    if (StrCmp(FileName, mFolder.Entries[Index].Name) == 0) {
+      mFolder.Files[Index].Position = 0;
+      *NewHandle = &mFolder.Files[Index].Protocol;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Fills the mock folder with Count tables, collected in array order.
+**/
+STATIC
+VOID
+MockFolderInit (
+  IN CONST TEST_TABLE  *Tables,
+  IN UINTN             Count,
+  IN UINT64            DelayNs,
+  IN UINTN             Request
+  )
+{
+  UINTN  Index;
+
+  memset(&mFolder, 0, sizeof(mFolder));
+  mFolder.Protocol.Revision = EFI_FILE_PROTOCOL_REVISION;
+  mFolder.Protocol.Open     = MockFolderOpen;
+  mFolder.Protocol.Close    = MockFileClose;
+  mFolder.Count             = Count;
+  mFolder.DelayNs           = DelayNs;
+  mFolder.Request           = Request;
+  for (Index = 0; Index < Count; Index++) {
+    StrCpyS(mFolder.Entries[Index].Name, ACPI_FILE_NAME_LENGTH, Tables[Index].Name);
+    mFolder.Entries[Index].Size       = Tables[Index].Size;
+    mFolder.Entries[Index].Tier       = Tables[Index].Tier;
+    mFolder.Entries[Index].Source     = &mFolder.Protocol;
+    mFolder.Entries[Index].QueueIndex = MAX_UINT32;
+    mFolder.Files[Index].Protocol.Revision = EFI_FILE_PROTOCOL_REVISION;
+    mFolder.Files[Index].Protocol.Read     = MockFileRead;
+    mFolder.Files[Index].Protocol.Close    = MockFileClose;
+    mFolder.Files[Index].Size              = Tables[Index].Size;
+  }
+}
+
+/**
+  Opens and reads a table from the mock folder, as AcpiSourceRead() does
+  for a plain file with the chunked strategy.
+**/
+STATIC
+EFI_STATUS
+TestReadTable (
+  IN ACPI_FILE_ENTRY  *Entry
+  )
+{
+  EFI_FILE_PROTOCOL  *File;
+  EFI_STATUS         Status;
+  UINT8              *Buffer;
+  UINT64             Done;
+  UINTN              Size;
+
+  Status = Entry->Source->Open(Entry->Source, &File, Entry->Name, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  Buffer = malloc((size_t)Entry->Size);
+  for (Done = 0; Done < Entry->Size && !EFI_ERROR(Status); Done += Size) {
+    Size   = (UINTN)(Entry->Size - Done);
+    Status = File->Read(File, &Size, Buffer + Done);
+    if (!EFI_ERROR(Status) && Size == 0) {
+      Status = EFI_END_OF_FILE;
+    }
+  }
+  free(Buffer);
+  File->Close(File);
+  return Status;
+}
+
+//
+// Scenarios
+//
+
+/**
+  Walks the tables under DeadlineMs and checks the outcome against each
+  table's Read flag.
+**/
+STATIC
+VOID
+TestScenario (
+  IN CONST char        *Title,
+  IN CONST TEST_TABLE  *Tables,
+  IN UINTN             Count,
+  IN UINT32            DeadlineMs,
+  IN UINT64            DelayNs,
+  IN UINTN             Request
+  )
+{
+  ACPI_FILE_LIST      Files;
+  ACPI_DEADLINE_WALK  Walk;
+  ACPI_FILE_ENTRY     *File;
+  EFI_STATUS          Status;
+  UINT64              PhaseStart;
+  UINT64              ReadNs;
+  UINTN               Index;
+  UINT32              Returned;
+  UINT32              Expected;
+  BOOLEAN             SeenOptional;
+  BOOLEAN             Deferred[TEST_MAX_TABLES];
+
+  printf("%s\n", Title);
+  MockFolderInit(Tables, Count, DelayNs, Request);
+  memset(Deferred, 0, sizeof(Deferred));
+  mLoggedDeferred   = 0;
+  mLastDeferredName = 0;
+  memset(&Files, 0, sizeof(Files));
+  Files.Entries     = mFolder.Entries;
+  Files.Count       = mFolder.Count;
+  AcpiPerfReset();
+  AcpiPerfStartClock();
+
+  Returned     = 0;
+  SeenOptional = FALSE;
+  AcpiDeadlineWalkInit(&Walk, DeadlineMs);
+  while ((File = AcpiDeadlineNext(&Walk, &Files)) != NULL) {
+    Index = (UINTN)(File - mFolder.Entries);
+    Returned++;
+    TEST_CHECK(File->Tier == AcpiTierOptional || !SeenOptional, "required table %u returned after an optional one", (unsigned)Index);
+    SeenOptional = (BOOLEAN)(SeenOptional || File->Tier == AcpiTierOptional);
+
+    if (AcpiDeadlineDefers(&Walk, File)) {
+      Deferred[Index] = TRUE;
+      TEST_CHECK(mLastDeferredName == AcpiLogPackName(File->Name), "table %u deferred without its log record", (unsigned)Index);
+      continue;
+    }
+
+    PhaseStart = AcpiPerfNow();
+    Status     = TestReadTable(File);
+    ReadNs     = AcpiPerfAddPhase(AcpiPhaseRead, PhaseStart);
+    TEST_CHECK(!EFI_ERROR(Status), "table %u read failed (0x%lx)", (unsigned)Index, (unsigned long)Status);
+    AcpiPerfRecordRead(File->Size, ReadNs);
+  }
+  TEST_CHECK(Returned == Count, "walk returned %u of %u tables", Returned, (unsigned)Count);
+
+  Expected = 0;
+  for (Index = 0; Index < Count; Index++) {
+    if (Tables[Index].Tier == AcpiTierRequired) {
+      TEST_CHECK(!Deferred[Index], "required table %u deferred", (unsigned)Index);
+    }
+    TEST_CHECK(Deferred[Index] == !Tables[Index].Read, "table %u %s, expected it %s", (unsigned)Index,
+               Deferred[Index] ? "deferred" : "read", Tables[Index].Read ? "read" : "deferred");
+    TEST_CHECK((mFolder.Files[Index].Reads == 0) == Deferred[Index], "table %u took %u reads", (unsigned)Index,
+               mFolder.Files[Index].Reads);
+    Expected += Tables[Index].Read ? 0 : 1;
+  }
+  TEST_CHECK(Walk.Deferred == Expected, "%u tables reported deferred, expected %u", Walk.Deferred, Expected);
+  TEST_CHECK(mLoggedDeferred == Walk.Deferred, "%u deferred records logged for %u deferred tables", mLoggedDeferred, Walk.Deferred);
+  printf("  %u tables, %u deferred at %llu ms\n", (unsigned)Count, Walk.Deferred,
+         (unsigned long long)(AcpiPerfClockNs() / TEST_MS));
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  //
+  // 2 KB tables, one 10 ms read each, 100 ms deadline (87.5 ms before the
+  // reserve): the four required tables end at 40 ms, four optional ones
+  // fit and the fifth would end past 87.5 ms. Tiers are interleaved so the
+  // walk has to reorder them.
+  //
+  STATIC CONST TEST_TABLE  Interleaved[] = {
+    { L"SSDT-O0.aml", SIZE_2KB, AcpiTierOptional, TRUE  },
+    { L"DSDT.aml",    SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-O1.aml", SIZE_2KB, AcpiTierOptional, TRUE  },
+    { L"SSDT-O2.aml", SIZE_2KB, AcpiTierOptional, TRUE  },
+    { L"SSDT-R1.aml", SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-O3.aml", SIZE_2KB, AcpiTierOptional, TRUE  },
+    { L"SSDT-R2.aml", SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-O4.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-O5.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-R3.aml", SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-O6.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-O7.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-O8.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-O9.aml", SIZE_2KB, AcpiTierOptional, FALSE }
+  };
+  //
+  // 1 KB requests at 10 ms each: the required tables take 40 ms, the 3 KB
+  // optional table 30 ms more. The next 3 KB table is predicted to end at
+  // 100 ms and is refused; the 1 KB table after it would fit at 84 ms but
+  // stays deferred behind it.
+  //
+  STATIC CONST TEST_TABLE  Sized[] = {
+    { L"DSDT.aml",    SIZE_1KB,     AcpiTierRequired, TRUE  },
+    { L"SSDT-R1.aml", SIZE_1KB,     AcpiTierRequired, TRUE  },
+    { L"SSDT-R2.aml", SIZE_1KB,     AcpiTierRequired, TRUE  },
+    { L"SSDT-R3.aml", SIZE_1KB,     AcpiTierRequired, TRUE  },
+    { L"SSDT-O0.aml", 3 * SIZE_1KB, AcpiTierOptional, TRUE  },
+    { L"SSDT-O1.aml", 3 * SIZE_1KB, AcpiTierOptional, FALSE },
+    { L"SSDT-O2.aml", SIZE_1KB,     AcpiTierOptional, FALSE }
+  };
+  //
+  // 60 ms per read: the required tables alone overrun the deadline and are
+  // still read; every optional table is deferred
+  //
+  STATIC CONST TEST_TABLE  Overrun[] = {
+    { L"SSDT-O0.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"DSDT.aml",    SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-R1.aml", SIZE_2KB, AcpiTierRequired, TRUE  },
+    { L"SSDT-O1.aml", SIZE_2KB, AcpiTierOptional, FALSE },
+    { L"SSDT-R2.aml", SIZE_2KB, AcpiTierRequired, TRUE  }
+  };
+  STATIC CONST TEST_TABLE  NoDeadline[] = {
+    { L"SSDT-O0.aml", SIZE_2KB, AcpiTierOptional, TRUE },
+    { L"DSDT.aml",    SIZE_2KB, AcpiTierRequired, TRUE },
+    { L"SSDT-O1.aml", SIZE_2KB, AcpiTierOptional, TRUE }
+  };
+
+  if (argc == 2 && strcmp(argv[1], "-v") == 0) {
+    gHostDebugLevel = DEBUG_INFO;
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: DeadlineTest [-v]\n");
+    return 1;
+  }
+
+  TestScenario("Interleaved tiers, 100 ms deadline, 10 ms reads", Interleaved, ARRAY_SIZE(Interleaved),
+               100, 10 * TEST_MS, SIZE_4KB);
+  TestScenario("Refused 3 KB table, 100 ms deadline, 1 KB reads", Sized, ARRAY_SIZE(Sized),
+               100, 10 * TEST_MS, SIZE_1KB);
+  TestScenario("Required tables past the deadline, 100 ms deadline, 60 ms reads", Overrun, ARRAY_SIZE(Overrun),
+               100, 60 * TEST_MS, SIZE_4KB);
+  TestScenario("No deadline, 60 ms reads", NoDeadline, ARRAY_SIZE(NoDeadline),
+               0, 60 * TEST_MS, SIZE_4KB);
+
+  printf("%u checks, %u failed\n", mChecks, mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,835 @@
+/** @file
+
+  Host test of ACPIPatcher/FatReader.c against real FAT images.
+
+  The image is served through mock EFI_DISK_IO_PROTOCOL and
+  EFI_BLOCK_IO_PROTOCOL instances, and every file and directory under the
+  tree the image was built from is checked through the reader: directory
+  listings (long and short names), EFI_FILE_INFO sizes, whole reads, odd
+  sized chunked reads and reads after SetPosition. The BlockIo-only mount
+  uses an IoAlign and misaligned buffers so the bounce path is covered.
+
+  The throughput pass then reads every file three ways and reports device
+  transfers, bytes and MB/s: FatReader over DiskIo, FatReader over BlockIo,
+  and a stand-in for the firmware SimpleFileSystem driver that serves the
+  same files from the host and splits each read into requests of at most
+  Request bytes, the way slow EFI 1.x drivers do. Every device call on
+  either side is charged Latency microseconds on the TimerLib clock, so the
+  comparison is deterministic and does not sleep.
+
+  Images are built by MakeFatImages.sh.
+
+  Usage:
+    FatReaderTest [-l LatencyUs] [-r Request] [-v] Image FilesDir
+
+  Exit status is 0 when every check passes, 1 when any fails and 2 when
+  the inputs cannot be read.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <HostUefi.h>
+
+#include "ACPIPatcher.h"
+#include "FatReader.h"
+
+#define TEST_PATH_SIZE      1024
+#define TEST_INFO_SIZE      (SIZE_OF_EFI_FILE_INFO + 512)
+#define TEST_CHUNK_SIZE     777       // Odd, so chunks straddle sectors and clusters
+#define TEST_IO_ALIGN       64
+#define TEST_MAX_NAMES      1024
+
+#define TEST_DEFAULT_LATENCY_US   100
+#define TEST_DEFAULT_REQUEST      512       // One sector, like the EFI 1.x drivers FatReader is for
+
+//
+// Image served as a disk
+//
+typedef struct {
+  EFI_DISK_IO_PROTOCOL   DiskIo;
+  EFI_BLOCK_IO_PROTOCOL  BlockIo;
+  EFI_BLOCK_IO_MEDIA     Media;
+  UINT8                  *Image;
+  UINT64                 ImageSize;
+  UINT64                 LatencyNs;
+  UINT32                 Transfers;
+  UINT64                 Bytes;
+} MOCK_DISK;
+
+//
+// Stand-in for the firmware file system driver, serving host files
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  Protocol;
+  FILE               *Stream;
+  char               Path[TEST_PATH_SIZE];
+} HOST_FILE;
+
+typedef struct {
+  UINT64  LatencyNs;
+  UINTN   Request;
+  UINT32  Transfers;
+  UINT64  Bytes;
+} HOST_FS;
+
+typedef struct {
+  CONST char  *Name;
+  UINT32      Transfers;
+  UINT64      Bytes;
+  UINT64      Ns;
+  UINT32      Files;
+} TEST_PASS;
+
+STATIC MOCK_DISK   mDisk;
+STATIC HOST_FS     mHostFs;
+STATIC UINT32      mFailures;
+STATIC UINT32      mChecks;
+STATIC BOOLEAN     mVerbose;
+
+#define TEST_CHECK(Cond, ...)                               \
+  do {                                                      \
+    mChecks++;                                              \
+    if (!(Cond)) {                                          \
+      mFailures++;                                          \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);           \
+      printf(__VA_ARGS__);                                  \
+      printf("\n");                                         \
+    }                                                       \
+  } while (0)
+
+#define MOCK_DISK_FROM_DISK_IO(a)   BASE_CR (a, MOCK_DISK, DiskIo)
+#define MOCK_DISK_FROM_BLOCK_IO(a)  BASE_CR (a, MOCK_DISK, BlockIo)
+#define HOST_FILE_FROM_PROTOCOL(a)  BASE_CR (a, HOST_FILE, Protocol)
+
+//
+// Mock disk
+//
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockReadDisk (
+  IN  EFI_DISK_IO_PROTOCOL  *This,
+  IN  UINT32                MediaId,
+  IN  UINT64                Offset,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  MOCK_DISK  *Disk;
+
+  Disk = MOCK_DISK_FROM_DISK_IO(This);
+  Disk->Transfers++;
+  HostClockAdvance(Disk->LatencyNs);
+  if (Offset > Disk->ImageSize || BufferSize > Disk->ImageSize - Offset) {
+    return EFI_INVALID_PARAMETER;
+  }
+  memcpy(Buffer, Disk->Image + Offset, BufferSize);
+  Disk->Bytes += BufferSize;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockReadBlocks (
+  IN  EFI_BLOCK_IO_PROTOCOL  *This,
+  IN  UINT32                 MediaId,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  BufferSize,
+  OUT VOID                   *Buffer
+  )
+{
+  MOCK_DISK  *Disk;
+  UINT64     Offset;
+
+  Disk = MOCK_DISK_FROM_BLOCK_IO(This);
+  Disk->Transfers++;
+  HostClockAdvance(Disk->LatencyNs);
+  // Enforce what real BlockIo drivers are allowed to reject
+  if (BufferSize % Disk->Media.BlockSize != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  if (Disk->Media.IoAlign > 1 && ((UINTN)Buffer & (Disk->Media.IoAlign - 1)) != 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Offset = Lba * Disk->Media.BlockSize;
+  if (Offset > Disk->ImageSize || BufferSize > Disk->ImageSize - Offset) {
+    return EFI_INVALID_PARAMETER;
+  }
+  memcpy(Buffer, Disk->Image + Offset, BufferSize);
+  Disk->Bytes += BufferSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Loads Path as the mock disk, with the block size from its boot sector.
+**/
+STATIC
+BOOLEAN
+MockDiskLoad (
+  IN  CONST char  *Path,
+  OUT MOCK_DISK   *Disk
+  )
+{
+  FILE    *Stream;
+  long    Size;
+  UINT32  BlockSize;
+
+  memset(Disk, 0, sizeof(*Disk));
+  Stream = fopen(Path, "rb");
+  if (Stream == NULL) {
+    return FALSE;
+  }
+  fseek(Stream, 0, SEEK_END);
+  Size = ftell(Stream);
+  fseek(Stream, 0, SEEK_SET);
+  Disk->Image = (Size >= 512) ? malloc((size_t)Size) : NULL;
+  if (Disk->Image == NULL || fread(Disk->Image, 1, (size_t)Size, Stream) != (size_t)Size) {
+    fclose(Stream);
+    free(Disk->Image);
+    return FALSE;
+  }
+  fclose(Stream);
+
+  BlockSize = ReadUnaligned16((UINT16 *)(Disk->Image + 11));
+  if (BlockSize < 512 || (BlockSize & (BlockSize - 1)) != 0 || (UINT64)Size % BlockSize != 0) {
+    BlockSize = 512;
+  }
+
+  Disk->ImageSize              = (UINT64)Size;
+  Disk->Media.MediaId          = 1;
+  Disk->Media.MediaPresent     = TRUE;
+  Disk->Media.ReadOnly         = TRUE;
+  Disk->Media.BlockSize        = BlockSize;
+  Disk->Media.LastBlock        = Disk->ImageSize / BlockSize - 1;
+  Disk->BlockIo.Revision       = 0x00010000;
+  Disk->BlockIo.Media          = &Disk->Media;
+  Disk->BlockIo.ReadBlocks     = MockReadBlocks;
+  Disk->DiskIo.Revision        = 0x00010000;
+  Disk->DiskIo.ReadDisk        = MockReadDisk;
+  return TRUE;
+}
+
+//
+// SimpleFileSystem stand-in: only Open, Read and Close, which the
+// throughput pass calls; the other members stay NULL
+//
+
+STATIC EFI_STATUS EFIAPI HostFileOpen (EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostFileClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  HOST_FILE  *File;
+
+  File = HOST_FILE_FROM_PROTOCOL(This);
+  if (File->Stream != NULL) {
+    fclose(File->Stream);
+  }
+  free(File);
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads in requests of at most mHostFs.Request bytes, each one a device call.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+HostFileRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  HOST_FILE  *File;
+  UINTN      Total;
+  UINTN      Length;
+  UINTN      Done;
+
+  File = HOST_FILE_FROM_PROTOCOL(This);
+  if (File->Stream == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  for (Total = 0; Total < *BufferSize; Total += Done) {
+    Length = MIN(*BufferSize - Total, mHostFs.Request);
+    mHostFs.Transfers++;
+    HostClockAdvance(mHostFs.LatencyNs);
+    Done = fread((UINT8 *)Buffer + Total, 1, Length, File->Stream);
+    mHostFs.Bytes += Done;
+    if (Done < Length) {
+      Total += Done;
+      break;
+    }
+  }
+  *BufferSize = Total;
+  return EFI_SUCCESS;
+}
+
+STATIC
+HOST_FILE *
+HostFileCreate (
+  IN CONST char  *Path
+  )
+{
+  HOST_FILE  *File;
+
+  File = calloc(1, sizeof(*File));
+  if (File == NULL) {
+    return NULL;
+  }
+  snprintf(File->Path, sizeof(File->Path), "%s", Path);
+  File->Protocol.Revision    = EFI_FILE_PROTOCOL_REVISION;
+  File->Protocol.Open        = HostFileOpen;
+  File->Protocol.Close       = HostFileClose;
+  File->Protocol.Read        = HostFileRead;
+  return File;
+}
+
+/**
+  Opens a file below This; the lookup is charged one device call.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+HostFileOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  HOST_FILE    *Parent;
+  HOST_FILE    *File;
+  char         Path[TEST_PATH_SIZE];
+  struct stat  Info;
+  UINTN        Length;
+
+  Parent = HOST_FILE_FROM_PROTOCOL(This);
+  Length = (UINTN)snprintf(Path, sizeof(Path), "%s/", Parent->Path);
+  for (; *FileName != 0 && Length < sizeof(Path) - 1; FileName++) {
+    Path[Length++] = (*FileName == L'\\') ? '/' : (char)*FileName;
+  }
+  Path[Length] = 0;
+
+  mHostFs.Transfers++;
+  HostClockAdvance(mHostFs.LatencyNs);
+
+  File = HostFileCreate(Path);
+  if (File == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (stat(Path, &Info) != 0) {
+    free(File);
+    return EFI_NOT_FOUND;
+  }
+  // Directories only serve as the parent of further opens
+  File->Stream = S_ISDIR(Info.st_mode) ? NULL : fopen(Path, "rb");
+  if (File->Stream == NULL && !S_ISDIR(Info.st_mode)) {
+    free(File);
+    return EFI_NOT_FOUND;
+  }
+  *NewHandle = &File->Protocol;
+  return EFI_SUCCESS;
+}
+
+//
+// Host tree helpers
+//
+
+/**
+  Returns the entry names of a host directory, without dot entries.
+**/
+STATIC
+UINTN
+TestListHost (
+  IN  CONST char  *Path,
+  OUT char        **Names
+  )
+{
+  DIR            *Directory;
+  struct dirent  *Entry;
+  UINTN          Count;
+
+  Directory = opendir(Path);
+  if (Directory == NULL) {
+    return 0;
+  }
+  Count = 0;
+  while ((Entry = readdir(Directory)) != NULL && Count < TEST_MAX_NAMES) {
+    if (strcmp(Entry->d_name, ".") != 0 && strcmp(Entry->d_name, "..") != 0) {
+      Names[Count++] = strdup(Entry->d_name);
+    }
+  }
+  closedir(Directory);
+  return Count;
+}
+
+STATIC
+UINT8 *
+TestLoadHost (
+  IN  CONST char  *Path,
+  OUT UINTN       *Size
+  )
+{
+  struct stat  Info;
+  FILE         *Stream;
+  UINT8        *Data;
+
+  if (stat(Path, &Info) != 0 || (Stream = fopen(Path, "rb")) == NULL) {
+    return NULL;
+  }
+  Data = malloc((size_t)Info.st_size + 1);
+  if (Data != NULL && fread(Data, 1, (size_t)Info.st_size, Stream) != (size_t)Info.st_size) {
+    free(Data);
+    Data = NULL;
+  }
+  fclose(Stream);
+  *Size = (UINTN)Info.st_size;
+  return Data;
+}
+
+STATIC
+VOID
+TestToChar16 (
+  IN  CONST char  *Path,
+  OUT CHAR16      *Wide,
+  IN  UINTN       Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Path[Index] != 0 && Index < Count - 1; Index++) {
+    Wide[Index] = (Path[Index] == '/') ? L'\\' : (CHAR16)(UINT8)Path[Index];
+  }
+  Wide[Index] = 0;
+}
+
+STATIC
+VOID
+TestToChar8 (
+  IN  CONST CHAR16  *Wide,
+  OUT char          *Name,
+  IN  UINTN         Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Wide[Index] != 0 && Index < Count - 1; Index++) {
+    Name[Index] = (Wide[Index] < 0x80) ? (char)Wide[Index] : '?';
+  }
+  Name[Index] = 0;
+}
+
+//
+// Checks
+//
+
+/**
+  Reads one file through the reader in every pattern the patcher uses and
+  compares it with the host copy.
+**/
+STATIC
+VOID
+TestFile (
+  IN EFI_FILE_PROTOCOL  *Root,
+  IN CONST char         *Relative,
+  IN CONST char         *HostPath
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  CHAR16             Path[TEST_PATH_SIZE];
+  UINT8              InfoBuffer[TEST_INFO_SIZE];
+  EFI_FILE_INFO      *Info;
+  UINT8              *Expected;
+  UINT8              *Allocation;
+  UINT8              *Buffer;
+  UINTN              Size;
+  UINTN              BufferSize;
+  UINTN              Offset;
+  UINT64             Position;
+
+  Expected = TestLoadHost(HostPath, &Size);
+  if (Expected == NULL) {
+    TEST_CHECK(FALSE, "%s: cannot read the host copy", HostPath);
+    return;
+  }
+
+  TestToChar16(Relative, Path, ARRAY_SIZE(Path));
+  Status = Root->Open(Root, &File, Path, EFI_FILE_MODE_READ, 0);
+  TEST_CHECK(!EFI_ERROR(Status), "%s: open failed (0x%lx)", Relative, (unsigned long)Status);
+  if (EFI_ERROR(Status)) {
+    free(Expected);
+    return;
+  }
+
+  Info       = (EFI_FILE_INFO *)InfoBuffer;
+  BufferSize = sizeof(InfoBuffer);
+  Status     = File->GetInfo(File, &gEfiFileInfoGuid, &BufferSize, Info);
+  TEST_CHECK(!EFI_ERROR(Status) && Info->FileSize == Size && (Info->Attribute & EFI_FILE_DIRECTORY) == 0,
+             "%s: info size %llu, expected %zu", Relative, (unsigned long long)Info->FileSize, (size_t)Size);
+
+  // Whole read into a buffer off by one byte from any alignment, one byte bigger than the file
+  Allocation = malloc(Size + 2);
+  Buffer     = Allocation + 1;
+  BufferSize = Size + 1;
+  Status     = File->Read(File, &BufferSize, Buffer);
+  TEST_CHECK(!EFI_ERROR(Status) && BufferSize == Size && memcmp(Buffer, Expected, Size) == 0,
+             "%s: whole read returned %zu of %zu bytes or different data", Relative, (size_t)BufferSize, (size_t)Size);
+
+  BufferSize = 1;
+  Status     = File->Read(File, &BufferSize, Buffer);
+  TEST_CHECK(!EFI_ERROR(Status) && BufferSize == 0, "%s: read at the end returned %zu bytes", Relative, (size_t)BufferSize);
+
+  // Odd sized chunks
+  memset(Buffer, 0, Size);
+  File->SetPosition(File, 0);
+  for (Offset = 0; Offset < Size; Offset += BufferSize) {
+    BufferSize = TEST_CHUNK_SIZE;
+    Status     = File->Read(File, &BufferSize, Buffer + Offset);
+    if (EFI_ERROR(Status) || BufferSize == 0) {
+      break;
+    }
+  }
+  TEST_CHECK(Offset == Size && memcmp(Buffer, Expected, Size) == 0,
+             "%s: chunked read stopped at %zu of %zu bytes or differs", Relative, (size_t)Offset, (size_t)Size);
+
+  // Seek back into the middle, past a cluster boundary for most files
+  Offset = Size / 3;
+  File->SetPosition(File, Offset);
+  File->GetPosition(File, &Position);
+  BufferSize = Size - Offset;
+  Status     = File->Read(File, &BufferSize, Buffer);
+  TEST_CHECK(Position == Offset && !EFI_ERROR(Status) && BufferSize == Size - Offset &&
+             memcmp(Buffer, Expected + Offset, BufferSize) == 0,
+             "%s: read after SetPosition(%zu) differs", Relative, (size_t)Offset);
+
+  File->Close(File);
+  free(Allocation);
+  free(Expected);
+}
+
+/**
+  Compares a directory listing with the host directory and recurses.
+**/
+STATIC
+VOID
+TestDirectory (
+  IN EFI_FILE_PROTOCOL  *Root,
+  IN CONST char         *Relative,
+  IN CONST char         *HostPath
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Directory;
+  CHAR16             Path[TEST_PATH_SIZE];
+  UINT8              InfoBuffer[TEST_INFO_SIZE];
+  EFI_FILE_INFO      *Info;
+  char               *Names[TEST_MAX_NAMES];
+  char               Name[TEST_PATH_SIZE];
+  char               ChildRelative[TEST_PATH_SIZE];
+  char               ChildHost[TEST_PATH_SIZE];
+  struct stat        HostInfo;
+  UINTN              Count;
+  UINTN              Listed;
+  UINTN              Index;
+  UINTN              BufferSize;
+
+  if (Relative[0] == 0) {
+    Directory = Root;
+    Status    = Root->SetPosition(Root, 0);
+  } else {
+    TestToChar16(Relative, Path, ARRAY_SIZE(Path));
+    Status = Root->Open(Root, &Directory, Path, EFI_FILE_MODE_READ, 0);
+  }
+  TEST_CHECK(!EFI_ERROR(Status), "%s/: open failed (0x%lx)", Relative, (unsigned long)Status);
+  if (EFI_ERROR(Status)) {
+    return;
+  }
+
+  Count  = TestListHost(HostPath, Names);
+  Info   = (EFI_FILE_INFO *)InfoBuffer;
+  Listed = 0;
+  for (;;) {
+    BufferSize = sizeof(InfoBuffer);
+    Status     = Directory->Read(Directory, &BufferSize, Info);
+    if (EFI_ERROR(Status) || BufferSize == 0) {
+      TEST_CHECK(!EFI_ERROR(Status), "%s/: listing failed (0x%lx)", Relative, (unsigned long)Status);
+      break;
+    }
+    TestToChar8(Info->FileName, Name, sizeof(Name));
+    if (strcmp(Name, ".") == 0 || strcmp(Name, "..") == 0) {
+      continue;
+    }
+    for (Index = 0; Index < Count; Index++) {
+      if (Names[Index] != NULL && strcmp(Names[Index], Name) == 0) {
+        break;
+      }
+    }
+    TEST_CHECK(Index < Count, "%s/: lists '%s', which the host tree does not have", Relative, Name);
+    if (Index == Count) {
+      continue;
+    }
+    free(Names[Index]);
+    Names[Index] = NULL;
+    Listed++;
+
+    snprintf(ChildRelative, sizeof(ChildRelative), "%s%s%s", Relative, Relative[0] != 0 ? "/" : "", Name);
+    snprintf(ChildHost, sizeof(ChildHost), "%s/%s", HostPath, Name);
+    if (stat(ChildHost, &HostInfo) == 0 && S_ISDIR(HostInfo.st_mode)) {
+      TEST_CHECK((Info->Attribute & EFI_FILE_DIRECTORY) != 0, "%s: not listed as a directory", ChildRelative);
+      TestDirectory(Root, ChildRelative, ChildHost);
+    } else {
+      TEST_CHECK(Info->FileSize == (UINT64)HostInfo.st_size, "%s: listed with size %llu, expected %lld",
+                 ChildRelative, (unsigned long long)Info->FileSize, (long long)HostInfo.st_size);
+      TestFile(Root, ChildRelative, ChildHost);
+    }
+  }
+  for (Index = 0; Index < Count; Index++) {
+    TEST_CHECK(Names[Index] == NULL, "%s/: '%s' is missing from the listing", Relative, Names[Index]);
+    free(Names[Index]);
+  }
+  if (mVerbose) {
+    printf("  %s/: %zu entries\n", Relative, (size_t)Listed);
+  }
+
+  if (Directory != Root) {
+    Directory->Close(Directory);
+  }
+}
+
+//
+// Throughput
+//
+
+/**
+  Reads every file below HostPath whole, opening each relative to its
+  directory the way the patcher walks the ACPI folder.
+**/
+STATIC
+VOID
+TestReadAll (
+  IN     EFI_FILE_PROTOCOL  *Directory,
+  IN     CONST char         *HostPath,
+  IN OUT TEST_PASS          *Pass
+  )
+{
+  char               *Names[TEST_MAX_NAMES];
+  char               ChildHost[TEST_PATH_SIZE];
+  CHAR16             Name[TEST_PATH_SIZE];
+  struct stat        HostInfo;
+  EFI_FILE_PROTOCOL  *File;
+  UINT8              *Buffer;
+  UINTN              BufferSize;
+  UINTN              Count;
+  UINTN              Index;
+
+  Count = TestListHost(HostPath, Names);
+  for (Index = 0; Index < Count; Index++) {
+    snprintf(ChildHost, sizeof(ChildHost), "%s/%s", HostPath, Names[Index]);
+    TestToChar16(Names[Index], Name, ARRAY_SIZE(Name));
+    free(Names[Index]);
+    if (stat(ChildHost, &HostInfo) != 0) {
+      continue;
+    }
+    if (EFI_ERROR(Directory->Open(Directory, &File, Name, EFI_FILE_MODE_READ, 0))) {
+      TEST_CHECK(FALSE, "%s: %s cannot open it", ChildHost, Pass->Name);
+      continue;
+    }
+    if (S_ISDIR(HostInfo.st_mode)) {
+      TestReadAll(File, ChildHost, Pass);
+      File->Close(File);
+      continue;
+    }
+
+    BufferSize = (UINTN)HostInfo.st_size;
+    Buffer     = malloc(BufferSize + 1);
+    File->Read(File, &BufferSize, Buffer);
+    TEST_CHECK(BufferSize == (UINTN)HostInfo.st_size, "%s: %s read %zu bytes", ChildHost, Pass->Name, (size_t)BufferSize);
+    File->Close(File);
+    free(Buffer);
+    Pass->Bytes += BufferSize;
+    Pass->Files++;
+  }
+}
+
+STATIC
+VOID
+TestPrintPass (
+  IN CONST TEST_PASS  *Pass
+  )
+{
+  printf("  %-28s %6u files %8llu bytes %8u transfers %9.3f ms %9.2f MB/s\n",
+         Pass->Name, Pass->Files, (unsigned long long)Pass->Bytes, Pass->Transfers,
+         Pass->Ns / 1e6, Pass->Ns != 0 ? Pass->Bytes * 1e3 / Pass->Ns : 0.0);
+}
+
+/**
+  Mounts the image and reads the whole tree through FatReader.
+**/
+STATIC
+VOID
+TestThroughputFat (
+  IN     CONST char  *FilesDir,
+  IN     BOOLEAN     UseDiskIo,
+  IN OUT TEST_PASS   *Pass
+  )
+{
+  EFI_FILE_PROTOCOL  *Root;
+  UINT64             Start;
+
+  mDisk.Transfers     = 0;
+  mDisk.Media.IoAlign = 0;
+  Start = GetPerformanceCounter();
+  if (EFI_ERROR(FatOpenVolumeIo(UseDiskIo ? &mDisk.DiskIo : NULL, &mDisk.BlockIo, &Root))) {
+    TEST_CHECK(FALSE, "%s: mount failed", Pass->Name);
+    return;
+  }
+  TestReadAll(Root, FilesDir, Pass);
+  Root->Close(Root);
+  Pass->Ns        = GetTimeInNanoSecond(GetPerformanceCounter() - Start);
+  Pass->Transfers = mDisk.Transfers;
+}
+
+STATIC
+VOID
+TestThroughputHost (
+  IN     CONST char  *FilesDir,
+  IN OUT TEST_PASS   *Pass
+  )
+{
+  HOST_FILE  *Root;
+  UINT64     Start;
+
+  mHostFs.Transfers = 0;
+  Start = GetPerformanceCounter();
+  Root  = HostFileCreate(FilesDir);
+  if (Root == NULL) {
+    return;
+  }
+  TestReadAll(&Root->Protocol, FilesDir, Pass);
+  Root->Protocol.Close(&Root->Protocol);
+  Pass->Ns        = GetTimeInNanoSecond(GetPerformanceCounter() - Start);
+  Pass->Transfers = mHostFs.Transfers;
+}
+
+STATIC
+VOID
+TestUsage (
+  VOID
+  )
+{
+  fprintf(stderr,
+          "Usage: FatReaderTest [-l LatencyUs] [-r Request] [-v] Image FilesDir\n"
+          "  Image      FAT image built from FilesDir by MakeFatImages.sh\n"
+          "  FilesDir   tree the image holds, compared file by file\n"
+          "  -l N       microseconds charged per device call (default %u)\n"
+          "  -r N       largest request of the SimpleFileSystem stand-in (default %u)\n"
+          "  -v         print each directory and the reader's own statistics\n",
+          TEST_DEFAULT_LATENCY_US, TEST_DEFAULT_REQUEST);
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Root;
+  CONST char         *Image;
+  CONST char         *FilesDir;
+  UINT64             LatencyNs;
+  TEST_PASS          Passes[3];
+  int                Index;
+
+  LatencyNs        = TEST_DEFAULT_LATENCY_US * 1000ULL;
+  mHostFs.Request  = TEST_DEFAULT_REQUEST;
+  for (Index = 1; Index < argc && argv[Index][0] == '-'; Index++) {
+    if (strcmp(argv[Index], "-l") == 0 && Index + 1 < argc) {
+      LatencyNs = strtoull(argv[++Index], NULL, 0) * 1000ULL;
+    } else if (strcmp(argv[Index], "-r") == 0 && Index + 1 < argc) {
+      mHostFs.Request = (UINTN)strtoull(argv[++Index], NULL, 0);
+    } else if (strcmp(argv[Index], "-v") == 0) {
+      mVerbose        = TRUE;
+      gHostDebugLevel = DEBUG_INFO;
+    } else {
+      TestUsage();
+      return 2;
+    }
+  }
+  if (argc - Index != 2 || mHostFs.Request == 0) {
+    TestUsage();
+    return 2;
+  }
+  Image    = argv[Index];
+  FilesDir = argv[Index + 1];
+
+  if (!MockDiskLoad(Image, &mDisk)) {
+    fprintf(stderr, "FatReaderTest: cannot read %s\n", Image);
+    return 2;
+  }
+  printf("%s: %llu bytes, %u byte blocks\n", Image, (unsigned long long)mDisk.ImageSize, mDisk.Media.BlockSize);
+
+  //
+  // Contents, through DiskIo and then BlockIo alone with an alignment requirement
+  //
+  Status = FatOpenVolumeIo(&mDisk.DiskIo, &mDisk.BlockIo, &Root);
+  TEST_CHECK(!EFI_ERROR(Status), "DiskIo mount failed (0x%lx)", (unsigned long)Status);
+  if (!EFI_ERROR(Status)) {
+    TestDirectory(Root, "", FilesDir);
+    Root->Close(Root);
+  }
+
+  mDisk.Media.IoAlign = TEST_IO_ALIGN;
+  Status = FatOpenVolumeIo(NULL, &mDisk.BlockIo, &Root);
+  TEST_CHECK(!EFI_ERROR(Status), "BlockIo mount failed (0x%lx)", (unsigned long)Status);
+  if (!EFI_ERROR(Status)) {
+    TestDirectory(Root, "", FilesDir);
+    Root->Close(Root);
+  }
+  TEST_CHECK(gHostLivePools == 0, "%zu pool buffers left after the volumes were closed", (size_t)gHostLivePools);
+
+  //
+  // Throughput against the SimpleFileSystem stand-in
+  //
+  memset(Passes, 0, sizeof(Passes));
+  Passes[0].Name = "FatReader over DiskIo";
+  Passes[1].Name = "FatReader over BlockIo";
+  Passes[2].Name = "SimpleFileSystem stand-in";
+  mDisk.LatencyNs   = LatencyNs;
+  mHostFs.LatencyNs = LatencyNs;
+  TestThroughputFat(FilesDir, TRUE, &Passes[0]);
+  TestThroughputFat(FilesDir, FALSE, &Passes[1]);
+  TestThroughputHost(FilesDir, &Passes[2]);
+
+  printf("Throughput, %llu us per device call, %zu byte driver requests:\n",
+         (unsigned long long)(LatencyNs / 1000), (size_t)mHostFs.Request);
+  for (Index = 0; Index < (int)ARRAY_SIZE(Passes); Index++) {
+    TestPrintPass(&Passes[Index]);
+  }
+
+  printf("%u checks, %u failed\n", mChecks, mFailures);
+  free(mDisk.Image);
+  return (mFailures == 0) ? 0 : 1;
+}
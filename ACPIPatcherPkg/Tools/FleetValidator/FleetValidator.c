@@ -0,0 +1,1009 @@
+/** @file
+
+  Offline validator for ACPIPatcher table sets across a fleet of machines.
+
+  Runs the table checks and XSDT capacity rules of the firmware (shared
+  through ACPIPatcher/AcpiRules.c) for every combination of a firmware dump
+  and a patch set, on all cores, and reports which sets would fail on which
+  machines before anything is copied to an ESP.
+
+  Corpus layout:
+
+    Corpus/dumps/<Model>/     ACPIPatcher.efi --export output of one machine:
+                              SIG-OEMTABLEID-N.aml files or TABLES.BND, plus
+                              an optional PRODUCT.TXT holding the SMBIOS
+                              product name on its first line
+    Corpus/patches/<Set>/     An ACPI folder as it would sit on the ESP:
+                              .aml files, P-XXXXXXXX profile subdirectories
+                              and an optional TABLES.BND
+
+  For each pair the profile is picked from the dump identity the way
+  AcpiProfile.c and AcpiSource.c do, the tables are merged in the same
+  order, and the pair fails when a table is malformed or the set needs more
+  XSDT entries than the firmware allows. Tables over 64 KB or more than 8
+  additional tables, which EFI 1.x firmware may refuse, are warnings unless
+  --efi1x makes them failures.
+
+  Usage:
+    FleetValidator [-j Threads] [-q] [--efi1x] Corpus
+
+  Exit status is 0 when every pair passes, 1 when any fails and 2 when the
+  corpus cannot be read.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <AcpiPatcherBundle.h>
+#include "AcpiRules.h"
+#include "WorkPool.h"
+
+#define FLEET_BUNDLE_NAME       "TABLES.BND"
+#define FLEET_PRODUCT_NAME      "PRODUCT.TXT"
+#define FLEET_MAX_FILE_SIZE     (64 * SIZE_1MB)
+#define FLEET_MESSAGE_SIZE      512
+
+// Version 1 bundle entries end with the name where ProfileKey now sits
+#define FLEET_V1_KEY_OFFSET     offsetof (ACPI_PATCHER_BUNDLE_ENTRY, ProfileKey)
+
+#define ACPI_PROFILE_OEM_ID_SIZE        6
+#define ACPI_PROFILE_OEM_TABLE_SIZE     8
+#define ACPI_PROFILE_PRODUCT_SIZE       64
+
+//
+// Where a patch set table comes from, in the order AcpiSourceCollect adds them
+//
+typedef enum {
+  FleetOriginBundleCommon,
+  FleetOriginBundleProfile,
+  FleetOriginRoot,
+  FleetOriginProfileDir,
+  FleetOriginMax
+} FLEET_ORIGIN;
+
+typedef struct {
+  char               *Name;
+  UINT32             Signature;
+  UINT32             Size;
+  UINT32             Key;
+  FLEET_ORIGIN       Origin;
+  ACPI_TABLE_DEFECT  Defect;
+  UINT8              Checksum;
+  UINT8              *Data;       ///< Kept for dump XSDT and FACP only
+} FLEET_TABLE;
+
+//
+// A dump or a patch set
+//
+typedef struct {
+  char         *Name;
+  char         *Path;
+  BOOLEAN      IsDump;
+  FLEET_TABLE  *Tables;
+  UINTN        Count;
+  UINTN        Capacity;
+  UINT32       *Profiles;         ///< Set: profile keys with tables
+  UINTN        ProfileCount;
+  UINT64       Bytes;
+  CHAR8        OemId[ACPI_PROFILE_OEM_ID_SIZE + 1];
+  CHAR8        OemTableId[ACPI_PROFILE_OEM_TABLE_SIZE + 1];
+  CHAR8        Product[ACPI_PROFILE_PRODUCT_SIZE];
+  UINT32       Keys[2];           ///< Dump: candidate profile keys, most specific first
+  UINTN        KeyCount;
+  char         *Error;
+} FLEET_FOLDER;
+
+typedef struct {
+  BOOLEAN  Pass;
+  UINT32   Profile;
+  UINT32   Tables;
+  UINT32   Slots;
+  UINT64   Bytes;
+  char     *Message;              ///< Failures and warnings, NULL if none
+} FLEET_RESULT;
+
+typedef struct {
+  FLEET_FOLDER  *Dumps;
+  UINTN         DumpCount;
+  FLEET_FOLDER  *Sets;
+  UINTN         SetCount;
+  FLEET_RESULT  *Results;         ///< SetCount * DumpCount, set major
+  BOOLEAN       Efi1x;
+} FLEET;
+
+STATIC UINT32  mCrcTable[256];
+
+/**
+  Fills the CRC32 table used for bundle entries (the polynomial of
+  gBS->CalculateCrc32 and zlib).
+**/
+STATIC
+VOID
+FleetCrcInit (
+  VOID
+  )
+{
+  UINT32  Index;
+  UINT32  Value;
+  UINT32  Bit;
+
+  for (Index = 0; Index < 256; Index++) {
+    Value = Index;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Value = (Value & 1) ? (0xEDB88320 ^ (Value >> 1)) : (Value >> 1);
+    }
+    mCrcTable[Index] = Value;
+  }
+}
+
+STATIC
+UINT32
+FleetCrc32 (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  UINT32  Crc;
+
+  Crc = 0xFFFFFFFF;
+  while (Size-- > 0) {
+    Crc = mCrcTable[(Crc ^ *Data++) & 0xFF] ^ (Crc >> 8);
+  }
+  return Crc ^ 0xFFFFFFFF;
+}
+
+/**
+  Appends a formatted note to a "; "-separated message.
+
+  @param[in,out] Message    Message, NULL when empty; reallocated
+  @param[in]     Format     printf format
+**/
+STATIC
+VOID
+FleetNote (
+  IN OUT char        **Message,
+  IN     CONST char  *Format,
+  ...
+  )
+{
+  char     Note[FLEET_MESSAGE_SIZE];
+  char     *Grown;
+  UINTN    Length;
+  va_list  Args;
+
+  va_start(Args, Format);
+  vsnprintf(Note, sizeof(Note), Format, Args);
+  va_end(Args);
+
+  Length = (*Message != NULL) ? strlen(*Message) : 0;
+  Grown  = realloc(*Message, Length + strlen(Note) + 3);
+  if (Grown == NULL) {
+    return;
+  }
+  if (Length > 0) {
+    strcpy(Grown + Length, "; ");
+    Length += 2;
+  }
+  strcpy(Grown + Length, Note);
+  *Message = Grown;
+}
+
+STATIC
+double
+FleetNow (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return Now.tv_sec + Now.tv_nsec / 1e9;
+}
+
+STATIC
+char *
+FleetJoin (
+  IN CONST char  *Directory,
+  IN CONST char  *Name
+  )
+{
+  char  *Path;
+
+  Path = malloc(strlen(Directory) + strlen(Name) + 2);
+  if (Path != NULL) {
+    sprintf(Path, "%s/%s", Directory, Name);
+  }
+  return Path;
+}
+
+STATIC
+int
+FleetCompareNames (
+  IN CONST void  *Left,
+  IN CONST void  *Right
+  )
+{
+  return strcmp(*(char * CONST *)Left, *(char * CONST *)Right);
+}
+
+/**
+  Lists a directory in name order, leaving out "." and "..".
+
+  @param[in]  Path    Directory
+  @param[out] Names   Allocated names; free each and the array
+
+  @return Number of names, or -1 if the directory cannot be read
+**/
+STATIC
+INTN
+FleetListDirectory (
+  IN  CONST char  *Path,
+  OUT char        ***Names
+  )
+{
+  DIR            *Directory;
+  struct dirent  *Entry;
+  char           **List;
+  char           **Grown;
+  UINTN          Count;
+  UINTN          Capacity;
+
+  Directory = opendir(Path);
+  if (Directory == NULL) {
+    return -1;
+  }
+
+  List     = NULL;
+  Count    = 0;
+  Capacity = 0;
+  while ((Entry = readdir(Directory)) != NULL) {
+    if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0) {
+      continue;
+    }
+    if (Count == Capacity) {
+      Capacity = (Capacity == 0) ? 64 : Capacity * 2;
+      Grown    = realloc(List, Capacity * sizeof(char *));
+      if (Grown == NULL) {
+        break;
+      }
+      List = Grown;
+    }
+    List[Count] = strdup(Entry->d_name);
+    if (List[Count] != NULL) {
+      Count++;
+    }
+  }
+  closedir(Directory);
+
+  qsort(List, Count, sizeof(char *), FleetCompareNames);
+  *Names = List;
+  return (INTN)Count;
+}
+
+STATIC
+VOID
+FleetFreeNames (
+  IN char   **Names,
+  IN INTN   Count
+  )
+{
+  while (Count-- > 0) {
+    free(Names[Count]);
+  }
+  free(Names);
+}
+
+/**
+  Reads a whole file.
+
+  @param[in]  Path    File to read
+  @param[out] Data    Allocated contents
+  @param[out] Size    File size
+
+  @return 0 on success, -1 with errno set otherwise
+**/
+STATIC
+int
+FleetReadFile (
+  IN  CONST char  *Path,
+  OUT UINT8       **Data,
+  OUT UINTN       *Size
+  )
+{
+  FILE         *File;
+  struct stat  Info;
+
+  *Data = NULL;
+  File  = fopen(Path, "rb");
+  if (File == NULL) {
+    return -1;
+  }
+  if (fstat(fileno(File), &Info) != 0 || Info.st_size > FLEET_MAX_FILE_SIZE) {
+    fclose(File);
+    return -1;
+  }
+
+  *Size = (UINTN)Info.st_size;
+  *Data = malloc(*Size + 1);
+  if (*Data == NULL || fread(*Data, 1, *Size, File) != *Size) {
+    free(*Data);
+    *Data = NULL;
+    fclose(File);
+    return -1;
+  }
+  fclose(File);
+  return 0;
+}
+
+STATIC
+BOOLEAN
+FleetHasProfile (
+  IN CONST FLEET_FOLDER  *Folder,
+  IN UINT32              Key
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Folder->ProfileCount; Index++) {
+    if (Folder->Profiles[Index] == Key) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+STATIC
+VOID
+FleetAddProfile (
+  IN OUT FLEET_FOLDER  *Folder,
+  IN     UINT32        Key
+  )
+{
+  UINT32  *Grown;
+
+  if (Key == ACPI_PROFILE_COMMON_KEY || FleetHasProfile(Folder, Key)) {
+    return;
+  }
+  Grown = realloc(Folder->Profiles, (Folder->ProfileCount + 1) * sizeof(UINT32));
+  if (Grown != NULL) {
+    Grown[Folder->ProfileCount++] = Key;
+    Folder->Profiles = Grown;
+  }
+}
+
+/**
+  Checks a table and adds it to the folder. Takes ownership of Data.
+
+  @retval 0   Table added
+  @retval -1  Out of memory
+**/
+STATIC
+int
+FleetAddTable (
+  IN OUT FLEET_FOLDER  *Folder,
+  IN     CONST char    *Name,
+  IN     UINT8         *Data,
+  IN     UINTN         Size,
+  IN     UINT32        Key,
+  IN     FLEET_ORIGIN  Origin
+  )
+{
+  FLEET_TABLE  *Table;
+  FLEET_TABLE  *Grown;
+
+  if (Folder->Count == Folder->Capacity) {
+    Folder->Capacity = (Folder->Capacity == 0) ? MAX_ADDITIONAL_TABLES : Folder->Capacity * 2;
+    Grown = realloc(Folder->Tables, Folder->Capacity * sizeof(FLEET_TABLE));
+    if (Grown == NULL) {
+      free(Data);
+      return -1;
+    }
+    Folder->Tables = Grown;
+  }
+
+  Table = &Folder->Tables[Folder->Count++];
+  memset(Table, 0, sizeof(*Table));
+  Table->Name      = strdup(Name);
+  Table->Size      = (UINT32)Size;
+  Table->Key       = Key;
+  Table->Origin    = Origin;
+  Table->Defect    = AcpiRulesCheckTable(Data, Size, &Table->Checksum);
+  if (Size >= sizeof(UINT32)) {
+    memcpy(&Table->Signature, Data, sizeof(UINT32));
+  }
+  Folder->Bytes += Size;
+
+  if (Folder->IsDump && Table->Defect == AcpiTableSound &&
+      (Table->Signature == EFI_ACPI_XSDT_SIGNATURE || Table->Signature == EFI_ACPI_FADT_SIGNATURE)) {
+    Table->Data = Data;
+  } else {
+    free(Data);
+  }
+  return 0;
+}
+
+/**
+  Adds the tables of a TABLES.BND bundle, as AcpiSourceAddBundle does.
+**/
+STATIC
+VOID
+FleetLoadBundle (
+  IN OUT FLEET_FOLDER  *Folder,
+  IN     CONST char    *Path
+  )
+{
+  ACPI_PATCHER_BUNDLE_HEADER  Header;
+  ACPI_PATCHER_BUNDLE_ENTRY   Entry;
+  UINT8                       *Data;
+  UINT8                       *Table;
+  UINTN                       Size;
+  UINTN                       EntrySize;
+  UINT32                      Index;
+  CHAR8                       Name[ACPI_PATCHER_BUNDLE_NAME_SIZE + 1];
+
+  if (FleetReadFile(Path, &Data, &Size) != 0) {
+    FleetNote(&Folder->Error, "%s: cannot read", FLEET_BUNDLE_NAME);
+    return;
+  }
+
+  memcpy(&Header, Data, MIN(Size, sizeof(Header)));
+  // Version 1 entries lack ProfileKey
+  EntrySize = (Header.Version == 1) ? sizeof(Entry) - sizeof(UINT32) : sizeof(Entry);
+  if (Size < sizeof(Header) || Header.Signature != ACPI_PATCHER_BUNDLE_SIGNATURE ||
+      Header.Version == 0 || Header.Version > ACPI_PATCHER_BUNDLE_VERSION || Header.EntrySize != EntrySize ||
+      Header.TotalSize > Size || sizeof(Header) + (UINT64)Header.TableCount * EntrySize > Size) {
+    FleetNote(&Folder->Error, "%s: malformed bundle", FLEET_BUNDLE_NAME);
+    free(Data);
+    return;
+  }
+
+  for (Index = 0; Index < Header.TableCount; Index++) {
+    memset(&Entry, 0, sizeof(Entry));
+    if (Header.Version == 1) {
+      memcpy(&Entry, Data + sizeof(Header) + Index * EntrySize, FLEET_V1_KEY_OFFSET);
+      memcpy(Entry.Name, Data + sizeof(Header) + Index * EntrySize + FLEET_V1_KEY_OFFSET, sizeof(Entry.Name));
+    } else {
+      memcpy(&Entry, Data + sizeof(Header) + Index * EntrySize, EntrySize);
+    }
+    if (Entry.Offset == 0) {
+      continue;
+    }
+
+    memcpy(Name, Entry.Name, sizeof(Entry.Name));
+    Name[sizeof(Entry.Name)] = '\0';
+    if ((UINT64)Entry.Offset + Entry.Length > Size) {
+      FleetNote(&Folder->Error, "%s: %s extends past the end", FLEET_BUNDLE_NAME, Name);
+      continue;
+    }
+    if (FleetCrc32(Data + Entry.Offset, Entry.Length) != Entry.Crc32) {
+      FleetNote(&Folder->Error, "%s: %s fails its CRC32", FLEET_BUNDLE_NAME, Name);
+      continue;
+    }
+
+    Table = malloc(MAX(Entry.Length, 1));
+    if (Table == NULL) {
+      break;
+    }
+    memcpy(Table, Data + Entry.Offset, Entry.Length);
+    FleetAddTable(Folder, Name, Table, Entry.Length, Entry.ProfileKey,
+                  Entry.ProfileKey == ACPI_PROFILE_COMMON_KEY ? FleetOriginBundleCommon : FleetOriginBundleProfile);
+    FleetAddProfile(Folder, Entry.ProfileKey);
+  }
+
+  free(Data);
+}
+
+/**
+  Tells whether AcpiSourceAddDirectory would load a file of this name.
+**/
+STATIC
+BOOLEAN
+FleetIsTableName (
+  IN CONST char  *Name
+  )
+{
+  return (BOOLEAN)(Name[0] != '.' && Name[0] != '_' && strstr(Name, ".aml") != NULL);
+}
+
+/**
+  Parses a P-XXXXXXXX profile directory name.
+
+  @return Profile key, or ACPI_PROFILE_COMMON_KEY if Name is not a profile directory
+**/
+STATIC
+UINT32
+FleetProfileDirKey (
+  IN CONST char  *Name
+  )
+{
+  char           *End;
+  unsigned long  Key;
+
+  if ((Name[0] != 'P' && Name[0] != 'p') || Name[1] != '-' || strlen(Name) != 10) {
+    return ACPI_PROFILE_COMMON_KEY;
+  }
+  Key = strtoul(&Name[2], &End, 16);
+  return (*End == '\0') ? (UINT32)Key : ACPI_PROFILE_COMMON_KEY;
+}
+
+/**
+  Adds the table files of one directory. Patch sets also descend into
+  profile subdirectories.
+**/
+STATIC
+VOID
+FleetLoadDirectory (
+  IN OUT FLEET_FOLDER  *Folder,
+  IN     CONST char    *Path,
+  IN     UINT32        Key
+  )
+{
+  char         **Names;
+  char         *FilePath;
+  UINT8        *Data;
+  UINTN        Size;
+  INTN         Count;
+  INTN         Index;
+  UINT32       SubKey;
+  struct stat  Info;
+
+  Count = FleetListDirectory(Path, &Names);
+  if (Count < 0) {
+    FleetNote(&Folder->Error, "cannot list %s", Path);
+    return;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    FilePath = FleetJoin(Path, Names[Index]);
+    if (FilePath == NULL || stat(FilePath, &Info) != 0) {
+      free(FilePath);
+      continue;
+    }
+
+    if (S_ISDIR(Info.st_mode)) {
+      SubKey = FleetProfileDirKey(Names[Index]);
+      if (!Folder->IsDump && Key == ACPI_PROFILE_COMMON_KEY && SubKey != ACPI_PROFILE_COMMON_KEY) {
+        FleetLoadDirectory(Folder, FilePath, SubKey);
+        FleetAddProfile(Folder, SubKey);
+      }
+    } else if (Key == ACPI_PROFILE_COMMON_KEY && strcasecmp(Names[Index], FLEET_BUNDLE_NAME) == 0) {
+      FleetLoadBundle(Folder, FilePath);
+    } else if (Folder->IsDump && strcasecmp(Names[Index], FLEET_PRODUCT_NAME) == 0) {
+      if (FleetReadFile(FilePath, &Data, &Size) == 0) {
+        Data[Size] = '\0';
+        Data[strcspn((char *)Data, "\r\n")] = '\0';
+        AcpiRulesCopyField(Folder->Product, (CHAR8 *)Data, MIN(strlen((char *)Data), ACPI_PROFILE_PRODUCT_SIZE - 1));
+        free(Data);
+      }
+    } else if (FleetIsTableName(Names[Index])) {
+      if (FleetReadFile(FilePath, &Data, &Size) != 0) {
+        FleetNote(&Folder->Error, "%s: cannot read", Names[Index]);
+      } else {
+        FleetAddTable(Folder, Names[Index], Data, Size, Key,
+                      Key == ACPI_PROFILE_COMMON_KEY ? FleetOriginRoot : FleetOriginProfileDir);
+      }
+    }
+    free(FilePath);
+  }
+
+  FleetFreeNames(Names, Count);
+}
+
+STATIC
+CONST FLEET_TABLE *
+FleetFindSignature (
+  IN CONST FLEET_FOLDER  *Folder,
+  IN UINT32              Signature
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Folder->Count; Index++) {
+    if (Folder->Tables[Index].Signature == Signature && Folder->Tables[Index].Data != NULL) {
+      return &Folder->Tables[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Derives the platform identity of a dump the way AcpiProfileIdentify does.
+**/
+STATIC
+VOID
+FleetIdentify (
+  IN OUT FLEET_FOLDER  *Dump
+  )
+{
+  CONST FLEET_TABLE                  *Xsdt;
+  CONST FLEET_TABLE                  *Facp;
+  CONST EFI_ACPI_DESCRIPTION_HEADER  *Source;
+
+  Xsdt = FleetFindSignature(Dump, EFI_ACPI_XSDT_SIGNATURE);
+  if (Xsdt == NULL) {
+    FleetNote(&Dump->Error, "no valid XSDT in dump");
+    return;
+  }
+
+  // Some firmware leaves the XSDT OEM table ID blank; the FADT is always filled in
+  Source = (CONST EFI_ACPI_DESCRIPTION_HEADER *)Xsdt->Data;
+  AcpiRulesCopyField(Dump->OemTableId, (CONST CHAR8 *)&Source->OemTableId, ACPI_PROFILE_OEM_TABLE_SIZE);
+  Facp = FleetFindSignature(Dump, EFI_ACPI_FADT_SIGNATURE);
+  if (Dump->OemTableId[0] == '\0' && Facp != NULL) {
+    Source = (CONST EFI_ACPI_DESCRIPTION_HEADER *)Facp->Data;
+    AcpiRulesCopyField(Dump->OemTableId, (CONST CHAR8 *)&Source->OemTableId, ACPI_PROFILE_OEM_TABLE_SIZE);
+  }
+  AcpiRulesCopyField(Dump->OemId, (CONST CHAR8 *)Source->OemId, ACPI_PROFILE_OEM_ID_SIZE);
+
+  if (Dump->Product[0] != '\0') {
+    Dump->Keys[Dump->KeyCount++] = AcpiRulesProfileKey(Dump->OemId, Dump->OemTableId, Dump->Product);
+  }
+  Dump->Keys[Dump->KeyCount++] = AcpiRulesProfileKey(Dump->OemId, Dump->OemTableId, NULL);
+}
+
+/**
+  Phase 1 work item: loads and checks one dump or patch set.
+**/
+STATIC
+VOID
+FleetLoadWorker (
+  IN VOID   *Context,
+  IN UINTN  Index
+  )
+{
+  FLEET         *Fleet;
+  FLEET_FOLDER  *Folder;
+  UINTN         Table;
+
+  Fleet  = Context;
+  Folder = (Index < Fleet->DumpCount) ? &Fleet->Dumps[Index] : &Fleet->Sets[Index - Fleet->DumpCount];
+
+  FleetLoadDirectory(Folder, Folder->Path, ACPI_PROFILE_COMMON_KEY);
+  if (!Folder->IsDump) {
+    return;
+  }
+
+  FleetIdentify(Folder);
+  for (Table = 0; Table < Folder->Count; Table++) {
+    free(Folder->Tables[Table].Data);
+    Folder->Tables[Table].Data = NULL;
+  }
+}
+
+/**
+  Phase 2 work item: checks one patch set against one dump.
+**/
+STATIC
+VOID
+FleetCheckWorker (
+  IN VOID   *Context,
+  IN UINTN  Index
+  )
+{
+  FLEET               *Fleet;
+  CONST FLEET_FOLDER  *Set;
+  CONST FLEET_FOLDER  *Dump;
+  FLEET_RESULT        *Result;
+  CONST FLEET_TABLE   **Selected;
+  CONST FLEET_TABLE   *Table;
+  UINTN               Count;
+  UINTN               Slot;
+  UINTN               Other;
+  UINTN               MaxTables;
+  UINT32              Origin;
+  CHAR8               Sig[5];
+
+  Fleet  = Context;
+  Set    = &Fleet->Sets[Index / Fleet->DumpCount];
+  Dump   = &Fleet->Dumps[Index % Fleet->DumpCount];
+  Result = &Fleet->Results[Index];
+
+  memset(Result, 0, sizeof(*Result));
+  Result->Pass = TRUE;
+  if (Set->Error != NULL || Dump->Error != NULL) {
+    FleetNote(&Result->Message, "%s", Set->Error != NULL ? Set->Error : Dump->Error);
+    Result->Pass = FALSE;
+    return;
+  }
+
+  // The most specific key with a profile wins
+  for (Slot = 0; Slot < Dump->KeyCount; Slot++) {
+    if (FleetHasProfile(Set, Dump->Keys[Slot])) {
+      Result->Profile = Dump->Keys[Slot];
+      break;
+    }
+  }
+
+  Selected = malloc(MAX(Set->Count, 1) * sizeof(*Selected));
+  if (Selected == NULL) {
+    FleetNote(&Result->Message, "out of memory");
+    Result->Pass = FALSE;
+    return;
+  }
+
+  // Same merge as AcpiSourceCollect: later tables replace earlier ones of the same name
+  Count = 0;
+  for (Origin = 0; Origin < FleetOriginMax; Origin++) {
+    for (Other = 0; Other < Set->Count; Other++) {
+      Table = &Set->Tables[Other];
+      if (Table->Origin != Origin || (Table->Key != ACPI_PROFILE_COMMON_KEY && Table->Key != Result->Profile)) {
+        continue;
+      }
+      for (Slot = 0; Slot < Count && strcmp(Selected[Slot]->Name, Table->Name) != 0; Slot++) {
+      }
+      Selected[Slot] = Table;
+      if (Slot == Count) {
+        Count++;
+      }
+    }
+  }
+
+  for (Slot = 0; Slot < Count; Slot++) {
+    Table = Selected[Slot];
+    memcpy(Sig, &Table->Signature, 4);
+    Sig[4] = '\0';
+    Result->Tables++;
+    Result->Bytes += Table->Size;
+
+    if (Table->Defect != AcpiTableSound) {
+      FleetNote(&Result->Message, "%s: %s", Table->Name, gAcpiTableDefectNames[Table->Defect]);
+      Result->Pass = FALSE;
+      continue;
+    }
+    if (Table->Checksum != 0) {
+      FleetNote(&Result->Message, "warning %s: checksum off by 0x%02x", Table->Name, Table->Checksum);
+    }
+    if (Table->Size > ACPI_EFI1X_MAX_TABLE_SIZE) {
+      FleetNote(&Result->Message, "%s%s: %u bytes exceeds the EFI 1.x limit",
+                Fleet->Efi1x ? "" : "warning ", Table->Name, Table->Size);
+      Result->Pass = (BOOLEAN)(Result->Pass && !Fleet->Efi1x);
+    }
+    // The DSDT is swapped through the FADT and takes no XSDT entry
+    if (Table->Signature == EFI_ACPI_DSDT_SIGNATURE) {
+      continue;
+    }
+    Result->Slots++;
+    if (Table->Signature != EFI_ACPI_SSDT_SIGNATURE) {
+      for (Other = 0; Other < Dump->Count && Dump->Tables[Other].Signature != Table->Signature; Other++) {
+      }
+      if (Other < Dump->Count) {
+        FleetNote(&Result->Message, "warning %s: firmware already has a %s", Table->Name, Sig);
+      }
+    }
+  }
+  free(Selected);
+
+  MaxTables = Fleet->Efi1x ? ACPI_EFI1X_MAX_ADDITIONAL_TABLES : MAX_ADDITIONAL_TABLES;
+  if (Result->Slots > MaxTables) {
+    FleetNote(&Result->Message, "%u tables need XSDT entries, %u fit", Result->Slots, (UINT32)MaxTables);
+    Result->Pass = FALSE;
+  } else if (!Fleet->Efi1x && Result->Slots > ACPI_EFI1X_MAX_ADDITIONAL_TABLES) {
+    FleetNote(&Result->Message, "warning %u XSDT entries exceed the EFI 1.x limit of %u",
+              Result->Slots, ACPI_EFI1X_MAX_ADDITIONAL_TABLES);
+  }
+}
+
+/**
+  Creates one folder record per subdirectory of Path.
+
+  @return Number of folders, or -1 if Path cannot be listed
+**/
+STATIC
+INTN
+FleetScan (
+  IN  CONST char    *Path,
+  IN  BOOLEAN       IsDump,
+  OUT FLEET_FOLDER  **Folders
+  )
+{
+  char         **Names;
+  char         *Child;
+  INTN         Count;
+  INTN         Index;
+  UINTN        Found;
+  struct stat  Info;
+
+  Count = FleetListDirectory(Path, &Names);
+  if (Count < 0) {
+    return -1;
+  }
+
+  *Folders = calloc(MAX(Count, 1), sizeof(FLEET_FOLDER));
+  Found    = 0;
+  for (Index = 0; Index < Count && *Folders != NULL; Index++) {
+    Child = FleetJoin(Path, Names[Index]);
+    if (Child == NULL || stat(Child, &Info) != 0 || !S_ISDIR(Info.st_mode)) {
+      free(Child);
+      continue;
+    }
+    (*Folders)[Found].Name   = strdup(Names[Index]);
+    (*Folders)[Found].Path   = Child;
+    (*Folders)[Found].IsDump = IsDump;
+    Found++;
+  }
+
+  FleetFreeNames(Names, Count);
+  return (*Folders != NULL) ? (INTN)Found : -1;
+}
+
+STATIC
+VOID
+FleetUsage (
+  VOID
+  )
+{
+  fprintf(stderr,
+          "Usage: FleetValidator [-j Threads] [-q] [--efi1x] Corpus\n"
+          "  Corpus/dumps/<Model>/   --export output of each machine\n"
+          "  Corpus/patches/<Set>/   ACPI folders to validate\n"
+          "  -j N      worker threads (default: all online CPUs)\n"
+          "  -q        print failures and the summary only\n"
+          "  --efi1x   treat EFI 1.x limits as failures\n");
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  FLEET            Fleet;
+  WORK_POOL_STATS  LoadStats;
+  WORK_POOL_STATS  CheckStats;
+  CONST char       *Corpus;
+  char             *Path;
+  FLEET_RESULT     *Result;
+  BOOLEAN          Quiet;
+  UINTN            Threads;
+  UINTN            Combos;
+  UINTN            Index;
+  UINTN            SetIndex;
+  UINTN            Passed;
+  UINTN            Failed;
+  UINTN            TotalFailed;
+  UINTN            Tables;
+  UINT64           Bytes;
+  UINT64           CheckedBytes;
+  INTN             Arg;
+  double           Start;
+  double           Loaded;
+  double           Checked;
+
+  memset(&Fleet, 0, sizeof(Fleet));
+  Quiet   = FALSE;
+  Corpus  = NULL;
+  Threads = (UINTN)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+
+  for (Arg = 1; Arg < argc; Arg++) {
+    if (strcmp(argv[Arg], "-j") == 0 && Arg + 1 < argc) {
+      Arg++;
+      Threads = (UINTN)MAX(atoi(argv[Arg]), 1);
+    } else if (strcmp(argv[Arg], "-q") == 0) {
+      Quiet = TRUE;
+    } else if (strcmp(argv[Arg], "--efi1x") == 0) {
+      Fleet.Efi1x = TRUE;
+    } else if (argv[Arg][0] != '-' && Corpus == NULL) {
+      Corpus = argv[Arg];
+    } else {
+      FleetUsage();
+      return 2;
+    }
+  }
+  if (Corpus == NULL) {
+    FleetUsage();
+    return 2;
+  }
+
+  FleetCrcInit();
+
+  Path = FleetJoin(Corpus, "dumps");
+  Arg  = FleetScan(Path, TRUE, &Fleet.Dumps);
+  free(Path);
+  if (Arg <= 0) {
+    fprintf(stderr, "FleetValidator: no dumps under %s/dumps\n", Corpus);
+    return 2;
+  }
+  Fleet.DumpCount = (UINTN)Arg;
+
+  Path = FleetJoin(Corpus, "patches");
+  Arg  = FleetScan(Path, FALSE, &Fleet.Sets);
+  free(Path);
+  if (Arg <= 0) {
+    fprintf(stderr, "FleetValidator: no patch sets under %s/patches\n", Corpus);
+    return 2;
+  }
+  Fleet.SetCount = (UINTN)Arg;
+
+  Combos        = Fleet.SetCount * Fleet.DumpCount;
+  Fleet.Results = calloc(Combos, sizeof(FLEET_RESULT));
+  if (Fleet.Results == NULL) {
+    fprintf(stderr, "FleetValidator: out of memory\n");
+    return 2;
+  }
+
+  // Phase 1: read and check every table once; phase 2: combine per pair
+  Start = FleetNow();
+  if (WorkPoolRun(Threads, Fleet.DumpCount + Fleet.SetCount, FleetLoadWorker, &Fleet, &LoadStats) != 0) {
+    fprintf(stderr, "FleetValidator: out of memory\n");
+    return 2;
+  }
+  Loaded = FleetNow();
+  if (WorkPoolRun(Threads, Combos, FleetCheckWorker, &Fleet, &CheckStats) != 0) {
+    fprintf(stderr, "FleetValidator: out of memory\n");
+    return 2;
+  }
+  Checked = FleetNow();
+
+  for (Index = 0; Index < Fleet.DumpCount; Index++) {
+    if (Fleet.Dumps[Index].Error != NULL) {
+      printf("Dump %s: %s\n", Fleet.Dumps[Index].Name, Fleet.Dumps[Index].Error);
+    } else if (!Quiet) {
+      printf("Dump %s: OEM '%s' '%s', product '%s', %u tables\n", Fleet.Dumps[Index].Name,
+             Fleet.Dumps[Index].OemId, Fleet.Dumps[Index].OemTableId, Fleet.Dumps[Index].Product,
+             (UINT32)Fleet.Dumps[Index].Count);
+    }
+  }
+
+  TotalFailed  = 0;
+  Tables       = 0;
+  CheckedBytes = 0;
+  for (SetIndex = 0; SetIndex < Fleet.SetCount; SetIndex++) {
+    Passed = 0;
+    Failed = 0;
+    for (Index = 0; Index < Fleet.DumpCount; Index++) {
+      Result  = &Fleet.Results[SetIndex * Fleet.DumpCount + Index];
+      Tables += Result->Tables;
+      CheckedBytes += Result->Bytes;
+      if (Result->Pass) {
+        Passed++;
+      } else {
+        Failed++;
+      }
+      if (!Result->Pass || (!Quiet && Result->Message != NULL)) {
+        printf("%s %s on %s: %s\n", Result->Pass ? "PASS" : "FAIL",
+               Fleet.Sets[SetIndex].Name, Fleet.Dumps[Index].Name, Result->Message);
+      } else if (!Quiet) {
+        printf("PASS %s on %s: %u tables, %u XSDT entries, profile P-%08X\n",
+               Fleet.Sets[SetIndex].Name, Fleet.Dumps[Index].Name, Result->Tables, Result->Slots, Result->Profile);
+      }
+    }
+    printf("Set %-32s %6u passed %6u failed\n", Fleet.Sets[SetIndex].Name, (UINT32)Passed, (UINT32)Failed);
+    TotalFailed += Failed;
+  }
+
+  Bytes = 0;
+  for (Index = 0; Index < Fleet.DumpCount; Index++) {
+    Bytes += Fleet.Dumps[Index].Bytes;
+  }
+  for (Index = 0; Index < Fleet.SetCount; Index++) {
+    Bytes += Fleet.Sets[Index].Bytes;
+  }
+
+  printf("\n%u dumps x %u sets = %u combinations, %u passed, %u failed\n",
+         (UINT32)Fleet.DumpCount, (UINT32)Fleet.SetCount, (UINT32)Combos,
+         (UINT32)(Combos - TotalFailed), (UINT32)TotalFailed);
+  printf("Load:  %.3f s, %llu bytes, %.1f MB/s, %u threads, %llu steals\n",
+         Loaded - Start, (unsigned long long)Bytes, Bytes / 1048576.0 / MAX(Loaded - Start, 1e-9),
+         (UINT32)LoadStats.Threads, (unsigned long long)LoadStats.Steals);
+  printf("Check: %.3f s, %u tables, %.0f combinations/s, %.1f MB/s of tables, %u threads, %llu steals\n",
+         Checked - Loaded, (UINT32)Tables, Combos / MAX(Checked - Loaded, 1e-9),
+         CheckedBytes / 1048576.0 / MAX(Checked - Loaded, 1e-9),
+         (UINT32)CheckStats.Threads, (unsigned long long)CheckStats.Steals);
+
+  return (TotalFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/** @file
+
+  EDK2 base types for building the shared ACPIPatcher sources on the host.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_BASE_H__
+#define __HOST_BASE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t    UINT8;
+typedef int8_t     INT8;
+typedef uint16_t   UINT16;
+typedef int16_t    INT16;
+typedef uint32_t   UINT32;
+typedef int32_t    INT32;
+typedef uint64_t   UINT64;
+typedef int64_t    INT64;
+typedef uintptr_t  UINTN;
+typedef intptr_t   INTN;
+typedef char       CHAR8;
+typedef uint16_t   CHAR16;
+typedef uint8_t    BOOLEAN;
+typedef void       VOID;
+
+#define CONST     const
+#define STATIC    static
+#define IN
+#define OUT
+#define OPTIONAL
+
+//
+// Assembly linked into a host test follows the UEFI calling convention
+//
+#if defined (MDE_CPU_X64)
+#define EFIAPI    __attribute__((ms_abi))
+#else
+#define EFIAPI
+#endif
+
+#ifndef TRUE
+#define TRUE   ((BOOLEAN)1)
+#define FALSE  ((BOOLEAN)0)
+#endif
+
+#define SIGNATURE_16(A, B)          ((A) | ((B) << 8))
+#define SIGNATURE_32(A, B, C, D)    (SIGNATURE_16 (A, B) | (SIGNATURE_16 (C, D) << 16))
+
+#define SIZE_64KB   0x00010000
+#define SIZE_1MB    0x00100000
+
+#define MIN(a, b)   (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)   (((a) > (b)) ? (a) : (b))
+
+#define ARRAY_SIZE(Array)   (sizeof (Array) / sizeof ((Array)[0]))
+
+#endif // __HOST_BASE_H__
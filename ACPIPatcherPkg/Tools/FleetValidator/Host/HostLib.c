@@ -0,0 +1,585 @@
+/** @file
+
+  Host implementations of the UEFI library functions declared in
+  HostUefi.h, so the shared ACPIPatcher sources can be unit tested on the
+  build machine. Pool allocations go to malloc and are counted, so tests
+  can check that every buffer was returned.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined (MDE_CPU_X64)
+#include <cpuid.h>
+#endif
+
+#include <HostUefi.h>
+
+#include "ACPIPatcher.h"
+#include "AcpiMemory.h"
+
+EFI_GUID  gEfiFileInfoGuid        = { 0x09576E92, 0x6D3F, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID  gEfiBlockIoProtocolGuid = { 0x964E5B21, 0x6459, 0x11D2, { 0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID  gEfiDiskIoProtocolGuid  = { 0xCE345171, 0xBA0B, 0x11D2, { 0x8E, 0x4F, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+
+STATIC EFI_STATUS EFIAPI HostHandleProtocol (EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
+STATIC EFI_STATUS EFIAPI HostStall (UINTN Microseconds);
+
+STATIC EFI_BOOT_SERVICES  mHostBootServices = { HostHandleProtocol, HostStall };
+EFI_BOOT_SERVICES         *gBS              = &mHostBootServices;
+
+UINTN   gHostDebugLevel;
+UINTN   gHostLivePools;
+
+STATIC UINT64  mClockOffset;
+
+//
+// Boot services
+//
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostHandleProtocol (
+  EFI_HANDLE  Handle,
+  EFI_GUID    *Protocol,
+  VOID        **Interface
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostStall (
+  UINTN  Microseconds
+  )
+{
+  HostClockAdvance((UINT64)Microseconds * 1000);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiMemAllocatePool (
+  IN  EFI_MEMORY_TYPE  Type,
+  IN  UINTN            Size,
+  OUT VOID             **Buffer,
+  IN  CONST CHAR8      *File,
+  IN  UINT32           Line
+  )
+{
+  *Buffer = malloc(Size != 0 ? Size : 1);
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  gHostLivePools++;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+AcpiMemFreePool (
+  IN VOID  *Buffer
+  )
+{
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  free(Buffer);
+  gHostLivePools--;
+  return EFI_SUCCESS;
+}
+
+//
+// Console
+//
+
+STATIC
+CONST CHAR8 *
+HostStatusName (
+  IN EFI_STATUS  Status
+  )
+{
+  STATIC CONST CHAR8  *Errors[] = {
+    "Success", "Load Error", "Invalid Parameter", "Unsupported", "Bad Buffer Size",
+    "Buffer Too Small", "Not Ready", "Device Error", "Write Protected", "Out of Resources",
+    "Volume Corrupt", "Volume Full", "No Media", "Media changed", "Not Found",
+    "Access Denied"
+  };
+
+  if (!EFI_ERROR(Status)) {
+    return Status == EFI_SUCCESS ? "Success" : "Warning";
+  }
+  Status &= ~MAX_BIT;
+  if (Status < ARRAY_SIZE(Errors)) {
+    return Errors[Status];
+  }
+  switch (Status) {
+    case EFI_TIMEOUT & ~MAX_BIT:      return "Time out";
+    case EFI_ABORTED & ~MAX_BIT:      return "Aborted";
+    case EFI_CRC_ERROR & ~MAX_BIT:    return "CRC Error";
+    case EFI_END_OF_FILE & ~MAX_BIT:  return "End of File";
+    default:                          return "Error";
+  }
+}
+
+/**
+  Formats an EDK2 PrintLib format string: %s takes a CHAR16 string, %a an
+  ASCII one, %r an EFI_STATUS and the l flag a 64-bit value.
+**/
+STATIC
+VOID
+HostVPrint (
+  IN FILE          *Stream,
+  IN CONST CHAR16  *Format,
+  IN va_list       Args
+  )
+{
+  CHAR8          Spec[16];
+  UINTN          SpecLength;
+  BOOLEAN        Long;
+  CONST CHAR16   *Wide;
+
+  for (; *Format != 0; Format++) {
+    if (*Format != L'%') {
+      fputc((int)*Format, Stream);
+      continue;
+    }
+
+    SpecLength = 0;
+    Spec[SpecLength++] = '%';
+    Long = FALSE;
+    for (Format++; *Format != 0; Format++) {
+      if (*Format == L'l') {
+        Long = TRUE;
+      } else if (*Format == L'-' || *Format == L'0' || *Format == L'.' || (*Format >= L'1' && *Format <= L'9')) {
+        if (SpecLength < sizeof (Spec) - 4) {
+          Spec[SpecLength++] = (CHAR8)*Format;
+        }
+      } else {
+        break;
+      }
+    }
+    if (*Format == 0) {
+      break;
+    }
+
+    switch (*Format) {
+      case L'd':
+      case L'u':
+      case L'x':
+      case L'X':
+        if (Long) {
+          Spec[SpecLength++] = 'l';
+          Spec[SpecLength++] = 'l';
+        }
+        Spec[SpecLength++] = (CHAR8)*Format;
+        Spec[SpecLength]   = 0;
+        if (Long) {
+          fprintf(Stream, Spec, va_arg(Args, unsigned long long));
+        } else {
+          fprintf(Stream, Spec, va_arg(Args, unsigned int));
+        }
+        break;
+      case L'p':
+        fprintf(Stream, "%p", va_arg(Args, VOID *));
+        break;
+      case L'c':
+        fputc(va_arg(Args, int), Stream);
+        break;
+      case L'a':
+        Spec[SpecLength++] = 's';
+        Spec[SpecLength]   = 0;
+        fprintf(Stream, Spec, va_arg(Args, CHAR8 *));
+        break;
+      case L's':
+        for (Wide = va_arg(Args, CHAR16 *); Wide != NULL && *Wide != 0; Wide++) {
+          fputc(*Wide < 0x80 ? (int)*Wide : '?', Stream);
+        }
+        break;
+      case L'r':
+        fputs(HostStatusName(va_arg(Args, EFI_STATUS)), Stream);
+        break;
+      default:
+        fputc((int)*Format, Stream);
+        break;
+    }
+  }
+}
+
+VOID
+AcpiDebugPrint (
+  IN UINTN         Level,
+  IN CONST CHAR16  *Format,
+  ...
+  )
+{
+  va_list  Args;
+
+  if (Level > gHostDebugLevel) {
+    return;
+  }
+  va_start(Args, Format);
+  HostVPrint(stderr, Format, Args);
+  va_end(Args);
+}
+
+VOID
+SelectivePrint (
+  IN CONST CHAR16  *Format,
+  ...
+  )
+{
+  va_list  Args;
+
+  if (gHostDebugLevel == 0) {
+    return;
+  }
+  va_start(Args, Format);
+  HostVPrint(stdout, Format, Args);
+  va_end(Args);
+}
+
+//
+// BaseMemoryLib
+//
+
+VOID *
+CopyMem (
+  VOID        *Destination,
+  CONST VOID  *Source,
+  UINTN       Length
+  )
+{
+  return memmove(Destination, Source, Length);
+}
+
+VOID *
+ZeroMem (
+  VOID   *Buffer,
+  UINTN  Length
+  )
+{
+  return memset(Buffer, 0, Length);
+}
+
+VOID *
+SetMem (
+  VOID   *Buffer,
+  UINTN  Length,
+  UINT8  Value
+  )
+{
+  return memset(Buffer, Value, Length);
+}
+
+INTN
+CompareMem (
+  CONST VOID  *First,
+  CONST VOID  *Second,
+  UINTN       Length
+  )
+{
+  return memcmp(First, Second, Length);
+}
+
+BOOLEAN
+CompareGuid (
+  CONST EFI_GUID  *First,
+  CONST EFI_GUID  *Second
+  )
+{
+  return (BOOLEAN)(memcmp(First, Second, sizeof (EFI_GUID)) == 0);
+}
+
+//
+// BaseLib strings, checksums, unaligned access, byte swaps and CPUID
+//
+
+UINTN
+AsciiStrLen (
+  CONST CHAR8  *String
+  )
+{
+  return strlen(String);
+}
+
+UINT8
+CalculateCheckSum8 (
+  CONST UINT8  *Buffer,
+  UINTN        Length
+  )
+{
+  UINT8  Sum;
+
+  for (Sum = 0; Length > 0; Length--) {
+    Sum = (UINT8)(Sum + *Buffer++);
+  }
+  return (UINT8)(0x100 - Sum);
+}
+
+UINTN
+StrLen (
+  CONST CHAR16  *String
+  )
+{
+  UINTN  Length;
+
+  for (Length = 0; String[Length] != 0; Length++) {
+  }
+  return Length;
+}
+
+UINTN
+StrSize (
+  CONST CHAR16  *String
+  )
+{
+  return (StrLen(String) + 1) * sizeof (CHAR16);
+}
+
+INTN
+StrnCmp (
+  CONST CHAR16  *First,
+  CONST CHAR16  *Second,
+  UINTN         Length
+  )
+{
+  for (; Length > 0; Length--, First++, Second++) {
+    if (*First != *Second || *First == 0) {
+      return (INTN)*First - (INTN)*Second;
+    }
+  }
+  return 0;
+}
+
+INTN
+StrCmp (
+  CONST CHAR16  *First,
+  CONST CHAR16  *Second
+  )
+{
+  return StrnCmp(First, Second, MAX_UINTN);
+}
+
+CHAR16 *
+StrStr (
+  CONST CHAR16  *String,
+  CONST CHAR16  *SearchString
+  )
+{
+  UINTN  Length;
+
+  Length = StrLen(SearchString);
+  for (; *String != 0; String++) {
+    if (StrnCmp(String, SearchString, Length) == 0) {
+      return (CHAR16 *)String;
+    }
+  }
+  return (Length == 0) ? (CHAR16 *)String : NULL;
+}
+
+RETURN_STATUS
+StrCpyS (
+  CHAR16        *Destination,
+  UINTN         DestMax,
+  CONST CHAR16  *Source
+  )
+{
+  UINTN  Length;
+
+  Length = StrLen(Source);
+  if (Length >= DestMax) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  memcpy(Destination, Source, (Length + 1) * sizeof (CHAR16));
+  return EFI_SUCCESS;
+}
+
+CHAR16
+CharToUpper (
+  CHAR16  Char
+  )
+{
+  return (Char >= L'a' && Char <= L'z') ? (CHAR16)(Char - (L'a' - L'A')) : Char;
+}
+
+UINT16
+ReadUnaligned16 (
+  CONST UINT16  *Buffer
+  )
+{
+  UINT16  Value;
+
+  memcpy(&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+UINT32
+ReadUnaligned32 (
+  CONST UINT32  *Buffer
+  )
+{
+  UINT32  Value;
+
+  memcpy(&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+UINT32
+WriteUnaligned32 (
+  UINT32  *Buffer,
+  UINT32  Value
+  )
+{
+  memcpy(Buffer, &Value, sizeof (Value));
+  return Value;
+}
+
+UINT64
+WriteUnaligned64 (
+  UINT64  *Buffer,
+  UINT64  Value
+  )
+{
+  memcpy(Buffer, &Value, sizeof (Value));
+  return Value;
+}
+
+UINT32 SwapBytes32 (UINT32 Value)                               { return __builtin_bswap32(Value); }
+UINT64 SwapBytes64 (UINT64 Value)                               { return __builtin_bswap64(Value); }
+
+#if defined (MDE_CPU_X64)
+UINT32
+AsmCpuidEx (
+  UINT32  Index,
+  UINT32  SubIndex,
+  UINT32  *Eax,
+  UINT32  *Ebx,
+  UINT32  *Ecx,
+  UINT32  *Edx
+  )
+{
+  UINT32  Regs[4];
+
+  __cpuid_count(Index, SubIndex, Regs[0], Regs[1], Regs[2], Regs[3]);
+  if (Eax != NULL) {
+    *Eax = Regs[0];
+  }
+  if (Ebx != NULL) {
+    *Ebx = Regs[1];
+  }
+  if (Ecx != NULL) {
+    *Ecx = Regs[2];
+  }
+  if (Edx != NULL) {
+    *Edx = Regs[3];
+  }
+  return Index;
+}
+
+UINT32
+AsmCpuid (
+  UINT32  Index,
+  UINT32  *Eax,
+  UINT32  *Ebx,
+  UINT32  *Ecx,
+  UINT32  *Edx
+  )
+{
+  return AsmCpuidEx(Index, 0, Eax, Ebx, Ecx, Edx);
+}
+#endif
+
+//
+// BaseLib 64-bit arithmetic
+//
+
+UINT64 LShiftU64 (UINT64 Operand, UINTN Count)                 { return Operand << Count; }
+UINT64 RShiftU64 (UINT64 Operand, UINTN Count)                 { return Operand >> Count; }
+UINT64 MultU64x32 (UINT64 Multiplicand, UINT32 Multiplier)     { return Multiplicand * Multiplier; }
+UINT64 MultU64x64 (UINT64 Multiplicand, UINT64 Multiplier)     { return Multiplicand * Multiplier; }
+UINT64 DivU64x32 (UINT64 Dividend, UINT32 Divisor)             { return Dividend / Divisor; }
+
+UINT64
+DivU64x32Remainder (
+  UINT64  Dividend,
+  UINT32  Divisor,
+  UINT32  *Remainder
+  )
+{
+  if (Remainder != NULL) {
+    *Remainder = (UINT32)(Dividend % Divisor);
+  }
+  return Dividend / Divisor;
+}
+
+UINT64
+DivU64x64Remainder (
+  UINT64  Dividend,
+  UINT64  Divisor,
+  UINT64  *Remainder
+  )
+{
+  if (Remainder != NULL) {
+    *Remainder = Dividend % Divisor;
+  }
+  return Dividend / Divisor;
+}
+
+//
+// TimerLib: one tick per nanosecond of CLOCK_MONOTONIC, plus whatever
+// HostClockAdvance() has added
+//
+
+UINT64
+GetPerformanceCounter (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (UINT64)Now.tv_sec * 1000000000ULL + (UINT64)Now.tv_nsec + mClockOffset;
+}
+
+UINT64
+GetPerformanceCounterProperties (
+  UINT64  *StartValue,
+  UINT64  *EndValue
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+  return 1000000000ULL;
+}
+
+UINT64
+GetTimeInNanoSecond (
+  UINT64  Ticks
+  )
+{
+  return Ticks;
+}
+
+VOID
+HostClockAdvance (
+  UINT64  Ns
+  )
+{
+  mClockOffset += Ns;
+}
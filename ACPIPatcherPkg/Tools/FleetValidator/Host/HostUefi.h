@@ -0,0 +1,327 @@
+/** @file
+
+  The UEFI types, protocols and library functions the shared ACPIPatcher
+  sources use, for host builds. The Library, Protocol and Guid headers next
+  to this file only include it, so the firmware sources compile unchanged.
+  Structures the sources only point to are left incomplete, and
+  EFI_BOOT_SERVICES holds just the services the host tests provide.
+  HostLib.c implements the functions.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_UEFI_H__
+#define __HOST_UEFI_H__
+
+#include <IndustryStandard/Acpi.h>
+
+typedef UINTN   EFI_STATUS;
+typedef UINTN   RETURN_STATUS;
+typedef VOID    *EFI_HANDLE;
+typedef UINT64  EFI_LBA;
+
+typedef struct {
+  UINT32  Data1;
+  UINT16  Data2;
+  UINT16  Data3;
+  UINT8   Data4[8];
+} EFI_GUID;
+
+#define MAX_UINT8     ((UINT8)0xFF)
+#define MAX_UINT16    ((UINT16)0xFFFF)
+#define MAX_UINT32    ((UINT32)0xFFFFFFFF)
+#define MAX_UINT64    ((UINT64)0xFFFFFFFFFFFFFFFFULL)
+#define MAX_UINTN     ((UINTN)~(UINTN)0)
+#define MAX_BIT       (((UINTN)1) << (sizeof (UINTN) * 8 - 1))
+
+#define BIT9          0x00000200
+#define BIT19         0x00080000
+#define BIT29         0x20000000
+
+#define ENCODE_ERROR(Code)          ((EFI_STATUS)(MAX_BIT | (Code)))
+#define EFI_ERROR(Status)           (((EFI_STATUS)(Status) & MAX_BIT) != 0)
+
+#define EFI_SUCCESS                 ((EFI_STATUS)0)
+#define EFI_LOAD_ERROR              ENCODE_ERROR (1)
+#define EFI_INVALID_PARAMETER       ENCODE_ERROR (2)
+#define EFI_UNSUPPORTED             ENCODE_ERROR (3)
+#define EFI_BAD_BUFFER_SIZE         ENCODE_ERROR (4)
+#define EFI_BUFFER_TOO_SMALL        ENCODE_ERROR (5)
+#define EFI_NOT_READY               ENCODE_ERROR (6)
+#define EFI_DEVICE_ERROR            ENCODE_ERROR (7)
+#define EFI_WRITE_PROTECTED         ENCODE_ERROR (8)
+#define EFI_OUT_OF_RESOURCES        ENCODE_ERROR (9)
+#define EFI_VOLUME_CORRUPTED        ENCODE_ERROR (10)
+#define EFI_VOLUME_FULL             ENCODE_ERROR (11)
+#define EFI_NO_MEDIA                ENCODE_ERROR (12)
+#define EFI_MEDIA_CHANGED           ENCODE_ERROR (13)
+#define EFI_NOT_FOUND               ENCODE_ERROR (14)
+#define EFI_ACCESS_DENIED           ENCODE_ERROR (15)
+#define EFI_TIMEOUT                 ENCODE_ERROR (18)
+#define EFI_ABORTED                 ENCODE_ERROR (21)
+#define EFI_SECURITY_VIOLATION      ENCODE_ERROR (26)
+#define EFI_CRC_ERROR               ENCODE_ERROR (27)
+#define EFI_END_OF_FILE             ENCODE_ERROR (31)
+#define EFI_WARN_DELETE_FAILURE     ((EFI_STATUS)2)
+
+#define SIZE_1KB      0x00000400
+#define SIZE_2KB      0x00000800
+#define SIZE_4KB      0x00001000
+#define SIZE_16KB     0x00004000
+#define SIZE_128KB    0x00020000
+#define SIZE_2MB      0x00200000
+#define SIZE_4MB      0x00400000
+
+#define OFFSET_OF(Type, Field)            ((UINTN)offsetof (Type, Field))
+#define BASE_CR(Record, Type, Field)      ((Type *)((UINT8 *)(Record) - OFFSET_OF (Type, Field)))
+#define CR(Record, Type, Field, Sig)      BASE_CR (Record, Type, Field)
+#define ALIGN_VALUE(Value, Alignment)     ((Value) + (((Alignment) - (Value)) & ((Alignment) - 1)))
+#define ALIGN_POINTER(Pointer, Alignment) ((VOID *)(ALIGN_VALUE ((UINTN)(Pointer), (Alignment))))
+
+typedef enum {
+  EfiReservedMemoryType,
+  EfiLoaderCode,
+  EfiLoaderData,
+  EfiBootServicesCode,
+  EfiBootServicesData,
+  EfiRuntimeServicesCode,
+  EfiRuntimeServicesData,
+  EfiConventionalMemory,
+  EfiUnusableMemory,
+  EfiACPIReclaimMemory,
+  EfiACPIMemoryNVS,
+  EfiMemoryMappedIO,
+  EfiMemoryMappedIOPortSpace,
+  EfiPalCode,
+  EfiPersistentMemory,
+  EfiUnacceptedMemoryType,
+  EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+typedef struct {
+  UINT16  Year;
+  UINT8   Month;
+  UINT8   Day;
+  UINT8   Hour;
+  UINT8   Minute;
+  UINT8   Second;
+  UINT8   Pad1;
+  UINT32  Nanosecond;
+  INT16   TimeZone;
+  UINT8   Daylight;
+  UINT8   Pad2;
+} EFI_TIME;
+
+#define EFI_UNSPECIFIED_TIMEZONE  0x07FF
+
+//
+// Only pointed to by the shared headers
+//
+typedef struct _EFI_SYSTEM_TABLE                              EFI_SYSTEM_TABLE;
+typedef struct _EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER  EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER;
+typedef struct _EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE     EFI_ACPI_6_4_FIXED_ACPI_DESCRIPTION_TABLE;
+
+//
+// EFI_ACPI_SDT_HEADER, from Protocol/AcpiSystemDescriptionTable.h
+//
+#pragma pack(1)
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Length;
+  UINT8   Revision;
+  UINT8   Checksum;
+  CHAR8   OemId[6];
+  CHAR8   OemTableId[8];
+  UINT32  OemRevision;
+  UINT32  CreatorId;
+  UINT32  CreatorRevision;
+} EFI_ACPI_SDT_HEADER;
+
+#pragma pack()
+
+#define EFI_ACPI_6_4_EXTENDED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE   EFI_ACPI_XSDT_SIGNATURE
+#define EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_SIGNATURE  EFI_ACPI_SSDT_SIGNATURE
+#define EFI_ACPI_6_4_SECONDARY_SYSTEM_DESCRIPTION_TABLE_REVISION   0x02
+
+//
+// EFI_FILE_PROTOCOL
+//
+typedef struct _EFI_FILE_PROTOCOL  EFI_FILE_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_FILE_OPEN)(EFI_FILE_PROTOCOL *This, EFI_FILE_PROTOCOL **NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_CLOSE)(EFI_FILE_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_DELETE)(EFI_FILE_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_READ)(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_WRITE)(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_POSITION)(EFI_FILE_PROTOCOL *This, UINT64 *Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_POSITION)(EFI_FILE_PROTOCOL *This, UINT64 Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_INFO)(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_INFO)(EFI_FILE_PROTOCOL *This, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_FLUSH)(EFI_FILE_PROTOCOL *This);
+
+struct _EFI_FILE_PROTOCOL {
+  UINT64                 Revision;
+  EFI_FILE_OPEN          Open;
+  EFI_FILE_CLOSE         Close;
+  EFI_FILE_DELETE        Delete;
+  EFI_FILE_READ          Read;
+  EFI_FILE_WRITE         Write;
+  EFI_FILE_GET_POSITION  GetPosition;
+  EFI_FILE_SET_POSITION  SetPosition;
+  EFI_FILE_GET_INFO      GetInfo;
+  EFI_FILE_SET_INFO      SetInfo;
+  EFI_FILE_FLUSH         Flush;
+};
+
+#define EFI_FILE_PROTOCOL_REVISION  0x00010000
+
+#define EFI_FILE_MODE_READ    0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE   0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE  0x8000000000000000ULL
+
+#define EFI_FILE_READ_ONLY    0x0000000000000001ULL
+#define EFI_FILE_HIDDEN       0x0000000000000002ULL
+#define EFI_FILE_SYSTEM       0x0000000000000004ULL
+#define EFI_FILE_RESERVED     0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY    0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE      0x0000000000000020ULL
+#define EFI_FILE_VALID_ATTR   0x0000000000000037ULL
+
+typedef struct {
+  UINT64    Size;
+  UINT64    FileSize;
+  UINT64    PhysicalSize;
+  EFI_TIME  CreateTime;
+  EFI_TIME  LastAccessTime;
+  EFI_TIME  ModificationTime;
+  UINT64    Attribute;
+  CHAR16    FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO   OFFSET_OF (EFI_FILE_INFO, FileName)
+
+//
+// EFI_BLOCK_IO_PROTOCOL and EFI_DISK_IO_PROTOCOL
+//
+typedef struct {
+  UINT32   MediaId;
+  BOOLEAN  RemovableMedia;
+  BOOLEAN  MediaPresent;
+  BOOLEAN  LogicalPartition;
+  BOOLEAN  ReadOnly;
+  BOOLEAN  WriteCaching;
+  UINT32   BlockSize;
+  UINT32   IoAlign;
+  EFI_LBA  LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+typedef struct _EFI_BLOCK_IO_PROTOCOL  EFI_BLOCK_IO_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_RESET)(EFI_BLOCK_IO_PROTOCOL *This, BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_READ)(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_WRITE)(EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_FLUSH)(EFI_BLOCK_IO_PROTOCOL *This);
+
+struct _EFI_BLOCK_IO_PROTOCOL {
+  UINT64              Revision;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  EFI_BLOCK_RESET     Reset;
+  EFI_BLOCK_READ      ReadBlocks;
+  EFI_BLOCK_WRITE     WriteBlocks;
+  EFI_BLOCK_FLUSH     FlushBlocks;
+};
+
+typedef struct _EFI_DISK_IO_PROTOCOL  EFI_DISK_IO_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_DISK_READ)(EFI_DISK_IO_PROTOCOL *This, UINT32 MediaId, UINT64 Offset, UINTN BufferSize, VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_DISK_WRITE)(EFI_DISK_IO_PROTOCOL *This, UINT32 MediaId, UINT64 Offset, UINTN BufferSize, VOID *Buffer);
+
+struct _EFI_DISK_IO_PROTOCOL {
+  UINT64          Revision;
+  EFI_DISK_READ   ReadDisk;
+  EFI_DISK_WRITE  WriteDisk;
+};
+
+//
+// Boot services the host tests provide
+//
+typedef struct {
+  EFI_STATUS (EFIAPI *HandleProtocol)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
+  EFI_STATUS (EFIAPI *Stall)(UINTN Microseconds);     ///< Advances the TimerLib clock without waiting
+} EFI_BOOT_SERVICES;
+
+extern EFI_BOOT_SERVICES  *gBS;
+
+extern EFI_GUID  gEfiFileInfoGuid;
+extern EFI_GUID  gEfiBlockIoProtocolGuid;
+extern EFI_GUID  gEfiDiskIoProtocolGuid;
+
+//
+// BaseLib and BaseMemoryLib
+//
+VOID    *CopyMem (VOID *Destination, CONST VOID *Source, UINTN Length);
+VOID    *ZeroMem (VOID *Buffer, UINTN Length);
+VOID    *SetMem (VOID *Buffer, UINTN Length, UINT8 Value);
+INTN    CompareMem (CONST VOID *First, CONST VOID *Second, UINTN Length);
+BOOLEAN CompareGuid (CONST EFI_GUID *First, CONST EFI_GUID *Second);
+
+UINTN   AsciiStrLen (CONST CHAR8 *String);
+UINT8   CalculateCheckSum8 (CONST UINT8 *Buffer, UINTN Length);
+
+UINTN   StrLen (CONST CHAR16 *String);
+UINTN   StrSize (CONST CHAR16 *String);
+INTN    StrCmp (CONST CHAR16 *First, CONST CHAR16 *Second);
+INTN    StrnCmp (CONST CHAR16 *First, CONST CHAR16 *Second, UINTN Length);
+CHAR16  *StrStr (CONST CHAR16 *String, CONST CHAR16 *SearchString);
+RETURN_STATUS StrCpyS (CHAR16 *Destination, UINTN DestMax, CONST CHAR16 *Source);
+CHAR16  CharToUpper (CHAR16 Char);
+
+UINT16  ReadUnaligned16 (CONST UINT16 *Buffer);
+UINT32  ReadUnaligned32 (CONST UINT32 *Buffer);
+UINT32  WriteUnaligned32 (UINT32 *Buffer, UINT32 Value);
+UINT64  WriteUnaligned64 (UINT64 *Buffer, UINT64 Value);
+UINT32  SwapBytes32 (UINT32 Value);
+UINT64  SwapBytes64 (UINT64 Value);
+
+#if defined (MDE_CPU_X64)
+UINT32  AsmCpuid (UINT32 Index, UINT32 *Eax, UINT32 *Ebx, UINT32 *Ecx, UINT32 *Edx);
+UINT32  AsmCpuidEx (UINT32 Index, UINT32 SubIndex, UINT32 *Eax, UINT32 *Ebx, UINT32 *Ecx, UINT32 *Edx);
+#endif
+
+UINT64  LShiftU64 (UINT64 Operand, UINTN Count);
+UINT64  RShiftU64 (UINT64 Operand, UINTN Count);
+UINT64  MultU64x32 (UINT64 Multiplicand, UINT32 Multiplier);
+UINT64  MultU64x64 (UINT64 Multiplicand, UINT64 Multiplier);
+UINT64  DivU64x32 (UINT64 Dividend, UINT32 Divisor);
+UINT64  DivU64x32Remainder (UINT64 Dividend, UINT32 Divisor, UINT32 *Remainder);
+UINT64  DivU64x64Remainder (UINT64 Dividend, UINT64 Divisor, UINT64 *Remainder);
+
+//
+// TimerLib, on CLOCK_MONOTONIC in nanoseconds. HostClockAdvance() moves the
+// clock forward without waiting, so tests can inject slow I/O
+// deterministically.
+//
+UINT64  GetPerformanceCounter (VOID);
+UINT64  GetPerformanceCounterProperties (UINT64 *StartValue, UINT64 *EndValue);
+UINT64  GetTimeInNanoSecond (UINT64 Ticks);
+VOID    HostClockAdvance (UINT64 Ns);
+
+//
+// AcpiDebugPrint() prints to stderr up to this level, and SelectivePrint()
+// to stdout at any level above 0; 0 keeps both quiet
+//
+extern UINTN  gHostDebugLevel;
+
+//
+// Pool buffers allocated and not yet freed
+//
+extern UINTN  gHostLivePools;
+
+#endif // __HOST_UEFI_H__
@@ -0,0 +1,38 @@
+/** @file
+
+  The ACPI definitions AcpiRules.c needs, for host builds.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_ACPI_H__
+#define __HOST_ACPI_H__
+
+#pragma pack(1)
+
+typedef struct {
+  UINT32  Signature;
+  UINT32  Length;
+  UINT8   Revision;
+  UINT8   Checksum;
+  UINT8   OemId[6];
+  UINT64  OemTableId;
+  UINT32  OemRevision;
+  UINT32  CreatorId;
+  UINT32  CreatorRevision;
+} EFI_ACPI_DESCRIPTION_HEADER;
+
+#pragma pack()
+
+#define EFI_ACPI_XSDT_SIGNATURE   SIGNATURE_32 ('X', 'S', 'D', 'T')
+#define EFI_ACPI_FADT_SIGNATURE   SIGNATURE_32 ('F', 'A', 'C', 'P')
+#define EFI_ACPI_DSDT_SIGNATURE   SIGNATURE_32 ('D', 'S', 'D', 'T')
+#define EFI_ACPI_SSDT_SIGNATURE   SIGNATURE_32 ('S', 'S', 'D', 'T')
+
+#endif // __HOST_ACPI_H__
@@ -0,0 +1,7 @@
+/** @file
+
+  Host stand-in for <Protocol/DiskIo.h>; everything is declared in HostUefi.h.
+
+**/
+
+#include <HostUefi.h>
@@ -0,0 +1,683 @@
+/** @file
+
+  Host benchmark of the I/O latency record and replay in
+  ACPIPatcher/AcpiIoSim.c.
+
+  Tables are served by a mock ACPI folder whose driver charges latency on
+  the TimerLib clock as an ACPI_IO_PROFILE describes: a fixed cost per
+  open, per directory entry and per request (a request above MaxTransfer
+  bytes is split and pays it once per piece), plus a cost per KB moved.
+  For each machine model the benchmark
+
+    - records a profile from the slow folder with AcpiIoSimRecord() and
+      checks it against the model;
+    - loads the tables from the slow folder, and from a free folder
+      wrapped with AcpiIoSimWrap() under the model itself, once per read
+      strategy, and checks that the replay makes the same driver calls and
+      adds exactly the latency the slow folder charged;
+    - loads them again under the recorded profile and prints both timings,
+      which have to agree within TEST_REPLAY_PERCENT.
+
+  Nothing sleeps: the replay's Stall() and the mock driver both advance
+  the clock.
+
+  Usage:
+    IoSimTest [-v]
+
+  Exit status is 0 when every check passes and 1 when any fails.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <HostUefi.h>
+
+#include "AcpiIoSim.h"
+#include "AcpiPerf.h"
+#include "AcpiLog.h"
+#include "AcpiSource.h"
+
+#define TEST_MAX_TABLES       16
+#define TEST_INFO_SIZE        (SIZE_OF_EFI_FILE_INFO + ACPI_FILE_NAME_LENGTH * sizeof(CHAR16))
+#define TEST_REPLAY_PERCENT   10      ///< Replay of the recorded profile against the machine
+#define TEST_RECORD_PERCENT   10      ///< Recorded per-KB cost against the model
+
+//
+// Table file in the mock folder
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  Protocol;
+  CONST CHAR16       *Name;
+  UINT8              *Data;
+  UINT64             Size;
+  UINT64             Position;
+} MOCK_FILE;
+
+//
+// Mock ACPI folder; its driver costs follow Machine
+//
+typedef struct {
+  EFI_FILE_PROTOCOL  Protocol;
+  MOCK_FILE          Files[TEST_MAX_TABLES];
+  UINTN              Count;
+  UINTN              Listed;        ///< Next directory entry
+  ACPI_IO_PROFILE    Machine;
+  ACPI_IO_SIM_STATS  Charged;       ///< Driver calls made and latency charged
+} MOCK_FOLDER;
+
+//
+// Table of the mock folders
+//
+typedef struct {
+  CONST CHAR16  *Name;
+  UINT32        Signature;
+  UINT32        Size;
+} TEST_TABLE;
+
+STATIC CONST TEST_TABLE  mTables[] = {
+  { L"DSDT.aml",        SIGNATURE_32('D', 'S', 'D', 'T'), 64 * SIZE_1KB },
+  { L"SSDT-CPU.aml",    SIGNATURE_32('S', 'S', 'D', 'T'), 2 * SIZE_1KB  },
+  { L"SSDT-EC.aml",     SIGNATURE_32('S', 'S', 'D', 'T'), 1 * SIZE_1KB  },
+  { L"SSDT-GPU.aml",    SIGNATURE_32('S', 'S', 'D', 'T'), 12 * SIZE_1KB },
+  { L"SSDT-PLUG.aml",   SIGNATURE_32('S', 'S', 'D', 'T'), 512           },
+  { L"SSDT-USB.aml",    SIGNATURE_32('S', 'S', 'D', 'T'), 6 * SIZE_1KB  },
+  { L"SSDT-XOSI.aml",   SIGNATURE_32('S', 'S', 'D', 'T'), 3 * SIZE_1KB  },
+  { L"SSDT-NVME.aml",   SIGNATURE_32('S', 'S', 'D', 'T'), 20 * SIZE_1KB }
+};
+
+STATIC CONST char  *mStrategyNames[] = { "whole", "header", "chunked" };
+
+STATIC MOCK_FOLDER  mSlow;
+STATIC MOCK_FOLDER  mFree;
+STATIC UINT32       mFailures;
+STATIC UINT32       mChecks;
+
+#define TEST_CHECK(Cond, ...)                               \
+  do {                                                      \
+    mChecks++;                                              \
+    if (!(Cond)) {                                          \
+      mFailures++;                                          \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);           \
+      printf(__VA_ARGS__);                                  \
+      printf("\n");                                         \
+    }                                                       \
+  } while (0)
+
+#define MOCK_FILE_FROM_PROTOCOL(a)    BASE_CR (a, MOCK_FILE, Protocol)
+#define MOCK_FOLDER_FROM_PROTOCOL(a)  BASE_CR (a, MOCK_FOLDER, Protocol)
+
+//
+// AcpiLog.c publishes its ring through boot services, which the replay
+// does not need
+//
+
+VOID
+AcpiLogRecord (
+  IN UINT8   Level,
+  IN UINT16  MessageId,
+  IN UINT8   ArgCount,
+  IN UINT64  Arg0,
+  IN UINT64  Arg1,
+  IN UINT64  Arg2,
+  IN UINT64  Arg3
+  )
+{
+}
+
+UINT64
+AcpiLogPackName (
+  IN CONST CHAR16  *Name
+  )
+{
+  return 0;
+}
+
+//
+// Mock folder
+//
+
+/**
+  Charges Ns of driver latency.
+**/
+STATIC
+VOID
+MockCharge (
+  IN OUT MOCK_FOLDER  *Folder,
+  IN     UINT64       Ns
+  )
+{
+  Folder->Charged.DelayNs += Ns;
+  HostClockAdvance(Ns);
+}
+
+STATIC
+MOCK_FOLDER *
+MockFolderOf (
+  IN MOCK_FILE  *File
+  )
+{
+  return (File >= mSlow.Files && File < mSlow.Files + TEST_MAX_TABLES) ? &mSlow : &mFree;
+}
+
+STATIC
+EFI_STATUS
+MockInfo (
+  IN     CONST CHAR16  *Name,
+  IN     UINT64        Size,
+  IN     UINT64        Attribute,
+  IN OUT UINTN         *BufferSize,
+  OUT    VOID          *Buffer
+  )
+{
+  EFI_FILE_INFO  *Info;
+  UINTN          InfoSize;
+
+  InfoSize = SIZE_OF_EFI_FILE_INFO + StrSize(Name);
+  if (*BufferSize < InfoSize) {
+    *BufferSize = InfoSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  Info = Buffer;
+  memset(Info, 0, SIZE_OF_EFI_FILE_INFO);
+  Info->Size         = InfoSize;
+  Info->FileSize     = Size;
+  Info->PhysicalSize = Size;
+  Info->Attribute    = Attribute;
+  memcpy(Info->FileName, Name, StrSize(Name));
+  *BufferSize = InfoSize;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Reads file data, charging the fixed cost once per MaxTransfer piece and
+  the per-KB cost on the bytes moved.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  MOCK_FILE    *File;
+  MOCK_FOLDER  *Folder;
+  UINTN        Size;
+  UINT64       Pieces;
+
+  File   = MOCK_FILE_FROM_PROTOCOL(This);
+  Folder = MockFolderOf(File);
+  Size   = (UINTN)MIN((UINT64)*BufferSize, File->Size - File->Position);
+  memcpy(Buffer, File->Data + File->Position, Size);
+  File->Position += Size;
+  *BufferSize     = Size;
+
+  Pieces = 1;
+  if (Folder->Machine.MaxTransfer != 0 && Size > Folder->Machine.MaxTransfer) {
+    Pieces = (Size + Folder->Machine.MaxTransfer - 1) / Folder->Machine.MaxTransfer;
+  }
+  Folder->Charged.Reads += (UINT32)Pieces;
+  MockCharge(Folder, Pieces * Folder->Machine.ReadCallUs * 1000 + (UINT64)Size * Folder->Machine.NsPerKb / 1024);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileGetPosition (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT UINT64             *Position
+  )
+{
+  *Position = MOCK_FILE_FROM_PROTOCOL(This)->Position;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileSetPosition (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN UINT64             Position
+  )
+{
+  MOCK_FILE  *File;
+
+  File = MOCK_FILE_FROM_PROTOCOL(This);
+  if (Position > File->Size) {
+    return EFI_UNSUPPORTED;
+  }
+  File->Position = Position;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFileGetInfo (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN     EFI_GUID           *InformationType,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  MOCK_FILE  *File;
+
+  File = MOCK_FILE_FROM_PROTOCOL(This);
+  return MockInfo(File->Name, File->Size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFolderOpen (
+  IN  EFI_FILE_PROTOCOL  *This,
+  OUT EFI_FILE_PROTOCOL  **NewHandle,
+  IN  CHAR16             *FileName,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  MOCK_FOLDER  *Folder;
+  UINTN        Index;
+
+  Folder = MOCK_FOLDER_FROM_PROTOCOL(This);
+  Folder->Charged.Opens++;
+  MockCharge(Folder, (UINT64)Folder->Machine.OpenUs * 1000);
+  for (Index = 0; Index < Folder->Count; Index++) {
+    if (StrCmp(FileName, Folder->Files[Index].Name) == 0) {
+      Folder->Files[Index].Position = 0;
+      *NewHandle = &Folder->Files[Index].Protocol;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Returns the next directory entry, or no data at the end of the listing,
+  charging one directory entry either way.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+MockFolderRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  MOCK_FOLDER  *Folder;
+  MOCK_FILE    *File;
+  EFI_STATUS   Status;
+
+  Folder = MOCK_FOLDER_FROM_PROTOCOL(This);
+  Folder->Charged.DirReads++;
+  MockCharge(Folder, (UINT64)Folder->Machine.DirEntryUs * 1000);
+  if (Folder->Listed == Folder->Count) {
+    *BufferSize = 0;
+    return EFI_SUCCESS;
+  }
+  File   = &Folder->Files[Folder->Listed];
+  Status = MockInfo(File->Name, File->Size, EFI_FILE_READ_ONLY, BufferSize, Buffer);
+  if (!EFI_ERROR(Status)) {
+    Folder->Listed++;
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFolderSetPosition (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN UINT64             Position
+  )
+{
+  if (Position != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  MOCK_FOLDER_FROM_PROTOCOL(This)->Listed = 0;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+MockFolderGetInfo (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN     EFI_GUID           *InformationType,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  return MockInfo(L"ACPI", 0, EFI_FILE_DIRECTORY, BufferSize, Buffer);
+}
+
+/**
+  Fills a mock folder with mTables; every table has a valid header.
+**/
+STATIC
+VOID
+MockFolderInit (
+  OUT MOCK_FOLDER            *Folder,
+  IN  CONST ACPI_IO_PROFILE  *Machine
+  )
+{
+  EFI_ACPI_SDT_HEADER  *Header;
+  MOCK_FILE            *File;
+  UINTN                Index;
+  UINTN                Byte;
+
+  memset(Folder, 0, sizeof(*Folder));
+  Folder->Protocol.Revision    = EFI_FILE_PROTOCOL_REVISION;
+  Folder->Protocol.Open        = MockFolderOpen;
+  Folder->Protocol.Close       = MockClose;
+  Folder->Protocol.Read        = MockFolderRead;
+  Folder->Protocol.SetPosition = MockFolderSetPosition;
+  Folder->Protocol.GetInfo     = MockFolderGetInfo;
+  Folder->Machine              = *Machine;
+  Folder->Count                = ARRAY_SIZE(mTables);
+  for (Index = 0; Index < Folder->Count; Index++) {
+    File = &Folder->Files[Index];
+    File->Protocol.Revision    = EFI_FILE_PROTOCOL_REVISION;
+    File->Protocol.Close       = MockClose;
+    File->Protocol.Read        = MockFileRead;
+    File->Protocol.GetPosition = MockFileGetPosition;
+    File->Protocol.SetPosition = MockFileSetPosition;
+    File->Protocol.GetInfo     = MockFileGetInfo;
+    File->Name                 = mTables[Index].Name;
+    File->Size                 = mTables[Index].Size;
+    File->Data                 = malloc(mTables[Index].Size);
+    for (Byte = sizeof(*Header); Byte < mTables[Index].Size; Byte++) {
+      File->Data[Byte] = (UINT8)(Byte * 7 + Index);
+    }
+    Header = (EFI_ACPI_SDT_HEADER *)File->Data;
+    memset(Header, 0, sizeof(*Header));
+    Header->Signature = mTables[Index].Signature;
+    Header->Length    = mTables[Index].Size;
+  }
+}
+
+STATIC
+VOID
+MockFolderRelease (
+  IN OUT MOCK_FOLDER  *Folder
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Folder->Count; Index++) {
+    free(Folder->Files[Index].Data);
+  }
+}
+
+//
+// Loading
+//
+
+/**
+  Reads an open table file with a read strategy, as AcpiSourceRead() does.
+**/
+STATIC
+EFI_STATUS
+TestReadFile (
+  IN  EFI_FILE_PROTOCOL   *File,
+  IN  UINTN               Size,
+  IN  ACPI_READ_STRATEGY  Strategy,
+  OUT UINT8               *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Offset;
+  UINTN       Length;
+
+  Status = EFI_SUCCESS;
+  Offset = 0;
+  if (Strategy == AcpiReadHeaderFirst) {
+    Length = sizeof(EFI_ACPI_SDT_HEADER);
+    Status = File->Read(File, &Length, Buffer);
+    if (!EFI_ERROR(Status) && ((EFI_ACPI_SDT_HEADER *)Buffer)->Length != Size) {
+      Status = EFI_LOAD_ERROR;
+    }
+    Offset = Length;
+  }
+  while (!EFI_ERROR(Status) && Offset < Size) {
+    Length = Size - Offset;
+    if (Strategy == AcpiReadChunked) {
+      Length = MIN(Length, ACPI_READ_CHUNK_SIZE);
+    }
+    Status = File->Read(File, &Length, Buffer + Offset);
+    if (!EFI_ERROR(Status) && Length == 0) {
+      Status = EFI_END_OF_FILE;
+    }
+    Offset += Length;
+  }
+  return Status;
+}
+
+/**
+  Lists the folder and reads every table in it, as a patch run does.
+
+  @return Nanoseconds on the TimerLib clock
+**/
+STATIC
+UINT64
+TestLoad (
+  IN CONST char          *Title,
+  IN EFI_FILE_PROTOCOL   *Directory,
+  IN ACPI_READ_STRATEGY  Strategy
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  EFI_FILE_INFO      *Info;
+  UINT8              *Buffer;
+  UINTN              InfoSize;
+  UINTN              Loaded;
+  UINT64             Start;
+
+  Info   = malloc(TEST_INFO_SIZE);
+  Buffer = malloc(SIZE_1MB);
+  Loaded = 0;
+  Start  = AcpiPerfNow();
+
+  Status = Directory->SetPosition(Directory, 0);
+  while (!EFI_ERROR(Status)) {
+    InfoSize = TEST_INFO_SIZE;
+    Status   = Directory->Read(Directory, &InfoSize, Info);
+    if (EFI_ERROR(Status) || InfoSize == 0) {
+      break;
+    }
+    Status = Directory->Open(Directory, &File, Info->FileName, EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR(Status)) {
+      break;
+    }
+    Status = TestReadFile(File, (UINTN)Info->FileSize, Strategy, Buffer);
+    TEST_CHECK(!EFI_ERROR(Status) && ((EFI_ACPI_SDT_HEADER *)Buffer)->Length == Info->FileSize,
+               "%s: %s read failed", Title, mStrategyNames[Strategy]);
+    File->Close(File);
+    Loaded++;
+  }
+
+  TEST_CHECK(!EFI_ERROR(Status) && Loaded == ARRAY_SIZE(mTables), "%s: %s loaded %u of %u tables",
+             Title, mStrategyNames[Strategy], (unsigned)Loaded, (unsigned)ARRAY_SIZE(mTables));
+  free(Buffer);
+  free(Info);
+  return AcpiPerfElapsedNs(Start);
+}
+
+/**
+  Loads the tables from the free folder replaying gAcpiIoProfile.
+
+  @return Nanoseconds on the TimerLib clock
+**/
+STATIC
+UINT64
+TestReplay (
+  IN CONST char          *Title,
+  IN ACPI_READ_STRATEGY  Strategy
+  )
+{
+  EFI_FILE_PROTOCOL  *Wrapped;
+  UINT64             Ns;
+
+  ZeroMem(&gAcpiIoSimStats, sizeof(gAcpiIoSimStats));
+  if (EFI_ERROR(AcpiIoSimWrap(&mFree.Protocol, &Wrapped))) {
+    TEST_CHECK(FALSE, "%s: folder not wrapped", Title);
+    return 0;
+  }
+  Ns = TestLoad(Title, Wrapped, Strategy);
+  Wrapped->Close(Wrapped);
+  return Ns;
+}
+
+//
+// Scenarios
+//
+
+STATIC
+BOOLEAN
+TestNear (
+  IN UINT64  Value,
+  IN UINT64  Expected,
+  IN UINT32  Percent,
+  IN UINT64  Slack
+  )
+{
+  UINT64  Limit;
+
+  Limit = Expected * Percent / 100 + Slack;
+  return (BOOLEAN)(Value + Limit >= Expected && Value <= Expected + Limit);
+}
+
+STATIC
+VOID
+TestParse (
+  VOID
+  )
+{
+  STATIC CONST CHAR16  *Refused[] = {
+    L"", L"1,2,3,4", L"1,2,3,4,5,6", L"1,,3,4,5", L"1,2,3,4,x", L"4294967296,2,3,4,5", L"1,2,3,4,5,"
+  };
+  ACPI_IO_PROFILE  Profile;
+  UINTN            Index;
+
+  TEST_CHECK(!EFI_ERROR(AcpiIoSimParse(L"400,150,30000,16384,20", &Profile)) && Profile.Enabled &&
+             Profile.OpenUs == 400 && Profile.ReadCallUs == 150 && Profile.NsPerKb == 30000 &&
+             Profile.MaxTransfer == 16384 && Profile.DirEntryUs == 20, "profile not parsed");
+  for (Index = 0; Index < ARRAY_SIZE(Refused); Index++) {
+    TEST_CHECK(AcpiIoSimParse(Refused[Index], &Profile) == EFI_INVALID_PARAMETER, "profile %u not refused",
+               (unsigned)Index);
+  }
+}
+
+/**
+  Records, checks and replays one machine model.
+**/
+STATIC
+VOID
+TestMachine (
+  IN CONST char             *Title,
+  IN CONST ACPI_IO_PROFILE  *Machine
+  )
+{
+  STATIC CONST ACPI_IO_PROFILE  Free = { FALSE };
+  ACPI_IO_PROFILE               Recorded;
+  ACPI_READ_STRATEGY            Strategy;
+  UINT64                        MachineNs;
+  UINT64                        ReplayNs;
+
+  MockFolderInit(&mSlow, Machine);
+  MockFolderInit(&mFree, &Free);
+
+  TEST_CHECK(!EFI_ERROR(AcpiIoSimRecord(&mSlow.Protocol, &Recorded)), "%s: profile not recorded", Title);
+  printf("%s: recorded --latency %u,%u,%u,%u,%u\n", Title, Recorded.OpenUs, Recorded.ReadCallUs,
+         Recorded.NsPerKb, Recorded.MaxTransfer, Recorded.DirEntryUs);
+  TEST_CHECK(TestNear(Recorded.OpenUs, Machine->OpenUs, 2, 1), "%s: open %u us, model %u", Title,
+             Recorded.OpenUs, Machine->OpenUs);
+  TEST_CHECK(TestNear(Recorded.ReadCallUs, Machine->ReadCallUs, 2, 1), "%s: read request %u us, model %u", Title,
+             Recorded.ReadCallUs, Machine->ReadCallUs);
+  TEST_CHECK(TestNear(Recorded.NsPerKb, Machine->NsPerKb, TEST_RECORD_PERCENT, 0), "%s: %u ns/KB, model %u", Title,
+             Recorded.NsPerKb, Machine->NsPerKb);
+  TEST_CHECK(Recorded.MaxTransfer == Machine->MaxTransfer, "%s: max transfer %u, model %u", Title,
+             Recorded.MaxTransfer, Machine->MaxTransfer);
+  TEST_CHECK(TestNear(Recorded.DirEntryUs, Machine->DirEntryUs, 2, 1), "%s: directory entry %u us, model %u", Title,
+             Recorded.DirEntryUs, Machine->DirEntryUs);
+
+  printf("  %-10s %12s %12s %8s\n", "Strategy", "machine ms", "replay ms", "error");
+  for (Strategy = AcpiReadWhole; Strategy <= AcpiReadChunked; Strategy++) {
+    // The model itself: the replay has to make the machine's calls and charge its latency
+    ZeroMem(&mSlow.Charged, sizeof(mSlow.Charged));
+    MachineNs      = TestLoad(Title, &mSlow.Protocol, Strategy);
+    gAcpiIoProfile = *Machine;
+    TestReplay(Title, Strategy);
+    TEST_CHECK(gAcpiIoSimStats.Opens == mSlow.Charged.Opens && gAcpiIoSimStats.Reads == mSlow.Charged.Reads &&
+               gAcpiIoSimStats.DirReads == mSlow.Charged.DirReads,
+               "%s: %s replay made %u/%u/%u opens/reads/entries, machine %u/%u/%u", Title, mStrategyNames[Strategy],
+               gAcpiIoSimStats.Opens, gAcpiIoSimStats.Reads, gAcpiIoSimStats.DirReads,
+               mSlow.Charged.Opens, mSlow.Charged.Reads, mSlow.Charged.DirReads);
+    TEST_CHECK(gAcpiIoSimStats.DelayNs == mSlow.Charged.DelayNs, "%s: %s replay added %llu ns, machine charged %llu",
+               Title, mStrategyNames[Strategy], (unsigned long long)gAcpiIoSimStats.DelayNs,
+               (unsigned long long)mSlow.Charged.DelayNs);
+
+    // The recorded profile, as a user would replay it
+    gAcpiIoProfile = Recorded;
+    ReplayNs       = TestReplay(Title, Strategy);
+    TEST_CHECK(TestNear(ReplayNs, MachineNs, TEST_REPLAY_PERCENT, 0), "%s: %s replay off by more than %u%%",
+               Title, mStrategyNames[Strategy], TEST_REPLAY_PERCENT);
+    printf("  %-10s %12.3f %12.3f %+7.1f%%\n", mStrategyNames[Strategy], MachineNs / 1e6, ReplayNs / 1e6,
+           MachineNs != 0 ? ((double)ReplayNs - (double)MachineNs) * 100.0 / MachineNs : 0.0);
+  }
+
+  MockFolderRelease(&mSlow);
+  MockFolderRelease(&mFree);
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  //
+  // OpenUs, ReadCallUs, NsPerKb, MaxTransfer, DirEntryUs
+  //
+  STATIC CONST ACPI_IO_PROFILE  UsbStick = { TRUE, 400, 150, 30000, SIZE_16KB, 20 };
+  STATIC CONST ACPI_IO_PROFILE  SataSsd  = { TRUE, 60, 25, 2000, 0, 4 };
+
+  if (argc == 2 && strcmp(argv[1], "-v") == 0) {
+    gHostDebugLevel = DEBUG_INFO;
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: IoSimTest [-v]\n");
+    return 1;
+  }
+
+  TestParse();
+  TestMachine("USB 2.0 stick, 16 KB transfers", &UsbStick);
+  TestMachine("SATA SSD", &SataSsd);
+
+  TEST_CHECK(gHostLivePools == 0, "%zu pool buffers left", (size_t)gHostLivePools);
+  printf("%u checks, %u failed\n", mChecks, mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#!/bin/sh
+## @file
+#  Builds the FAT images FatReaderTest checks, with mkfs.vfat and mtools.
+#
+#  OutDir/Files is the tree every image holds: an ACPI folder with long and
+#  lowercase short names, an empty file, a directory spanning several
+#  clusters, Optional and P-XXXXXXXX subdirectories, and random contents.
+#  Each image gets a hole freed in front of the ACPI folder first, so the
+#  first tables copied are fragmented and the reader has to follow the chain
+#  across runs.
+#
+#  Usage: MakeFatImages.sh [OutDir]     (default FatImages)
+#
+#  This program and the accompanying materials
+#  are licensed and made available under the terms and conditions of the BSD License
+#  which accompanies this distribution. The full text of the license may be found at
+#  http://opensource.org/licenses/bsd-license.php
+#  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+##
+
+set -e
+
+Out=${1:-FatImages}
+Files=$Out/Files
+
+for Tool in mkfs.vfat mcopy mmd mdel; do
+  command -v $Tool >/dev/null || { echo "MakeFatImages: $Tool not found (dosfstools, mtools)" >&2; exit 2; }
+done
+
+export MTOOLS_SKIP_CHECK=1
+
+rm -rf "$Out"
+mkdir -p "$Files/ACPI/Optional" "$Files/ACPI/P-1A2B3C4D" "$Files/ACPI/Many"
+
+Random () {
+  head -c "$2" /dev/urandom > "$1"
+}
+
+Random "$Files/ACPI/DSDT.aml"                          180001
+Random "$Files/ACPI/SSDT-CPU-Power-Management.aml"       9000
+Random "$Files/ACPI/ssdt-ec.aml"                         1500
+Random "$Files/ACPI/SSDT-2K.aml"                         2048
+Random "$Files/ACPI/SSDT-4K.aml"                         4096
+: >    "$Files/ACPI/Empty.aml"
+Random "$Files/ACPI/Optional/SSDT-USB-Ports.aml"        20000
+Random "$Files/ACPI/P-1A2B3C4D/DSDT.aml"                70000
+Random "$Files/Fill-A.bin"                              10000
+Random "$Files/Fill-C.bin"                              10000
+Index=0
+while [ $Index -lt 40 ]; do
+  Random "$Files/ACPI/Many/SSDT-Generated-Table-$Index.aml" $((Index * 97 + 36))
+  Index=$((Index + 1))
+done
+( cd "$Files/ACPI" && sha256sum DSDT.aml SSDT-*.aml > Manifest.sha256 )
+
+#
+# MakeImage Name SizeKB mkfs.vfat-options...
+#
+MakeImage () {
+  Image=$Out/$1
+  Size=$2
+  shift 2
+  mkfs.vfat -C "$@" -n ACPITEST "$Image" $Size >/dev/null
+  Random "$Out/Fill-B.bin" 6000
+  mcopy -i "$Image" "$Files/Fill-A.bin" "$Out/Fill-B.bin" "$Files/Fill-C.bin" ::/
+  mdel  -i "$Image" ::/Fill-B.bin
+  mmd   -i "$Image" ::/ACPI
+  mcopy -i "$Image" "$Files/ACPI/DSDT.aml" ::/ACPI/
+  for Entry in "$Files/ACPI"/*; do
+    [ "$Entry" = "$Files/ACPI/DSDT.aml" ] || mcopy -s -i "$Image" "$Entry" ::/ACPI/
+  done
+  rm -f "$Out/Fill-B.bin"
+  echo "$Image"
+}
+
+MakeImage fat12.img     1440    -F 12
+MakeImage fat16.img     32768   -F 16 -s 4
+MakeImage fat32.img     65536   -F 32 -s 1
+MakeImage fat16-4k.img  65536   -F 16 -S 4096 -s 1
@@ -0,0 +1,278 @@
+/** @file
+
+  Host test of ACPIPatcher/AcpiSha256.c.
+
+  Every block function the build and CPU provide is selected in turn and
+  checked against the FIPS 180-2 test vectors, against the portable one
+  for every message length up to a few blocks, and for the same digest
+  whether a message is hashed at once or in uneven pieces. Each one is
+  then timed hashing 1 MB, as the --benchmark SHA-256 rows do.
+
+  The accelerated block function is assembled from X64/AcpiSha256Ni.nasm
+  when the host is x86-64 and has nasm; otherwise only the portable one is
+  tested.
+
+  Usage:
+    Sha256Test [-v]
+
+  Exit status is 0 when every check passes and 1 when any fails.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <HostUefi.h>
+
+#include "AcpiSha256.h"
+
+#define TEST_SWEEP_LENGTH   (4 * ACPI_SHA256_BLOCK_SIZE + 1)
+#define TEST_TIMED_SIZE     SIZE_1MB
+#define TEST_TIMED_ROUNDS   16
+
+//
+// FIPS 180-2 vector; a Text of NULL stands for a million 'a'
+//
+typedef struct {
+  CONST char  *Name;
+  CONST char  *Text;
+  CONST char  *Digest;
+} TEST_VECTOR;
+
+STATIC CONST TEST_VECTOR  mVectors[] = {
+  { "empty",      "",    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+  { "abc",        "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+  { "448 bit",    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+  { "896 bit",    "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+                  "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+                         "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+  { "million a",  NULL,  "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }
+};
+
+//
+// Pieces a message is fed to AcpiSha256Update() in, cycled
+//
+STATIC CONST UINTN  mPieces[] = { 1, 63, 64, 65, 7, 128, 3 };
+
+STATIC UINT8    mSweepDigests[TEST_SWEEP_LENGTH + 1][ACPI_SHA256_DIGEST_SIZE];
+STATIC UINT32   mFailures;
+STATIC UINT32   mChecks;
+STATIC BOOLEAN  mVerbose;
+
+#define TEST_CHECK(Cond, ...)                               \
+  do {                                                      \
+    mChecks++;                                              \
+    if (!(Cond)) {                                          \
+      mFailures++;                                          \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);           \
+      printf(__VA_ARGS__);                                  \
+      printf("\n");                                         \
+    }                                                       \
+  } while (0)
+
+STATIC
+VOID
+TestToChar8 (
+  IN  CONST CHAR16  *Wide,
+  OUT char          *Name,
+  IN  UINTN         Count
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Wide[Index] != 0 && Index < Count - 1; Index++) {
+    Name[Index] = (Wide[Index] < 0x80) ? (char)Wide[Index] : '?';
+  }
+  Name[Index] = 0;
+}
+
+STATIC
+VOID
+TestToHex (
+  IN  CONST UINT8  *Digest,
+  OUT char         *Hex
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ACPI_SHA256_DIGEST_SIZE; Index++) {
+    sprintf(Hex + Index * 2, "%02x", Digest[Index]);
+  }
+}
+
+/**
+  Hashes Data in the uneven pieces of mPieces.
+**/
+STATIC
+VOID
+TestHashPieces (
+  IN  CONST UINT8  *Data,
+  IN  UINTN        Size,
+  OUT UINT8        *Digest
+  )
+{
+  ACPI_SHA256_CONTEXT  Context;
+  UINTN                Piece;
+  UINTN                Take;
+
+  AcpiSha256Init(&Context);
+  for (Piece = 0; Size > 0; Piece++) {
+    Take = MIN(Size, mPieces[Piece % ARRAY_SIZE(mPieces)]);
+    AcpiSha256Update(&Context, Data, Take);
+    Data += Take;
+    Size -= Take;
+  }
+  AcpiSha256Final(&Context, Digest);
+}
+
+/**
+  Checks the block function in use against the FIPS 180-2 vectors.
+**/
+STATIC
+VOID
+TestVectors (
+  IN CONST char  *Impl,
+  IN UINT8       *Million
+  )
+{
+  CONST TEST_VECTOR  *Vector;
+  CONST UINT8        *Data;
+  UINTN              Size;
+  UINTN              Index;
+  UINT8              Digest[ACPI_SHA256_DIGEST_SIZE];
+  char               Hex[ACPI_SHA256_DIGEST_SIZE * 2 + 1];
+
+  for (Index = 0; Index < ARRAY_SIZE(mVectors); Index++) {
+    Vector = &mVectors[Index];
+    Data   = (Vector->Text != NULL) ? (CONST UINT8 *)Vector->Text : Million;
+    Size   = (Vector->Text != NULL) ? strlen(Vector->Text) : 1000000;
+
+    AcpiSha256(Data, Size, Digest);
+    TestToHex(Digest, Hex);
+    TEST_CHECK(strcmp(Hex, Vector->Digest) == 0, "%s: %s hashed to %s", Impl, Vector->Name, Hex);
+
+    TestHashPieces(Data, Size, Digest);
+    TestToHex(Digest, Hex);
+    TEST_CHECK(strcmp(Hex, Vector->Digest) == 0, "%s: %s hashed in pieces to %s", Impl, Vector->Name, Hex);
+  }
+}
+
+/**
+  Hashes every prefix of Data up to TEST_SWEEP_LENGTH bytes, recording the
+  digests on the first call and comparing with them on later ones.
+**/
+STATIC
+VOID
+TestSweep (
+  IN CONST char   *Impl,
+  IN CONST UINT8  *Data,
+  IN BOOLEAN      Record
+  )
+{
+  UINT8  Digest[ACPI_SHA256_DIGEST_SIZE];
+  UINT8  Pieces[ACPI_SHA256_DIGEST_SIZE];
+  UINTN  Length;
+
+  for (Length = 0; Length <= TEST_SWEEP_LENGTH; Length++) {
+    AcpiSha256(Data, Length, Digest);
+    TestHashPieces(Data, Length, Pieces);
+    TEST_CHECK(memcmp(Digest, Pieces, sizeof(Digest)) == 0, "%s: %zu bytes hash differently in pieces",
+               Impl, (size_t)Length);
+    if (Record) {
+      memcpy(mSweepDigests[Length], Digest, sizeof(Digest));
+    } else {
+      TEST_CHECK(memcmp(Digest, mSweepDigests[Length], sizeof(Digest)) == 0, "%s: %zu bytes differ from portable",
+                 Impl, (size_t)Length);
+    }
+  }
+}
+
+/**
+  Times hashing TEST_TIMED_SIZE bytes and prints the best round.
+**/
+STATIC
+VOID
+TestTime (
+  IN CONST char   *Impl,
+  IN CONST UINT8  *Data
+  )
+{
+  UINT8   Digest[ACPI_SHA256_DIGEST_SIZE];
+  UINT64  Start;
+  UINT64  Ns;
+  UINT64  Best;
+  UINTN   Round;
+
+  Best = MAX_UINT64;
+  for (Round = 0; Round < TEST_TIMED_ROUNDS; Round++) {
+    Start = GetPerformanceCounter();
+    AcpiSha256(Data, TEST_TIMED_SIZE, Digest);
+    Ns   = GetTimeInNanoSecond(GetPerformanceCounter() - Start);
+    Best = MIN(Best, Ns);
+  }
+  printf("  %-10s %9.3f ms per MB %9.2f MB/s\n", Impl, Best / 1e6, Best != 0 ? TEST_TIMED_SIZE * 1e3 / Best : 0.0);
+}
+
+int
+main (
+  int   argc,
+  char  **argv
+  )
+{
+  UINT8             *Data;
+  ACPI_SHA256_IMPL  Impl;
+  UINTN             Index;
+  UINT32            Tested;
+  char              Name[32];
+
+  if (argc == 2 && strcmp(argv[1], "-v") == 0) {
+    mVerbose = TRUE;
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: Sha256Test [-v]\n");
+    return 1;
+  }
+
+  Data = malloc(TEST_TIMED_SIZE);
+  if (Data == NULL) {
+    fprintf(stderr, "Sha256Test: out of memory\n");
+    return 1;
+  }
+
+  Tested = 0;
+  printf("SHA-256, best of %u rounds:\n", TEST_TIMED_ROUNDS);
+  for (Impl = 0; Impl < AcpiSha256ImplMax; Impl++) {
+    TestToChar8(AcpiSha256ImplName(Impl), Name, sizeof(Name));
+    if (EFI_ERROR(AcpiSha256Select(Impl))) {
+      TEST_CHECK(Impl != AcpiSha256Portable, "portable block function not selectable");
+      printf("  %-10s not supported by this CPU or build\n", Name);
+      continue;
+    }
+    TEST_CHECK(AcpiSha256Current() == Impl, "%s: not the block function in use", Name);
+
+    memset(Data, 'a', 1000000);
+    TestVectors(Name, Data);
+
+    for (Index = 0; Index < TEST_TIMED_SIZE; Index++) {
+      Data[Index] = (UINT8)(Index * 31 + (Index >> 8));
+    }
+    TestSweep(Name, Data, (BOOLEAN)(Impl == AcpiSha256Portable));
+    TestTime(Name, Data);
+    Tested++;
+  }
+
+  if (mVerbose) {
+    printf("%u block functions tested\n", Tested);
+  }
+  free(Data);
+  printf("%u checks, %u failed\n", mChecks, mFailures);
+  return (mFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/** @file
+
+  Work-stealing thread pool for index ranges.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "WorkPool.h"
+
+typedef struct WORK_POOL WORK_POOL;
+
+typedef struct {
+  pthread_mutex_t  Lock;      ///< Guards Begin and End
+  UINTN            Begin;     ///< Next index the owner takes
+  UINTN            End;       ///< Thieves take from here downwards
+  UINT64           Steals;
+  pthread_t        Thread;
+  WORK_POOL        *Pool;
+} WORK_POOL_WORKER;
+
+struct WORK_POOL {
+  WORK_POOL_WORKER    *Workers;
+  UINTN               Count;
+  WORK_POOL_FUNCTION  Function;
+  VOID                *Context;
+};
+
+/**
+  Moves the back half of the fullest other slice to Self.
+
+  @param[in,out] Self   Worker whose own slice is empty
+
+  @retval TRUE    Self has work again
+  @retval FALSE   Every slice is empty; since no work is ever added, the worker is done
+**/
+STATIC
+BOOLEAN
+WorkPoolSteal (
+  IN OUT WORK_POOL_WORKER  *Self
+  )
+{
+  WORK_POOL         *Pool;
+  WORK_POOL_WORKER  *Victim;
+  UINTN             Index;
+  UINTN             Best;
+  UINTN             Remaining;
+  UINTN             Middle;
+  UINTN             End;
+
+  Pool = Self->Pool;
+
+  while (TRUE) {
+    // Unlocked sizes are only a hint; the chosen slice is re-checked under its lock
+    Victim = NULL;
+    Best   = 0;
+    for (Index = 0; Index < Pool->Count; Index++) {
+      if (&Pool->Workers[Index] == Self) {
+        continue;
+      }
+      Remaining = __atomic_load_n(&Pool->Workers[Index].End, __ATOMIC_RELAXED) -
+                  __atomic_load_n(&Pool->Workers[Index].Begin, __ATOMIC_RELAXED);
+      if ((INTN)Remaining > (INTN)Best) {
+        Best   = Remaining;
+        Victim = &Pool->Workers[Index];
+      }
+    }
+    if (Victim == NULL) {
+      return FALSE;
+    }
+
+    pthread_mutex_lock(&Victim->Lock);
+    if (Victim->Begin >= Victim->End) {
+      pthread_mutex_unlock(&Victim->Lock);
+      continue;
+    }
+    End         = Victim->End;
+    Middle      = Victim->Begin + (End - Victim->Begin) / 2;
+    Victim->End = Middle;
+    pthread_mutex_unlock(&Victim->Lock);
+
+    pthread_mutex_lock(&Self->Lock);
+    Self->Begin = Middle;
+    Self->End   = End;
+    Self->Steals++;
+    pthread_mutex_unlock(&Self->Lock);
+    return TRUE;
+  }
+}
+
+/**
+  Worker thread: drains its own slice, then steals until no work is left.
+
+  @param[in] Argument   WORK_POOL_WORKER of this thread
+**/
+STATIC
+VOID *
+WorkPoolWorker (
+  IN VOID  *Argument
+  )
+{
+  WORK_POOL_WORKER  *Self;
+  UINTN             Index;
+  BOOLEAN           Taken;
+
+  Self = Argument;
+
+  do {
+    while (TRUE) {
+      pthread_mutex_lock(&Self->Lock);
+      Taken = (BOOLEAN)(Self->Begin < Self->End);
+      Index = Self->Begin;
+      if (Taken) {
+        Self->Begin++;
+      }
+      pthread_mutex_unlock(&Self->Lock);
+
+      if (!Taken) {
+        break;
+      }
+      Self->Pool->Function(Self->Pool->Context, Index);
+    }
+  } while (WorkPoolSteal(Self));
+
+  return NULL;
+}
+
+int
+WorkPoolRun (
+  IN  UINTN               Threads,
+  IN  UINTN               Count,
+  IN  WORK_POOL_FUNCTION  Function,
+  IN  VOID                *Context,
+  OUT WORK_POOL_STATS     *Stats  OPTIONAL
+  )
+{
+  WORK_POOL  Pool;
+  UINTN      Index;
+  UINTN      Started;
+  UINT64     Steals;
+
+  Threads = MAX(1, MIN(Threads, MAX(Count, 1)));
+
+  Pool.Workers = calloc(Threads, sizeof(WORK_POOL_WORKER));
+  if (Pool.Workers == NULL) {
+    return -1;
+  }
+  Pool.Count    = Threads;
+  Pool.Function = Function;
+  Pool.Context  = Context;
+
+  for (Index = 0; Index < Threads; Index++) {
+    pthread_mutex_init(&Pool.Workers[Index].Lock, NULL);
+    Pool.Workers[Index].Begin = Count * Index / Threads;
+    Pool.Workers[Index].End   = Count * (Index + 1) / Threads;
+    Pool.Workers[Index].Pool  = &Pool;
+  }
+
+  // Worker 0 runs on the calling thread
+  for (Started = 1; Started < Threads; Started++) {
+    if (pthread_create(&Pool.Workers[Started].Thread, NULL, WorkPoolWorker, &Pool.Workers[Started]) != 0) {
+      break;
+    }
+  }
+  // Slices of threads that failed to start are stolen by the others
+  WorkPoolWorker(&Pool.Workers[0]);
+
+  Steals = 0;
+  for (Index = 0; Index < Threads; Index++) {
+    if (Index > 0 && Index < Started) {
+      pthread_join(Pool.Workers[Index].Thread, NULL);
+    }
+    Steals += Pool.Workers[Index].Steals;
+    pthread_mutex_destroy(&Pool.Workers[Index].Lock);
+  }
+  free(Pool.Workers);
+
+  if (Stats != NULL) {
+    Stats->Threads = Started;
+    Stats->Steals  = Steals;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+/** @file
+
+  Work-stealing thread pool for index ranges.
+
+  Each worker starts with an equal slice of [0, Count) and takes indices
+  from the front of it. A worker that runs dry takes the back half of the
+  largest remaining slice of another worker, so uneven work items (a dump
+  with hundreds of tables next to one with ten) do not leave cores idle.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution. The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __WORK_POOL_H__
+#define __WORK_POOL_H__
+
+/**
+  Processes one work item. Called concurrently from several threads.
+
+  @param[in] Context    Context passed to WorkPoolRun
+  @param[in] Index      Work item, below the count passed to WorkPoolRun
+**/
+typedef
+VOID
+(*WORK_POOL_FUNCTION) (
+  IN VOID   *Context,
+  IN UINTN  Index
+  );
+
+typedef struct {
+  UINTN   Threads;      ///< Threads actually started
+  UINT64  Steals;       ///< Ranges taken from another worker
+} WORK_POOL_STATS;
+
+/**
+  Calls Function once for every index in [0, Count) on up to Threads
+  threads and returns when all calls have finished.
+
+  @param[in]  Threads     Number of threads, at least 1
+  @param[in]  Count       Number of work items
+  @param[in]  Function    Work function
+  @param[in]  Context     Passed to Function
+  @param[out] Stats       Pool statistics, may be NULL
+
+  @retval 0   All items processed
+  @retval -1  Out of memory; no item was processed
+**/
+int
+WorkPoolRun (
+  IN  UINTN               Threads,
+  IN  UINTN               Count,
+  IN  WORK_POOL_FUNCTION  Function,
+  IN  VOID                *Context,
+  OUT WORK_POOL_STATS     *Stats  OPTIONAL
+  );
+
+#endif // __WORK_POOL_H__